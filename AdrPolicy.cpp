@@ -0,0 +1,232 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::AdrPolicy device side choice of datarate, TX power and redundancy
+ *
+ */
+
+#include "AdrPolicy.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint8_t FRAME_OVERHEAD = 13;          //!< MHDR, FHDR without options, FPort and MIC
+    const double MAX_BIAS = 20.0;               //!< dB
+
+    uint8_t MinAllowed(const AdrLimits& limits, uint8_t size) {
+        for (uint8_t dr = 0; dr < ADR_POLICY_DATARATES; dr++) {
+            if (limits.Allowed(dr) && limits.MaxPayload[dr] >= size) {
+                return dr;
+            }
+        }
+
+        return 0;
+    }
+
+}
+
+AdrLimits::AdrLimits()
+:   Datarates(0),
+    MaxPower(14),
+    MinPower(0),
+    PowerStep(2),
+    MaxRedundancy(1)
+{
+    memset(SpreadingFactor, 0, sizeof(SpreadingFactor));
+    memset(Bandwidth, 0, sizeof(Bandwidth));
+    memset(MaxPayload, 0, sizeof(MaxPayload));
+}
+
+void AdrLimits::Allow(uint8_t datarate, uint8_t spreadingFactor, uint32_t bandwidth, uint8_t maxPayload) {
+    if (datarate >= ADR_POLICY_DATARATES) {
+        return;
+    }
+
+    Datarates |= 1 << datarate;
+    SpreadingFactor[datarate] = spreadingFactor;
+    Bandwidth[datarate] = bandwidth;
+    MaxPayload[datarate] = maxPayload;
+}
+
+bool AdrLimits::Allowed(uint8_t datarate) const {
+    return datarate < ADR_POLICY_DATARATES && (Datarates & (1 << datarate)) != 0;
+}
+
+uint32_t AdrPolicy::TimeOnAir(uint8_t spreadingFactor, uint32_t bandwidth, uint8_t bytes) {
+    double symbol = (double) (1 << spreadingFactor) * 1e6 / bandwidth;
+    int lowDatarate = symbol >= 16000.0 ? 1 : 0;
+    double numerator = 8.0 * bytes - 4.0 * spreadingFactor + 28 + 16;
+    double symbols = 8 + fmax(ceil(numerator / (4.0 * (spreadingFactor - 2 * lowDatarate))) * 5, 0.0);
+
+    return (uint32_t) ((8 + 4.25 + symbols) * symbol);
+}
+
+double AdrPolicy::DemodulationFloor(uint8_t spreadingFactor) {
+    // SX126x datasheet, 2.5 dB per spreading factor from -7.5 dB at SF7
+    return -7.5 - 2.5 * (spreadingFactor - 7);
+}
+
+EnergyAdrPolicyConfig::EnergyAdrPolicyConfig()
+:   TargetDelivery(0.9),
+    Fading(3.0),
+    GatewayPower(14),
+    NoiseFigure(6.0),
+    Step(1.0),
+    MaxRedundancy(3)
+{
+}
+
+EnergyAdrPolicy::EnergyAdrPolicy(const EnergyAdrPolicyConfig& config)
+:   _config(config),
+    _bias(0.0),
+    _predicted(-1.0)
+{
+}
+
+double EnergyAdrPolicy::Success(double margin, double sigma) const {
+    return 0.5 * erfc(-margin / (sigma * M_SQRT2));
+}
+
+double EnergyAdrPolicy::AttemptCharge(uint8_t spreadingFactor, uint32_t bandwidth, uint8_t bytes, int8_t power) const {
+    const EnergyProfile& energy = _config.Energy;
+    double symbol = (double) (1 << spreadingFactor) * 1e6 / bandwidth;
+    uint8_t timeout = spreadingFactor < SF_11 ? HI_DR_SYMBOL_TIMEOUT : LO_DR_SYMBOL_TIMEOUT;
+
+    // RX2 is the same for every choice and is left out
+    return (double) TimeOnAir(spreadingFactor, bandwidth, bytes) * energy.TxCurrentAt(power)
+           + timeout * symbol * energy.Radio[ENERGY_RADIO_RX];
+}
+
+AdrSettings EnergyAdrPolicy::Select(const AdrUplink& uplink, const Statistics& stats, const AdrLimits& limits) {
+    AdrSettings best = { MinAllowed(limits, uplink.Size), limits.MaxPower, 1 };
+
+    _predicted = -1.0;
+
+    if (stats.AvgCount <= 0 || stats.RssiAvg == INVALID_RSSI) {
+        // nothing heard yet, the most robust settings allowed
+        return best;
+    }
+
+    double rssi = stats.RssiAvg;
+    double sigma = _config.Fading;
+    bool downlinkSnr = stats.SnrAvg != INVALID_SNR && stats.SnrMin != INVALID_SNR;
+    double snr = 0.0;
+
+    if (downlinkSnr) {
+        // the minimum of a handful of samples sits about 1.5 sigma under the mean, SNR is in cB
+        sigma = fmax(sigma, (stats.SnrAvg - stats.SnrMin) / 10.0 / 1.5);
+        snr = stats.SnrAvg / 10.0;
+    }
+
+    uint8_t attempts = uplink.Attempts != 0 ? uplink.Attempts : 1;
+    uint8_t redundancy = uplink.Confirmed ? 1 : (limits.MaxRedundancy < _config.MaxRedundancy ? limits.MaxRedundancy : _config.MaxRedundancy);
+    int step = limits.PowerStep != 0 ? limits.PowerStep : 2;
+    double bestCost = 0.0;
+    double bestDelivery = -1.0;
+    double bestSuccess = -1.0;
+    bool feasible = false;
+
+    for (uint8_t dr = 0; dr < ADR_POLICY_DATARATES; dr++) {
+        uint8_t sf = limits.SpreadingFactor[dr];
+        uint32_t bw = limits.Bandwidth[dr];
+
+        if (!limits.Allowed(dr) || limits.MaxPayload[dr] < uplink.Size || sf < SF_6 || sf > SF_12 || bw == 0) {
+            continue;
+        }
+
+        double noise = -174.0 + 10.0 * log10((double) bw) + _config.NoiseFigure;
+
+        for (int power = limits.MaxPower; power >= limits.MinPower; power -= step) {
+            // same path loss both ways
+            double margin = rssi - _config.GatewayPower + power - noise - DemodulationFloor(sf) - _bias;
+            double p = Success(margin, sigma);
+            double attempt = p;
+            double charge = AttemptCharge(sf, bw, uplink.Size + FRAME_OVERHEAD, power);
+
+            if (uplink.Confirmed && downlinkSnr) {
+                // the ACK comes in RX1 with the spreading factor of the uplink and has to be received too
+                attempt *= Success(snr - DemodulationFloor(sf), sigma);
+            }
+
+            if (attempt < 1e-9) {
+                continue;
+            }
+
+            for (uint8_t n = 1; n <= (redundancy != 0 ? redundancy : 1); n++) {
+                double delivery;
+                double cost;
+
+                if (uplink.Confirmed) {
+                    // retries until the ACK, the expected number of attempts is 1/attempt
+                    delivery = 1.0 - pow(1.0 - p, attempts);
+                    cost = charge / attempt;
+                } else {
+                    // every repetition is sent
+                    delivery = 1.0 - pow(1.0 - p, n);
+                    cost = n * charge / delivery;
+                }
+
+                bool better;
+
+                if (delivery >= _config.TargetDelivery) {
+                    better = !feasible || cost < bestCost;
+                    feasible = true;
+                } else {
+                    better = !feasible && (delivery > bestDelivery || (delivery == bestDelivery && cost < bestCost));
+                }
+
+                if (better) {
+                    best.Datarate = dr;
+                    best.Power = power;
+                    best.Redundancy = n;
+                    bestCost = cost;
+                    bestDelivery = delivery;
+                    bestSuccess = attempt;
+                }
+            }
+        }
+    }
+
+    _predicted = bestSuccess;
+    return best;
+}
+
+void EnergyAdrPolicy::Outcome(uint8_t missed, bool acked) {
+    if (_predicted < 0.0) {
+        return;
+    }
+
+    // each attempt moves the bias by the prediction error, so it settles where predictions match outcomes
+    _bias += _config.Step * _predicted * missed;
+
+    if (acked) {
+        _bias -= _config.Step * (1.0 - _predicted);
+    }
+
+    _bias = fmax(-MAX_BIAS, fmin(MAX_BIAS, _bias));
+}
+
+void EnergyAdrPolicy::Reset() {
+    _bias = 0.0;
+    _predicted = -1.0;
+}
+
+double EnergyAdrPolicy::Bias() const {
+    return _bias;
+}
+
+double EnergyAdrPolicy::Predicted() const {
+    return _predicted;
+}
+
+void EnergyAdrPolicy::Log() const {
+    logInfo("adr policy: bias %.1f dB, last prediction %.3f", _bias, _predicted);
+}
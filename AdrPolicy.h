@@ -0,0 +1,165 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::AdrPolicy device side choice of datarate, TX power and redundancy
+ *
+ * @details With ADR off the device picks its own uplink settings.  A policy gets the link
+ *          statistics of the session and the datarates and powers the channel plan allows,
+ *          returns the settings of the next uplink and hears back how many attempts of a
+ *          confirmed uplink went unacknowledged.  EnergyAdrPolicy predicts the uplink margin
+ *          from the downlink RSSI, turns it into a delivery probability and takes the
+ *          settings with the least charge per delivered uplink that still meet a target
+ *          delivery ratio.  A bias learnt from missed ACKs corrects the prediction.
+ *
+ */
+
+#ifndef __LORA_ADR_POLICY_H__
+#define __LORA_ADR_POLICY_H__
+
+#include "Lora.h"
+#include "EnergyMeter.h"
+
+namespace lora {
+
+    const uint8_t ADR_POLICY_DATARATES = 16;
+
+    /**
+     * Uplink about to be sent
+     */
+    struct AdrUplink {
+            uint8_t Size;                       //!< application payload bytes
+            bool Confirmed;
+            uint8_t Attempts;                   //!< transmissions of a confirmed uplink before giving up
+    };
+
+    /**
+     * Settings the channel plan and the network allow
+     */
+    struct AdrLimits {
+            AdrLimits();
+
+            /**
+             * Set the modulation of an uplink datarate and mark it allowed
+             * @param bandwidth Hz
+             * @param maxPayload application payload bytes
+             */
+            void Allow(uint8_t datarate, uint8_t spreadingFactor, uint32_t bandwidth, uint8_t maxPayload = 255);
+
+            bool Allowed(uint8_t datarate) const;
+
+            uint16_t Datarates;                 //!< bit per datarate usable on an enabled channel
+            uint8_t SpreadingFactor[ADR_POLICY_DATARATES];
+            uint32_t Bandwidth[ADR_POLICY_DATARATES];   //!< Hz
+            uint8_t MaxPayload[ADR_POLICY_DATARATES];
+            int8_t MaxPower;                    //!< dBm
+            int8_t MinPower;                    //!< dBm
+            uint8_t PowerStep;                  //!< dB between selectable powers
+            uint8_t MaxRedundancy;              //!< transmissions of an unconfirmed uplink
+    };
+
+    /**
+     * Settings of one uplink
+     */
+    struct AdrSettings {
+            uint8_t Datarate;
+            int8_t Power;                       //!< dBm
+            uint8_t Redundancy;                 //!< transmissions of an unconfirmed uplink, 1 for none
+    };
+
+    class AdrPolicy {
+        public:
+            virtual ~AdrPolicy() {}
+
+            /**
+             * Pick the settings of the next uplink
+             * @param uplink size and kind of the uplink
+             * @param stats session statistics, RSSI and SNR of the recent downlinks
+             * @param limits what may be chosen
+             */
+            virtual AdrSettings Select(const AdrUplink& uplink, const Statistics& stats, const AdrLimits& limits) = 0;
+
+            /**
+             * Result of the last selected confirmed uplink
+             * @param missed attempts without an ACK
+             * @param acked whether the last attempt was acknowledged
+             */
+            virtual void Outcome(uint8_t missed, bool acked) = 0;
+
+            /**
+             * Forget what was learnt, e.g. after a join
+             */
+            virtual void Reset() {}
+
+            /**
+             * LoRa time on air with explicit header, CRC, coding rate 4/5 and 8 preamble symbols
+             * @param bandwidth Hz
+             * @param bytes PHY payload
+             * @return us
+             */
+            static uint32_t TimeOnAir(uint8_t spreadingFactor, uint32_t bandwidth, uint8_t bytes);
+
+            /**
+             * Lowest SNR a LoRa receiver demodulates at
+             * @return dB
+             */
+            static double DemodulationFloor(uint8_t spreadingFactor);
+    };
+
+    struct EnergyAdrPolicyConfig {
+            EnergyAdrPolicyConfig();
+
+            double TargetDelivery;              //!< probability an uplink reaches the network
+            double Fading;                      //!< dB sigma assumed when the downlinks vary less
+            int8_t GatewayPower;                //!< dBm of the downlinks the RSSI is measured on
+            double NoiseFigure;                 //!< dB of the gateway receiver
+            double Step;                        //!< dB the bias moves for a miss predicted as certain to succeed
+            uint8_t MaxRedundancy;              //!< transmissions of an unconfirmed uplink, within AdrLimits
+            EnergyProfile Energy;               //!< currents the charge of an attempt is estimated with
+    };
+
+    class EnergyAdrPolicy : public AdrPolicy {
+        public:
+            EnergyAdrPolicy(const EnergyAdrPolicyConfig& config = EnergyAdrPolicyConfig());
+
+            virtual AdrSettings Select(const AdrUplink& uplink, const Statistics& stats, const AdrLimits& limits);
+            virtual void Outcome(uint8_t missed, bool acked);
+            virtual void Reset();
+
+            /**
+             * dB taken off the predicted margin, positive when the uplink is worse than the downlinks suggest
+             */
+            double Bias() const;
+
+            /**
+             * Predicted probability one attempt of the last selected uplink succeeds, with the ACK
+             * when confirmed, -1 if nothing was heard to predict from
+             */
+            double Predicted() const;
+
+            void Log() const;
+
+        private:
+            /**
+             * Probability one transmission is received
+             * @param margin dB over the demodulation floor
+             */
+            double Success(double margin, double sigma) const;
+
+            /**
+             * Charge of one transmission and its RX1 window
+             * @return uA.us
+             */
+            double AttemptCharge(uint8_t spreadingFactor, uint32_t bandwidth, uint8_t bytes, int8_t power) const;
+
+            EnergyAdrPolicyConfig _config;
+            double _bias;
+            double _predicted;
+    };
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::AdrTransaction stages the LinkADRReq blocks of a downlink
+ *
+ */
+
+#include "AdrTransaction.h"
+#include "ChannelPlan.h"
+#include "MacCommandCodec.h"
+
+using namespace lora;
+
+AdrTransaction::AdrTransaction()
+:   _datarate(UNCHANGED),
+    _power(UNCHANGED),
+    _redundancy(UNCHANGED),
+    _index(0),
+    _end(0),
+    _status(0x07),
+    _pending(false)
+{
+}
+
+void AdrTransaction::Stage(const std::vector<uint16_t>& live, const uint8_t* payload, uint8_t index, uint8_t size) {
+    if (_pending && (index <= _index || index >= _end)) {
+        logWarning("ADR dropping commands staged by a previous downlink");
+        _pending = false;
+    }
+
+    if (!_pending) {
+        // assignment reuses the shadow storage once it has grown to the plan size
+        _mask = live;
+        _datarate = UNCHANGED;
+        _power = UNCHANGED;
+        _redundancy = UNCHANGED;
+        _status = 0x07;
+        _pending = true;
+
+        uint8_t cid = index > 0 ? index - 1 : 0;
+        _end = cid + MacCommandCodec::LinkAdrBlock(payload, cid, size) * MacCommandCodec::ServerCommandSize(SRV_MAC_LINK_ADR_REQ);
+    }
+
+    _index = index;
+}
+
+bool AdrTransaction::Pending() const {
+    return _pending;
+}
+
+const std::vector<uint16_t>& AdrTransaction::GetChannelMask() const {
+    return _mask;
+}
+
+void AdrTransaction::SetChannelMask(uint8_t index, uint16_t mask) {
+    if (index < _mask.size()) {
+        _mask[index] = mask;
+    }
+}
+
+void AdrTransaction::SetDatarate(uint8_t datarate) {
+    _datarate = datarate;
+}
+
+void AdrTransaction::SetTxPower(uint8_t power) {
+    _power = power;
+}
+
+void AdrTransaction::SetRedundancy(uint8_t nbRep) {
+    _redundancy = nbRep;
+}
+
+uint8_t AdrTransaction::GetDatarate(uint8_t current) const {
+    return (_pending && _datarate != UNCHANGED) ? _datarate : current;
+}
+
+uint8_t AdrTransaction::GetTxPower(uint8_t current) const {
+    return (_pending && _power != UNCHANGED) ? _power : current;
+}
+
+void AdrTransaction::AddStatus(uint8_t status) {
+    _status &= status;
+}
+
+uint8_t AdrTransaction::GetStatus() const {
+    return _status;
+}
+
+void AdrTransaction::Commit(ChannelPlan* plan, const std::vector<uint16_t>& live) {
+    if (!_pending) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < _mask.size() && i < live.size(); i++) {
+        if (_mask[i] != live[i]) {
+            plan->SetChannelMask(i, _mask[i]);
+        }
+    }
+
+    Settings* settings = plan->GetSettings();
+
+    if (_datarate != UNCHANGED)
+        settings->Session.TxDatarate = _datarate;
+    if (_power != UNCHANGED)
+        settings->Session.TxPower = _power;
+    if (_redundancy != UNCHANGED)
+        settings->Session.Redundancy = _redundancy;
+
+    logDebug("ADR committed DR: %u PWR: %u NbRep: %u", settings->Session.TxDatarate, settings->Session.TxPower, settings->Session.Redundancy);
+
+    _pending = false;
+}
+
+void AdrTransaction::Abort() {
+    if (_pending) {
+        logDebug("ADR staged commands dropped, status %02x", _status);
+    }
+
+    _pending = false;
+}
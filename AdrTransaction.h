@@ -0,0 +1,117 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::AdrTransaction stages the LinkADRReq blocks of a downlink
+ *
+ * @details Every LinkADRReq in a downlink edits a shadow copy of the channel mask along
+ *          with the datarate, power and redundancy it requests.  Once the Mac has handled
+ *          all of them the shadow is validated as a whole and either written to the plan
+ *          in one step or dropped, the live mask never holds a partial update.
+ *
+ */
+
+#ifndef __LORA_ADR_TRANSACTION_H__
+#define __LORA_ADR_TRANSACTION_H__
+
+#include "Lora.h"
+#include <vector>
+
+namespace lora {
+
+    class ChannelPlan;
+
+    class AdrTransaction {
+        public:
+            AdrTransaction();
+
+            /**
+             * Stage a LinkADRReq
+             * The first command of a block sizes it with MacCommandCodec::LinkAdrBlock and the
+             * commands of the block share the shadow mask.  A command outside the block being
+             * staged belongs to a new downlink, anything left staged from the last downlink is
+             * dropped and the shadow is copied from the live mask.
+             * @param live channel mask in use by the plan
+             * @param payload FOpts or decrypted port 0 payload
+             * @param index offset of the command parameters in the payload, after the CID
+             * @param size number of bytes in payload
+             */
+            void Stage(const std::vector<uint16_t>& live, const uint8_t* payload, uint8_t index, uint8_t size);
+
+            /**
+             * @return true if commands are staged and not yet committed or aborted
+             */
+            bool Pending() const;
+
+            /**
+             * Shadow channel mask, only valid while Pending()
+             */
+            const std::vector<uint16_t>& GetChannelMask() const;
+
+            /**
+             * Set a word of the shadow channel mask
+             * @param index of mask to set 0:0-15, 1:16-31 ...
+             * @param mask 16 bit mask of enabled channels
+             */
+            void SetChannelMask(uint8_t index, uint16_t mask);
+
+            void SetDatarate(uint8_t datarate);
+            void SetTxPower(uint8_t power);
+            void SetRedundancy(uint8_t nbRep);
+
+            /**
+             * Datarate the commit would leave in the session
+             * @param current session datarate, returned when nothing is staged
+             */
+            uint8_t GetDatarate(uint8_t current) const;
+
+            /**
+             * TX power the commit would leave in the session
+             * @param current session TX power, returned when nothing is staged
+             */
+            uint8_t GetTxPower(uint8_t current) const;
+
+            /**
+             * Combine the answer status of a command with the block
+             * The LinkADRAns of a block all carry the same status, one rejected command rejects all.
+             * @param status answer status of a single command
+             */
+            void AddStatus(uint8_t status);
+
+            /**
+             * @return combined answer status of the staged commands
+             */
+            uint8_t GetStatus() const;
+
+            /**
+             * Write the shadow mask and staged settings to the plan
+             * Only mask words that differ from the live mask are written.
+             * @param plan plan the commands were staged for
+             * @param live channel mask in use by the plan
+             */
+            void Commit(ChannelPlan* plan, const std::vector<uint16_t>& live);
+
+            /**
+             * Drop the staged commands
+             */
+            void Abort();
+
+        private:
+            static const int16_t UNCHANGED = -1;
+
+            std::vector<uint16_t> _mask;    //!< shadow channel mask
+            int16_t _datarate;              //!< staged datarate or UNCHANGED
+            int16_t _power;                 //!< staged TX power in dBm or UNCHANGED
+            int16_t _redundancy;            //!< staged NbRep or UNCHANGED
+            uint8_t _index;                 //!< payload offset of the last staged command
+            uint16_t _end;                  //!< payload offset after the last command of the block
+            uint8_t _status;                //!< combined answer status
+            bool _pending;
+    };
+
+}
+
+#endif
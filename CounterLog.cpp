@@ -0,0 +1,422 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::CounterLog frame counters kept apart from the settings
+ *
+ */
+
+#include "CounterLog.h"
+#include "crc32.h"
+
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint8_t ENTRY_SIZE = 8;
+    const uint8_t MAX_SLOT = 32;
+    const uint8_t TALLY_BYTES = 8;              //!< of a bit tally before rounding to the program size
+    const uint8_t TALLY_UNITS = 8;              //!< of a unit tally
+    const uint8_t ENTRY_HEADER = 0xFE;          //!< id of the entry holding the bank generation
+    const uint8_t HEADER_BITS = 0x80;           //!< geometry flag of a bit tally
+
+    /**
+     * Value, id, step, CRC-16 taken from a CRC-32 of the first six bytes, little endian
+     */
+    void Encode(uint8_t* entry, uint8_t id, uint32_t value, uint8_t step) {
+        entry[0] = value;
+        entry[1] = value >> 8;
+        entry[2] = value >> 16;
+        entry[3] = value >> 24;
+        entry[4] = id;
+        entry[5] = step;
+
+        uint32_t crc = crc32(0, entry, 6);
+        entry[6] = crc;
+        entry[7] = crc >> 8;
+    }
+
+    bool Decode(const uint8_t* entry, uint8_t& id, uint32_t& value, uint8_t& step) {
+        uint32_t crc = crc32(0, entry, 6);
+
+        if (entry[6] != (uint8_t) crc || entry[7] != (uint8_t) (crc >> 8)) {
+            return false;
+        }
+
+        id = entry[4];
+        step = entry[5];
+        value = entry[0] | (entry[1] << 8) | (entry[2] << 16) | ((uint32_t) entry[3] << 24);
+        return true;
+    }
+
+    bool Blank(const uint8_t* data, uint32_t size) {
+        for (uint32_t i = 0; i < size; i++) {
+            if (data[i] != NVM_ERASED) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    uint8_t Cleared(uint8_t byte) {
+        uint8_t count = 0;
+
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            if ((byte & (1 << bit)) == 0) {
+                count++;
+            }
+        }
+
+        return count;
+    }
+
+}
+
+CounterLog::CounterLog(NvmDevice& nvm, uint32_t address, uint32_t bankSize)
+:   _nvm(nvm),
+    _address(address),
+    _bankSize(bankSize),
+    _slot(ENTRY_SIZE),
+    _tally(TALLY_BYTES),
+    _marks(TALLY_BYTES * 8),
+    _bits(true),
+    _bank(0),
+    _generation(0),
+    _cursor(0),
+    _mounted(false)
+{
+    memset(_reserve, 0, sizeof(_reserve));
+    memset(_value, 0, sizeof(_value));
+    memset(_stored, 0, sizeof(_stored));
+    memset(_valid, 0, sizeof(_valid));
+    memset(_block, 0, sizeof(_block));
+    memset(_used, 0, sizeof(_used));
+    memset(_step, 0, sizeof(_step));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void CounterLog::SetReserve(uint8_t counter, uint8_t reserve) {
+    if (counter < COUNTERS) {
+        _reserve[counter] = reserve;
+    }
+}
+
+int32_t CounterLog::Mount() {
+    uint32_t program = _nvm.ProgramSize();
+    uint32_t erase = _nvm.EraseSize();
+
+    _mounted = false;
+    _bits = _nvm.Reprogrammable();
+    _slot = program > ENTRY_SIZE ? program : ENTRY_SIZE;
+
+    if (program == 0 || _slot > MAX_SLOT || _slot % program != 0 || erase == 0 || _bankSize % erase != 0) {
+        return LORA_ERROR;
+    }
+
+    if (_bits) {
+        _tally = (TALLY_BYTES + program - 1) / program * program;
+        _marks = _tally * 8;
+    } else {
+        _tally = TALLY_UNITS * program;
+        _marks = TALLY_UNITS;
+    }
+
+    uint32_t block = _slot + _tally;
+    uint8_t geometry = (_bits ? HEADER_BITS : 0) | (_tally / TALLY_BYTES);
+
+    if (_bankSize < _slot + (COUNTERS + 1) * block) {
+        return LORA_ERROR;
+    }
+
+    memset(_value, 0, sizeof(_value));
+    memset(_stored, 0, sizeof(_stored));
+    memset(_valid, 0, sizeof(_valid));
+    memset(_block, 0, sizeof(_block));
+    memset(_used, 0, sizeof(_used));
+
+    uint8_t entry[MAX_SLOT];
+    uint8_t id;
+    uint32_t value;
+    uint8_t step;
+    bool found = false;
+
+    for (uint8_t bank = 0; bank < 2; bank++) {
+        if (_nvm.Read(_address + bank * _bankSize, entry, _slot) != 0) {
+            return LORA_ERROR;
+        }
+
+        // a bank written with another tally layout is not read
+        if (Decode(entry, id, value, step) && id == ENTRY_HEADER && step == geometry && (!found || value > _generation)) {
+            found = true;
+            _bank = bank;
+            _generation = value;
+        }
+    }
+
+    if (!found) {
+        // nothing stored, the first Set starts bank 0
+        _bank = 1;
+        _generation = 0;
+        _cursor = _bankSize;
+        _mounted = true;
+        return LORA_OK;
+    }
+
+    uint32_t base = _address + _bank * _bankSize;
+
+    for (_cursor = _slot; _cursor + block <= _bankSize; _cursor += block) {
+        if (_nvm.Read(base + _cursor, entry, _slot) != 0) {
+            return LORA_ERROR;
+        }
+
+        if (Blank(entry, _slot)) {
+            break;
+        }
+
+        // a base cut short by a reset fails its check and its block is passed over
+        if (!Decode(entry, id, value, step) || id >= COUNTERS || step == 0) {
+            continue;
+        }
+
+        uint32_t marks = 0;
+        bool torn = false;
+
+        if (CountMarks(_cursor, marks, torn) != LORA_OK) {
+            return LORA_ERROR;
+        }
+
+        _stored[id] = value + marks * step;
+        _value[id] = _stored[id];
+        _valid[id] = true;
+        // marks after a torn one would not add up, the next change starts a block
+        _block[id] = torn ? 0 : _cursor;
+        _used[id] = marks;
+        _step[id] = step;
+    }
+
+    _mounted = true;
+    return LORA_OK;
+}
+
+int32_t CounterLog::CountMarks(uint32_t offset, uint32_t& marks, bool& torn) {
+    uint32_t program = _nvm.ProgramSize();
+    uint32_t address = _address + _bank * _bankSize + offset + _slot;
+    uint8_t chunk[MAX_SLOT];
+
+    marks = 0;
+    torn = false;
+
+    for (uint32_t done = 0; done < _tally; done += program) {
+        if (_nvm.Read(address + done, chunk, program) != 0) {
+            return LORA_ERROR;
+        }
+
+        if (_bits) {
+            for (uint32_t i = 0; i < program; i++) {
+                uint8_t cleared = Cleared(chunk[i]);
+
+                // bits are cleared in order, anything else is a mark cut short
+                if (chunk[i] != (uint8_t) (0xFF << cleared) || (cleared != 0 && marks % 8 != 0)) {
+                    torn = true;
+                }
+
+                marks += cleared;
+            }
+        } else if (!Blank(chunk, program)) {
+            // a unit cut short counts, the value read back is never below one in use
+            marks++;
+        }
+    }
+
+    return LORA_OK;
+}
+
+int32_t CounterLog::Format() {
+    _mounted = false;
+
+    if (_nvm.Erase(_address, _bankSize * 2) != 0) {
+        return LORA_ERROR;
+    }
+
+    _stats.Erases += 2;
+    return Mount();
+}
+
+bool CounterLog::Stored(uint8_t counter) const {
+    return counter < COUNTERS && _valid[counter];
+}
+
+uint32_t CounterLog::Get(uint8_t counter) const {
+    return counter < COUNTERS ? _stored[counter] : 0;
+}
+
+int32_t CounterLog::Set(uint8_t counter, uint32_t value) {
+    if (!_mounted || counter >= COUNTERS) {
+        return LORA_ERROR;
+    }
+
+    // with a reserve the value after this one has to be covered too, a reset may come before the next Set
+    uint8_t reserve = _reserve[counter];
+    uint32_t needed = reserve != 0 ? value + 1 : value;
+
+    if (_valid[counter] && value >= _value[counter]) {
+        if (needed <= _stored[counter]) {
+            _value[counter] = value;
+            return LORA_OK;
+        }
+
+        if (_block[counter] != 0) {
+            uint8_t step = _step[counter];
+            uint32_t marks = (needed - _stored[counter] + step - 1) / step;
+
+            if (_used[counter] + marks <= _marks) {
+                _value[counter] = value;
+                return Mark(counter, marks);
+            }
+        }
+    }
+
+    // first value, a tally too short for the jump, or a counter set back by a join
+    _value[counter] = value;
+    return NewBlock(counter, reserve != 0 ? value + reserve : value, reserve != 0 ? reserve : 1);
+}
+
+const CounterLogStats& CounterLog::GetStats() const {
+    return _stats;
+}
+
+int32_t CounterLog::Mark(uint8_t counter, uint32_t marks) {
+    uint32_t program = _nvm.ProgramSize();
+    uint32_t address = _address + _bank * _bankSize + _block[counter] + _slot;
+    uint32_t from = _used[counter];
+    uint32_t to = from + marks;
+    uint8_t unit[MAX_SLOT];
+
+    if (_bits) {
+        // marks clear bits in order, every unit holding one of the new marks is programmed
+        for (uint32_t index = from / 8 / program; index <= (to - 1) / 8 / program; index++) {
+            for (uint32_t i = 0; i < program; i++) {
+                uint32_t byte = index * program + i;
+                uint32_t cleared = to > byte * 8 ? to - byte * 8 : 0;
+
+                unit[i] = cleared >= 8 ? 0x00 : (uint8_t) (0xFF << cleared);
+            }
+
+            if (_nvm.Program(address + index * program, unit, program) != 0) {
+                // what was written is unknown, the next change starts a block
+                _block[counter] = 0;
+                return LORA_ERROR;
+            }
+
+            _stats.Writes++;
+            _stats.Bytes += program;
+        }
+    } else {
+        memset(unit, 0x00, program);
+
+        for (uint32_t mark = from; mark < to; mark++) {
+            if (_nvm.Program(address + mark * program, unit, program) != 0) {
+                _block[counter] = 0;
+                return LORA_ERROR;
+            }
+
+            _stats.Writes++;
+            _stats.Bytes += program;
+        }
+    }
+
+    _used[counter] = to;
+    _stored[counter] += marks * _step[counter];
+
+    return LORA_OK;
+}
+
+int32_t CounterLog::NewBlock(uint8_t counter, uint32_t base, uint8_t step) {
+    _stored[counter] = base;
+    _valid[counter] = true;
+    _step[counter] = step;
+    _used[counter] = 0;
+
+    if (_cursor + _slot + _tally > _bankSize) {
+        return Swap();
+    }
+
+    if (WriteEntry(_address + _bank * _bankSize + _cursor, counter, base, step) != LORA_OK) {
+        // the block may be partly written, leave it behind
+        _block[counter] = 0;
+        _cursor += _slot + _tally;
+        return LORA_ERROR;
+    }
+
+    _block[counter] = _cursor;
+    _cursor += _slot + _tally;
+    _stats.Blocks++;
+
+    return LORA_OK;
+}
+
+int32_t CounterLog::Swap() {
+    uint8_t target = _bank ^ 1;
+    uint32_t base = _address + target * _bankSize;
+    uint32_t cursor = _slot;
+    uint32_t block[COUNTERS];
+
+    if (_nvm.Erase(base, _bankSize) != 0) {
+        return LORA_ERROR;
+    }
+
+    _stats.Erases++;
+
+    for (uint8_t id = 0; id < COUNTERS; id++) {
+        block[id] = 0;
+
+        if (!_valid[id]) {
+            continue;
+        }
+
+        if (WriteEntry(base + cursor, id, _stored[id], _step[id]) != LORA_OK) {
+            return LORA_ERROR;
+        }
+
+        block[id] = cursor;
+        cursor += _slot + _tally;
+        _stats.Blocks++;
+    }
+
+    // the header makes the bank valid, so it goes last
+    uint8_t geometry = (_bits ? HEADER_BITS : 0) | (_tally / TALLY_BYTES);
+
+    if (WriteEntry(base, ENTRY_HEADER, _generation + 1, geometry) != LORA_OK) {
+        return LORA_ERROR;
+    }
+
+    _bank = target;
+    _generation++;
+    _cursor = cursor;
+    memcpy(_block, block, sizeof(_block));
+    memset(_used, 0, sizeof(_used));
+
+    return LORA_OK;
+}
+
+int32_t CounterLog::WriteEntry(uint32_t address, uint8_t id, uint32_t value, uint8_t step) {
+    uint8_t entry[MAX_SLOT];
+
+    memset(entry, NVM_ERASED, _slot);
+    Encode(entry, id, value, step);
+
+    if (_nvm.Program(address, entry, _slot) != 0) {
+        return LORA_ERROR;
+    }
+
+    _stats.Writes++;
+    _stats.Bytes += _slot;
+
+    return LORA_OK;
+}
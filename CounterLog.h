@@ -0,0 +1,136 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::CounterLog frame counters kept apart from the settings
+ *
+ * @details The log is a run of equal sized blocks in the active of two banks.  A block holds
+ *          a checked base value of one counter and a tally after it; the counter is the base
+ *          plus a step for every tally mark.  A mark clears the next bit of the tally, or
+ *          programs the next unit where the NVM cannot program a unit twice, so counting up
+ *          needs no erase and no new entry.  A full tally, or a counter going down after a
+ *          join, starts a new block.  When the bank is full the counters are copied to the
+ *          other bank, whose header is written last.
+ *
+ *          A reset while a mark is programmed leaves the old or the new value.  With a
+ *          reserve of k an uplink counter is stored one step of k ahead of the value in
+ *          use, so a write is needed only every k uplinks and the value loaded after a
+ *          reset is never one that was already sent.
+ *
+ */
+
+#ifndef __LORA_COUNTER_LOG_H__
+#define __LORA_COUNTER_LOG_H__
+
+#include "Lora.h"
+#include "NvmDevice.h"
+
+namespace lora {
+
+    enum FrameCounter {
+        COUNTER_UPLINK = 0,
+        COUNTER_DOWNLINK,
+        COUNTER_MULTICAST,                      //!< first of MAX_MULTICAST_SESSIONS downlink counters
+        COUNTERS = COUNTER_MULTICAST + MAX_MULTICAST_SESSIONS
+    };
+
+    struct CounterLogStats {
+            uint32_t Writes;                    //!< programs of a base or a tally
+            uint32_t Blocks;                    //!< bases written
+            uint32_t Bytes;                     //!< bytes programmed
+            uint32_t Erases;                    //!< banks erased
+    };
+
+    class CounterLog {
+        public:
+            /**
+             * @param address start of two banks of bankSize bytes
+             * @param bankSize multiple of the erase size of nvm
+             */
+            CounterLog(NvmDevice& nvm, uint32_t address, uint32_t bankSize);
+
+            /**
+             * Store a counter ahead of its value, for counters whose next value is always higher
+             * @param reserve values stored ahead, 0 to store the exact value
+             */
+            void SetReserve(uint8_t counter, uint8_t reserve);
+
+            /**
+             * Find the active bank and read the counters
+             * @return LORA_OK, LORA_ERROR if the NVM failed or the banks are too small
+             */
+            int32_t Mount();
+
+            /**
+             * Erase both banks and forget all counters
+             */
+            int32_t Format();
+
+            /**
+             * @return true if a value of the counter was read or written
+             */
+            bool Stored(uint8_t counter) const;
+
+            /**
+             * @return value stored, the reserved value for a counter with a reserve
+             */
+            uint32_t Get(uint8_t counter) const;
+
+            /**
+             * Store a new value, nothing is written while it is within the reserve
+             */
+            int32_t Set(uint8_t counter, uint32_t value);
+
+            const CounterLogStats& GetStats() const;
+
+        private:
+            /**
+             * Start a block for a counter, in the other bank if this one is full
+             */
+            int32_t NewBlock(uint8_t counter, uint32_t base, uint8_t step);
+
+            /**
+             * Add marks to the tally of the open block of a counter
+             */
+            int32_t Mark(uint8_t counter, uint32_t marks);
+
+            /**
+             * Copy the counters to the other bank and make it active
+             */
+            int32_t Swap();
+
+            int32_t WriteEntry(uint32_t address, uint8_t id, uint32_t value, uint8_t step);
+
+            /**
+             * Count the marks in the tally of the block at offset
+             * @param torn set if the bits are not cleared in order
+             */
+            int32_t CountMarks(uint32_t offset, uint32_t& marks, bool& torn);
+
+            NvmDevice& _nvm;
+            uint32_t _address;
+            uint32_t _bankSize;
+            uint32_t _slot;                     //!< entry size rounded up to the program size
+            uint32_t _tally;                    //!< bytes of the tally of a block
+            uint32_t _marks;                    //!< marks a tally holds
+            bool _bits;                         //!< a mark is one bit, else one program unit
+            uint8_t _bank;
+            uint32_t _generation;
+            uint32_t _cursor;                   //!< offset of the next block in the active bank
+            bool _mounted;
+            uint8_t _reserve[COUNTERS];
+            uint32_t _value[COUNTERS];          //!< last value set
+            uint32_t _stored[COUNTERS];         //!< value a mount would return
+            bool _valid[COUNTERS];
+            uint32_t _block[COUNTERS];          //!< offset of the open block, 0 for none
+            uint32_t _used[COUNTERS];           //!< marks in the open block
+            uint8_t _step[COUNTERS];            //!< of the open block
+            CounterLogStats _stats;
+    };
+
+}
+
+#endif
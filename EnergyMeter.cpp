@@ -0,0 +1,305 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::EnergyMeter charge spent per radio and MCU state and per operation
+ *
+ */
+
+#include "EnergyMeter.h"
+
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const double UA_US_PER_UAH = 3.6e9;
+    const double US_PER_DAY = 86400e6;
+
+    const char* const OPERATION_NAMES[ENERGY_OPERATIONS] = {
+        "uplink",
+        "join",
+        "fota"
+    };
+
+}
+
+EnergyProfile::EnergyProfile()
+:   BatteryCapacity(2400)
+{
+    Radio[ENERGY_RADIO_SLEEP] = 1;
+    Radio[ENERGY_RADIO_STANDBY] = 1200;
+    Radio[ENERGY_RADIO_RX] = 5300;
+    Radio[ENERGY_RADIO_TX] = 0;
+
+    Mcu[ENERGY_MCU_RUN] = 4000;
+    Mcu[ENERGY_MCU_SLEEP] = 1600;
+    Mcu[ENERGY_MCU_STOP] = 12;
+    Mcu[ENERGY_MCU_STANDBY] = 2;
+
+    static const int8_t power[ENERGY_TX_POINTS] = { 0, 10, 14, 17, 20, 22 };
+    static const uint32_t current[ENERGY_TX_POINTS] = { 24000, 32000, 45000, 90000, 105000, 118000 };
+    memcpy(TxPower, power, sizeof(TxPower));
+    memcpy(TxCurrent, current, sizeof(TxCurrent));
+}
+
+uint32_t EnergyProfile::TxCurrentAt(int8_t power) const {
+    if (power <= TxPower[0]) {
+        return TxCurrent[0];
+    }
+
+    for (uint8_t i = 1; i < ENERGY_TX_POINTS; i++) {
+        if (power <= TxPower[i]) {
+            int32_t span = TxPower[i] - TxPower[i - 1];
+            int32_t step = (int32_t) TxCurrent[i] - (int32_t) TxCurrent[i - 1];
+            return TxCurrent[i - 1] + step * (power - TxPower[i - 1]) / span;
+        }
+    }
+
+    return TxCurrent[ENERGY_TX_POINTS - 1];
+}
+
+double EnergyTotal::Mean() const {
+    return Count != 0 ? EnergyMeter::MicroAmpHours(Charge) / Count : 0.0;
+}
+
+EnergyMeter::EnergyMeter(const EnergyProfile& profile)
+:   _profile(profile),
+    _radio(ENERGY_RADIO_STANDBY),
+    _radioCurrent(profile.Radio[ENERGY_RADIO_STANDBY]),
+    _mcu(ENERGY_MCU_RUN),
+    _last(0)
+{
+    ResetAt(0);
+}
+
+EnergyMeter& EnergyMeter::Global() {
+    static EnergyMeter meter;
+    return meter;
+}
+
+void EnergyMeter::SetProfile(const EnergyProfile& profile) {
+    core_util_critical_section_enter();
+    _profile = profile;
+    if (_radio != ENERGY_RADIO_TX) {
+        _radioCurrent = _profile.Radio[_radio];
+    }
+    core_util_critical_section_exit();
+}
+
+const EnergyProfile& EnergyMeter::GetProfile() const {
+    return _profile;
+}
+
+uint64_t EnergyMeter::Now() {
+    return (uint64_t) Kernel::Clock::now().time_since_epoch().count() * 1000;
+}
+
+void EnergyMeter::Advance(uint64_t now) {
+    if (now <= _last) {
+        return;
+    }
+
+    uint64_t elapsed = now - _last;
+    uint64_t radio = elapsed * _radioCurrent;
+    uint64_t mcu = elapsed * _profile.Mcu[_mcu];
+
+    _radioCharge[_radio] += radio;
+    _radioTime[_radio] += elapsed;
+    _mcuCharge[_mcu] += mcu;
+    _mcuTime[_mcu] += elapsed;
+    _total += radio + mcu;
+    _last = now;
+}
+
+void EnergyMeter::SetRadioState(EnergyRadioState state, int8_t power) {
+    SetRadioStateAt(Now(), state, power);
+}
+
+void EnergyMeter::SetRadioStateAt(uint64_t now, EnergyRadioState state, int8_t power) {
+    if (state >= ENERGY_RADIO_STATES) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    Advance(now);
+    _radio = state;
+    _radioCurrent = state == ENERGY_RADIO_TX ? _profile.TxCurrentAt(power) : _profile.Radio[state];
+    core_util_critical_section_exit();
+}
+
+void EnergyMeter::SetRadioState(SxRadio::RadioState_t state, int8_t power) {
+    switch (state) {
+        case SxRadio::RF_TX_RUNNING:
+            SetRadioState(ENERGY_RADIO_TX, power);
+            break;
+        case SxRadio::RF_RX_RUNNING:
+        case SxRadio::RF_CAD:
+        case SxRadio::RF_LBT:
+            SetRadioState(ENERGY_RADIO_RX);
+            break;
+        default:
+            SetRadioState(ENERGY_RADIO_STANDBY);
+            break;
+    }
+}
+
+void EnergyMeter::SetMcuState(EnergyMcuState state) {
+    SetMcuStateAt(Now(), state);
+}
+
+void EnergyMeter::SetMcuStateAt(uint64_t now, EnergyMcuState state) {
+    if (state >= ENERGY_MCU_STATES) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    Advance(now);
+    _mcu = state;
+    core_util_critical_section_exit();
+}
+
+void EnergyMeter::Begin(EnergyOperation operation) {
+    BeginAt(Now(), operation);
+}
+
+void EnergyMeter::BeginAt(uint64_t now, EnergyOperation operation) {
+    if (operation >= ENERGY_OPERATIONS) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    Advance(now);
+    _begin[operation] = _total;
+    _active[operation] = true;
+    core_util_critical_section_exit();
+}
+
+void EnergyMeter::End(EnergyOperation operation) {
+    EndAt(Now(), operation);
+}
+
+void EnergyMeter::EndAt(uint64_t now, EnergyOperation operation) {
+    if (operation >= ENERGY_OPERATIONS) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+
+    if (_active[operation]) {
+        Advance(now);
+
+        EnergyTotal& total = _operations[operation];
+        total.Last = _total - _begin[operation];
+        total.Charge += total.Last;
+        total.Count++;
+        _active[operation] = false;
+    }
+
+    core_util_critical_section_exit();
+}
+
+void EnergyMeter::Update() {
+    UpdateAt(Now());
+}
+
+void EnergyMeter::UpdateAt(uint64_t now) {
+    core_util_critical_section_enter();
+    Advance(now);
+    core_util_critical_section_exit();
+}
+
+uint64_t EnergyMeter::RadioCharge(EnergyRadioState state) const {
+    return state < ENERGY_RADIO_STATES ? _radioCharge[state] : 0;
+}
+
+uint64_t EnergyMeter::McuCharge(EnergyMcuState state) const {
+    return state < ENERGY_MCU_STATES ? _mcuCharge[state] : 0;
+}
+
+uint64_t EnergyMeter::RadioTime(EnergyRadioState state) const {
+    return state < ENERGY_RADIO_STATES ? _radioTime[state] : 0;
+}
+
+uint64_t EnergyMeter::McuTime(EnergyMcuState state) const {
+    return state < ENERGY_MCU_STATES ? _mcuTime[state] : 0;
+}
+
+double EnergyMeter::Total() const {
+    return MicroAmpHours(_total);
+}
+
+const EnergyTotal& EnergyMeter::Operation(EnergyOperation operation) const {
+    return _operations[operation < ENERGY_OPERATIONS ? operation : ENERGY_UPLINK];
+}
+
+double EnergyMeter::AverageCurrent() const {
+    uint64_t elapsed = _last - _start;
+    return elapsed != 0 ? (double) _total / elapsed : 0.0;
+}
+
+double EnergyMeter::ProjectedLifetime() const {
+    double current = AverageCurrent();
+    return current > 0.0 ? _profile.BatteryCapacity * 1000.0 / current / 24.0 : 0.0;
+}
+
+double EnergyMeter::ProjectedLifetime(uint32_t period) const {
+    const EnergyTotal& uplinks = _operations[ENERGY_UPLINK];
+
+    if (uplinks.Count == 0 || period == 0) {
+        return 0.0;
+    }
+
+    // the floor between uplinks plus the uplink charge spread over the period
+    double floor = _profile.Radio[ENERGY_RADIO_SLEEP] + _profile.Mcu[ENERGY_MCU_STOP];
+    double current = floor + (double) uplinks.Charge / uplinks.Count / (period * 1e6);
+
+    return _profile.BatteryCapacity * 1000.0 / current / 24.0;
+}
+
+void EnergyMeter::Reset() {
+    ResetAt(Now());
+}
+
+void EnergyMeter::ResetAt(uint64_t now) {
+    core_util_critical_section_enter();
+    _last = now;
+    _start = now;
+    _total = 0;
+    memset(_radioCharge, 0, sizeof(_radioCharge));
+    memset(_radioTime, 0, sizeof(_radioTime));
+    memset(_mcuCharge, 0, sizeof(_mcuCharge));
+    memset(_mcuTime, 0, sizeof(_mcuTime));
+    memset(_operations, 0, sizeof(_operations));
+    memset(_begin, 0, sizeof(_begin));
+    memset(_active, 0, sizeof(_active));
+    core_util_critical_section_exit();
+}
+
+double EnergyMeter::MicroAmpHours(uint64_t charge) {
+    return charge / UA_US_PER_UAH;
+}
+
+void EnergyMeter::Log() const {
+    logInfo("energy: %.1f uAh over %.1f h, average %.1f uA, lifetime %.0f days",
+            Total(), (_last - _start) / 3.6e9, AverageCurrent(), ProjectedLifetime());
+    logInfo("radio uAh: sleep %.2f standby %.2f rx %.2f tx %.2f",
+            MicroAmpHours(_radioCharge[ENERGY_RADIO_SLEEP]), MicroAmpHours(_radioCharge[ENERGY_RADIO_STANDBY]),
+            MicroAmpHours(_radioCharge[ENERGY_RADIO_RX]), MicroAmpHours(_radioCharge[ENERGY_RADIO_TX]));
+    logInfo("mcu uAh: run %.2f sleep %.2f stop %.2f standby %.2f",
+            MicroAmpHours(_mcuCharge[ENERGY_MCU_RUN]), MicroAmpHours(_mcuCharge[ENERGY_MCU_SLEEP]),
+            MicroAmpHours(_mcuCharge[ENERGY_MCU_STOP]), MicroAmpHours(_mcuCharge[ENERGY_MCU_STANDBY]));
+
+    for (uint8_t op = 0; op < ENERGY_OPERATIONS; op++) {
+        const EnergyTotal& total = _operations[op];
+
+        if (total.Count != 0) {
+            logInfo("%s: %lu metered, mean %.3f uAh, last %.3f uAh", OPERATION_NAMES[op],
+                    (unsigned long) total.Count, total.Mean(), MicroAmpHours(total.Last));
+        }
+    }
+}
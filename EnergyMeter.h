@@ -0,0 +1,222 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::EnergyMeter charge spent per radio and MCU state and per operation
+ *
+ * @details The radio and the MCU each report their state changes; the time between changes is
+ *          multiplied by the current of the state from an EnergyProfile and added up.  TX current
+ *          follows the output power.  Charge between Begin() and End() of an uplink, a join or
+ *          a FOTA session is kept per operation, and the average current gives a projected
+ *          battery lifetime.  Charge is kept in uA.us, 3.6e9 of which make one uAh.
+ *
+ */
+
+#ifndef __LORA_ENERGY_METER_H__
+#define __LORA_ENERGY_METER_H__
+
+#include "Lora.h"
+#include "SxRadio.h"
+
+namespace lora {
+
+    const uint8_t ENERGY_TX_POINTS = 6;         //!< Points of the TX current against power table
+
+    enum EnergyRadioState {
+        ENERGY_RADIO_SLEEP = 0,
+        ENERGY_RADIO_STANDBY,
+        ENERGY_RADIO_RX,                        //!< RX windows, CAD and LBT
+        ENERGY_RADIO_TX,
+        ENERGY_RADIO_STATES
+    };
+
+    enum EnergyMcuState {
+        ENERGY_MCU_RUN = 0,
+        ENERGY_MCU_SLEEP,                       //!< core halted, peripherals clocked
+        ENERGY_MCU_STOP,                        //!< LowPower::enterStopMode
+        ENERGY_MCU_STANDBY,                     //!< LowPower::enterStandbyMode
+        ENERGY_MCU_STATES
+    };
+
+    enum EnergyOperation {
+        ENERGY_UPLINK = 0,                      //!< an uplink with its receive windows and retries
+        ENERGY_JOIN,                            //!< join requests until the join accept
+        ENERGY_FOTA,                            //!< a FOTA session from setup to the rebuilt image
+        ENERGY_OPERATIONS
+    };
+
+    /**
+     * Supply current of each state, in uA
+     */
+    struct EnergyProfile {
+            /**
+             * Typical datasheet figures for an SX1262 radio and a Cortex-M4 MCU at 3.3 V,
+             * measure the board for real numbers
+             */
+            EnergyProfile();
+
+            uint32_t Radio[ENERGY_RADIO_STATES];    //!< ENERGY_RADIO_TX is unused, see TxPower and TxCurrent
+            uint32_t Mcu[ENERGY_MCU_STATES];
+            int8_t TxPower[ENERGY_TX_POINTS];       //!< dBm, ascending
+            uint32_t TxCurrent[ENERGY_TX_POINTS];   //!< uA at each power
+            uint32_t BatteryCapacity;               //!< mAh
+
+            /**
+             * TX current at a power, interpolated in the table
+             * @param power dBm
+             * @return uA
+             */
+            uint32_t TxCurrentAt(int8_t power) const;
+    };
+
+    /**
+     * Charge of one kind of operation
+     */
+    struct EnergyTotal {
+            uint32_t Count;
+            uint64_t Charge;                    //!< uA.us over all operations
+            uint64_t Last;                      //!< uA.us of the last operation
+
+            /**
+             * Mean charge of an operation
+             * @return uAh
+             */
+            double Mean() const;
+    };
+
+    class EnergyMeter {
+        public:
+            /**
+             * Radio in standby and MCU running from time 0
+             */
+            EnergyMeter(const EnergyProfile& profile = EnergyProfile());
+
+            /**
+             * Meter the stack and the application report to
+             */
+            static EnergyMeter& Global();
+
+            void SetProfile(const EnergyProfile& profile);
+            const EnergyProfile& GetProfile() const;
+
+            /**
+             * Time in us from the kernel clock, which keeps counting in stop and standby
+             */
+            static uint64_t Now();
+
+            /**
+             * Change the radio state
+             * @param power dBm, for ENERGY_RADIO_TX
+             */
+            void SetRadioState(EnergyRadioState state, int8_t power = 0);
+            void SetRadioStateAt(uint64_t now, EnergyRadioState state, int8_t power = 0);
+
+            /**
+             * Change the radio state from SxRadio::State, RF_IDLE counts as standby
+             */
+            void SetRadioState(SxRadio::RadioState_t state, int8_t power = 0);
+
+            /**
+             * Change the MCU state, mDot::sleep sets stop or standby and run around the LowPower entry points
+             */
+            void SetMcuState(EnergyMcuState state);
+            void SetMcuStateAt(uint64_t now, EnergyMcuState state);
+
+            /**
+             * Start counting the charge of an operation
+             */
+            void Begin(EnergyOperation operation);
+            void BeginAt(uint64_t now, EnergyOperation operation);
+
+            /**
+             * Add the charge since Begin to the operation, no effect without Begin
+             */
+            void End(EnergyOperation operation);
+            void EndAt(uint64_t now, EnergyOperation operation);
+
+            /**
+             * Bring the totals up to a time without a state change
+             */
+            void Update();
+            void UpdateAt(uint64_t now);
+
+            /**
+             * Charge spent in a state since Reset
+             * @return uA.us
+             */
+            uint64_t RadioCharge(EnergyRadioState state) const;
+            uint64_t McuCharge(EnergyMcuState state) const;
+
+            /**
+             * Time spent in a state since Reset
+             * @return us
+             */
+            uint64_t RadioTime(EnergyRadioState state) const;
+            uint64_t McuTime(EnergyMcuState state) const;
+
+            /**
+             * All charge since Reset
+             * @return uAh
+             */
+            double Total() const;
+
+            const EnergyTotal& Operation(EnergyOperation operation) const;
+
+            /**
+             * Average current since Reset
+             * @return uA, 0 if no time has passed
+             */
+            double AverageCurrent() const;
+
+            /**
+             * Battery lifetime at the average current since Reset
+             * @return days, 0 if no time has passed
+             */
+            double ProjectedLifetime() const;
+
+            /**
+             * Battery lifetime with one uplink of the mean metered charge per period and the
+             * radio asleep with the MCU stopped in between
+             * @param period s between uplinks
+             * @return days, 0 if no uplink was metered
+             */
+            double ProjectedLifetime(uint32_t period) const;
+
+            /**
+             * Clear all totals, keeping the current states
+             */
+            void Reset();
+            void ResetAt(uint64_t now);
+
+            /**
+             * Convert charge to uAh
+             */
+            static double MicroAmpHours(uint64_t charge);
+
+            void Log() const;
+
+        private:
+            void Advance(uint64_t now);
+
+            EnergyProfile _profile;
+            EnergyRadioState _radio;
+            uint32_t _radioCurrent;             //!< uA of the radio state, TX depends on power
+            EnergyMcuState _mcu;
+            uint64_t _last;                     //!< us of the last update
+            uint64_t _start;                    //!< us of the last reset
+            uint64_t _total;                    //!< uA.us
+            uint64_t _radioCharge[ENERGY_RADIO_STATES];
+            uint64_t _radioTime[ENERGY_RADIO_STATES];
+            uint64_t _mcuCharge[ENERGY_MCU_STATES];
+            uint64_t _mcuTime[ENERGY_MCU_STATES];
+            EnergyTotal _operations[ENERGY_OPERATIONS];
+            uint64_t _begin[ENERGY_OPERATIONS];     //!< _total at Begin
+            bool _active[ENERGY_OPERATIONS];
+    };
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::FileDevice open file a FileStream or LogFile reads and writes
+ *
+ * @details Every call goes to the file system unbuffered, as mDot::readUserFile and
+ *          mDot::writeUserFile do on an open mdot_file.
+ *
+ */
+
+#ifndef __LORA_FILE_DEVICE_H__
+#define __LORA_FILE_DEVICE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace lora {
+
+    class FileDevice {
+        public:
+            virtual ~FileDevice() {}
+
+            /**
+             * Read at the current position and move past what was read
+             * @return bytes read, 0 at the end of the file, -1 on failure
+             */
+            virtual int32_t Read(uint8_t* data, uint32_t size) = 0;
+
+            /**
+             * Write at the current position, at the end for a file opened to append
+             * @return bytes written, -1 on failure
+             */
+            virtual int32_t Write(const uint8_t* data, uint32_t size) = 0;
+
+            /**
+             * @param whence SEEK_SET, SEEK_CUR or SEEK_END
+             * @return 0 on success, -1 on failure
+             */
+            virtual int32_t Seek(int32_t offset, int whence) = 0;
+
+            /**
+             * @return current position
+             */
+            virtual uint32_t Tell() const = 0;
+
+            /**
+             * @return bytes in the file
+             */
+            virtual uint32_t Size() const = 0;
+    };
+
+}
+
+#endif
@@ -0,0 +1,295 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::FileStream buffered reads and writes of a FileDevice
+ *
+ */
+
+#include "FileStream.h"
+#include "Lora.h"
+
+#include <string.h>
+
+using namespace lora;
+
+FileStream::FileStream(FileDevice& file, uint8_t* buffer, uint32_t size, uint32_t readAhead)
+:   _file(file),
+    _buffer(buffer),
+    _size(size),
+    _readAhead(readAhead == 0 || readAhead > size ? size : readAhead),
+    _state(BUFFER_EMPTY),
+    _start(file.Tell()),
+    _length(0),
+    _position(file.Tell()),
+    _sequential(true)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+FileStream::~FileStream() {
+    Flush();
+}
+
+int32_t FileStream::Read(uint8_t* data, uint32_t size) {
+    uint32_t done = 0;
+
+    if (Flush() != LORA_OK) {
+        return -1;
+    }
+
+    while (done < size) {
+        uint32_t left = size - done;
+
+        if (_state == BUFFER_READ && _position >= _start && _position < _start + _length) {
+            uint32_t offset = _position - _start;
+            uint32_t count = _length - offset < left ? _length - offset : left;
+
+            memcpy(data + done, _buffer + offset, count);
+            done += count;
+            _position += count;
+            continue;
+        }
+
+        if (left >= _size) {
+            // nothing gained by passing through the buffer
+            if (SeekFile(_position) != LORA_OK) {
+                return -1;
+            }
+
+            int32_t read = _file.Read(data + done, left);
+
+            if (read < 0) {
+                return -1;
+            }
+
+            _stats.Reads++;
+            _stats.Direct++;
+            _stats.BytesRead += read;
+            done += read;
+            _position += read;
+            _sequential = true;
+
+            if ((uint32_t) read < left) {
+                break;
+            }
+
+            continue;
+        }
+
+        int32_t filled = Fill(left);
+
+        if (filled < 0) {
+            return -1;
+        }
+
+        if (filled == 0) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+int32_t FileStream::ReadInto(mbed::Span<uint8_t> data) {
+    return Read(data.data(), data.size());
+}
+
+mbed::Span<const uint8_t> FileStream::Next(uint32_t max) {
+    if (max == 0 || Flush() != LORA_OK) {
+        return mbed::Span<const uint8_t>();
+    }
+
+    if (_state != BUFFER_READ || _position < _start || _position >= _start + _length) {
+        if (Fill(max < _size ? max : _size) <= 0) {
+            return mbed::Span<const uint8_t>();
+        }
+    }
+
+    uint32_t offset = _position - _start;
+    uint32_t count = _length - offset < max ? _length - offset : max;
+
+    _position += count;
+    return mbed::Span<const uint8_t>(_buffer + offset, count);
+}
+
+int32_t FileStream::Write(const uint8_t* data, uint32_t size) {
+    uint32_t done = 0;
+
+    // data read ahead is dropped, the buffer is needed for writing
+    if (_state == BUFFER_READ) {
+        _state = BUFFER_EMPTY;
+        _length = 0;
+    }
+
+    // the buffer holds one run of bytes
+    if (_state == BUFFER_WRITE && _position != _start + _length && Flush() != LORA_OK) {
+        return -1;
+    }
+
+    while (done < size) {
+        uint32_t left = size - done;
+
+        if (_state == BUFFER_EMPTY && left >= _size) {
+            if (SeekFile(_position) != LORA_OK) {
+                return -1;
+            }
+
+            int32_t written = _file.Write(data + done, left);
+
+            _stats.Writes++;
+            _stats.Direct++;
+
+            if (written < 0) {
+                return -1;
+            }
+
+            _stats.BytesWritten += written;
+            _position += written;
+            done += written;
+
+            if ((uint32_t) written < left) {
+                return -1;
+            }
+
+            continue;
+        }
+
+        if (_state == BUFFER_EMPTY) {
+            _state = BUFFER_WRITE;
+            _start = _position;
+            _length = 0;
+        }
+
+        uint32_t count = _size - _length < left ? _size - _length : left;
+
+        memcpy(_buffer + _length, data + done, count);
+        _length += count;
+        _position += count;
+        done += count;
+
+        if (_length == _size && Flush() != LORA_OK) {
+            return -1;
+        }
+    }
+
+    return done;
+}
+
+int32_t FileStream::Flush() {
+    if (_state != BUFFER_WRITE) {
+        return LORA_OK;
+    }
+
+    if (SeekFile(_start) != LORA_OK) {
+        return LORA_ERROR;
+    }
+
+    int32_t written = _file.Write(_buffer, _length);
+
+    _stats.Writes++;
+
+    if (written > 0) {
+        _stats.BytesWritten += written;
+    }
+
+    if (written != (int32_t) _length) {
+        // keep what did not go out for the next flush
+        if (written > 0) {
+            memmove(_buffer, _buffer + written, _length - written);
+            _start += written;
+            _length -= written;
+        }
+
+        return LORA_ERROR;
+    }
+
+    _state = BUFFER_EMPTY;
+    _length = 0;
+
+    return LORA_OK;
+}
+
+int32_t FileStream::Seek(int32_t offset, int whence) {
+    int64_t target;
+
+    switch (whence) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = (int64_t) _position + offset;
+            break;
+        case SEEK_END:
+            target = (int64_t) Size() + offset;
+            break;
+        default:
+            return LORA_ERROR;
+    }
+
+    if (target < 0 || target > UINT32_MAX || Flush() != LORA_OK) {
+        return LORA_ERROR;
+    }
+
+    // the file itself is moved by the next read or write that needs it
+    _sequential = (uint32_t) target == _position;
+    _position = target;
+
+    return LORA_OK;
+}
+
+uint32_t FileStream::Tell() const {
+    return _position;
+}
+
+uint32_t FileStream::Size() const {
+    uint32_t size = _file.Size();
+
+    if (_state == BUFFER_WRITE && _start + _length > size) {
+        size = _start + _length;
+    }
+
+    return size;
+}
+
+const FileStreamStats& FileStream::GetStats() const {
+    return _stats;
+}
+
+int32_t FileStream::Fill(uint32_t want) {
+    uint32_t amount = _sequential && _readAhead > want ? _readAhead : want;
+
+    if (SeekFile(_position) != LORA_OK) {
+        return -1;
+    }
+
+    int32_t read = _file.Read(_buffer, amount);
+
+    _stats.Reads++;
+    _state = BUFFER_EMPTY;
+    _length = 0;
+
+    if (read < 0) {
+        return -1;
+    }
+
+    _stats.BytesRead += read;
+    _start = _position;
+    _length = read;
+    _state = read > 0 ? BUFFER_READ : BUFFER_EMPTY;
+    _sequential = true;
+
+    return read;
+}
+
+int32_t FileStream::SeekFile(uint32_t position) {
+    if (_file.Tell() == position) {
+        return LORA_OK;
+    }
+
+    _stats.Seeks++;
+    return _file.Seek(position, SEEK_SET) == 0 ? LORA_OK : LORA_ERROR;
+}
@@ -0,0 +1,123 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::FileStream buffered reads and writes of a FileDevice
+ *
+ * @details One buffer given by the caller holds either data read ahead or data waiting to
+ *          be written, like a stdio stream.  Writes collect in the buffer and go to the file
+ *          when it is full, on Flush() or before anything else touches the file.  Reads
+ *          that follow on from the last one fill the buffer up to the read ahead size, a
+ *          read after a seek fetches only what was asked.  A read or write at least as large
+ *          as the buffer goes straight between the file and the caller's memory, and Next()
+ *          hands out the buffered data in place, so neither is copied twice.
+ *
+ */
+
+#ifndef __LORA_FILE_STREAM_H__
+#define __LORA_FILE_STREAM_H__
+
+#include "mbed.h"
+#include "FileDevice.h"
+
+namespace lora {
+
+    struct FileStreamStats {
+            uint32_t Reads;                     //!< FileDevice reads
+            uint32_t Writes;                    //!< FileDevice writes
+            uint32_t Seeks;                     //!< FileDevice seeks
+            uint32_t Direct;                    //!< reads and writes that bypassed the buffer
+            uint32_t BytesRead;                 //!< from the file
+            uint32_t BytesWritten;              //!< to the file
+    };
+
+    class FileStream {
+        public:
+            /**
+             * @param buffer write back and read ahead buffer, kept by the caller for the life of the stream
+             * @param readAhead bytes fetched by a sequential read, 0 for the whole buffer
+             */
+            FileStream(FileDevice& file, uint8_t* buffer, uint32_t size, uint32_t readAhead = 0);
+
+            /**
+             * Writes what is still buffered, check Flush() to see it fail
+             */
+            ~FileStream();
+
+            /**
+             * @return bytes read, less than size at the end of the file, -1 on failure
+             */
+            int32_t Read(uint8_t* data, uint32_t size);
+
+            /**
+             * Fill the span, a span the size of the buffer or more is read without a copy
+             * @return bytes read, less than the span at the end of the file, -1 on failure
+             */
+            int32_t ReadInto(mbed::Span<uint8_t> data);
+
+            /**
+             * Read up to max bytes without copying them, valid until the next call on the stream
+             * @return buffered data, empty at the end of the file or on failure
+             */
+            mbed::Span<const uint8_t> Next(uint32_t max);
+
+            /**
+             * @return bytes taken, -1 on failure
+             */
+            int32_t Write(const uint8_t* data, uint32_t size);
+
+            /**
+             * Write what is buffered
+             */
+            int32_t Flush();
+
+            /**
+             * @param whence SEEK_SET, SEEK_CUR or SEEK_END
+             */
+            int32_t Seek(int32_t offset, int whence);
+
+            uint32_t Tell() const;
+
+            /**
+             * @return bytes in the file, with those still buffered
+             */
+            uint32_t Size() const;
+
+            const FileStreamStats& GetStats() const;
+
+        private:
+            enum BufferState {
+                BUFFER_EMPTY,
+                BUFFER_READ,                    //!< bytes read ahead from _start
+                BUFFER_WRITE                    //!< bytes to be written at _start
+            };
+
+            /**
+             * Fill the buffer at _position with want bytes, or the read ahead size if more
+             * @return bytes buffered, 0 at the end of the file, -1 on failure
+             */
+            int32_t Fill(uint32_t want);
+
+            /**
+             * Move the file to position if it is elsewhere
+             */
+            int32_t SeekFile(uint32_t position);
+
+            FileDevice& _file;
+            uint8_t* _buffer;
+            uint32_t _size;
+            uint32_t _readAhead;
+            BufferState _state;
+            uint32_t _start;                    //!< file offset of the buffer
+            uint32_t _length;                   //!< bytes in the buffer
+            uint32_t _position;
+            bool _sequential;                   //!< the next read follows on from the last
+            FileStreamStats _stats;
+    };
+
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef APPLICATION_PAYLOAD_H_
+#define APPLICATION_PAYLOAD_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define APP_MAX_PAYLOAD_SIZE  (242)
+
+/**
+ * Fixed capacity payload for application layer package commands.
+ *
+ * Holds up to APP_MAX_PAYLOAD_SIZE bytes inline so building or parsing a port
+ * 200/201/202 command never touches the heap.  The vector style members
+ * (push_back, at, size, clear, data) match their use on ApplicationMessage::payload
+ * so packages can switch between the two.  The append and read methods keep a
+ * cursor, fail instead of growing or overrunning, and multi-byte values are
+ * little endian as in the LoRaWAN application layer specifications.
+ */
+class ApplicationPayload
+{
+public:
+   ApplicationPayload() : _size(0), _cursor(0) { }
+
+   ApplicationPayload(const uint8_t* data, uint8_t size) : _size(0), _cursor(0)
+   {
+      append(data, size);
+   }
+
+   uint8_t size() const { return _size; }
+   uint8_t capacity() const { return APP_MAX_PAYLOAD_SIZE; }
+   bool empty() const { return _size == 0; }
+   bool full() const { return _size == APP_MAX_PAYLOAD_SIZE; }
+
+   uint8_t* data() { return _data; }
+   const uint8_t* data() const { return _data; }
+   const uint8_t* begin() const { return _data; }
+   const uint8_t* end() const { return _data + _size; }
+
+   uint8_t& operator[](uint8_t index) { return _data[index]; }
+   uint8_t operator[](uint8_t index) const { return _data[index]; }
+
+   /** Bounds checked access, returns 0 past the end instead of throwing */
+   uint8_t at(uint8_t index) const { return index < _size ? _data[index] : 0; }
+
+   void clear()
+   {
+      _size = 0;
+      _cursor = 0;
+   }
+
+   /** Drop bytes past size, e.g. after writing into data() directly */
+   bool resize(uint8_t size)
+   {
+      if (size > APP_MAX_PAYLOAD_SIZE)
+         return false;
+      _size = size;
+      if (_cursor > _size)
+         _cursor = _size;
+      return true;
+   }
+
+   bool push_back(uint8_t value) { return appendU8(value); }
+
+   bool appendU8(uint8_t value)
+   {
+      if (_size == APP_MAX_PAYLOAD_SIZE)
+         return false;
+      _data[_size++] = value;
+      return true;
+   }
+
+   bool appendU16(uint16_t value)
+   {
+      if (APP_MAX_PAYLOAD_SIZE - _size < 2)
+         return false;
+      _data[_size++] = value & 0xFF;
+      _data[_size++] = value >> 8;
+      return true;
+   }
+
+   bool appendU24(uint32_t value)
+   {
+      if (APP_MAX_PAYLOAD_SIZE - _size < 3)
+         return false;
+      _data[_size++] = value & 0xFF;
+      _data[_size++] = (value >> 8) & 0xFF;
+      _data[_size++] = (value >> 16) & 0xFF;
+      return true;
+   }
+
+   bool appendU32(uint32_t value)
+   {
+      if (APP_MAX_PAYLOAD_SIZE - _size < 4)
+         return false;
+      _data[_size++] = value & 0xFF;
+      _data[_size++] = (value >> 8) & 0xFF;
+      _data[_size++] = (value >> 16) & 0xFF;
+      _data[_size++] = value >> 24;
+      return true;
+   }
+
+   bool append(const uint8_t* data, uint8_t size)
+   {
+      if (APP_MAX_PAYLOAD_SIZE - _size < size)
+         return false;
+      memcpy(&_data[_size], data, size);
+      _size += size;
+      return true;
+   }
+
+   /** Number of bytes left to read after the cursor */
+   uint8_t remaining() const { return _size - _cursor; }
+
+   /** Move the read cursor, e.g. back to 0 to parse again */
+   bool seek(uint8_t position)
+   {
+      if (position > _size)
+         return false;
+      _cursor = position;
+      return true;
+   }
+
+   uint8_t position() const { return _cursor; }
+
+   bool readU8(uint8_t& value)
+   {
+      if (remaining() < 1)
+         return false;
+      value = _data[_cursor++];
+      return true;
+   }
+
+   bool readU16(uint16_t& value)
+   {
+      if (remaining() < 2)
+         return false;
+      value = _data[_cursor] | (_data[_cursor + 1] << 8);
+      _cursor += 2;
+      return true;
+   }
+
+   bool readU24(uint32_t& value)
+   {
+      if (remaining() < 3)
+         return false;
+      value = _data[_cursor] | (_data[_cursor + 1] << 8) | ((uint32_t) _data[_cursor + 2] << 16);
+      _cursor += 3;
+      return true;
+   }
+
+   bool readU32(uint32_t& value)
+   {
+      if (remaining() < 4)
+         return false;
+      value = _data[_cursor] | (_data[_cursor + 1] << 8) | ((uint32_t) _data[_cursor + 2] << 16) | ((uint32_t) _data[_cursor + 3] << 24);
+      _cursor += 4;
+      return true;
+   }
+
+   /** Copy bytes out, or pass NULL to skip them */
+   bool read(uint8_t* data, uint8_t size)
+   {
+      if (remaining() < size)
+         return false;
+      if (data != NULL)
+         memcpy(data, &_data[_cursor], size);
+      _cursor += size;
+      return true;
+   }
+
+   /** Pointer to the unread bytes without copying */
+   const uint8_t* peek() const { return &_data[_cursor]; }
+
+private:
+   uint8_t _data[APP_MAX_PAYLOAD_SIZE];
+   uint8_t _size;
+   uint8_t _cursor;
+};
+
+#endif // APPLICATION_PAYLOAD_H_
@@ -0,0 +1,299 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#ifdef FOTA
+#include "DeltaPatch.h"
+#include "crc64.h"
+#include "MTSLog.h"
+#include <algorithm>
+
+static const uint8_t DELTA_PATCH_MAGIC[4] = { 'M', 'T', 'D', '2' };
+
+static uint32_t readU32(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+DeltaPatch::DeltaPatch(const uint8_t* source, uint32_t source_size, Callback<int32_t(const uint8_t*, uint32_t)> sink)
+  : _source(source),
+    _source_size(source_size),
+    _sink(sink)
+{
+#if FLASH_RECORD_STORE_FILE_ENABLE
+    _file = NULL;
+#endif
+    reset();
+}
+
+#if FLASH_RECORD_STORE_FILE_ENABLE
+DeltaPatch::DeltaPatch(const uint8_t* source, uint32_t source_size, mts::FlashFileRecord* target)
+  : DeltaPatch(source, source_size, callback(this, &DeltaPatch::writeFile))
+{
+    _file = target;
+}
+
+int32_t DeltaPatch::writeFile(const uint8_t* data, uint32_t size)
+{
+    return _file->write(const_cast<uint8_t*>(data), size);
+}
+#endif
+
+void DeltaPatch::reset()
+{
+    _state = HEADER;
+    _varint = 0;
+    _shift = 0;
+    _remaining = 0;
+    _cursor = 0;
+    _target_size = 0;
+    _target_crc = 0;
+    _crc = 0;
+    _written = 0;
+    _buffered = 0;
+}
+
+bool DeltaPatch::complete() const
+{
+    return _state == DONE;
+}
+
+uint32_t DeltaPatch::written() const
+{
+    return _written;
+}
+
+uint32_t DeltaPatch::targetSize() const
+{
+    return _target_size;
+}
+
+int32_t DeltaPatch::apply(const uint8_t* patch, uint32_t size)
+{
+    int32_t ret;
+
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t byte = patch[i];
+
+        switch (_state) {
+            case HEADER:
+                _header[_remaining++] = byte;
+                if (_remaining == DELTA_PATCH_HEADER_SIZE) {
+                    if ((ret = parseHeader()) != DELTA_OK) {
+                        return fail(ret);
+                    }
+                    _remaining = 0;
+                    if (_target_size == 0) {
+                        if ((ret = finish()) != DELTA_OK) {
+                            return fail(ret);
+                        }
+                    } else {
+                        _state = COPY_LENGTH;
+                    }
+                }
+                break;
+
+            case COPY_LENGTH:
+                if ((ret = readVarint(byte)) < 0) {
+                    return fail(ret);
+                } else if (ret > 0) {
+                    if (_varint > _source_size - _cursor || _varint > _target_size - _written) {
+                        logError("Delta record copies past the end of the image");
+                        return fail(DELTA_ERR_FORMAT);
+                    }
+                    if ((ret = copy(_varint)) != DELTA_OK) {
+                        return fail(ret);
+                    }
+                    _state = EXTRA_LENGTH;
+                }
+                break;
+
+            case EXTRA_LENGTH:
+                if ((ret = readVarint(byte)) < 0) {
+                    return fail(ret);
+                } else if (ret > 0) {
+                    if (_varint > _target_size - _written) {
+                        logError("Delta record writes past the end of the image");
+                        return fail(DELTA_ERR_FORMAT);
+                    }
+                    _remaining = _varint;
+                    _state = _remaining == 0 ? SEEK : EXTRA;
+                }
+                break;
+
+            case EXTRA:
+                if ((ret = emit(byte)) != DELTA_OK) {
+                    return fail(ret);
+                }
+                if (--_remaining == 0) {
+                    _state = SEEK;
+                }
+                break;
+
+            case SEEK:
+                if ((ret = readVarint(byte)) < 0) {
+                    return fail(ret);
+                } else if (ret > 0) {
+                    // zigzag decode
+                    int64_t cursor = (int64_t) _cursor + (int32_t) ((_varint >> 1) ^ -(int32_t) (_varint & 1));
+                    if (cursor < 0 || cursor > _source_size) {
+                        logError("Delta record seeks outside the source image");
+                        return fail(DELTA_ERR_FORMAT);
+                    }
+                    _cursor = (uint32_t) cursor;
+
+                    if (_written == _target_size) {
+                        if ((ret = finish()) != DELTA_OK) {
+                            return fail(ret);
+                        }
+                    } else {
+                        _state = COPY_LENGTH;
+                    }
+                }
+                break;
+
+            case DONE:
+                // fragment padding
+                return DELTA_OK;
+
+            case FAILED:
+                return DELTA_ERR_FORMAT;
+        }
+    }
+
+    return DELTA_OK;
+}
+
+int32_t DeltaPatch::parseHeader()
+{
+    if (memcmp(_header, DELTA_PATCH_MAGIC, sizeof(DELTA_PATCH_MAGIC)) != 0) {
+        logError("Delta patch magic mismatch");
+        return DELTA_ERR_HEADER;
+    }
+
+    uint32_t source_size = readU32(_header + 4);
+    _target_size = readU32(_header + 8);
+    uint64_t source_crc = readU32(_header + 12) | ((uint64_t) readU32(_header + 16) << 32);
+    _target_crc = readU32(_header + 20) | ((uint64_t) readU32(_header + 24) << 32);
+
+    if (source_size != _source_size) {
+        logError("Delta patch made for a %lu byte image, running image is %lu bytes",
+                 (unsigned long) source_size, (unsigned long) _source_size);
+        return DELTA_ERR_SOURCE;
+    }
+
+    if (crc64(0, _source, _source_size) != source_crc) {
+        logError("Delta patch made for a different image");
+        return DELTA_ERR_SOURCE;
+    }
+
+    return DELTA_OK;
+}
+
+int32_t DeltaPatch::readVarint(uint8_t byte)
+{
+    if (_shift == 28 && (byte & 0xF0)) {
+        logError("Delta patch varint overflow");
+        return DELTA_ERR_FORMAT;
+    }
+
+    if (_shift == 0) {
+        _varint = 0;
+    }
+    _varint |= (uint32_t) (byte & 0x7F) << _shift;
+
+    if (byte & 0x80) {
+        _shift += 7;
+        return 0;
+    }
+
+    _shift = 0;
+    return 1;
+}
+
+int32_t DeltaPatch::emit(uint8_t byte)
+{
+    _buffer[_buffered++] = byte;
+    _written++;
+
+    if (_buffered == sizeof(_buffer)) {
+        return flush();
+    }
+
+    return DELTA_OK;
+}
+
+int32_t DeltaPatch::copy(uint32_t size)
+{
+    int32_t ret;
+
+    while (size > 0) {
+        uint32_t chunk = std::min<uint32_t>(size, sizeof(_buffer) - _buffered);
+        memcpy(_buffer + _buffered, _source + _cursor, chunk);
+        _buffered += chunk;
+        _cursor += chunk;
+        _written += chunk;
+        size -= chunk;
+
+        if (_buffered == sizeof(_buffer) && (ret = flush()) != DELTA_OK) {
+            return ret;
+        }
+    }
+
+    return DELTA_OK;
+}
+
+int32_t DeltaPatch::flush()
+{
+    if (_buffered == 0) {
+        return DELTA_OK;
+    }
+
+    int32_t ret = _sink(_buffer, _buffered);
+    if (ret != _buffered) {
+        logError("Delta patch target write failed %ld", (long) ret);
+        return DELTA_ERR_WRITE;
+    }
+
+    _crc = crc64(_crc, _buffer, _buffered);
+    _buffered = 0;
+    return DELTA_OK;
+}
+
+int32_t DeltaPatch::finish()
+{
+    int32_t ret = flush();
+    if (ret != DELTA_OK) {
+        return ret;
+    }
+
+    if (_crc != _target_crc) {
+        logError("Delta patch rebuilt a different image");
+        return DELTA_ERR_TARGET;
+    }
+
+    logInfo("Delta patch applied, %lu bytes", (unsigned long) _written);
+    _state = DONE;
+    return DELTA_OK;
+}
+
+int32_t DeltaPatch::fail(int32_t error)
+{
+    _state = FAILED;
+    return error;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#ifndef _DELTA_PATCH_H
+#define _DELTA_PATCH_H
+#ifdef FOTA
+
+#include "mbed.h"
+#include "FlashRecord.h"
+
+#define DELTA_PATCH_HEADER_SIZE     (28)
+#define DELTA_PATCH_BUFFER_SIZE     (128)
+
+/**
+ * Streaming applier for delta firmware images made by tools/fota_delta.py.
+ *
+ * The patch is a header followed by bsdiff style control records, each of which is
+ *   copy length               bytes copied unchanged from the source cursor
+ *   extra length, extra bytes copied to the target as is
+ *   seek                      signed move of the source cursor
+ * Lengths are LEB128 varints and the seek is a zigzag varint.  Code that
+ * only moved costs a few bytes per record, a changed word costs the word
+ * plus a record.  The header
+ * holds the magic "MTD2", the source and target sizes and the crc64 of the
+ * source and of the target image.  The source crc64 is checked before any
+ * output is written so a patch built for another firmware version is
+ * rejected, the target crc64 is checked over the bytes written once the last
+ * record is applied.
+ *
+ * apply() accepts the patch in pieces of any size as contiguous prefixes of
+ * the fragmented file become available, and only keeps a small output buffer,
+ * so the new image is rebuilt into the target while fragments stream in.
+ * Fragmented files are padded to a whole number of fragments, bytes after
+ * the last record are ignored.  complete() only becomes true once the target
+ * holds target size bytes with the crc64 from the header, so the image can be
+ * handed to the bootloader.
+ */
+class DeltaPatch {
+    public:
+        enum Result {
+            DELTA_OK = 0,
+            DELTA_ERR_HEADER = -1,      //!< bad magic or sizes
+            DELTA_ERR_SOURCE = -2,      //!< source image does not match the patch
+            DELTA_ERR_FORMAT = -3,      //!< record points outside the source or target
+            DELTA_ERR_WRITE = -4,       //!< target write failed
+            DELTA_ERR_TARGET = -5       //!< rebuilt image does not match the patch
+        };
+
+        /**
+         * @param source running image the patch was made against, e.g. the application in internal flash
+         * @param source_size bytes in the source image
+         * @param sink called with the rebuilt image in order, returns bytes written or a negative error
+         */
+        DeltaPatch(const uint8_t* source, uint32_t source_size, Callback<int32_t(const uint8_t*, uint32_t)> sink);
+
+#if FLASH_RECORD_STORE_FILE_ENABLE
+        /**
+         * @param source running image the patch was made against
+         * @param source_size bytes in the source image
+         * @param target file record the new image is written to from its current position
+         */
+        DeltaPatch(const uint8_t* source, uint32_t source_size, mts::FlashFileRecord* target);
+#endif
+
+        /**
+         * Apply the next piece of the patch
+         * @param patch bytes following the ones passed before
+         * @param size number of bytes
+         * @return DELTA_OK or a negative Result, the patch can not continue after an error
+         */
+        int32_t apply(const uint8_t* patch, uint32_t size);
+
+        /**
+         * Start over with a new patch
+         */
+        void reset();
+
+        /**
+         * True once the whole target image has been written
+         */
+        bool complete() const;
+
+        /**
+         * Bytes of the target image written so far
+         */
+        uint32_t written() const;
+
+        /**
+         * Size of the target image from the patch header, 0 until the header was read
+         */
+        uint32_t targetSize() const;
+
+    private:
+        enum State {
+            HEADER,
+            COPY_LENGTH,
+            EXTRA_LENGTH,
+            EXTRA,
+            SEEK,
+            DONE,
+            FAILED
+        };
+
+        int32_t parseHeader();
+        int32_t readVarint(uint8_t byte);
+        int32_t emit(uint8_t byte);
+        int32_t copy(uint32_t size);
+        int32_t flush();
+        int32_t finish();
+        int32_t fail(int32_t error);
+
+#if FLASH_RECORD_STORE_FILE_ENABLE
+        int32_t writeFile(const uint8_t* data, uint32_t size);
+        mts::FlashFileRecord* _file;
+#endif
+
+        const uint8_t* _source;
+        uint32_t _source_size;
+        Callback<int32_t(const uint8_t*, uint32_t)> _sink;
+
+        State _state;
+        uint8_t _header[DELTA_PATCH_HEADER_SIZE];
+        uint32_t _varint;
+        uint8_t _shift;
+        uint32_t _remaining;
+        uint32_t _cursor;
+        uint32_t _target_size;
+        uint64_t _target_crc;
+        uint64_t _crc;                  // of the bytes flushed to the target
+        uint32_t _written;
+        uint8_t _buffer[DELTA_PATCH_BUFFER_SIZE];
+        uint16_t _buffered;
+};
+
+#endif
+#endif // _DELTA_PATCH_H
@@ -0,0 +1,167 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#include "FragmentIngestQueue.h"
+#include "Fota.h"
+#include "MTSLog.h"
+#include "PerfStats.h"
+
+// DataFragment command id and header size, Fragmented Data Block Transport v1.0.0
+#define DATA_FRAGMENT_CID       (0x08)
+#define DATA_FRAGMENT_HEADER    (3)
+
+// port and size ahead of each payload in the ring
+#define INGEST_HEADER           (2)
+#define INGEST_FLAG             (0x01)
+
+FragmentIngestQueue::FragmentIngestQueue()
+    : _ring(FRAG_INGEST_SLOTS * (INGEST_HEADER + APP_MAX_PAYLOAD_SIZE)),
+      _worker(NULL),
+      _pending(0),
+      _high_water(0),
+      _dropped(0),
+      _rejected(0)
+{
+}
+
+FragmentIngestQueue::~FragmentIngestQueue()
+{
+    if (_worker != NULL) {
+        _worker->terminate();
+        delete _worker;
+    }
+}
+
+void FragmentIngestQueue::start(osPriority priority)
+{
+    if (_worker != NULL) {
+        return;
+    }
+
+    _worker = new Thread(priority, LORA_APP_LAYER_STACK_SIZE, NULL, "frag-ingest");
+    _worker->start(callback(this, &FragmentIngestQueue::run));
+    _worker->flags_set(INGEST_FLAG);
+}
+
+bool FragmentIngestQueue::enqueue(const uint8_t* payload, uint8_t port, uint8_t size)
+{
+    if (port != APP_PORT_MULTICAST && port != APP_PORT_FRAGMENTATION && port != APP_PORT_CLOCK_SYNC) {
+        _rejected++;
+        return false;
+    }
+
+    if (size == 0 || size > APP_MAX_PAYLOAD_SIZE) {
+        _rejected++;
+        return false;
+    }
+
+    if (port == APP_PORT_FRAGMENTATION && payload[0] == DATA_FRAGMENT_CID && !validFragment(payload, size)) {
+        _rejected++;
+        return false;
+    }
+
+    if (_ring.remaining() < INGEST_HEADER + size) {
+        _dropped++;
+        return false;
+    }
+
+    const uint8_t header[INGEST_HEADER] = { port, size };
+    _ring.write((const char*) header, sizeof(header));
+    _ring.write((const char*) payload, size);
+
+    // counted only once all of its bytes are in the ring, the worker reads no further
+    uint16_t pending = ++_pending;
+    if (pending > _high_water) {
+        _high_water = pending;
+    }
+
+    if (_worker != NULL) {
+        _worker->flags_set(INGEST_FLAG);
+    }
+    return true;
+}
+
+uint16_t FragmentIngestQueue::drain()
+{
+    uint16_t batch = 0;
+
+    while (_pending > 0) {
+        uint8_t header[INGEST_HEADER];
+        _ring.read((char*) header, sizeof(header));
+
+        _rx.clear();
+        _ring.read((char*) _rx.data(), header[1]);
+        _rx.resize(header[1]);
+
+        uint8_t port = header[0];
+        bool fragment = port == APP_PORT_FRAGMENTATION && _rx[0] == DATA_FRAGMENT_CID;
+        uint32_t start = us_ticker_read();
+
+        Fota::getInstance()->processCmd(_rx.data(), port, _rx.size());
+
+        if (fragment) {
+            lora::PerfStats::Global().Record(lora::PERF_FOTA_FRAGMENT, us_ticker_read() - start);
+        }
+        --_pending;
+        batch++;
+    }
+
+    return batch;
+}
+
+uint16_t FragmentIngestQueue::pending() const
+{
+    return _pending;
+}
+
+uint16_t FragmentIngestQueue::highWater() const
+{
+    return _high_water;
+}
+
+uint32_t FragmentIngestQueue::dropped() const
+{
+    return _dropped;
+}
+
+uint32_t FragmentIngestQueue::rejected() const
+{
+    return _rejected;
+}
+
+bool FragmentIngestQueue::validFragment(const uint8_t* payload, uint8_t size)
+{
+    if (size <= DATA_FRAGMENT_HEADER) {
+        return false;
+    }
+
+    // IndexAndN: fragment number N in bits 0-13 starting at 1, session index in bits 14-15
+    uint16_t index_and_n = payload[1] | (payload[2] << 8);
+    return (index_and_n & 0x3FFF) != 0;
+}
+
+void FragmentIngestQueue::run()
+{
+    for (;;) {
+        ThisThread::flags_wait_any(INGEST_FLAG);
+
+        // everything that arrived while the previous batch was written
+        uint16_t batch = drain();
+
+        logTrace("Processed %d queued application layer messages", batch);
+    }
+}
@@ -0,0 +1,104 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#ifndef _FRAGMENT_INGEST_QUEUE_H
+#define _FRAGMENT_INGEST_QUEUE_H
+
+#include "mbed.h"
+#include "ApplicationPayload.h"
+#include "MTSSpscCircularBuffer.h"
+#include <atomic>
+
+#ifndef FRAG_INGEST_SLOTS
+#define FRAG_INGEST_SLOTS 8
+#endif
+
+/**
+ * Moves application layer package downlinks off the MAC receive path.
+ *
+ * enqueue() is called from PacketRx instead of Fota::processCmd().  It checks
+ * the port and, for DATA_FRAGMENT, the fragment header, then copies the port,
+ * size and payload into a preallocated single producer, single consumer ring
+ * with room for FRAG_INGEST_SLOTS full size messages and returns, so the
+ * receive window can reopen right away.  A worker thread drains every queued
+ * message per wake up into Fota::processCmd(), where the flash write and the
+ * parity math run.  Control commands share the queue so they stay ordered with
+ * the fragments around them.
+ *
+ * The ring takes no lock, so enqueue() must only be called from one context
+ * and drain() only from the worker.
+ */
+class FragmentIngestQueue {
+    public:
+        FragmentIngestQueue();
+        ~FragmentIngestQueue();
+
+        /**
+         * Start the worker thread
+         * @param priority should be below the MAC threads
+         */
+        void start(osPriority priority = osPriorityBelowNormal);
+
+        /**
+         * Queue a downlink for the application layer packages
+         * @param payload received bytes
+         * @param port port 200, 201 or 202
+         * @param size number of received bytes
+         * @return false if the message was rejected or no slot was free
+         */
+        bool enqueue(const uint8_t* payload, uint8_t port, uint8_t size);
+
+        /**
+         * Hand every queued message to Fota::processCmd() in order, the worker thread runs it per wake up
+         * @return number of messages processed
+         */
+        uint16_t drain();
+
+        /**
+         * Number of messages waiting for the worker
+         */
+        uint16_t pending() const;
+
+        /**
+         * Largest number of messages waiting at the same time
+         */
+        uint16_t highWater() const;
+
+        /**
+         * Number of messages lost because the ring was full
+         */
+        uint32_t dropped() const;
+
+        /**
+         * Number of messages with a bad port or fragment header
+         */
+        uint32_t rejected() const;
+
+    private:
+        void run();
+        static bool validFragment(const uint8_t* payload, uint8_t size);
+
+        mts::MTSSpscCircularBuffer _ring;
+        ApplicationPayload _rx;             //!< worker side copy of the message being processed
+        Thread* _worker;
+        std::atomic<uint16_t> _pending;
+        uint16_t _high_water;
+        uint32_t _dropped;
+        uint32_t _rejected;
+};
+
+#endif // _FRAGMENT_INGEST_QUEUE_H
@@ -0,0 +1,275 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#ifdef FOTA
+#include "LzDecoder.h"
+#include "MTSLog.h"
+#include <algorithm>
+
+static const uint8_t LZ_MAGIC[4] = { 'M', 'T', 'Z', '1' };
+static const uint32_t LZ_WINDOW_MASK = (1 << LZ_WINDOW_BITS) - 1;
+
+LzDecoder::LzDecoder(Callback<int32_t(const uint8_t*, uint32_t)> sink)
+  : _sink(sink)
+{
+#if FLASH_RECORD_STORE_FILE_ENABLE
+    _file = NULL;
+#endif
+    reset();
+}
+
+#if FLASH_RECORD_STORE_FILE_ENABLE
+LzDecoder::LzDecoder(mts::FlashFileRecord* target)
+  : LzDecoder(callback(this, &LzDecoder::writeFile))
+{
+    _file = target;
+}
+
+int32_t LzDecoder::writeFile(const uint8_t* data, uint32_t size)
+{
+    return _file->write(const_cast<uint8_t*>(data), size);
+}
+#endif
+
+void LzDecoder::reset()
+{
+    _state = HEADER;
+    _token = 0;
+    _length = 0;
+    _offset = 0;
+    _window_size = 0;
+    _image_size = 0;
+    _written = 0;
+    _flushed = 0;
+}
+
+bool LzDecoder::complete() const
+{
+    return _state == DONE;
+}
+
+uint32_t LzDecoder::written() const
+{
+    return _written;
+}
+
+uint32_t LzDecoder::imageSize() const
+{
+    return _image_size;
+}
+
+int32_t LzDecoder::decode(const uint8_t* data, uint32_t size)
+{
+    int32_t ret = LZ_OK;
+
+    for (uint32_t i = 0; i < size && ret == LZ_OK; i++) {
+        uint8_t byte = data[i];
+
+        switch (_state) {
+            case HEADER:
+                _header[_length++] = byte;
+                if (_length == LZ_HEADER_SIZE) {
+                    if ((ret = parseHeader()) == LZ_OK) {
+                        _length = 0;
+                        _state = _image_size == 0 ? DONE : TOKEN;
+                    }
+                }
+                break;
+
+            case TOKEN:
+                _token = byte;
+                _length = byte >> 4;
+                if (_length == 15) {
+                    _state = LITERAL_LENGTH;
+                } else {
+                    ret = startLiterals();
+                }
+                break;
+
+            case LITERAL_LENGTH:
+                _length += byte;
+                if (_length > _image_size) {
+                    ret = LZ_ERR_FORMAT;
+                } else if (byte != 255) {
+                    ret = startLiterals();
+                }
+                break;
+
+            case LITERALS:
+                if ((ret = put(byte)) == LZ_OK && --_length == 0) {
+                    ret = endLiterals();
+                }
+                break;
+
+            case OFFSET_LOW:
+                _offset = byte;
+                _state = OFFSET_HIGH;
+                break;
+
+            case OFFSET_HIGH:
+                _offset |= byte << 8;
+                if (_offset == 0 || _offset > _window_size || _offset > _written) {
+                    logError("LZ offset %u outside the window", _offset);
+                    ret = LZ_ERR_FORMAT;
+                    break;
+                }
+                _length = _token & 0x0F;
+                if (_length == 15) {
+                    _state = MATCH_LENGTH;
+                } else {
+                    ret = match();
+                }
+                break;
+
+            case MATCH_LENGTH:
+                _length += byte;
+                if (_length > _image_size) {
+                    ret = LZ_ERR_FORMAT;
+                } else if (byte != 255) {
+                    ret = match();
+                }
+                break;
+
+            case DONE:
+                // fragment padding
+                return LZ_OK;
+
+            case FAILED:
+                return LZ_ERR_FORMAT;
+        }
+    }
+
+    if (ret != LZ_OK) {
+        return fail(ret);
+    }
+
+    return LZ_OK;
+}
+
+int32_t LzDecoder::parseHeader()
+{
+    if (memcmp(_header, LZ_MAGIC, sizeof(LZ_MAGIC)) != 0) {
+        logError("LZ magic mismatch");
+        return LZ_ERR_HEADER;
+    }
+
+    _image_size = _header[4] | (_header[5] << 8) | (_header[6] << 16) | ((uint32_t) _header[7] << 24);
+
+    uint8_t bits = _header[8];
+    if (bits == 0 || bits > LZ_WINDOW_BITS) {
+        logError("LZ window of %u bits, decoder supports %u", bits, LZ_WINDOW_BITS);
+        return LZ_ERR_HEADER;
+    }
+    _window_size = 1 << bits;
+
+    return LZ_OK;
+}
+
+int32_t LzDecoder::startLiterals()
+{
+    if (_length > _image_size - _written) {
+        logError("LZ literals past the end of the image");
+        return LZ_ERR_FORMAT;
+    }
+
+    if (_length == 0) {
+        return endLiterals();
+    }
+
+    _state = LITERALS;
+    return LZ_OK;
+}
+
+int32_t LzDecoder::endLiterals()
+{
+    if (_written == _image_size) {
+        int32_t ret = flush();
+        if (ret == LZ_OK) {
+            logInfo("LZ image decompressed, %lu bytes", (unsigned long) _written);
+            _state = DONE;
+        }
+        return ret;
+    }
+
+    _state = OFFSET_LOW;
+    return LZ_OK;
+}
+
+int32_t LzDecoder::match()
+{
+    int32_t ret;
+    uint32_t length = _length + LZ_MIN_MATCH;
+
+    if (length > _image_size - _written) {
+        logError("LZ match past the end of the image");
+        return LZ_ERR_FORMAT;
+    }
+
+    // byte by byte, a match may overlap the bytes it produces
+    while (length--) {
+        if ((ret = put(_window[(_written - _offset) & LZ_WINDOW_MASK])) != LZ_OK) {
+            return ret;
+        }
+    }
+
+    if (_written == _image_size) {
+        return endLiterals();
+    }
+
+    _state = TOKEN;
+    return LZ_OK;
+}
+
+int32_t LzDecoder::put(uint8_t byte)
+{
+    int32_t ret;
+
+    if (_written - _flushed == sizeof(_window) && (ret = flush()) != LZ_OK) {
+        return ret;
+    }
+
+    _window[_written & LZ_WINDOW_MASK] = byte;
+    _written++;
+    return LZ_OK;
+}
+
+int32_t LzDecoder::flush()
+{
+    // the unwritten output may wrap around the end of the window
+    while (_flushed != _written) {
+        uint32_t start = _flushed & LZ_WINDOW_MASK;
+        uint32_t size = std::min<uint32_t>(_written - _flushed, sizeof(_window) - start);
+
+        int32_t ret = _sink(_window + start, size);
+        if (ret != (int32_t) size) {
+            logError("LZ target write failed %ld", (long) ret);
+            return LZ_ERR_WRITE;
+        }
+
+        _flushed += size;
+    }
+
+    return LZ_OK;
+}
+
+int32_t LzDecoder::fail(int32_t error)
+{
+    _state = FAILED;
+    return error;
+}
+
+#endif
@@ -0,0 +1,142 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#ifndef _LZ_DECODER_H
+#define _LZ_DECODER_H
+#ifdef FOTA
+
+#include "mbed.h"
+#include "FlashRecord.h"
+
+#ifndef LZ_WINDOW_BITS
+// largest window accepted, also the RAM used by the decoder
+#define LZ_WINDOW_BITS 10
+#endif
+
+#define LZ_HEADER_SIZE      (9)
+#define LZ_MIN_MATCH        (3)
+
+/**
+ * Streaming decompressor for images compressed by tools/fota_lz.py.
+ *
+ * The format is LZ4 style sequences over a small window:
+ *   token              literal count in the high nibble, match length - 3 in the low nibble
+ *   [count bytes]      a nibble of 15 continues with bytes added until one is below 255
+ *   literals
+ *   offset             u16 little endian distance back into the output, 1 to window size
+ *   [length bytes]
+ * The last sequence ends after its literals.  The header holds the magic
+ * "MTZ1", the uncompressed size and the window bits used by the compressor.
+ *
+ * The window doubles as the output buffer, so the decoder needs
+ * 1 << LZ_WINDOW_BITS bytes of RAM whatever the image size.  Data can be
+ * fed as contiguous prefixes of the fragmented file become available or all
+ * at once at completion, and the output is written to the target in window
+ * sized blocks.  Bytes after the end of the stream, e.g. fragment padding,
+ * are ignored.
+ */
+class LzDecoder {
+    public:
+        enum Result {
+            LZ_OK = 0,
+            LZ_ERR_HEADER = -1,     //!< bad magic or window larger than LZ_WINDOW_BITS
+            LZ_ERR_FORMAT = -2,     //!< offset outside the window or output past the end
+            LZ_ERR_WRITE = -3       //!< target write failed
+        };
+
+        /**
+         * @param sink called with the decompressed image in order, returns bytes written or a negative error
+         */
+        LzDecoder(Callback<int32_t(const uint8_t*, uint32_t)> sink);
+
+#if FLASH_RECORD_STORE_FILE_ENABLE
+        /**
+         * @param target file record the image is written to from its current position
+         */
+        LzDecoder(mts::FlashFileRecord* target);
+#endif
+
+        /**
+         * Decompress the next piece of the stream
+         * @param data bytes following the ones passed before
+         * @param size number of bytes
+         * @return LZ_OK or a negative Result, the stream can not continue after an error
+         */
+        int32_t decode(const uint8_t* data, uint32_t size);
+
+        /**
+         * Start over with a new stream
+         */
+        void reset();
+
+        /**
+         * True once the whole image has been written to the target
+         */
+        bool complete() const;
+
+        /**
+         * Bytes decompressed so far
+         */
+        uint32_t written() const;
+
+        /**
+         * Uncompressed size from the header, 0 until the header was read
+         */
+        uint32_t imageSize() const;
+
+    private:
+        enum State {
+            HEADER,
+            TOKEN,
+            LITERAL_LENGTH,
+            LITERALS,
+            OFFSET_LOW,
+            OFFSET_HIGH,
+            MATCH_LENGTH,
+            DONE,
+            FAILED
+        };
+
+        int32_t parseHeader();
+        int32_t put(uint8_t byte);
+        int32_t match();
+        int32_t startLiterals();
+        int32_t endLiterals();
+        int32_t flush();
+        int32_t fail(int32_t error);
+
+#if FLASH_RECORD_STORE_FILE_ENABLE
+        int32_t writeFile(const uint8_t* data, uint32_t size);
+        mts::FlashFileRecord* _file;
+#endif
+
+        Callback<int32_t(const uint8_t*, uint32_t)> _sink;
+
+        State _state;
+        uint8_t _header[LZ_HEADER_SIZE];
+        uint8_t _token;
+        uint32_t _length;
+        uint16_t _offset;
+        uint32_t _window_size;
+        uint32_t _image_size;
+        uint32_t _written;
+        uint32_t _flushed;
+        uint8_t _window[1 << LZ_WINDOW_BITS];
+};
+
+#endif
+#endif // _LZ_DECODER_H
@@ -0,0 +1,194 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#include "DeadlineQueue.h"
+
+using namespace std::chrono;
+
+DeadlineQueue::DeadlineQueue()
+    : _count(0),
+      _offset(0)
+{
+    _clock.start();
+}
+
+DeadlineQueue::~DeadlineQueue()
+{
+    _timer.detach();
+}
+
+void DeadlineQueue::attach(Callback<void(uint8_t, uint8_t)> callback)
+{
+    _callback = callback;
+}
+
+bool DeadlineQueue::schedule(uint8_t id, uint8_t event, us_timestamp_t delay)
+{
+    CriticalSectionLock lock;
+
+    int index = find(id, event);
+    if (index >= 0) {
+        remove(index);
+    } else if (_count == MC_DEADLINE_QUEUE_SIZE) {
+        return false;
+    }
+
+    // stored without the clock corrections so rebase() never has to touch the entries
+    int64_t time = now() + delay - _offset;
+
+    int i = _count;
+    while (i > 0 && _queue[i - 1].time > time) {
+        _queue[i] = _queue[i - 1];
+        i--;
+    }
+    _queue[i].time = time;
+    _queue[i].id = id;
+    _queue[i].event = event;
+    _count++;
+
+    if (i == 0 || index == 0) {
+        arm();
+    }
+
+    return true;
+}
+
+bool DeadlineQueue::cancel(uint8_t id, uint8_t event)
+{
+    CriticalSectionLock lock;
+
+    int index = find(id, event);
+    if (index < 0) {
+        return false;
+    }
+
+    remove(index);
+    if (index == 0) {
+        arm();
+    }
+
+    return true;
+}
+
+void DeadlineQueue::cancelAll(uint8_t id)
+{
+    CriticalSectionLock lock;
+
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_queue[i].id != id) {
+            _queue[kept++] = _queue[i];
+        }
+    }
+    _count = kept;
+
+    arm();
+}
+
+void DeadlineQueue::rebase(int32_t offset)
+{
+    CriticalSectionLock lock;
+
+    _offset -= (int64_t) offset * 1000000;
+    arm();
+}
+
+int64_t DeadlineQueue::timeToNext()
+{
+    CriticalSectionLock lock;
+
+    if (_count == 0) {
+        return -1;
+    }
+
+    int64_t remaining = _queue[0].time + _offset - now();
+    return remaining > 0 ? remaining : 0;
+}
+
+int64_t DeadlineQueue::timeTo(uint8_t id, uint8_t event)
+{
+    CriticalSectionLock lock;
+
+    int index = find(id, event);
+    if (index < 0) {
+        return -1;
+    }
+
+    int64_t remaining = _queue[index].time + _offset - now();
+    return remaining > 0 ? remaining : 0;
+}
+
+uint8_t DeadlineQueue::size() const
+{
+    return _count;
+}
+
+int64_t DeadlineQueue::now()
+{
+    return duration_cast<microseconds>(_clock.elapsed_time()).count();
+}
+
+int DeadlineQueue::find(uint8_t id, uint8_t event) const
+{
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_queue[i].id == id && _queue[i].event == event) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void DeadlineQueue::remove(int index)
+{
+    for (uint8_t i = index + 1; i < _count; i++) {
+        _queue[i - 1] = _queue[i];
+    }
+    _count--;
+}
+
+void DeadlineQueue::arm()
+{
+    _timer.detach();
+
+    if (_count == 0) {
+        return;
+    }
+
+    int64_t remaining = _queue[0].time + _offset - now();
+    if (remaining < 0) {
+        remaining = 0;
+    }
+
+    _timer.attach(callback(this, &DeadlineQueue::expire), microseconds(remaining));
+}
+
+void DeadlineQueue::expire()
+{
+    int64_t current = now() - _offset;
+
+    // hand out every deadline that is due, then re-arm once for the new head
+    while (_count > 0 && _queue[0].time <= current) {
+        Deadline due = _queue[0];
+        remove(0);
+
+        if (_callback) {
+            _callback(due.id, due.event);
+        }
+    }
+
+    arm();
+}
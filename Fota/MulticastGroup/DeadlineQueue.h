@@ -0,0 +1,120 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#ifndef DEADLINEQUEUE_H
+#define DEADLINEQUEUE_H
+#include "mbed.h"
+#include "Lora.h"
+
+// A start and a stop deadline for every multicast session
+#define MC_DEADLINE_QUEUE_SIZE (lora::MAX_MULTICAST_SESSIONS * 2)
+
+/**
+ * Ordered queue of multicast session deadlines driven by a single low power timer.
+ *
+ * Deadlines are kept sorted, earliest first, and the timer is only armed for the
+ * head of the queue.  A clock sync correction is applied to every deadline at once
+ * through rebase() without touching the entries, so no per session timers or
+ * rescans are needed when the network time changes.
+ *
+ * The attached callback runs in timer interrupt context, it should only pend work
+ * for a thread, the way MulticastGroup::switchClassIfPending() is polled.
+ */
+class DeadlineQueue {
+    public:
+        enum Event {
+            SESSION_START,
+            SESSION_STOP
+        };
+
+        DeadlineQueue();
+        ~DeadlineQueue();
+
+        /**
+         * Set the function called when a deadline expires
+         * @param callback called with the session id and Event of the deadline
+         */
+        void attach(Callback<void(uint8_t, uint8_t)> callback);
+
+        /**
+         * Add a deadline or move an existing one for the same session and event
+         * @param id multicast session id
+         * @param event SESSION_START or SESSION_STOP
+         * @param delay microseconds from now, the deadline expires immediately if 0
+         * @return false if the queue is full
+         */
+        bool schedule(uint8_t id, uint8_t event, us_timestamp_t delay);
+
+        /**
+         * Remove a deadline
+         * @return false if no deadline was found
+         */
+        bool cancel(uint8_t id, uint8_t event);
+
+        /**
+         * Remove every deadline of a session
+         */
+        void cancelAll(uint8_t id);
+
+        /**
+         * Shift all deadlines after the device clock was corrected
+         * @param offset seconds the clock was moved, positive when it moved forward which brings
+         *        every deadline closer
+         */
+        void rebase(int32_t offset);
+
+        /**
+         * Time until the earliest deadline
+         * @return microseconds, 0 if it is already due, -1 if the queue is empty
+         */
+        int64_t timeToNext();
+
+        /**
+         * Time until a session deadline
+         * @return microseconds, 0 if it is already due, -1 if it is not scheduled
+         */
+        int64_t timeTo(uint8_t id, uint8_t event);
+
+        uint8_t size() const;
+
+    private:
+        struct Deadline {
+            int64_t time;
+            uint8_t id;
+            uint8_t event;
+        };
+
+        int64_t now();
+        int find(uint8_t id, uint8_t event) const;
+        void remove(int index);
+        void arm();
+        void expire();
+
+        Deadline _queue[MC_DEADLINE_QUEUE_SIZE];    // sorted by time, earliest first
+        uint8_t _count;
+        int64_t _offset;                            // clock corrections applied by rebase
+        Callback<void(uint8_t, uint8_t)> _callback;
+
+        #if defined(TARGET_MAX32660EVSYS) || defined(TARGET_MAX32630FTHR)
+            Timer _clock;
+            Timeout _timer;
+        #else
+            LowPowerTimer _clock;
+            LowPowerTimeout _timer;
+        #endif
+};
+#endif
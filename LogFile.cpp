@@ -0,0 +1,91 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::LogFile small appends gathered into whole file system pages
+ *
+ */
+
+#include "LogFile.h"
+#include "Lora.h"
+
+#include <string.h>
+
+using namespace lora;
+
+LogFile::LogFile(FileDevice& file, uint8_t* buffer, uint32_t size, uint32_t pageSize)
+:   _file(file),
+    _buffer(buffer),
+    _size(size),
+    _pageSize(pageSize != 0 ? pageSize : LOG_PAGE_SIZE),
+    _length(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+LogFile::~LogFile() {
+    Flush();
+}
+
+int32_t LogFile::Append(const uint8_t* data, uint32_t size) {
+    uint32_t done = 0;
+
+    _stats.Appends++;
+
+    while (done < size) {
+        uint32_t count = _size - _length < size - done ? _size - _length : size - done;
+
+        memcpy(_buffer + _length, data + done, count);
+        _length += count;
+        done += count;
+
+        if (_length == _size && WritePages() != LORA_OK) {
+            return LORA_ERROR;
+        }
+    }
+
+    return LORA_OK;
+}
+
+int32_t LogFile::Flush() {
+    return _length != 0 ? Write(_length) : LORA_OK;
+}
+
+uint32_t LogFile::Size() const {
+    return _file.Size() + _length;
+}
+
+uint32_t LogFile::Buffered() const {
+    return _length;
+}
+
+const LogFileStats& LogFile::GetStats() const {
+    return _stats;
+}
+
+int32_t LogFile::WritePages() {
+    uint32_t size = _file.Size();
+    uint32_t end = (size + _length) / _pageSize * _pageSize;
+
+    // a buffer smaller than the page left in the file can only be written whole
+    return Write(end > size ? end - size : _length);
+}
+
+int32_t LogFile::Write(uint32_t length) {
+    int32_t written = _file.Write(_buffer, length);
+
+    _stats.Writes++;
+
+    if (written <= 0) {
+        return LORA_ERROR;
+    }
+
+    _stats.Bytes += written;
+    _length -= written;
+    memmove(_buffer, _buffer + written, _length);
+
+    return (uint32_t) written == length ? LORA_OK : LORA_ERROR;
+}
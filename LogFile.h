@@ -0,0 +1,83 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::LogFile small appends gathered into whole file system pages
+ *
+ * @details Every write to a SPIFFS file programs its data and rewrites the object index
+ *          page holding the file size, so a 16 byte append costs a page of wear and a page
+ *          program time.  A LogFile keeps appends in a buffer and, once it is full, writes
+ *          the part that ends on a page boundary of the file, leaving the rest for the next
+ *          write.  Data still buffered is lost on a reset or deep sleep, call Flush() first.
+ *
+ */
+
+#ifndef __LORA_LOG_FILE_H__
+#define __LORA_LOG_FILE_H__
+
+#include "FileDevice.h"
+
+namespace lora {
+
+    const uint32_t LOG_PAGE_SIZE = 256;         //!< logical page of the mDot user file system
+
+    struct LogFileStats {
+            uint32_t Appends;
+            uint32_t Writes;                    //!< FileDevice writes
+            uint32_t Bytes;                     //!< written to the file
+    };
+
+    class LogFile {
+        public:
+            /**
+             * @param file opened to append
+             * @param buffer kept by the caller for the life of the log, at least one page
+             */
+            LogFile(FileDevice& file, uint8_t* buffer, uint32_t size, uint32_t pageSize = LOG_PAGE_SIZE);
+
+            /**
+             * Writes what is still buffered
+             */
+            ~LogFile();
+
+            /**
+             * @return LORA_OK, LORA_ERROR if a write of a full buffer failed
+             */
+            int32_t Append(const uint8_t* data, uint32_t size);
+
+            /**
+             * Write everything buffered, the last page of the file may be left part full
+             */
+            int32_t Flush();
+
+            /**
+             * @return bytes in the file, with those still buffered
+             */
+            uint32_t Size() const;
+
+            uint32_t Buffered() const;
+
+            const LogFileStats& GetStats() const;
+
+        private:
+            /**
+             * Write the buffered bytes up to the last page boundary they reach
+             */
+            int32_t WritePages();
+
+            int32_t Write(uint32_t length);
+
+            FileDevice& _file;
+            uint8_t* _buffer;
+            uint32_t _size;
+            uint32_t _pageSize;
+            uint32_t _length;                   //!< bytes buffered
+            LogFileStats _stats;
+    };
+
+}
+
+#endif
@@ -0,0 +1,99 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::MacCommandCodec sizes, validates, decodes and answers MAC commands
+ *
+ */
+
+#include "MacCommandCodec.h"
+
+using namespace lora;
+
+constexpr MacCommandCodec::Sizes MacCommandCodec::TABLE[];
+
+int16_t MacCommandCodec::Validate(const uint8_t* payload, uint8_t size, uint8_t& end) {
+    int16_t count = 0;
+    uint8_t index = 0;
+
+    while (index < size) {
+        uint8_t length = ServerCommandSize(payload[index]);
+
+        if (length == MAC_CMD_SIZE_PLAN) {
+            break;
+        }
+
+        if (length == MAC_CMD_SIZE_UNKNOWN || length > size - index) {
+            logWarning("Invalid MAC command %02x at %u of %u", payload[index], index, size);
+            end = index;
+            return -1;
+        }
+
+        index += length;
+        count++;
+    }
+
+    end = index;
+    return count;
+}
+
+uint8_t MacCommandCodec::LinkAdrBlock(const uint8_t* payload, uint8_t index, uint8_t size) {
+    const uint8_t length = ServerCommandSize(SRV_MAC_LINK_ADR_REQ);
+    uint8_t count = 0;
+
+    while (index < size && payload[index] == SRV_MAC_LINK_ADR_REQ && length <= size - index) {
+        index += length;
+        count++;
+    }
+
+    return count;
+}
+
+void MacCommandCodec::DecodeLinkAdrReq(const uint8_t* args, uint8_t& datarate, uint8_t& power, uint16_t& mask, uint8_t& ctrl, uint8_t& nbRep) {
+    datarate = (args[0] >> 4) & 0x0F;
+    power = args[0] & 0x0F;
+    mask = args[1] | (args[2] << 8);
+    ctrl = (args[3] >> 4) & 0x07;
+    nbRep = args[3] & 0x0F;
+}
+
+void MacCommandCodec::DecodeRxParamSetupReq(const uint8_t* args, int8_t& datarate, int8_t& drOffset, uint32_t& freq) {
+    datarate = args[0] & 0x0F;
+    drOffset = (args[0] >> 4) & 0x07;
+    freq = (args[1] | (args[2] << 8) | (args[3] << 16)) * 100U;
+}
+
+void MacCommandCodec::DecodeTxParamSetupReq(const uint8_t* args, uint8_t& downlinkDwell, uint8_t& uplinkDwell, uint8_t& eirp) {
+    downlinkDwell = (args[0] >> 5) & 0x01;
+    uplinkDwell = (args[0] >> 4) & 0x01;
+    eirp = args[0] & 0x0F;
+}
+
+uint8_t* MacCommandCodec::ReserveAnswer(NetworkSession& session, uint8_t cid, uint8_t limit, uint8_t size) {
+    if (size == 0) {
+        size = MoteCommandSize(cid);
+    }
+
+    if (size == MAC_CMD_SIZE_UNKNOWN || size == MAC_CMD_SIZE_PLAN) {
+        logError("No size for MAC answer %02x", cid);
+        return NULL;
+    }
+
+    if (limit > COMMANDS_BUFFER_SIZE) {
+        limit = COMMANDS_BUFFER_SIZE;
+    }
+
+    if (session.CommandBufferIndex + size > limit) {
+        logWarning("MAC answer %02x does not fit, %u of %u used", cid, session.CommandBufferIndex, limit);
+        return NULL;
+    }
+
+    uint8_t* answer = session.CommandBuffer + session.CommandBufferIndex;
+    session.CommandBufferIndex += size;
+    answer[0] = cid;
+
+    return answer + 1;
+}
@@ -0,0 +1,146 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::MacCommandCodec sizes, validates, decodes and answers MAC commands
+ *
+ * @details Command sizes are kept in one table keyed by CID for the LoRaWAN commands
+ *          and the MultiTech 0x80-0x86 extensions.  A FOpts or port 0 payload can be
+ *          checked end to end before any command in it is applied, and answers are
+ *          written straight into NetworkSession::CommandBuffer.
+ *
+ */
+
+#ifndef __LORA_MAC_COMMAND_CODEC_H__
+#define __LORA_MAC_COMMAND_CODEC_H__
+
+#include "Lora.h"
+
+namespace lora {
+
+    const uint8_t MAC_CMD_SIZE_UNKNOWN = 0;         //!< CID is not defined
+    const uint8_t MAC_CMD_SIZE_PLAN = 0xFF;         //!< CID is passed to ChannelPlan::HandleMacCommand which knows its size
+
+    class MacCommandCodec {
+        public:
+            /**
+             * Size of a server command including the CID
+             * @param cid command identifier
+             * @return size in bytes, MAC_CMD_SIZE_UNKNOWN or MAC_CMD_SIZE_PLAN
+             */
+            static constexpr uint8_t ServerCommandSize(uint8_t cid) {
+                return Slot(cid) < TABLE_SIZE ? TABLE[Slot(cid)].Server : MAC_CMD_SIZE_UNKNOWN;
+            }
+
+            /**
+             * Size of a mote command including the CID
+             * @param cid command identifier
+             * @return size in bytes, MAC_CMD_SIZE_UNKNOWN or MAC_CMD_SIZE_PLAN
+             */
+            static constexpr uint8_t MoteCommandSize(uint8_t cid) {
+                return Slot(cid) < TABLE_SIZE ? TABLE[Slot(cid)].Mote : MAC_CMD_SIZE_UNKNOWN;
+            }
+
+            /**
+             * Check every command in a downlink before any is applied
+             * Walks the payload once.  A command handled by the channel plan ends the walk
+             * since only the plan knows its size, the rest of the payload belongs to the plan.
+             * @param payload FOpts or decrypted port 0 payload
+             * @param size number of bytes
+             * @param[out] end offset of the first byte not validated, size if all were
+             * @return number of commands, -1 if a CID is unknown or a command is truncated
+             */
+            static int16_t Validate(const uint8_t* payload, uint8_t size, uint8_t& end);
+
+            /**
+             * Number of consecutive LinkADRReq blocks
+             * A block is applied as a whole, with one mask update and one answer status.
+             * @param payload FOpts or decrypted port 0 payload
+             * @param index offset of the first LinkADRReq CID
+             * @param size number of bytes in payload
+             * @return number of complete LinkADRReq commands starting at index
+             */
+            static uint8_t LinkAdrBlock(const uint8_t* payload, uint8_t index, uint8_t size);
+
+            /**
+             * Decode LinkADRReq parameters
+             * @param args command bytes after the CID
+             */
+            static void DecodeLinkAdrReq(const uint8_t* args, uint8_t& datarate, uint8_t& power, uint16_t& mask, uint8_t& ctrl, uint8_t& nbRep);
+
+            /**
+             * Decode RXParamSetupReq parameters
+             * @param args command bytes after the CID
+             * @param[out] freq RX2 frequency in Hz
+             */
+            static void DecodeRxParamSetupReq(const uint8_t* args, int8_t& datarate, int8_t& drOffset, uint32_t& freq);
+
+            /**
+             * Decode TxParamSetupReq parameters
+             * @param args command bytes after the CID
+             * @param[out] eirp index into the plan MAX_ERP_VALUES table
+             */
+            static void DecodeTxParamSetupReq(const uint8_t* args, uint8_t& downlinkDwell, uint8_t& uplinkDwell, uint8_t& eirp);
+
+            /**
+             * Reserve an answer in the command buffer
+             * The CID is written and the caller fills in the parameters through the returned pointer.
+             * @param session session holding the command buffer
+             * @param cid mote command
+             * @param limit largest command buffer size allowed, e.g. the max payload of the current datarate
+             * @param size size including the CID, only needed for MAC_CMD_SIZE_PLAN commands
+             * @return start of the parameters or NULL if the answer does not fit
+             */
+            static uint8_t* ReserveAnswer(NetworkSession& session, uint8_t cid, uint8_t limit, uint8_t size = 0);
+
+        private:
+            struct Sizes {
+                uint8_t Server;
+                uint8_t Mote;
+            };
+
+            static const uint8_t TABLE_SIZE = 27;
+            static constexpr Sizes TABLE[TABLE_SIZE] = {
+                /* 0x00 */ { MAC_CMD_SIZE_UNKNOWN, MAC_CMD_SIZE_UNKNOWN },
+                /* 0x01 */ { MAC_CMD_SIZE_UNKNOWN, MAC_CMD_SIZE_UNKNOWN },
+                /* 0x02 LinkCheck */            { 3, 1 },
+                /* 0x03 LinkADR */              { 5, 2 },
+                /* 0x04 DutyCycle */            { 2, 1 },
+                /* 0x05 RXParamSetup */         { 5, 2 },
+                /* 0x06 DevStatus */            { 1, 3 },
+                /* 0x07 NewChannel */           { 6, 2 },
+                /* 0x08 RXTimingSetup */        { 2, 1 },
+                /* 0x09 TxParamSetup */         { 2, 1 },
+                /* 0x0A DlChannel */            { 5, 2 },
+                /* 0x0B Rekey */                { 2, 2 },
+                /* 0x0C ADRParamSetup */        { 2, 1 },
+                /* 0x0D DeviceTime */           { 6, 1 },
+                /* 0x0E ForceRejoin */          { 3, MAC_CMD_SIZE_UNKNOWN },
+                /* 0x0F RejoinParamSetup */     { 2, 2 },
+                /* 0x10 PingSlotInfo */         { 1, 2 },
+                /* 0x11 PingSlotChannel */      { 5, 2 },
+                /* 0x12 BeaconTiming */         { 4, 1 },
+                /* 0x13 BeaconFreq */           { 4, 2 },
+                /* 0x80 Ping */                 { 5, MAC_CMD_SIZE_PLAN },
+                /* 0x81 ChangeClass */          { 2, MAC_CMD_SIZE_PLAN },
+                /* 0x82 MultipartStartReq */    { MAC_CMD_SIZE_PLAN, MAC_CMD_SIZE_PLAN },
+                /* 0x83 MultipartStartAns */    { MAC_CMD_SIZE_PLAN, MAC_CMD_SIZE_PLAN },
+                /* 0x84 MultipartChunk */       { MAC_CMD_SIZE_PLAN, MAC_CMD_SIZE_PLAN },
+                /* 0x85 MultipartEndReq */      { MAC_CMD_SIZE_PLAN, MAC_CMD_SIZE_PLAN },
+                /* 0x86 MultipartEndAns */      { MAC_CMD_SIZE_PLAN, MAC_CMD_SIZE_PLAN }
+            };
+
+            // LoRaWAN CIDs 0x00-0x13 followed by MultiTech CIDs 0x80-0x86
+            static constexpr uint8_t Slot(uint8_t cid) {
+                return cid <= SRV_MAC_BEACON_FREQ_REQ ? cid
+                     : (cid >= SRV_MAC_PING_ANS && cid <= SRV_MAC_MULTIPART_END_ANS) ? cid - SRV_MAC_PING_ANS + SRV_MAC_BEACON_FREQ_REQ + 1
+                     : TABLE_SIZE;
+            }
+    };
+
+}
+
+#endif
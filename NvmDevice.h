@@ -0,0 +1,67 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::NvmDevice non volatile memory the settings and counter logs are kept in
+ *
+ * @details Flash semantics: erase sets whole blocks to 0xFF and a program may only clear
+ *          bits.  EEPROM fits the same model with an erase that writes 0xFF.  Some flash
+ *          lets a programmed unit be programmed again to clear more bits, flash with ECC
+ *          does not.
+ *
+ */
+
+#ifndef __LORA_NVM_DEVICE_H__
+#define __LORA_NVM_DEVICE_H__
+
+#include <stdint.h>
+
+namespace lora {
+
+    const uint8_t NVM_ERASED = 0xFF;
+
+    class NvmDevice {
+        public:
+            virtual ~NvmDevice() {}
+
+            /**
+             * @return 0 on success, -1 on failure
+             */
+            virtual int32_t Read(uint32_t address, uint8_t* data, uint32_t size) = 0;
+
+            /**
+             * Clear bits, address and size are multiples of ProgramSize()
+             * @return 0 on success, -1 on failure
+             */
+            virtual int32_t Program(uint32_t address, const uint8_t* data, uint32_t size) = 0;
+
+            /**
+             * Set to NVM_ERASED, address and size are multiples of EraseSize()
+             * @return 0 on success, -1 on failure
+             */
+            virtual int32_t Erase(uint32_t address, uint32_t size) = 0;
+
+            /**
+             * @return bytes of an erase block
+             */
+            virtual uint32_t EraseSize() const = 0;
+
+            /**
+             * @return bytes a program is aligned to
+             */
+            virtual uint32_t ProgramSize() const = 0;
+
+            /**
+             * @return true if a programmed unit may be programmed again to clear more bits
+             */
+            virtual bool Reprogrammable() const {
+                return false;
+            }
+    };
+
+}
+
+#endif
@@ -0,0 +1,275 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::PerfStats latency histograms and error counters of stack operations
+ *
+ */
+
+#include "PerfStats.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const char* const OPERATION_NAMES[PERF_OPERATIONS] = {
+        "send",
+        "duty cycle wait",
+        "rx window to done",
+        "join",
+        "flash save",
+        "fota fragment"
+    };
+
+    const char* const COUNTER_NAMES[PERF_COUNTERS] = {
+        "no channels",
+        "no free channel",
+        "aggregated duty cycle",
+        "lbt busy"
+    };
+
+    /**
+     * Append an unsigned LEB128 varint
+     * @return false if it does not fit
+     */
+    bool PutVarint(uint8_t* buffer, uint16_t size, uint16_t& pos, uint64_t value) {
+        do {
+            if (pos >= size) {
+                return false;
+            }
+
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            buffer[pos++] = value != 0 ? (byte | 0x80) : byte;
+        } while (value != 0);
+
+        return true;
+    }
+
+}
+
+uint8_t PerfHistogram::Bucket(uint32_t usec) {
+    uint32_t scaled = usec >> PERF_BUCKET_SHIFT;
+
+    if (scaled == 0) {
+        return 0;
+    }
+
+    // bit length of the scaled value
+    uint8_t bucket = 32 - __builtin_clz(scaled);
+    return bucket < PERF_HISTOGRAM_BUCKETS ? bucket : PERF_HISTOGRAM_BUCKETS - 1;
+}
+
+uint32_t PerfHistogram::BucketStart(uint8_t bucket) {
+    if (bucket == 0) {
+        return 0;
+    }
+
+    return 1UL << (PERF_BUCKET_SHIFT + bucket - 1);
+}
+
+uint32_t PerfHistogram::Percentile(uint8_t percent) const {
+    if (Count == 0) {
+        return 0;
+    }
+
+    // rank of the sample, rounded up so the 100th percentile is the last one
+    uint32_t rank = (uint32_t) (((uint64_t) Count * percent + 99) / 100);
+    uint32_t seen = 0;
+
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    for (uint8_t b = 0; b < PERF_HISTOGRAM_BUCKETS - 1; b++) {
+        seen += Buckets[b];
+
+        if (seen >= rank) {
+            uint32_t limit = BucketStart(b + 1) - 1;
+            return limit < Max ? limit : Max;
+        }
+    }
+
+    return Max;
+}
+
+uint32_t PerfHistogram::Mean() const {
+    return Count != 0 ? (uint32_t) (Total / Count) : 0;
+}
+
+PerfStats::PerfStats() {
+    Reset();
+}
+
+PerfStats& PerfStats::Global() {
+    static PerfStats stats;
+    return stats;
+}
+
+void PerfStats::Record(PerfOperation operation, uint32_t usec) {
+    if (operation >= PERF_OPERATIONS) {
+        return;
+    }
+
+    PerfHistogram& histogram = _histograms[operation];
+    uint8_t bucket = PerfHistogram::Bucket(usec);
+
+    core_util_critical_section_enter();
+
+    if (histogram.Count == 0 || usec < histogram.Min) {
+        histogram.Min = usec;
+    }
+
+    if (usec > histogram.Max) {
+        histogram.Max = usec;
+    }
+
+    histogram.Count++;
+    histogram.Total += usec;
+    histogram.Buckets[bucket]++;
+
+    core_util_critical_section_exit();
+}
+
+void PerfStats::Increment(PerfCounter counter) {
+    if (counter >= PERF_COUNTERS) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    _counters[counter]++;
+    core_util_critical_section_exit();
+}
+
+void PerfStats::CountStatus(uint8_t status) {
+    switch (status) {
+        case LORA_NO_CHANS_ENABLED:
+            Increment(PERF_NO_CHANNELS);
+            break;
+        case LORA_NO_FREE_CHAN:
+            Increment(PERF_NO_FREE_CHANNEL);
+            break;
+        case LORA_AGGREGATED_DUTY_CYCLE:
+            Increment(PERF_AGGREGATED_DUTY_CYCLE);
+            break;
+        case LORA_LBT_CHANNEL_BUSY:
+            Increment(PERF_LBT_BUSY);
+            break;
+        default:
+            break;
+    }
+}
+
+void PerfStats::CountDutyCycle(uint8_t status, uint32_t time_off) {
+    CountStatus(status);
+    Record(PERF_DUTY_CYCLE_WAIT, std::min(time_off, UINT32_MAX / 1000U) * 1000U);
+}
+
+const PerfHistogram& PerfStats::Histogram(PerfOperation operation) const {
+    return _histograms[operation < PERF_OPERATIONS ? operation : PERF_SEND];
+}
+
+uint32_t PerfStats::Counter(PerfCounter counter) const {
+    return counter < PERF_COUNTERS ? _counters[counter] : 0;
+}
+
+void PerfStats::Reset() {
+    core_util_critical_section_enter();
+    memset(_histograms, 0, sizeof(_histograms));
+    memset(_counters, 0, sizeof(_counters));
+    core_util_critical_section_exit();
+}
+
+uint16_t PerfStats::Dump(uint8_t* buffer, uint16_t size) const {
+    PerfHistogram histograms[PERF_OPERATIONS];
+    uint32_t counters[PERF_COUNTERS];
+    uint16_t pos = 0;
+
+    // snapshot so a dump is consistent while the stack keeps recording
+    core_util_critical_section_enter();
+    memcpy(histograms, _histograms, sizeof(histograms));
+    memcpy(counters, _counters, sizeof(counters));
+    core_util_critical_section_exit();
+
+    if (size < 5) {
+        return 0;
+    }
+
+    buffer[pos++] = PERF_DUMP_VERSION;
+    buffer[pos++] = PERF_OPERATIONS;
+    buffer[pos++] = PERF_HISTOGRAM_BUCKETS;
+    buffer[pos++] = PERF_BUCKET_SHIFT;
+    buffer[pos++] = PERF_COUNTERS;
+
+    for (uint8_t op = 0; op < PERF_OPERATIONS; op++) {
+        const PerfHistogram& histogram = histograms[op];
+        uint32_t mask = 0;
+
+        for (uint8_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+            if (histogram.Buckets[b] != 0) {
+                mask |= 1UL << b;
+            }
+        }
+
+        if (!PutVarint(buffer, size, pos, histogram.Count)
+            || !PutVarint(buffer, size, pos, histogram.Min)
+            || !PutVarint(buffer, size, pos, histogram.Max)
+            || !PutVarint(buffer, size, pos, histogram.Total)
+            || !PutVarint(buffer, size, pos, mask)) {
+            return 0;
+        }
+
+        for (uint8_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+            if (histogram.Buckets[b] != 0 && !PutVarint(buffer, size, pos, histogram.Buckets[b])) {
+                return 0;
+            }
+        }
+    }
+
+    for (uint8_t c = 0; c < PERF_COUNTERS; c++) {
+        if (!PutVarint(buffer, size, pos, counters[c])) {
+            return 0;
+        }
+    }
+
+    return pos;
+}
+
+void PerfStats::Log() const {
+    for (uint8_t op = 0; op < PERF_OPERATIONS; op++) {
+        const PerfHistogram& histogram = _histograms[op];
+
+        if (histogram.Count == 0) {
+            continue;
+        }
+
+        logInfo("%s: %lu samples min %lu mean %lu p50 %lu p95 %lu max %lu us", OPERATION_NAMES[op],
+                (unsigned long) histogram.Count, (unsigned long) histogram.Min, (unsigned long) histogram.Mean(),
+                (unsigned long) histogram.Percentile(50), (unsigned long) histogram.Percentile(95), (unsigned long) histogram.Max);
+    }
+
+    for (uint8_t c = 0; c < PERF_COUNTERS; c++) {
+        logInfo("%s: %lu", COUNTER_NAMES[c], (unsigned long) _counters[c]);
+    }
+}
+
+PerfTimer::PerfTimer(PerfOperation operation, PerfStats& stats)
+:   _stats(stats),
+    _operation(operation),
+    _start(us_ticker_read())
+{
+}
+
+PerfTimer::~PerfTimer() {
+    _stats.Record(_operation, Elapsed());
+}
+
+uint32_t PerfTimer::Elapsed() const {
+    return us_ticker_read() - _start;
+}
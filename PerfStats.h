@@ -0,0 +1,179 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::PerfStats latency histograms and error counters of stack operations
+ *
+ * @details Each operation keeps a histogram with power of two buckets in microseconds, so
+ *          memory is fixed and recording is a bit scan and an increment.  Counters track the
+ *          send results that mean the stack could not transmit.  Dump() writes everything
+ *          in a compact binary form that tools/perf_stats.py decodes.
+ *
+ */
+
+#ifndef __LORA_PERF_STATS_H__
+#define __LORA_PERF_STATS_H__
+
+#include "Lora.h"
+
+#ifndef PERF_HISTOGRAM_BUCKETS
+#define PERF_HISTOGRAM_BUCKETS 24
+#endif
+
+namespace lora {
+
+    /**
+     * Values below 2^PERF_BUCKET_SHIFT us go in bucket 0, bucket n holds values from
+     * 2^(PERF_BUCKET_SHIFT + n - 1) us up to twice that, the last bucket has no upper limit
+     */
+    const uint8_t PERF_BUCKET_SHIFT = 6;
+
+    const uint8_t PERF_DUMP_VERSION = 1;
+
+    enum PerfOperation {
+        PERF_SEND = 0,          //!< uplink TX start to the end of its RX windows, each retry on its own
+        PERF_DUTY_CYCLE_WAIT,   //!< off time left when a channel plan refused a transmission for duty cycle
+        PERF_RX_WINDOW_TO_DONE, //!< RX1 or RX2 opened to the downlink received, its time on air included
+        PERF_JOIN,              //!< join request TX start to join accept or failure
+        PERF_FLASH_SAVE,        //!< settings or session saved to flash
+        PERF_FOTA_FRAGMENT,     //!< one FOTA data fragment written and decoded
+        PERF_OPERATIONS
+    };
+
+    enum PerfCounter {
+        PERF_NO_CHANNELS = 0,   //!< LORA_NO_CHANS_ENABLED
+        PERF_NO_FREE_CHANNEL,   //!< LORA_NO_FREE_CHAN, every enabled channel held by its duty band
+        PERF_AGGREGATED_DUTY_CYCLE, //!< LORA_AGGREGATED_DUTY_CYCLE
+        PERF_LBT_BUSY,          //!< LORA_LBT_CHANNEL_BUSY
+        PERF_COUNTERS
+    };
+
+    /**
+     * Latency distribution of one operation
+     */
+    struct PerfHistogram {
+            uint32_t Count;
+            uint32_t Min;       //!< us
+            uint32_t Max;       //!< us
+            uint64_t Total;     //!< us, sum of all samples
+            uint32_t Buckets[PERF_HISTOGRAM_BUCKETS];
+
+            /**
+             * Bucket a sample goes in
+             */
+            static uint8_t Bucket(uint32_t usec);
+
+            /**
+             * Smallest value of a bucket
+             */
+            static uint32_t BucketStart(uint8_t bucket);
+
+            /**
+             * Estimate a percentile from the buckets
+             * @param percent 0-100
+             * @return upper limit of the bucket holding the percentile, or Max if lower, 0 if empty
+             */
+            uint32_t Percentile(uint8_t percent) const;
+
+            /**
+             * Mean of the samples
+             * @return us, 0 if empty
+             */
+            uint32_t Mean() const;
+    };
+
+    class PerfStats {
+        public:
+            /**
+             * Upper bound of the bytes written by Dump
+             */
+            static const uint16_t MAX_DUMP_SIZE = 5 + PERF_OPERATIONS * (5 * 4 + 10 + PERF_HISTOGRAM_BUCKETS * 5) + PERF_COUNTERS * 5;
+
+            PerfStats();
+
+            /**
+             * Stats shared by the stack, the library and the application
+             */
+            static PerfStats& Global();
+
+            /**
+             * Add a latency sample, safe from threads and interrupts
+             * @param operation histogram to update
+             * @param usec duration in microseconds
+             */
+            void Record(PerfOperation operation, uint32_t usec);
+
+            /**
+             * Count one occurrence
+             */
+            void Increment(PerfCounter counter);
+
+            /**
+             * Count a mac status if it has a counter
+             * @param status lora::MacStatus returned by the mac
+             */
+            void CountStatus(uint8_t status);
+
+            /**
+             * Count a transmission refused for duty cycle and record the off time it has left
+             * @param status lora::MacStatus of the refusal
+             * @param time_off ms until a channel is free, ChannelPlan::GetTimeOffAir()
+             */
+            void CountDutyCycle(uint8_t status, uint32_t time_off);
+
+            const PerfHistogram& Histogram(PerfOperation operation) const;
+
+            uint32_t Counter(PerfCounter counter) const;
+
+            /**
+             * Clear all histograms and counters
+             */
+            void Reset();
+
+            /**
+             * Write all histograms and counters in the binary dump format
+             * Integers are unsigned LEB128 varints, a histogram lists only its non-empty buckets
+             *   u8 version, u8 operations, u8 buckets, u8 bucket shift, u8 counters
+             *   per operation: count, min, max, total, bucket mask, count of each set bucket
+             *   per counter: value
+             * @param buffer destination, MAX_DUMP_SIZE bytes is always enough
+             * @param size of buffer
+             * @return bytes written, 0 if the buffer is too small
+             */
+            uint16_t Dump(uint8_t* buffer, uint16_t size) const;
+
+            /**
+             * Log a summary of each operation and the counters
+             */
+            void Log() const;
+
+        private:
+            PerfHistogram _histograms[PERF_OPERATIONS];
+            uint32_t _counters[PERF_COUNTERS];
+    };
+
+    /**
+     * Record the lifetime of a scope in a histogram
+     */
+    class PerfTimer {
+        public:
+            PerfTimer(PerfOperation operation, PerfStats& stats = PerfStats::Global());
+            ~PerfTimer();
+
+            /**
+             * Microseconds since the timer was created
+             */
+            uint32_t Elapsed() const;
+
+        private:
+            PerfStats& _stats;
+            PerfOperation _operation;
+            uint32_t _start;
+    };
+
+}
+
+#endif
@@ -0,0 +1,188 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::PingSlotSchedule precomputes the class B ping slots of one beacon period
+ *
+ */
+
+#include "PingSlotSchedule.h"
+#include "mbedtls/aes.h"
+
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    // 2^(5 + periodicity) slots between pings, 2^(7 - periodicity) pings per beacon period
+    inline uint16_t PingPeriod(uint8_t periodicity) {
+        return 1U << (5 + periodicity);
+    }
+
+    void EncryptBlock(mbedtls_aes_context* ctx, uint32_t beaconTime, uint32_t address, uint8_t* rand) {
+        uint8_t block[16] = { 0 };
+
+        block[0] = beaconTime & 0xFF;
+        block[1] = (beaconTime >> 8) & 0xFF;
+        block[2] = (beaconTime >> 16) & 0xFF;
+        block[3] = (beaconTime >> 24) & 0xFF;
+        block[4] = address & 0xFF;
+        block[5] = (address >> 8) & 0xFF;
+        block[6] = (address >> 16) & 0xFF;
+        block[7] = (address >> 24) & 0xFF;
+
+        mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, block, rand);
+    }
+
+}
+
+PingSlotSchedule::PingSlotSchedule() {
+    Clear();
+}
+
+void PingSlotSchedule::Clear() {
+    memset(_sessions, 0, sizeof(_sessions));
+    _count = 0;
+    _conflicts = 0;
+    _truncated = 0;
+}
+
+uint16_t PingSlotSchedule::Build(const Settings& settings, uint32_t beaconTime, bool unicast) {
+    static const uint8_t beaconKey[KEY_SIZE] = { 0 };
+
+    Clear();
+
+    for (uint8_t i = 0; i < MAX_MULTICAST_SESSIONS; i++) {
+        const MulticastSession& mc = settings.Multicast[i];
+        if (mc.Address != 0 && mc.Active && mc.Periodicity >= 0 && mc.Periodicity <= 7) {
+            _sessions[i].Active = true;
+            _sessions[i].Period = PingPeriod(mc.Periodicity);
+            _sessions[i].Frequency = mc.Frequency;
+            _sessions[i].Datarate = mc.DatarateIndex;
+        }
+    }
+
+    if (unicast && settings.Network.PingPeriodicity <= 7) {
+        _sessions[UNICAST].Active = true;
+        _sessions[UNICAST].Period = PingPeriod(settings.Network.PingPeriodicity);
+        _sessions[UNICAST].Frequency = settings.Session.PingSlotFrequency;
+        _sessions[UNICAST].Datarate = settings.Session.PingSlotDatarateIndex;
+    }
+
+    // all offsets with one key schedule
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, beaconKey, KEY_SIZE * 8);
+
+    for (uint8_t i = 0; i < NUM_SESSIONS; i++) {
+        if (!_sessions[i].Active)
+            continue;
+
+        uint32_t address = (i == UNICAST) ? settings.Session.Address : settings.Multicast[i].Address;
+        uint8_t rand[16];
+        EncryptBlock(&ctx, beaconTime, address, rand);
+        _sessions[i].Offset = (rand[0] + rand[1] * 256U) % _sessions[i].Period;
+    }
+
+    mbedtls_aes_free(&ctx);
+
+    // merge the per session arithmetic sequences, priority order breaks ties
+    uint16_t next[NUM_SESSIONS];
+    for (uint8_t i = 0; i < NUM_SESSIONS; i++) {
+        next[i] = _sessions[i].Active ? _sessions[i].Offset : PING_SLOTS_PER_BEACON;
+    }
+
+    for (;;) {
+        uint8_t best = UNICAST;
+        for (uint8_t i = 0; i < MAX_MULTICAST_SESSIONS; i++) {
+            if (next[i] < next[best])
+                best = i;
+        }
+
+        if (next[best] >= PING_SLOTS_PER_BEACON)
+            break;
+
+        if (_count > 0 && _slots[_count - 1].Slot == next[best]) {
+            _conflicts++;
+        } else if (_count == PING_SCHEDULE_MAX_SLOTS) {
+            _truncated++;
+        } else {
+            _slots[_count].Slot = next[best];
+            _slots[_count].Session = best;
+            _count++;
+        }
+
+        next[best] += _sessions[best].Period;
+    }
+
+    return _count;
+}
+
+bool PingSlotSchedule::Next(uint32_t msec, PingSlot& slot) const {
+    uint16_t low = 0;
+    uint16_t high = _count;
+
+    // first slot that starts at or after msec
+    while (low < high) {
+        uint16_t mid = (low + high) / 2;
+        if (BEACON_RESERVED_TIME + _slots[mid].Slot * PING_SLOT_LENGTH < msec)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (low == _count)
+        return false;
+
+    slot = At(low);
+    return true;
+}
+
+uint16_t PingSlotSchedule::Size() const {
+    return _count;
+}
+
+PingSlot PingSlotSchedule::At(uint16_t index) const {
+    return PingSlot(BEACON_RESERVED_TIME + _slots[index].Slot * PING_SLOT_LENGTH, SessionId(_slots[index].Session));
+}
+
+uint32_t PingSlotSchedule::Frequency(int8_t id) const {
+    return _sessions[SessionIndex(id)].Frequency;
+}
+
+uint8_t PingSlotSchedule::Datarate(int8_t id) const {
+    return _sessions[SessionIndex(id)].Datarate;
+}
+
+uint16_t PingSlotSchedule::Conflicts() const {
+    return _conflicts;
+}
+
+uint16_t PingSlotSchedule::Truncated() const {
+    return _truncated;
+}
+
+uint16_t PingSlotSchedule::PingOffset(uint32_t beaconTime, uint32_t address, uint16_t pingPeriod) {
+    static const uint8_t beaconKey[KEY_SIZE] = { 0 };
+    uint8_t rand[16];
+
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, beaconKey, KEY_SIZE * 8);
+    EncryptBlock(&ctx, beaconTime, address, rand);
+    mbedtls_aes_free(&ctx);
+
+    return (rand[0] + rand[1] * 256U) % pingPeriod;
+}
+
+uint8_t PingSlotSchedule::SessionIndex(int8_t id) {
+    return (id < 0 || id >= MAX_MULTICAST_SESSIONS) ? UNICAST : id;
+}
+
+int8_t PingSlotSchedule::SessionId(uint8_t index) {
+    return index == UNICAST ? -1 : index;
+}
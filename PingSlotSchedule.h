@@ -0,0 +1,133 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::PingSlotSchedule precomputes the class B ping slots of one beacon period
+ *
+ * @details The ping offsets of the unicast session and every active multicast session are
+ *          computed together when a beacon is received and merged into one list sorted by
+ *          time, so opening the windows is a walk through the list.
+ *
+ */
+
+#ifndef __LORA_PING_SLOT_SCHEDULE_H__
+#define __LORA_PING_SLOT_SCHEDULE_H__
+
+#include "Lora.h"
+
+// every session at periodicity 0, so a full schedule never drops a slot
+#ifndef PING_SCHEDULE_MAX_SLOTS
+#define PING_SCHEDULE_MAX_SLOTS ((lora::MAX_MULTICAST_SESSIONS + 1) * lora::PING_SLOTS_PER_SESSION)
+#endif
+
+namespace lora {
+
+    const uint16_t PING_SLOTS_PER_BEACON = 4096U;   //!< Number of ping slot positions in a beacon period
+    const uint16_t PING_SLOTS_PER_SESSION = 128U;   //!< Most pings of one session in a beacon period, periodicity 0
+
+    class PingSlotSchedule {
+        public:
+            PingSlotSchedule();
+
+            /**
+             * Compute the ping slots for a beacon period
+             * Call after the beacon was received and ChannelPlan::FrequencyHop has set the
+             * frequencies for the period.  Sessions with equal slots are resolved in a fixed
+             * order: the unicast session first, then multicast sessions by index.
+             * @param settings unicast session and multicast sessions to schedule
+             * @param beaconTime GPS time of the beacon in seconds
+             * @param unicast include the unicast session, false if the device is not in class B
+             * @return number of scheduled slots
+             */
+            uint16_t Build(const Settings& settings, uint32_t beaconTime, bool unicast = true);
+
+            /**
+             * Clear the schedule, e.g. when beacon synchronization is lost
+             */
+            void Clear();
+
+            /**
+             * Find the next slot at or after a time
+             * @param msec milliseconds since the start of the beacon period
+             * @param slot updated with the slot time and session id, -1 for the unicast session
+             * @return false if there are no more slots in this beacon period
+             */
+            bool Next(uint32_t msec, PingSlot& slot) const;
+
+            /**
+             * Number of slots in the schedule
+             */
+            uint16_t Size() const;
+
+            /**
+             * Slot at an index of the sorted schedule
+             */
+            PingSlot At(uint16_t index) const;
+
+            /**
+             * Frequency of the windows of a session
+             * @param id session id from a PingSlot, -1 for the unicast session
+             */
+            uint32_t Frequency(int8_t id) const;
+
+            /**
+             * Datarate index of the windows of a session
+             * @param id session id from a PingSlot, -1 for the unicast session
+             */
+            uint8_t Datarate(int8_t id) const;
+
+            /**
+             * Number of slots dropped in the last Build because a session with higher priority
+             * had the same slot
+             */
+            uint16_t Conflicts() const;
+
+            /**
+             * Number of slots dropped in the last Build because the schedule was full, only
+             * when PING_SCHEDULE_MAX_SLOTS is set below its default
+             */
+            uint16_t Truncated() const;
+
+            /**
+             * Compute the ping offset of a session as defined by the class B specification
+             * @param beaconTime GPS time of the beacon in seconds
+             * @param address device or multicast group address
+             * @param pingPeriod number of slots between two pings of the session
+             * @return offset of the first slot in the range 0 to pingPeriod - 1
+             */
+            static uint16_t PingOffset(uint32_t beaconTime, uint32_t address, uint16_t pingPeriod);
+
+        private:
+            static const uint8_t NUM_SESSIONS = MAX_MULTICAST_SESSIONS + 1;
+            static const uint8_t UNICAST = MAX_MULTICAST_SESSIONS;
+
+            // two bytes, the schedule holds every slot of every session at periodicity 0
+            typedef struct {
+                uint16_t Slot : 12;     //!< Slot position in the beacon period
+                uint16_t Session : 4;   //!< Index into _sessions
+            } Entry;
+
+            typedef struct {
+                bool Active;
+                uint16_t Offset;
+                uint16_t Period;
+                uint32_t Frequency;
+                uint8_t Datarate;
+            } Session;
+
+            static uint8_t SessionIndex(int8_t id);
+            static int8_t SessionId(uint8_t index);
+
+            Session _sessions[NUM_SESSIONS];
+            Entry _slots[PING_SCHEDULE_MAX_SLOTS];
+            uint16_t _count;
+            uint16_t _conflicts;
+            uint16_t _truncated;
+    };
+
+}
+
+#endif
@@ -23,6 +23,20 @@ namespace lora {
              */
             bool NextChannel(const uint8_t *enabledChannels, uint8_t nbEnabledChannels, uint8_t *channel);
 
+            /** Picks a random channel from a bitmask of enabled channels. Works on whole words: the
+             * enabled and unused state are combined with a single AND, counted with popcount and the
+             * selected channel is found by rank, so the cost does not grow with the number of channels.
+             * When all enabled channels have been used the pool resets, as with the list overload.
+             *
+             * @param channelMask 16 bit words of enabled channels in the ChannelPlan channel mask layout,
+             *        bit 0 of word 0 is channel 0
+             * @param maskWords number of words in channelMask, channels beyond the supported range are ignored
+             * @param channel updated with the randomly generated channel, value is valid only when this method
+             *        returns true
+             * @return false if no channels are enabled
+             */
+            bool NextChannel(const uint16_t *channelMask, uint8_t maskWords, uint8_t *channel);
+
             /** Gets the bitmask state containing the randomly used 125K channels
              * @return bitmask of the random channel distribution state - a '1' bit indicates the channel has
              *         not been used for randomization, a '0' indicates the channel has been used for randomization.
@@ -0,0 +1,116 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  Word level channel selection for lora::RandomChannel
+ *
+ * @details The per subband byte arrays are loaded into one 64 bit word for channels 0-63 and
+ *          one 32 bit word for the remaining channels, then selection is a popcount and a
+ *          search for the n-th set bit.
+ *
+ */
+
+#include "RandomChannel.h"
+#include "Lora.h"
+
+using namespace lora;
+
+namespace {
+
+    inline uint8_t Popcount64(uint64_t value) {
+        return __builtin_popcount((uint32_t) value) + __builtin_popcount((uint32_t) (value >> 32));
+    }
+
+    /** Index of the n-th set bit (n from 0) of a 32 bit word with more than n bits set.
+     *  Narrows by halves, a fixed five steps regardless of the word contents.
+     */
+    inline uint8_t SelectBit32(uint32_t value, uint8_t n) {
+        uint8_t pos = 0;
+        for (uint8_t width = 16; width > 0; width >>= 1) {
+            uint32_t low = value & ((1UL << width) - 1);
+            uint8_t count = __builtin_popcount(low);
+            if (n >= count) {
+                n -= count;
+                value >>= width;
+                pos += width;
+            } else {
+                value = low;
+            }
+        }
+        return pos;
+    }
+
+    inline uint8_t SelectBit64(uint64_t value, uint8_t n) {
+        uint8_t count = __builtin_popcount((uint32_t) value);
+        if (n < count) {
+            return SelectBit32((uint32_t) value, n);
+        }
+        return 32 + SelectBit32((uint32_t) (value >> 32), n - count);
+    }
+
+}
+
+bool RandomChannel::NextChannel(const uint16_t *channelMask, uint8_t maskWords, uint8_t *channel) {
+    const uint8_t highBytes = NUM_SUBBANDS - SUBBAND_500K_INDEX;
+
+    uint64_t enabledLow = 0;
+    uint32_t enabledHigh = 0;
+
+    for (uint8_t i = 0; i < maskWords && i < 4; i++) {
+        enabledLow |= (uint64_t) channelMask[i] << (i * 16);
+    }
+    for (uint8_t i = 4; i < maskWords && i < 6; i++) {
+        enabledHigh |= (uint32_t) channelMask[i] << ((i - 4) * 16);
+    }
+    if (highBytes < 4) {
+        enabledHigh &= (1UL << (highBytes * 8)) - 1;
+    }
+
+    uint64_t unusedLow = 0;
+    uint32_t unusedHigh = 0;
+
+    for (uint8_t i = 0; i < SUBBAND_500K_INDEX; i++) {
+        unusedLow |= (uint64_t) _unusedChannels[i] << (i * 8);
+        _enabledChannels[i] = enabledLow >> (i * 8);
+    }
+    for (uint8_t i = 0; i < highBytes; i++) {
+        unusedHigh |= (uint32_t) _unusedChannels[SUBBAND_500K_INDEX + i] << (i * 8);
+        _enabledChannels[SUBBAND_500K_INDEX + i] = enabledHigh >> (i * 8);
+    }
+
+    uint64_t availableLow = unusedLow & enabledLow;
+    uint32_t availableHigh = unusedHigh & enabledHigh;
+
+    // every enabled channel has been used, start a new round
+    if ((availableLow | availableHigh) == 0) {
+        for (uint8_t i = 0; i < NUM_SUBBANDS; i++) {
+            MarkAllSubbandChannelsUnused(i);
+        }
+        availableLow = enabledLow;
+        availableHigh = enabledHigh;
+    }
+
+    uint8_t countLow = Popcount64(availableLow);
+    uint8_t count = countLow + __builtin_popcount(availableHigh);
+
+    if (count == 0) {
+        return false;
+    }
+
+    uint8_t n = rand_r(0, count - 1);
+
+    if (n < countLow) {
+        uint8_t bit = SelectBit64(availableLow, n);
+        _unusedChannels[bit / CHANNELS_PER_SUBBAND] &= ~(1 << (bit % CHANNELS_PER_SUBBAND));
+        *channel = bit;
+    } else {
+        uint8_t bit = SelectBit32(availableHigh, n - countLow);
+        _unusedChannels[SUBBAND_500K_INDEX + bit / CHANNELS_PER_SUBBAND] &= ~(1 << (bit % CHANNELS_PER_SUBBAND));
+        *channel = 64 + bit;
+    }
+
+    return true;
+}
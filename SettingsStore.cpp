@@ -0,0 +1,619 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SettingsStore saves only the parts of lora::Settings that changed
+ *
+ */
+
+#include "SettingsStore.h"
+#include "PerfStats.h"
+#include "crc32.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint32_t BANK_MAGIC = 0x5445534C;     //!< "LSET"
+    const uint8_t BANK_HEADER_SIZE = 12;        //!< magic, generation, settings size, check
+    const uint8_t RECORD_HEADER_SIZE = 8;       //!< region, flags, offset, length, check
+    const uint8_t RECORD_COMMIT = 0x01;         //!< last record of a save
+    const uint8_t MAX_ALIGN = 32;
+    const uint8_t CHUNK = 32;
+
+    struct RegionLayout {
+        uint16_t Offset;
+        uint16_t Size;
+    };
+
+    RegionLayout Layout(uint8_t region) {
+        RegionLayout layout = { 0, 0 };
+
+        if (region == SETTINGS_DEVICE) {
+            layout.Offset = offsetof(Settings, Device);
+            layout.Size = sizeof(DeviceConfig);
+        } else if (region == SETTINGS_NETWORK) {
+            layout.Offset = offsetof(Settings, Network);
+            layout.Size = sizeof(NetworkConfig);
+        } else if (region == SETTINGS_SESSION) {
+            layout.Offset = offsetof(Settings, Session);
+            layout.Size = sizeof(NetworkSession);
+        } else if (region >= SETTINGS_MULTICAST && region < SETTINGS_STATS) {
+            layout.Offset = offsetof(Settings, Multicast) + (region - SETTINGS_MULTICAST) * sizeof(MulticastSession);
+            layout.Size = sizeof(MulticastSession);
+        } else if (region == SETTINGS_STATS) {
+            layout.Offset = offsetof(Settings, Stats);
+            layout.Size = sizeof(Statistics);
+        } else if (region == SETTINGS_TEST) {
+            layout.Offset = offsetof(Settings, Test);
+            layout.Size = sizeof(Testing);
+        }
+
+        return layout;
+    }
+
+    uint32_t* CounterField(Settings& settings, uint8_t counter) {
+        if (counter == COUNTER_UPLINK) {
+            return &settings.Session.UplinkCounter;
+        } else if (counter == COUNTER_DOWNLINK) {
+            return &settings.Session.DownlinkCounter;
+        }
+
+        return &settings.Multicast[counter - COUNTER_MULTICAST].DownlinkCounter;
+    }
+
+    /**
+     * Frame counters go to the counter log, their bytes never make a region differ
+     */
+    bool Masked(uint8_t region, uint16_t offset) {
+        uint16_t field[2];
+        uint8_t fields = 0;
+
+        if (region == SETTINGS_SESSION) {
+            field[fields++] = offsetof(NetworkSession, UplinkCounter);
+            field[fields++] = offsetof(NetworkSession, DownlinkCounter);
+        } else if (region >= SETTINGS_MULTICAST && region < SETTINGS_STATS) {
+            field[fields++] = offsetof(MulticastSession, DownlinkCounter);
+        }
+
+        for (uint8_t i = 0; i < fields; i++) {
+            if (offset >= field[i] && offset < field[i] + sizeof(uint32_t)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool Differs(const uint8_t* current, const uint8_t* stored, uint8_t region, uint16_t offset) {
+        return current[offset] != stored[offset] && !Masked(region, offset);
+    }
+
+    /**
+     * Find the next span of changed bytes at or after from, joining spans a record header apart
+     * @return false if nothing changed from there on
+     */
+    bool NextSpan(const uint8_t* current, const uint8_t* stored, uint8_t region, uint16_t size,
+                  uint16_t from, uint16_t& start, uint16_t& length) {
+        uint16_t i = from;
+
+        while (i < size && !Differs(current, stored, region, i)) {
+            i++;
+        }
+
+        if (i >= size) {
+            return false;
+        }
+
+        uint16_t end = i + 1;
+
+        for (uint16_t j = end; j < size && j - end <= RECORD_HEADER_SIZE; j++) {
+            if (Differs(current, stored, region, j)) {
+                end = j + 1;
+            }
+        }
+
+        start = i;
+        length = end - i;
+        return true;
+    }
+
+    uint32_t Align(uint32_t size, uint32_t program) {
+        return (size + program - 1) / program * program;
+    }
+
+    bool Blank(const uint8_t* data, uint32_t size) {
+        for (uint32_t i = 0; i < size; i++) {
+            if (data[i] != NVM_ERASED) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void EncodeRecordHeader(uint8_t* header, uint8_t region, uint8_t flags, uint16_t offset, uint16_t length) {
+        header[0] = region;
+        header[1] = flags;
+        header[2] = offset;
+        header[3] = offset >> 8;
+        header[4] = length;
+        header[5] = length >> 8;
+    }
+
+}
+
+SettingsStoreConfig::SettingsStoreConfig()
+:   Address(0x0A00),
+    BankSize(0x0600),
+    CounterAddress(0x1600),
+    CounterBankSize(0x0100),
+    UplinkReserve(16)
+{
+    // the top 3.5 KB of the 6 KB xDot user EEPROM
+}
+
+SettingsStore::SettingsStore(NvmDevice& nvm, const SettingsStoreConfig& config)
+:   _nvm(nvm),
+    _config(config),
+    _counters(nvm, config.CounterAddress, config.CounterBankSize),
+    _bank(0),
+    _generation(0),
+    _cursor(0),
+    _mounted(false),
+    _loaded(false),
+    _snapshot(true)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _counters.SetReserve(COUNTER_UPLINK, std::max(config.UplinkReserve, UPLINK_RESERVE_MIN));
+}
+
+uint32_t SettingsStore::RecordSize(uint16_t length) const {
+    return Align(RECORD_HEADER_SIZE + length, _nvm.ProgramSize());
+}
+
+int32_t SettingsStore::Mount(Settings& settings) {
+    uint32_t program = _nvm.ProgramSize();
+    uint32_t erase = _nvm.EraseSize();
+    uint32_t snapshot = Align(BANK_HEADER_SIZE, program);
+
+    _mounted = false;
+    _loaded = false;
+
+    for (uint8_t region = 0; region < SETTINGS_REGIONS; region++) {
+        snapshot += RecordSize(Layout(region).Size);
+    }
+
+    if (program == 0 || program > MAX_ALIGN || erase == 0 || _config.BankSize % erase != 0 || snapshot > _config.BankSize) {
+        logError("settings store: %lu byte banks cannot hold a %lu byte snapshot", (unsigned long) _config.BankSize, (unsigned long) snapshot);
+        return LORA_ERROR;
+    }
+
+    if (_counters.Mount() != LORA_OK) {
+        return LORA_ERROR;
+    }
+
+    uint8_t header[MAX_ALIGN];
+    bool found = false;
+
+    for (uint8_t bank = 0; bank < 2; bank++) {
+        if (_nvm.Read(_config.Address + bank * _config.BankSize, header, BANK_HEADER_SIZE) != 0) {
+            return LORA_ERROR;
+        }
+
+        uint32_t magic = header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t) header[3] << 24);
+        uint32_t generation = header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t) header[7] << 24);
+        uint16_t size = header[8] | (header[9] << 8);
+        uint32_t crc = crc32(0, header, 10);
+
+        // a different Settings layout is not loaded
+        if (magic != BANK_MAGIC || size != sizeof(Settings) || header[10] != (uint8_t) crc || header[11] != (uint8_t) (crc >> 8)) {
+            continue;
+        }
+
+        if (!found || generation > _generation) {
+            found = true;
+            _bank = bank;
+            _generation = generation;
+        }
+    }
+
+    _defaults = settings;
+    _stored = settings;
+    _snapshot = true;
+
+    if (found) {
+        bool complete = false;
+
+        if (Replay(_bank, complete) != LORA_OK) {
+            _stored = settings;
+            return LORA_ERROR;
+        }
+
+        _loaded = true;
+        // records after the last commit are left over from a save cut short, start clean
+        _snapshot = !complete;
+    } else {
+        _bank = 1;
+        _generation = 0;
+    }
+
+    for (uint8_t counter = 0; counter < COUNTERS; counter++) {
+        if (_counters.Stored(counter)) {
+            *CounterField(_stored, counter) = _counters.Get(counter);
+            _loaded = true;
+        }
+    }
+
+    settings = _stored;
+    _mounted = true;
+
+    return LORA_OK;
+}
+
+int32_t SettingsStore::Replay(uint8_t bank, bool& complete) {
+    uint32_t base = _config.Address + bank * _config.BankSize;
+    uint32_t start = Align(BANK_HEADER_SIZE, _nvm.ProgramSize());
+    uint32_t committed = start;
+    uint32_t cursor = start;
+    uint8_t header[RECORD_HEADER_SIZE];
+    uint8_t chunk[CHUNK];
+
+    complete = true;
+
+    // find the end of the last committed save
+    while (cursor + RECORD_HEADER_SIZE <= _config.BankSize) {
+        if (_nvm.Read(base + cursor, header, RECORD_HEADER_SIZE) != 0) {
+            return LORA_ERROR;
+        }
+
+        if (Blank(header, RECORD_HEADER_SIZE)) {
+            break;
+        }
+
+        uint8_t region = header[0];
+        uint16_t offset = header[2] | (header[3] << 8);
+        uint16_t length = header[4] | (header[5] << 8);
+        RegionLayout layout = Layout(region);
+
+        if (region >= SETTINGS_REGIONS || offset + length > layout.Size || cursor + RecordSize(length) > _config.BankSize) {
+            complete = false;
+            break;
+        }
+
+        uint32_t crc = crc32(0, header, 6);
+
+        for (uint16_t done = 0; done < length; done += CHUNK) {
+            uint16_t size = length - done < CHUNK ? length - done : CHUNK;
+
+            if (_nvm.Read(base + cursor + RECORD_HEADER_SIZE + done, chunk, size) != 0) {
+                return LORA_ERROR;
+            }
+
+            crc = crc32(crc, chunk, size);
+        }
+
+        if (header[6] != (uint8_t) crc || header[7] != (uint8_t) (crc >> 8)) {
+            complete = false;
+            break;
+        }
+
+        cursor += RecordSize(length);
+
+        if (header[1] & RECORD_COMMIT) {
+            committed = cursor;
+        }
+    }
+
+    if (committed != cursor) {
+        complete = false;
+    }
+
+    // apply the committed records in order
+    for (cursor = start; cursor < committed; ) {
+        if (_nvm.Read(base + cursor, header, RECORD_HEADER_SIZE) != 0) {
+            return LORA_ERROR;
+        }
+
+        uint16_t offset = header[2] | (header[3] << 8);
+        uint16_t length = header[4] | (header[5] << 8);
+        uint8_t* destination = (uint8_t*) &_stored + Layout(header[0]).Offset + offset;
+
+        if (_nvm.Read(base + cursor + RECORD_HEADER_SIZE, destination, length) != 0) {
+            return LORA_ERROR;
+        }
+
+        cursor += RecordSize(length);
+    }
+
+    _cursor = committed;
+    return LORA_OK;
+}
+
+int32_t SettingsStore::Format() {
+    _mounted = false;
+
+    if (_nvm.Erase(_config.Address, _config.BankSize * 2) != 0) {
+        return LORA_ERROR;
+    }
+
+    _stats.Erases += 2;
+
+    if (_counters.Format() != LORA_OK) {
+        return LORA_ERROR;
+    }
+
+    _bank = 1;
+    _generation = 0;
+    _loaded = false;
+    _snapshot = true;
+    _mounted = true;
+
+    return LORA_OK;
+}
+
+int32_t SettingsStore::Save(const Settings& settings, uint32_t regions) {
+    if (!_mounted) {
+        return LORA_ERROR;
+    }
+
+    // the settings records and the counter log writes under them
+    PerfTimer timer(PERF_FLASH_SAVE);
+
+    uint32_t bytes = _stats.Bytes + _counters.GetStats().Bytes;
+    uint32_t back = 0;
+
+    // counters set back by a join are written once the new session is committed, a reset
+    // in between loads the new session with counters too high rather than the old one with
+    // counters it already used
+    for (uint8_t counter = 0; counter < COUNTERS; counter++) {
+        if (*CounterField(const_cast<Settings&>(settings), counter) < *CounterField(_stored, counter)) {
+            back |= 1UL << counter;
+        }
+    }
+
+    int32_t ret = SaveCounters(settings, ~back);
+
+    if (ret == LORA_OK) {
+        const uint8_t* current = (const uint8_t*) &settings;
+        const uint8_t* stored = (const uint8_t*) &_stored;
+        uint32_t records = 0;
+        uint32_t size = 0;
+        uint16_t start;
+        uint16_t length;
+
+        for (uint8_t region = 0; region < SETTINGS_REGIONS && !_snapshot; region++) {
+            RegionLayout layout = Layout(region);
+
+            if ((regions & (1UL << region)) == 0) {
+                continue;
+            }
+
+            for (uint16_t from = 0; NextSpan(current + layout.Offset, stored + layout.Offset, region, layout.Size, from, start, length); from = start + length) {
+                records++;
+                size += RecordSize(length);
+            }
+        }
+
+        if (_snapshot || _cursor + size > _config.BankSize) {
+            ret = Snapshot(settings, regions);
+        } else if (records != 0) {
+            uint32_t address = _config.Address + _bank * _config.BankSize + _cursor;
+
+            for (uint8_t region = 0; region < SETTINGS_REGIONS && ret == LORA_OK; region++) {
+                RegionLayout layout = Layout(region);
+
+                if ((regions & (1UL << region)) == 0) {
+                    continue;
+                }
+
+                for (uint16_t from = 0; ret == LORA_OK && NextSpan(current + layout.Offset, stored + layout.Offset, region, layout.Size, from, start, length); from = start + length) {
+                    ret = WriteRecord(address, region, start, length, current + layout.Offset + start, --records == 0);
+                }
+            }
+
+            if (ret == LORA_OK) {
+                _cursor = address - _config.Address - _bank * _config.BankSize;
+                _stats.Saves++;
+
+                for (uint8_t region = 0; region < SETTINGS_REGIONS; region++) {
+                    RegionLayout layout = Layout(region);
+
+                    if (regions & (1UL << region)) {
+                        memcpy((uint8_t*) &_stored + layout.Offset, current + layout.Offset, layout.Size);
+                    }
+                }
+            } else {
+                // the tail of the bank may hold part of a record
+                _snapshot = true;
+            }
+        }
+    }
+
+    if (ret == LORA_OK && back != 0) {
+        ret = SaveCounters(settings, back);
+    }
+
+    _stats.LastSave = _stats.Bytes + _counters.GetStats().Bytes - bytes;
+    return ret;
+}
+
+int32_t SettingsStore::SaveCounters(const Settings& settings, uint32_t counters) {
+    for (uint8_t counter = 0; counter < COUNTERS; counter++) {
+        uint32_t value = *CounterField(const_cast<Settings&>(settings), counter);
+
+        if ((counters & (1UL << counter)) == 0) {
+            continue;
+        }
+
+        // sessions never used keep nothing in the log
+        if (!_counters.Stored(counter) && value == 0) {
+            continue;
+        }
+
+        if (_counters.Set(counter, value) != LORA_OK) {
+            return LORA_ERROR;
+        }
+
+        *CounterField(_stored, counter) = value;
+    }
+
+    return LORA_OK;
+}
+
+int32_t SettingsStore::Snapshot(const Settings& settings, uint32_t regions) {
+    uint8_t target = _bank ^ 1;
+    uint32_t base = _config.Address + target * _config.BankSize;
+    uint32_t address = base + Align(BANK_HEADER_SIZE, _nvm.ProgramSize());
+    const Settings* source[SETTINGS_REGIONS];
+    uint8_t last = SETTINGS_REGIONS;
+    int32_t ret = LORA_OK;
+
+    // a region still at its defaults is left out, loading starts from the defaults
+    for (uint8_t region = 0; region < SETTINGS_REGIONS; region++) {
+        RegionLayout layout = Layout(region);
+
+        source[region] = (regions & (1UL << region)) ? &settings : &_stored;
+
+        if (memcmp((const uint8_t*) source[region] + layout.Offset, (const uint8_t*) &_defaults + layout.Offset, layout.Size) == 0) {
+            source[region] = NULL;
+        } else {
+            last = region;
+        }
+    }
+
+    if (_nvm.Erase(base, _config.BankSize) != 0) {
+        return LORA_ERROR;
+    }
+
+    _stats.Erases++;
+
+    for (uint8_t region = 0; region < SETTINGS_REGIONS && ret == LORA_OK; region++) {
+        RegionLayout layout = Layout(region);
+
+        if (source[region] != NULL) {
+            ret = WriteRecord(address, region, 0, layout.Size, (const uint8_t*) source[region] + layout.Offset, region == last);
+        }
+    }
+
+    if (ret != LORA_OK) {
+        return ret;
+    }
+
+    // the header makes the bank valid, so it goes last
+    uint8_t header[MAX_ALIGN];
+    uint32_t generation = _generation + 1;
+    uint16_t size = sizeof(Settings);
+    uint32_t length = Align(BANK_HEADER_SIZE, _nvm.ProgramSize());
+
+    memset(header, NVM_ERASED, length);
+    header[0] = (uint8_t) BANK_MAGIC;
+    header[1] = (uint8_t) (BANK_MAGIC >> 8);
+    header[2] = (uint8_t) (BANK_MAGIC >> 16);
+    header[3] = (uint8_t) (BANK_MAGIC >> 24);
+    header[4] = generation;
+    header[5] = generation >> 8;
+    header[6] = generation >> 16;
+    header[7] = generation >> 24;
+    header[8] = size;
+    header[9] = size >> 8;
+
+    uint32_t crc = crc32(0, header, 10);
+    header[10] = crc;
+    header[11] = crc >> 8;
+
+    if (_nvm.Program(base, header, length) != 0) {
+        return LORA_ERROR;
+    }
+
+    _stats.Bytes += length;
+    _stats.Snapshots++;
+    _stats.Saves++;
+
+    for (uint8_t region = 0; region < SETTINGS_REGIONS; region++) {
+        RegionLayout layout = Layout(region);
+
+        if (regions & (1UL << region)) {
+            memcpy((uint8_t*) &_stored + layout.Offset, (const uint8_t*) &settings + layout.Offset, layout.Size);
+        }
+    }
+
+    _bank = target;
+    _generation = generation;
+    _cursor = address - base;
+    _snapshot = false;
+
+    return LORA_OK;
+}
+
+int32_t SettingsStore::WriteRecord(uint32_t& address, uint8_t region, uint16_t offset, uint16_t length, const uint8_t* data, bool commit) {
+    uint32_t program = _nvm.ProgramSize();
+    uint32_t size = RecordSize(length);
+    uint8_t block[MAX_ALIGN];
+    uint32_t crc;
+
+    // header and data are streamed through one program sized block at a time
+    memset(block, NVM_ERASED, sizeof(block));
+    EncodeRecordHeader(block, region, commit ? RECORD_COMMIT : 0, offset, length);
+    crc = crc32(crc32(0, block, 6), data, length);
+    block[6] = crc;
+    block[7] = crc >> 8;
+
+    uint32_t used = RECORD_HEADER_SIZE;
+    uint32_t done = 0;
+
+    for (uint32_t written = 0; written < size; written += program) {
+        while (used < program && done < length) {
+            block[used++] = data[done++];
+        }
+
+        if (_nvm.Program(address + written, block, program) != 0) {
+            return LORA_ERROR;
+        }
+
+        // a header longer than the program size spills into the next block
+        if (used > program) {
+            memmove(block, block + program, used - program);
+            used -= program;
+        } else {
+            used = 0;
+        }
+
+        memset(block + used, NVM_ERASED, sizeof(block) - used);
+    }
+
+    address += size;
+    _stats.Records++;
+    _stats.Bytes += size;
+
+    return LORA_OK;
+}
+
+bool SettingsStore::Loaded() const {
+    return _loaded;
+}
+
+const SettingsStoreStats& SettingsStore::GetStats() const {
+    return _stats;
+}
+
+const CounterLog& SettingsStore::Counters() const {
+    return _counters;
+}
+
+void SettingsStore::Log() const {
+    const CounterLogStats& counters = _counters.GetStats();
+
+    logInfo("settings store: %lu saves, %lu records, %lu bytes, %lu snapshots, %lu erases, last save %lu bytes",
+            (unsigned long) _stats.Saves, (unsigned long) _stats.Records, (unsigned long) _stats.Bytes,
+            (unsigned long) _stats.Snapshots, (unsigned long) _stats.Erases, (unsigned long) _stats.LastSave);
+    logInfo("counter log: %lu writes, %lu bytes, %lu erases",
+            (unsigned long) counters.Writes, (unsigned long) counters.Bytes, (unsigned long) counters.Erases);
+}
@@ -0,0 +1,131 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SettingsStore saves only the parts of lora::Settings that changed
+ *
+ * @details Settings are split into regions, one per sub-struct and one per multicast session.
+ *          A save compares each region with a copy of what is already stored and appends a
+ *          record per changed byte span to a log in the active of two banks; the last record
+ *          of a save is marked as its commit.  Loading replays the committed records over the
+ *          defaults.  When the bank is full a snapshot of every region that differs from the
+ *          defaults is written to the other bank, its header last.  Frame counters are left
+ *          out of the regions and kept in a CounterLog, so an uplink costs a counter entry and
+ *          the few session bytes that moved.
+ *
+ */
+
+#ifndef __LORA_SETTINGS_STORE_H__
+#define __LORA_SETTINGS_STORE_H__
+
+#include "Lora.h"
+#include "NvmDevice.h"
+#include "CounterLog.h"
+
+namespace lora {
+
+    enum SettingsRegion {
+        SETTINGS_DEVICE = 0,
+        SETTINGS_NETWORK,
+        SETTINGS_SESSION,
+        SETTINGS_MULTICAST,                     //!< first of MAX_MULTICAST_SESSIONS
+        SETTINGS_STATS = SETTINGS_MULTICAST + MAX_MULTICAST_SESSIONS,
+        SETTINGS_TEST,
+        SETTINGS_REGIONS
+    };
+
+    const uint32_t SETTINGS_ALL = (1UL << SETTINGS_REGIONS) - 1;
+    const uint32_t SETTINGS_SAVED = SETTINGS_ALL & ~(1UL << SETTINGS_STATS);   //!< statistics move with every packet
+
+    // an uplink counter stored exactly is written after the frame is sent, a reset between the two reuses it
+    const uint8_t UPLINK_RESERVE_MIN = 1;
+
+    struct SettingsStoreConfig {
+            SettingsStoreConfig();
+
+            uint32_t Address;                   //!< start of two settings banks
+            uint32_t BankSize;                  //!< holds a snapshot of all regions and the records after it
+            uint32_t CounterAddress;            //!< start of two counter log banks
+            uint32_t CounterBankSize;
+            uint8_t UplinkReserve;              //!< uplink counter values stored ahead, raised to UPLINK_RESERVE_MIN
+    };
+
+    struct SettingsStoreStats {
+            uint32_t Saves;                     //!< saves that wrote records
+            uint32_t Records;
+            uint32_t Bytes;                     //!< bytes programmed for settings, counters not included
+            uint32_t Snapshots;                 //!< bank swaps
+            uint32_t Erases;
+            uint32_t LastSave;                  //!< bytes programmed by the last save, counters included
+    };
+
+    class SettingsStore {
+        public:
+            SettingsStore(NvmDevice& nvm, const SettingsStoreConfig& config = SettingsStoreConfig());
+
+            /**
+             * Load the stored settings and counters over the given ones
+             * @param settings defaults in, the same on every boot, stored values out
+             * @return LORA_OK, LORA_ERROR if the NVM failed or a bank is too small
+             */
+            int32_t Mount(Settings& settings);
+
+            /**
+             * Erase the store, the next save writes a snapshot
+             */
+            int32_t Format();
+
+            /**
+             * Write the frame counters and the changes of the given regions since the last save
+             * @param regions bit per SettingsRegion
+             */
+            int32_t Save(const Settings& settings, uint32_t regions = SETTINGS_SAVED);
+
+            /**
+             * @return true if Mount found stored settings
+             */
+            bool Loaded() const;
+
+            const SettingsStoreStats& GetStats() const;
+            const CounterLog& Counters() const;
+
+            void Log() const;
+
+        private:
+            /**
+             * Write every region to the other bank and make it active
+             * @param settings values of the regions being saved, the rest come from the stored copy
+             */
+            int32_t Snapshot(const Settings& settings, uint32_t regions);
+
+            /**
+             * Append one record
+             * @param address in NVM, advanced past the record
+             */
+            int32_t WriteRecord(uint32_t& address, uint8_t region, uint16_t offset, uint16_t length, const uint8_t* data, bool commit);
+
+            int32_t Replay(uint8_t bank, bool& complete);
+            int32_t SaveCounters(const Settings& settings, uint32_t counters);
+
+            uint32_t RecordSize(uint16_t length) const;
+
+            NvmDevice& _nvm;
+            SettingsStoreConfig _config;
+            CounterLog _counters;
+            Settings _defaults;                 //!< given to Mount, regions equal to them are not in snapshots
+            Settings _stored;                   //!< what a load would return
+            uint8_t _bank;
+            uint32_t _generation;
+            uint32_t _cursor;                   //!< offset of the next record in the active bank
+            bool _mounted;
+            bool _loaded;
+            bool _snapshot;                     //!< next save starts a new bank
+            SettingsStoreStats _stats;
+    };
+
+}
+
+#endif
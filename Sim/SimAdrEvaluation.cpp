@@ -0,0 +1,254 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimAdrEvaluation device side AdrPolicy against network ADR
+ *
+ */
+
+#include "SimAdrEvaluation.h"
+#include "SimEndDevice.h"
+#include "SimNetworkServer.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+
+using namespace lora;
+
+namespace {
+
+    const uint8_t DEV_EUI[8] = { 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 };
+    const uint8_t APP_EUI[8] = { 0x16, 0xEA, 0x76, 0xF6, 0xAB, 0x66, 0x3D, 0x80 };
+    const uint8_t APP_KEY[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+
+    const uint64_t JOIN_TIMEOUT = 600000000;    //!< us
+
+    void RunWhile(SimClock& clock, SimEndDevice& device, uint64_t deadline) {
+        uint64_t at = 0;
+
+        while (device.Busy() && clock.NextEventTime(at) && at <= deadline) {
+            clock.RunNext();
+        }
+    }
+
+}
+
+SimAdrEvaluationConfig::SimAdrEvaluationConfig()
+:   Region(SimRegion::EU868()),
+    Fading(3.0),
+    Seed(1),
+    GatewayPower(14),
+    Uplinks(400),
+    PayloadSize(12),
+    UplinkPeriod(300ULL * 1000000),
+    ConfirmedEvery(4),
+    Retries(8)
+{
+    // a good link, a fade to the SF9 range, one only SF11 and SF12 get through, then recovery
+    SimPathLossStep steps[4] = {
+        { 0, 115.0 },
+        { 100ULL * 300 * 1000000, 138.0 },
+        { 200ULL * 300 * 1000000, 146.0 },
+        { 300ULL * 300 * 1000000, 125.0 }
+    };
+
+    PathLoss.assign(steps, steps + 4);
+}
+
+double SimAdrResult::DeliveryRatio() const {
+    return Uplinks != 0 ? (double) Delivered / Uplinks : 0.0;
+}
+
+void SimAdrResult::Log(const char* name) const {
+    std::string use;
+    char entry[16];
+
+    for (size_t dr = 0; dr < Datarates.size(); dr++) {
+        if (Datarates[dr] != 0) {
+            snprintf(entry, sizeof(entry), " DR%u:%lu", (unsigned) dr, (unsigned long) Datarates[dr]);
+            use += entry;
+        }
+    }
+
+    logInfo("%s: %lu/%lu delivered (%.1f%%), %lu frames, airtime %.1f s, %.3f uAh per delivered uplink, lifetime %.0f days, link adr %lu,%s",
+            name, (unsigned long) Delivered, (unsigned long) Uplinks, DeliveryRatio() * 100.0, (unsigned long) Transmissions,
+            Airtime / 1e6, Charge, Lifetime, (unsigned long) LinkAdrReqs, use.c_str());
+
+    for (size_t i = 0; i < Phases.size(); i++) {
+        const SimAdrPhase& phase = Phases[i];
+        logInfo("%s at %.0f dB: %lu/%lu delivered, %.3f uAh per delivered uplink", name, phase.PathLoss,
+                (unsigned long) phase.Delivered, (unsigned long) phase.Uplinks, phase.Charge);
+    }
+}
+
+void SimAdrReport::Log() const {
+    logInfo("adr evaluation in %.2f s", WallTime);
+    Network.Log("network adr");
+    Policy.Log("adr policy");
+    logInfo("policy bias %.1f dB, airtime %+.0f%%, charge per delivered uplink %+.0f%%", Bias,
+            Network.Airtime != 0 ? (Policy.Airtime * 100.0 / Network.Airtime - 100.0) : 0.0,
+            Network.Charge > 0.0 ? (Policy.Charge * 100.0 / Network.Charge - 100.0) : 0.0);
+}
+
+SimAdrEvaluation::SimAdrEvaluation(const SimAdrEvaluationConfig& config)
+:   _config(config)
+{
+}
+
+size_t SimAdrEvaluation::Step(uint64_t at) const {
+    size_t step = 0;
+
+    for (size_t i = 0; i < _config.PathLoss.size(); i++) {
+        if (_config.PathLoss[i].At <= at) {
+            step = i;
+        }
+    }
+
+    return step;
+}
+
+double SimAdrEvaluation::PathLoss(uint64_t at) const {
+    return _config.PathLoss.empty() ? 120.0 : _config.PathLoss[Step(at)].PathLoss;
+}
+
+SimAdrReport SimAdrEvaluation::Run() {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    SimAdrReport report;
+
+    EnergyAdrPolicyConfig policyConfig = _config.Policy;
+    policyConfig.GatewayPower = _config.GatewayPower;
+    policyConfig.Energy = _config.Energy;
+    EnergyAdrPolicy policy(policyConfig);
+
+    report.Network = Run(NULL);
+    report.Policy = Run(&policy);
+    report.Bias = policy.Bias();
+    report.WallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    return report;
+}
+
+SimAdrResult SimAdrEvaluation::Run(AdrPolicy* policy) {
+    const SimRegion& region = _config.Region;
+    SimAdrResult result;
+
+    result.Uplinks = 0;
+    result.Delivered = 0;
+    result.Transmissions = 0;
+    result.Airtime = 0;
+    result.Charge = 0.0;
+    result.Lifetime = 0.0;
+    result.LinkAdrReqs = 0;
+    result.Datarates.assign(region.Datarates.size(), 0);
+
+    for (size_t i = 0; i < _config.PathLoss.size(); i++) {
+        SimAdrPhase phase = { _config.PathLoss[i].PathLoss, 0, 0, 0.0 };
+        result.Phases.push_back(phase);
+    }
+
+    SimClock clock;
+    SimMedium medium(clock, _config.Seed);
+    medium.SetFading(_config.Fading);
+
+    SimNetworkServerConfig nsConfig;
+    nsConfig.Region = region;
+    nsConfig.Seed = _config.Seed;
+    nsConfig.Power = _config.GatewayPower;
+    SimNetworkServer server(medium, nsConfig);
+    server.AddDevice(DEV_EUI, APP_EUI, APP_KEY);
+
+    SimRadio radio(medium);
+    SimEndDevice device(radio, region, DEV_EUI, APP_EUI, APP_KEY);
+    EnergyMeter meter(_config.Energy);
+    meter.SetMcuStateAt(clock.Now(), ENERGY_MCU_STOP);
+    radio.SetEnergyMeter(&meter);
+
+    device.SetAdr(policy == NULL);
+    device.SetPolicy(policy);
+    device.SetRetries(_config.Retries);
+    device.SetDatarate(region.MinDatarate);
+    medium.SetPathLoss(&radio, &server.Radio(), PathLoss(0));
+
+    device.Join();
+    RunWhile(clock, device, clock.Now() + JOIN_TIMEOUT);
+
+    if (!device.Joined()) {
+        logError("adr evaluation: device did not join");
+        radio.SetEnergyMeter(NULL);
+        return result;
+    }
+
+    if (policy != NULL) {
+        policy->Reset();
+    }
+
+    uint64_t start = clock.Now();
+    uint32_t frames = device.GetStats().Uplinks;
+    uint64_t airtime = radio.GetStats().TxTime;
+    uint32_t accepted = server.GetStats().Uplinks;
+    std::vector<uint8_t> payload(_config.PayloadSize, 0x5A);
+
+    meter.ResetAt(start);
+
+    for (uint32_t i = 0; i < _config.Uplinks; i++) {
+        uint64_t due = start + i * _config.UplinkPeriod;
+
+        clock.RunUntil(std::max(due, clock.Now()));
+        size_t step = Step(clock.Now() - start);
+        medium.SetPathLoss(&radio, &server.Radio(), PathLoss(clock.Now() - start));
+
+        bool confirmed = _config.ConfirmedEvery != 0 && i % _config.ConfirmedEvery == 0;
+
+        uint32_t before = server.GetStats().Uplinks;
+        uint64_t charge = meter.Operation(ENERGY_UPLINK).Charge;
+
+        meter.BeginAt(clock.Now(), ENERGY_UPLINK);
+        if (!device.Send(1, payload, confirmed)) {
+            continue;
+        }
+
+        result.Uplinks++;
+        if (device.GetDatarate() < result.Datarates.size()) {
+            result.Datarates[device.GetDatarate()]++;
+        }
+
+        RunWhile(clock, device, clock.Now() + _config.UplinkPeriod * 4);
+        meter.EndAt(clock.Now(), ENERGY_UPLINK);
+
+        if (step < result.Phases.size()) {
+            SimAdrPhase& phase = result.Phases[step];
+            phase.Uplinks++;
+            phase.Delivered += server.GetStats().Uplinks - before;
+            phase.Charge += EnergyMeter::MicroAmpHours(meter.Operation(ENERGY_UPLINK).Charge - charge);
+        }
+    }
+
+    for (size_t i = 0; i < result.Phases.size(); i++) {
+        if (result.Phases[i].Delivered != 0) {
+            result.Phases[i].Charge /= result.Phases[i].Delivered;
+        }
+    }
+
+    // let the last downlink go out
+    clock.RunUntil(clock.Now() + 10000000);
+    meter.UpdateAt(clock.Now());
+
+    result.Delivered = server.GetStats().Uplinks - accepted;
+    result.Transmissions = device.GetStats().Uplinks - frames;
+    result.Airtime = radio.GetStats().TxTime - airtime;
+    result.LinkAdrReqs = server.GetStats().LinkAdrReqs;
+    result.Lifetime = meter.ProjectedLifetime(_config.UplinkPeriod / 1000000);
+
+    if (result.Delivered != 0) {
+        result.Charge = EnergyMeter::MicroAmpHours(meter.Operation(ENERGY_UPLINK).Charge) / result.Delivered;
+    }
+
+    radio.SetEnergyMeter(NULL);
+
+    return result;
+}
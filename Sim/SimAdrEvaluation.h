@@ -0,0 +1,123 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimAdrEvaluation device side AdrPolicy against network ADR
+ *
+ * @details Runs the same uplink schedule twice over a script of path loss steps, once with
+ *          ADR on as devices run today, the SimNetworkServer sending LinkADRReq and the
+ *          device backing off after ADR_ACK_LIMIT + ADR_ACK_DELAY uplinks without a
+ *          downlink, and once with ADR off and an AdrPolicy picking each uplink.  Both runs
+ *          use the same seed, so fading and channel choice start out the same.  Delivery is
+ *          counted at the network server, charge is metered on the device radio, both for the
+ *          whole run and per path loss step.
+ *
+ */
+
+#ifndef __LORA_SIM_ADR_EVALUATION_H__
+#define __LORA_SIM_ADR_EVALUATION_H__
+
+#include "SimRegion.h"
+#include "AdrPolicy.h"
+#include "EnergyMeter.h"
+#include <vector>
+
+namespace lora {
+
+    /**
+     * Path loss from a virtual time on, counted from the first uplink
+     */
+    struct SimPathLossStep {
+        uint64_t At;                        //!< us
+        double PathLoss;                    //!< dB
+    };
+
+    struct SimAdrEvaluationConfig {
+        SimAdrEvaluationConfig();
+
+        SimRegion Region;
+        double Fading;                      //!< dB sigma
+        uint32_t Seed;
+        int8_t GatewayPower;                //!< dBm, also given to the policy
+
+        uint32_t Uplinks;
+        uint8_t PayloadSize;
+        uint64_t UplinkPeriod;              //!< us
+        uint32_t ConfirmedEvery;            //!< every Nth uplink is confirmed, 1 for all, 0 for none
+        uint8_t Retries;                    //!< attempts of a confirmed uplink
+
+        EnergyProfile Energy;
+        EnergyAdrPolicyConfig Policy;
+
+        std::vector<SimPathLossStep> PathLoss;
+    };
+
+    /**
+     * Uplinks sent under one path loss step
+     */
+    struct SimAdrPhase {
+        double PathLoss;                    //!< dB
+        uint32_t Uplinks;
+        uint32_t Delivered;
+        double Charge;                      //!< uAh per delivered uplink
+    };
+
+    /**
+     * Outcome of one run
+     */
+    struct SimAdrResult {
+        uint32_t Uplinks;                   //!< uplinks sent, not counting retries and repetitions
+        uint32_t Delivered;                 //!< uplinks the network server accepted
+        uint32_t Transmissions;             //!< frames including retries and repetitions
+        uint64_t Airtime;                   //!< us
+        double Charge;                      //!< uAh per delivered uplink
+        double Lifetime;                    //!< days at one uplink per UplinkPeriod
+        uint32_t LinkAdrReqs;
+        std::vector<uint32_t> Datarates;    //!< uplinks sent at each datarate
+        std::vector<SimAdrPhase> Phases;    //!< one per path loss step
+
+        double DeliveryRatio() const;
+        void Log(const char* name) const;
+    };
+
+    struct SimAdrReport {
+        SimAdrResult Network;               //!< ADR on, network driven
+        SimAdrResult Policy;                //!< ADR off, AdrPolicy driven
+        double Bias;                        //!< dB learnt by the policy at the end
+        double WallTime;                    //!< s
+
+        void Log() const;
+    };
+
+    class SimAdrEvaluation {
+        public:
+            SimAdrEvaluation(const SimAdrEvaluationConfig& config);
+
+            /**
+             * Run with network ADR and with an EnergyAdrPolicy of the configuration
+             */
+            SimAdrReport Run();
+
+            /**
+             * Run with network ADR, or with ADR off and a policy
+             * @param policy NULL for network ADR
+             */
+            SimAdrResult Run(AdrPolicy* policy);
+
+        private:
+            /**
+             * Index of the path loss step in force
+             * @param at us from the first uplink
+             */
+            size_t Step(uint64_t at) const;
+            double PathLoss(uint64_t at) const;
+
+            SimAdrEvaluationConfig _config;
+    };
+
+}
+
+#endif
@@ -0,0 +1,235 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimAdrTransaction checks of LinkADRReq blocks through the US915 plan
+ *
+ */
+
+#include "SimAdrTransaction.h"
+#include "ChannelPlan_US915.h"
+#include "MTSLog.h"
+
+using namespace lora;
+
+namespace {
+
+    /**
+     * LinkADRReq arguments
+     */
+    struct Command {
+        uint8_t Datarate;
+        uint8_t Power;                      //!< TX power index
+        uint16_t Mask;
+        uint8_t Ctrl;
+        uint8_t NbRep;
+    };
+
+    struct Session {
+        uint8_t Datarate;
+        uint8_t Power;
+        uint8_t Redundancy;
+
+        bool operator==(const Session& other) const {
+            return Datarate == other.Datarate && Power == other.Power && Redundancy == other.Redundancy;
+        }
+    };
+
+    const uint8_t LINK_ADR_REQ_SIZE = 5;    //!< CID and arguments
+
+    /**
+     * FOpts of a downlink carrying the commands as one LinkADRReq block
+     */
+    std::vector<uint8_t> Downlink(const Command* commands, uint8_t count) {
+        std::vector<uint8_t> payload;
+
+        for (uint8_t i = 0; i < count; i++) {
+            payload.push_back(SRV_MAC_LINK_ADR_REQ);
+            payload.push_back((commands[i].Datarate << 4) | commands[i].Power);
+            payload.push_back(commands[i].Mask & 0xFF);
+            payload.push_back(commands[i].Mask >> 8);
+            payload.push_back((commands[i].Ctrl << 4) | commands[i].NbRep);
+        }
+
+        return payload;
+    }
+
+    /**
+     * Hand the first handled commands of a downlink to the plan, as the MAC does before it validates the block
+     */
+    void Handle(ChannelPlan& plan, const std::vector<uint8_t>& payload, uint8_t handled) {
+        for (uint8_t i = 0; i < handled; i++) {
+            uint8_t status = 0;
+
+            plan.HandleAdrCommand(payload.data(), i * LINK_ADR_REQ_SIZE + 1, payload.size(), status);
+        }
+    }
+
+    Session Current(ChannelPlan& plan) {
+        Session session;
+
+        session.Datarate = plan.GetSettings()->Session.TxDatarate;
+        session.Power = plan.GetSettings()->Session.TxPower;
+        session.Redundancy = plan.GetSettings()->Session.Redundancy;
+
+        return session;
+    }
+
+    /**
+     * A fresh US915 plan for each case
+     */
+    class Case {
+        public:
+            Case(const SimAdrTransactionConfig& config, const char* name)
+            :   _settings(),
+                _plan(&_settings)
+            {
+                _settings.Network.ADREnabled = true;
+                _settings.Network.TxPower = config.TxPower;
+                _settings.Network.FrequencySubBand = config.SubBand;
+                _settings.Session.Redundancy = 1;
+                _plan.Init();
+
+                _mask = _plan.GetChannelMask();
+                _session = Current(_plan);
+
+                Result.Name = name;
+                Result.Status = 0;
+                Result.Expected = 0;
+                Result.Staged = true;
+                Result.Mask = false;
+                Result.Session = false;
+            }
+
+            ChannelPlan& Plan() {
+                return _plan;
+            }
+
+            const std::vector<uint16_t>& Mask() const {
+                return _mask;
+            }
+
+            const Session& Before() const {
+                return _session;
+            }
+
+            /**
+             * Commands handled so far may only be staged
+             */
+            void CheckStaged() {
+                Result.Staged = Result.Staged && _plan.GetChannelMask() == _mask && Current(_plan) == _session;
+            }
+
+            void Validate(uint8_t expected, const std::vector<uint16_t>& mask, const Session& session) {
+                Result.Status = _plan.ValidateAdrConfiguration();
+                Result.Expected = expected;
+                Result.Mask = _plan.GetChannelMask() == mask;
+                Result.Session = Current(_plan) == session;
+            }
+
+            SimAdrTransactionResult Result;
+
+        private:
+            Settings _settings;
+            ChannelPlan_US915 _plan;
+            std::vector<uint16_t> _mask;
+            Session _session;
+    };
+
+}
+
+SimAdrTransactionConfig::SimAdrTransactionConfig()
+:   SubBand(2),
+    TxPower(20)
+{
+}
+
+bool SimAdrTransactionReport::Passed() const {
+    for (size_t i = 0; i < Results.size(); i++) {
+        const SimAdrTransactionResult& result = Results[i];
+
+        if (result.Status != result.Expected || !result.Staged || !result.Mask || !result.Session) {
+            return false;
+        }
+    }
+
+    return !Results.empty();
+}
+
+void SimAdrTransactionReport::Log() const {
+    for (size_t i = 0; i < Results.size(); i++) {
+        const SimAdrTransactionResult& result = Results[i];
+
+        logInfo("%-16s status %02x of %02x, staged %s, mask %s, session %s", result.Name, result.Status, result.Expected,
+                result.Staged ? "ok" : "CHANGED", result.Mask ? "ok" : "WRONG", result.Session ? "ok" : "WRONG");
+    }
+}
+
+SimAdrTransaction::SimAdrTransaction(const SimAdrTransactionConfig& config)
+:   _config(config)
+{
+}
+
+SimAdrTransactionReport SimAdrTransaction::Run() {
+    SimAdrTransactionReport report;
+
+    {
+        // all 125 kHz and 500 kHz channels off, then channels 16-23 on, at DR3 and power index 2
+        Case test(_config, "block");
+        const Command commands[] = { { 3, 2, 0x0000, 7, 1 }, { 3, 2, 0x00FF, 1, 2 } };
+        std::vector<uint16_t> mask(test.Mask().size(), 0);
+        Session session = { 3, 26, 2 };
+
+        mask[1] = 0x00FF;
+
+        Handle(test.Plan(), Downlink(commands, 2), 2);
+        test.CheckStaged();
+        test.Validate(0x07, mask, session);
+        report.Results.push_back(test.Result);
+    }
+
+    {
+        // the second command asks to disable every channel, the first may not be applied either
+        Case test(_config, "rejected command");
+        const Command commands[] = { { 2, 1, 0x00FF, 1, 1 }, { 2, 1, 0x0000, 5, 1 } };
+
+        Handle(test.Plan(), Downlink(commands, 2), 2);
+        test.CheckStaged();
+        test.Validate(0x06, test.Mask(), test.Before());
+        report.Results.push_back(test.Result);
+    }
+
+    {
+        // each command is fine alone, the block leaves a single 125 kHz channel
+        Case test(_config, "rejected mask");
+        const Command commands[] = { { 2, 1, 0x0000, 7, 1 }, { 2, 1, 0x0001, 0, 1 } };
+
+        Handle(test.Plan(), Downlink(commands, 2), 2);
+        test.CheckStaged();
+        test.Validate(0x06, test.Mask(), test.Before());
+        report.Results.push_back(test.Result);
+    }
+
+    {
+        // a downlink whose block was never validated, then a new downlink with one command
+        Case test(_config, "stale stage");
+        const Command stale[] = { { 4, 5, 0x0000, 7, 3 }, { 4, 5, 0x0000, 7, 3 } };
+        const Command fresh[] = { { 1, 3, 0x00FF, 0, 1 } };
+        std::vector<uint16_t> mask = test.Mask();
+        Session session = { 1, 24, 1 };
+
+        mask[0] = 0x00FF;
+
+        Handle(test.Plan(), Downlink(stale, 2), 1);
+        test.CheckStaged();
+        Handle(test.Plan(), Downlink(fresh, 1), 1);
+        test.CheckStaged();
+        test.Validate(0x07, mask, session);
+        report.Results.push_back(test.Result);
+    }
+
+    return report;
+}
@@ -0,0 +1,61 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimAdrTransaction checks of LinkADRReq blocks through the US915 plan
+ *
+ * @details A ChannelPlan_US915 on the host base is handed LinkADRReq blocks the way the MAC
+ *          does, HandleAdrCommand() per command and ValidateAdrConfiguration() once per block.
+ *          A block has to reach the live mask and the session only as a whole once it
+ *          validates, a rejected block has to leave both as they were, and a command from a
+ *          new downlink has to drop what an unvalidated block left staged.
+ *
+ */
+
+#ifndef __LORA_SIM_ADR_TRANSACTION_H__
+#define __LORA_SIM_ADR_TRANSACTION_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace lora {
+
+    struct SimAdrTransactionConfig {
+        SimAdrTransactionConfig();
+
+        uint8_t SubBand;                    //!< frequency sub band the plan starts on, 0 for all channels
+        uint8_t TxPower;                    //!< dBm the session starts with
+    };
+
+    struct SimAdrTransactionResult {
+        const char* Name;
+        uint8_t Status;                     //!< LinkADRAns status of the block
+        uint8_t Expected;
+        bool Staged;                        //!< the live mask and session stayed put until validation
+        bool Mask;                          //!< the live mask is the one expected after validation
+        bool Session;                       //!< datarate, power and NbRep are the ones expected
+    };
+
+    struct SimAdrTransactionReport {
+        std::vector<SimAdrTransactionResult> Results;
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimAdrTransaction {
+        public:
+            SimAdrTransaction(const SimAdrTransactionConfig& config = SimAdrTransactionConfig());
+
+            SimAdrTransactionReport Run();
+
+        private:
+            SimAdrTransactionConfig _config;
+    };
+
+}
+
+#endif
@@ -0,0 +1,289 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimBenchmark end-to-end latency of join, confirmed uplink and FUOTA
+ *
+ */
+
+#include "SimBenchmark.h"
+#include "SimEndDevice.h"
+#include "SimNetworkServer.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+using namespace lora;
+
+namespace {
+
+    const uint8_t DEV_EUI[8] = { 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    const uint8_t APP_EUI[8] = { 0x16, 0xEA, 0x76, 0xF6, 0xAB, 0x66, 0x3D, 0x80 };
+    const uint8_t APP_KEY[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+
+    /**
+     * Run the clock until a condition holds or a deadline passes
+     * @return true if the condition holds
+     */
+    bool RunUntil(SimClock& clock, const std::function<bool()>& done, uint64_t deadline) {
+        uint64_t at = 0;
+
+        while (!done()) {
+            if (!clock.NextEventTime(at) || at > deadline) {
+                clock.RunUntil(deadline);
+                return done();
+            }
+
+            clock.RunNext();
+        }
+
+        return true;
+    }
+
+}
+
+SimBenchmarkConfig::SimBenchmarkConfig()
+:   Region(SimRegion::US915()),
+    PathLoss(120.0),
+    Fading(3.0),
+    Seed(1),
+    Joins(20),
+    Uplinks(100),
+    PayloadSize(10),
+    Datarate(0),
+    Adr(true),
+    FotaSessions(3),
+    FotaSize(2048),
+    FragmentSize(48),
+    Redundancy(0.5),
+    MulticastDatarate(0xFF),
+    MulticastFrequency(0),
+    SessionLead(10),
+    ClockError(30),
+    PollPeriod(5000000),
+    Gap(2000000),
+    Timeout(600000000),
+    ReportPeriod(3600)
+{
+}
+
+void SimLatency::Log(const char* name) const {
+    logInfo("%s: %lu done %lu failed, min %.3f s median %.3f s p95 %.3f s max %.3f s", name,
+            (unsigned long) Count, (unsigned long) Failed, Min / 1e6, Median / 1e6, P95 / 1e6, Max / 1e6);
+}
+
+void SimBenchmarkReport::Log() const {
+    logInfo("benchmark: %.1f h virtual in %.2f s", VirtualTime / 3.6e9, WallTime);
+    Join.Log("join");
+    Ack.Log("ack");
+    Fota.Log("fuota");
+    logInfo("fuota verified %lu, retransmissions %lu, link adr %lu, scripted losses %lu, final DR%u",
+            (unsigned long) FotaVerified, (unsigned long) Retransmissions, (unsigned long) LinkAdrReqs, (unsigned long) Dropped, Datarate);
+    logInfo("energy: join %.3f uAh, uplink %.3f uAh, fuota %.1f uAh, lifetime %.0f days", JoinCharge, UplinkCharge, FotaCharge, Lifetime);
+}
+
+SimBenchmark::SimBenchmark(const SimBenchmarkConfig& config)
+:   _config(config),
+    _random(config.Seed)
+{
+}
+
+bool SimBenchmark::Drop(const SimFrame& frame, const SimRadio* listener) {
+    const SimLossStep* step = NULL;
+
+    (void) listener;
+
+    for (size_t i = 0; i < _config.Loss.size(); i++) {
+        if (_config.Loss[i].At <= frame.Start) {
+            step = &_config.Loss[i];
+        }
+    }
+
+    if (step == NULL) {
+        return false;
+    }
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    return unit(_random) < (frame.IqInverted ? step->Downlink : step->Uplink);
+}
+
+SimLatency SimBenchmark::Summarize(std::vector<uint64_t>& samples, uint32_t failed) {
+    SimLatency latency;
+
+    latency.Count = samples.size();
+    latency.Failed = failed;
+    latency.Min = 0;
+    latency.Median = 0;
+    latency.P95 = 0;
+    latency.Max = 0;
+
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        latency.Min = samples.front();
+        latency.Median = samples[samples.size() / 2];
+        latency.P95 = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+        latency.Max = samples.back();
+    }
+
+    return latency;
+}
+
+SimBenchmarkReport SimBenchmark::Run() {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    const SimRegion& region = _config.Region;
+
+    SimClock clock;
+    SimMedium medium(clock, _config.Seed);
+    medium.SetPathLoss(_config.PathLoss);
+    medium.SetFading(_config.Fading);
+    medium.SetLoss(this);
+
+    SimNetworkServerConfig nsConfig;
+    nsConfig.Region = region;
+    nsConfig.Seed = _config.Seed;
+    SimNetworkServer server(medium, nsConfig);
+    server.AddDevice(DEV_EUI, APP_EUI, APP_KEY);
+
+    SimRadio radio(medium);
+    SimEndDevice device(radio, region, DEV_EUI, APP_EUI, APP_KEY);
+    EnergyMeter meter(_config.Energy);
+    meter.SetMcuStateAt(clock.Now(), ENERGY_MCU_STOP);
+    radio.SetEnergyMeter(&meter);
+    device.SetAdr(_config.Adr);
+    device.SetClockError(_config.ClockError);
+
+    std::vector<uint64_t> joins;
+    std::vector<uint64_t> acks;
+    std::vector<uint64_t> fotas;
+    uint32_t joinsFailed = 0;
+    uint32_t acksFailed = 0;
+    uint32_t fotasFailed = 0;
+    SimBenchmarkReport report;
+    report.FotaVerified = 0;
+
+    for (uint32_t i = 0; i < _config.Joins; i++) {
+        uint64_t start = clock.Now();
+        device.SetDatarate(region.MinDatarate);
+        meter.BeginAt(start, ENERGY_JOIN);
+        device.Join();
+
+        bool joined = RunUntil(clock, [&]() { return device.Joined(); }, start + _config.Timeout);
+
+        if (joined) {
+            joins.push_back(clock.Now() - start);
+        } else {
+            joinsFailed++;
+        }
+
+        RunUntil(clock, [&]() { return !device.Busy(); }, clock.Now() + _config.Timeout);
+
+        if (joined) {
+            meter.EndAt(clock.Now(), ENERGY_JOIN);
+        }
+        clock.RunUntil(clock.Now() + _config.Gap);
+    }
+
+    if (!device.Joined()) {
+        device.Join();
+        RunUntil(clock, [&]() { return device.Joined(); }, clock.Now() + _config.Timeout);
+    }
+
+    device.SetDatarate(_config.Datarate);
+    std::vector<uint8_t> payload(_config.PayloadSize, 0xA5);
+
+    for (uint32_t i = 0; i < _config.Uplinks; i++) {
+        uint64_t start = clock.Now();
+        meter.BeginAt(start, ENERGY_UPLINK);
+
+        if (!device.Send(1, payload, true)) {
+            acksFailed++;
+            continue;
+        }
+
+        RunUntil(clock, [&]() { return !device.Busy(); }, start + _config.Timeout);
+
+        if (device.Acked()) {
+            acks.push_back(clock.Now() - start);
+            meter.EndAt(clock.Now(), ENERGY_UPLINK);
+        } else {
+            acksFailed++;
+        }
+
+        clock.RunUntil(clock.Now() + _config.Gap);
+    }
+
+    uint32_t frequency = _config.MulticastFrequency != 0 ? _config.MulticastFrequency : region.Rx2Frequency;
+    uint8_t datarate = _config.MulticastDatarate != 0xFF ? _config.MulticastDatarate : region.Rx2Datarate;
+    uint16_t uncoded = (_config.FotaSize + _config.FragmentSize - 1) / _config.FragmentSize;
+    uint16_t parity = (uint16_t) (uncoded * _config.Redundancy + 0.5);
+
+    for (uint32_t i = 0; i < _config.FotaSessions; i++) {
+        std::vector<uint8_t> image(_config.FotaSize);
+        for (size_t b = 0; b < image.size(); b++) {
+            image[b] = (uint8_t) _random();
+        }
+
+        RunUntil(clock, [&]() { return !device.Busy(); }, clock.Now() + _config.Timeout);
+
+        uint64_t start = clock.Now();
+        uint64_t deadline = start + _config.Timeout;
+        uint64_t poll = start;
+        uint32_t blocks = device.GetStats().Blocks;
+        std::function<bool()> rebuilt = [&]() { return device.GetStats().Blocks != blocks; };
+        meter.BeginAt(start, ENERGY_FOTA);
+
+        if (!server.StartFota(DEV_EUI, image, _config.FragmentSize, parity, datarate, frequency, _config.SessionLead)) {
+            fotasFailed++;
+            continue;
+        }
+
+        // the device syncs its clock first, as the FUOTA package does before the session
+        device.RequestTime();
+
+        while (!rebuilt() && clock.Now() < deadline) {
+            if (!device.Busy() && !device.InSession() && clock.Now() >= poll) {
+                device.Poll();
+                poll = clock.Now() + _config.PollPeriod;
+            }
+
+            RunUntil(clock, rebuilt, std::min(deadline, std::max(poll, clock.Now() + 1000)));
+        }
+
+        if (rebuilt()) {
+            fotas.push_back(clock.Now() - start);
+            meter.EndAt(clock.Now(), ENERGY_FOTA);
+            if (device.FotaImage() == image) {
+                report.FotaVerified++;
+            }
+        } else {
+            fotasFailed++;
+        }
+
+        // let the session run out before the next campaign
+        RunUntil(clock, [&]() { return server.FotaSent() && !device.InSession(); }, clock.Now() + _config.Timeout);
+        clock.RunUntil(clock.Now() + _config.Gap);
+    }
+
+    report.Join = Summarize(joins, joinsFailed);
+    report.Ack = Summarize(acks, acksFailed);
+    report.Fota = Summarize(fotas, fotasFailed);
+    report.Retransmissions = device.GetStats().Retransmissions;
+    report.LinkAdrReqs = server.GetStats().LinkAdrReqs;
+    report.Dropped = medium.GetStats().Dropped;
+    report.Datarate = device.GetDatarate();
+    report.JoinCharge = meter.Operation(ENERGY_JOIN).Mean();
+    report.UplinkCharge = meter.Operation(ENERGY_UPLINK).Mean();
+    report.FotaCharge = meter.Operation(ENERGY_FOTA).Mean();
+    report.Lifetime = meter.ProjectedLifetime(_config.ReportPeriod);
+    report.VirtualTime = clock.Now();
+    report.WallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    medium.SetLoss(NULL);
+    radio.SetEnergyMeter(NULL);
+
+    return report;
+}
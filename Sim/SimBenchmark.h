@@ -0,0 +1,123 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimBenchmark end-to-end latency of join, confirmed uplink and FUOTA
+ *
+ * @details Runs one SimEndDevice against a SimNetworkServer on a virtual clock and measures
+ *          how long each operation takes over the air, from the first transmission to the
+ *          join accept, to the ACK, and to the rebuilt data block.  Frame loss follows a
+ *          script of time steps on top of the path loss and fading of the medium, so the
+ *          same run can be repeated under changing link conditions.  The device radio is
+ *          metered with an EnergyProfile for the charge of each operation; the MCU counts as
+ *          stopped throughout since the device stand-in does not model its processing.
+ *
+ */
+
+#ifndef __LORA_SIM_BENCHMARK_H__
+#define __LORA_SIM_BENCHMARK_H__
+
+#include "SimMedium.h"
+#include "SimRegion.h"
+#include "EnergyMeter.h"
+#include <random>
+#include <vector>
+
+namespace lora {
+
+    /**
+     * Loss probabilities from a virtual time on
+     */
+    struct SimLossStep {
+        uint64_t At;                        //!< us virtual time
+        double Uplink;                      //!< probability an uplink is lost at the gateway
+        double Downlink;                    //!< probability a downlink is lost at the device
+    };
+
+    struct SimBenchmarkConfig {
+        SimBenchmarkConfig();
+
+        SimRegion Region;
+        double PathLoss;                    //!< dB between device and gateway
+        double Fading;                      //!< dB sigma
+        uint32_t Seed;
+
+        uint32_t Joins;
+        uint32_t Uplinks;                   //!< confirmed uplinks
+        uint8_t PayloadSize;
+        uint8_t Datarate;                   //!< initial device datarate
+        bool Adr;
+
+        uint32_t FotaSessions;
+        uint32_t FotaSize;                  //!< bytes of the data block
+        uint8_t FragmentSize;
+        double Redundancy;                  //!< coded fragments as a fraction of the uncoded ones
+        uint8_t MulticastDatarate;          //!< 0xFF for the RX2 datarate
+        uint32_t MulticastFrequency;        //!< Hz, 0 for the RX2 frequency
+        uint32_t SessionLead;               //!< s between McClassCSessionReq and the session start
+        int32_t ClockError;                 //!< s the device clock is off before clock sync
+
+        uint64_t PollPeriod;                //!< us between polling uplinks while a FUOTA is set up
+        uint64_t Gap;                       //!< us idle between operations
+        uint64_t Timeout;                   //!< us before an operation counts as failed
+
+        EnergyProfile Energy;               //!< currents the device radio is metered with
+        uint32_t ReportPeriod;              //!< s between uplinks for the lifetime projection
+
+        std::vector<SimLossStep> Loss;
+    };
+
+    /**
+     * Distribution of the latency of one kind of operation
+     */
+    struct SimLatency {
+        uint32_t Count;                     //!< operations that completed
+        uint32_t Failed;
+        uint64_t Min;                       //!< us
+        uint64_t Median;
+        uint64_t P95;
+        uint64_t Max;
+
+        void Log(const char* name) const;
+    };
+
+    struct SimBenchmarkReport {
+        SimLatency Join;
+        SimLatency Ack;                     //!< confirmed uplink to its ACK including retries
+        SimLatency Fota;                    //!< StartFota to the rebuilt block
+        uint32_t FotaVerified;              //!< rebuilt blocks equal to the image sent
+        uint32_t Retransmissions;
+        uint32_t LinkAdrReqs;
+        uint32_t Dropped;                   //!< frames lost by the loss script
+        uint8_t Datarate;                   //!< device datarate at the end
+        double JoinCharge;                  //!< uAh, mean of the joins
+        double UplinkCharge;                //!< uAh, mean of the confirmed uplinks
+        double FotaCharge;                  //!< uAh, mean of the rebuilt FOTA sessions
+        double Lifetime;                    //!< days at one confirmed uplink per ReportPeriod
+        uint64_t VirtualTime;               //!< us
+        double WallTime;                    //!< s
+
+        void Log() const;
+    };
+
+    class SimBenchmark : public SimLoss {
+        public:
+            SimBenchmark(const SimBenchmarkConfig& config);
+
+            SimBenchmarkReport Run();
+
+            virtual bool Drop(const SimFrame& frame, const SimRadio* listener);
+
+        private:
+            static SimLatency Summarize(std::vector<uint64_t>& samples, uint32_t failed);
+
+            SimBenchmarkConfig _config;
+            std::mt19937 _random;
+    };
+
+}
+
+#endif
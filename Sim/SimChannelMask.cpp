@@ -0,0 +1,172 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimChannelMask checks of RandomChannel::NextChannel() on a channel mask
+ *
+ */
+
+#include "SimChannelMask.h"
+#include "RandomChannel.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace lora;
+
+namespace {
+
+    bool Enabled(const uint16_t* mask, uint8_t channel) {
+        return channel < SIM_MASK_WORDS * 16 && (mask[channel / 16] & (1 << (channel % 16))) != 0;
+    }
+
+    /**
+     * Chi-square value exceeded with the probability of the normal quantile z, Wilson-Hilferty
+     */
+    double ChiSquareThreshold(uint32_t dof, double z) {
+        double a = 2.0 / (9.0 * dof);
+        double b = 1.0 - a + z * sqrt(a);
+
+        return dof * b * b * b;
+    }
+
+}
+
+SimChannelMaskConfig::SimChannelMaskConfig()
+:   Rounds(2000),
+    Z(4.0)
+{
+    // the 500 kHz words reach channel 95 as in CN470, the host build has no CHANNEL_PLAN
+    SimChannelMaskCase cases[6] = {
+        { "us915 sb2", { 0xFF00, 0x0000, 0x0000, 0x0000, 0x0002, 0x0000 } },
+        { "us915 all", { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x00FF, 0x0000 } },
+        { "eu868", { 0x0007, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 } },
+        { "sparse", { 0x8421, 0x1248, 0x0000, 0x8001, 0x0010, 0x0300 } },
+        { "cn470", { 0x0000, 0x0000, 0x0000, 0x0000, 0xFFFF, 0xFFFF } },
+        { "single", { 0x0000, 0x0000, 0x0400, 0x0000, 0x0000, 0x0000 } }
+    };
+
+    Cases.assign(cases, cases + 6);
+}
+
+bool SimChannelMaskReport::Passed() const {
+    for (size_t i = 0; i < Results.size(); i++) {
+        const SimChannelMaskResult& result = Results[i];
+
+        if (result.Repeats != 0 || result.Disabled != 0 || result.Failed != 0 || result.ChiSquare > result.Threshold) {
+            return false;
+        }
+    }
+
+    return !Results.empty();
+}
+
+void SimChannelMaskReport::Log() const {
+    for (size_t i = 0; i < Results.size(); i++) {
+        const SimChannelMaskResult& result = Results[i];
+
+        logInfo("%-10s %2lu channels %7lu picks, repeats %lu, disabled %lu, failed %lu, chi-square %.1f of %.1f",
+                result.Name, (unsigned long) result.Channels, (unsigned long) result.Picks, (unsigned long) result.Repeats,
+                (unsigned long) result.Disabled, (unsigned long) result.Failed, result.ChiSquare, result.Threshold);
+    }
+}
+
+SimChannelMask::SimChannelMask(const SimChannelMaskConfig& config)
+:   _config(config)
+{
+}
+
+SimChannelMaskReport SimChannelMask::Run() {
+    SimChannelMaskReport report;
+
+    for (size_t i = 0; i < _config.Cases.size(); i++) {
+        report.Results.push_back(Run(_config.Cases[i]));
+    }
+
+    return report;
+}
+
+SimChannelMaskResult SimChannelMask::Run(const SimChannelMaskCase& test) {
+    RandomChannel random;
+    std::vector<uint8_t> enabled;
+    SimChannelMaskResult result;
+
+    result.Name = test.Name;
+    result.Picks = 0;
+    result.Repeats = 0;
+    result.Disabled = 0;
+    result.Failed = 0;
+    result.ChiSquare = 0.0;
+    result.Threshold = 0.0;
+
+    for (uint8_t channel = 0; channel < SIM_MASK_WORDS * 16; channel++) {
+        if (Enabled(test.Mask, channel)) {
+            enabled.push_back(channel);
+        }
+    }
+
+    uint32_t channels = enabled.size();
+
+    result.Channels = channels;
+
+    if (channels == 0) {
+        return result;
+    }
+
+    // counts[position * channels + index of the channel picked]
+    std::vector<uint32_t> counts(channels * channels, 0);
+    std::vector<uint8_t> index(SIM_MASK_WORDS * 16, 0);
+
+    for (uint32_t i = 0; i < channels; i++) {
+        index[enabled[i]] = i;
+    }
+
+    for (uint32_t round = 0; round < _config.Rounds; round++) {
+        std::vector<bool> picked(channels, false);
+
+        for (uint32_t position = 0; position < channels; position++) {
+            uint8_t channel = 0xFF;
+
+            result.Picks++;
+
+            if (!random.NextChannel(test.Mask, SIM_MASK_WORDS, &channel)) {
+                result.Failed++;
+                continue;
+            }
+
+            if (!Enabled(test.Mask, channel)) {
+                result.Disabled++;
+                continue;
+            }
+
+            if (picked[index[channel]]) {
+                result.Repeats++;
+            }
+
+            picked[index[channel]] = true;
+            counts[position * channels + index[channel]]++;
+        }
+    }
+
+    if (channels > 1) {
+        double expected = (double) _config.Rounds / channels;
+
+        for (uint32_t position = 0; position < channels; position++) {
+            double chi = 0.0;
+
+            for (uint32_t i = 0; i < channels; i++) {
+                double d = counts[position * channels + i] - expected;
+                chi += d * d / expected;
+            }
+
+            result.ChiSquare = std::max(result.ChiSquare, chi);
+        }
+
+        result.Threshold = ChiSquareThreshold(channels - 1, _config.Z);
+    }
+
+    return result;
+}
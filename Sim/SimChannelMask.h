@@ -0,0 +1,72 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimChannelMask checks of RandomChannel::NextChannel() on a channel mask
+ *
+ * @details Each mask is drawn from for a number of rounds, a round being as many picks as
+ *          there are enabled channels.  Every pick has to be an enabled channel not yet picked
+ *          in its round.  The channel at each position of a round is counted and a chi-square
+ *          test per position checks the picks are uniform over the enabled channels.
+ *
+ */
+
+#ifndef __LORA_SIM_CHANNEL_MASK_H__
+#define __LORA_SIM_CHANNEL_MASK_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace lora {
+
+    const uint8_t SIM_MASK_WORDS = 6;           //!< up to 96 channels, CN470
+
+    struct SimChannelMaskCase {
+        const char* Name;
+        uint16_t Mask[SIM_MASK_WORDS];
+    };
+
+    struct SimChannelMaskConfig {
+        SimChannelMaskConfig();
+
+        std::vector<SimChannelMaskCase> Cases;
+        uint32_t Rounds;                    //!< per mask
+        double Z;                           //!< standard normal quantile of the chi-square threshold
+    };
+
+    struct SimChannelMaskResult {
+        const char* Name;
+        uint32_t Channels;                  //!< enabled
+        uint32_t Picks;
+        uint32_t Repeats;                   //!< picks already made in their round
+        uint32_t Disabled;                  //!< picks of channels not enabled
+        uint32_t Failed;                    //!< NextChannel() returning false
+        double ChiSquare;                   //!< largest over the positions of a round
+        double Threshold;
+    };
+
+    struct SimChannelMaskReport {
+        std::vector<SimChannelMaskResult> Results;
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimChannelMask {
+        public:
+            SimChannelMask(const SimChannelMaskConfig& config = SimChannelMaskConfig());
+
+            SimChannelMaskReport Run();
+
+        private:
+            SimChannelMaskResult Run(const SimChannelMaskCase& test);
+
+            SimChannelMaskConfig _config;
+    };
+
+}
+
+#endif
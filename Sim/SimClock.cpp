@@ -0,0 +1,111 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimClock virtual time base and event scheduler for host simulation
+ *
+ */
+
+#include "SimClock.h"
+#include <algorithm>
+
+using namespace lora;
+
+SimClock::SimClock()
+:   _now(0),
+    _sequence(0),
+    _nextId(1)
+{
+}
+
+uint64_t SimClock::Now() const {
+    return _now;
+}
+
+bool SimClock::Later(const Event& a, const Event& b) {
+    return a.At > b.At || (a.At == b.At && a.Sequence > b.Sequence);
+}
+
+SimClock::EventId SimClock::At(uint64_t at, Callback<void()> event) {
+    Event e;
+    e.At = std::max(at, _now);
+    e.Sequence = _sequence++;
+    e.Id = _nextId++;
+    e.Run = event;
+
+    if (_nextId == 0) {
+        _nextId = 1;
+    }
+
+    _events.push_back(e);
+    std::push_heap(_events.begin(), _events.end(), Later);
+
+    return e.Id;
+}
+
+SimClock::EventId SimClock::After(uint64_t delay, Callback<void()> event) {
+    return At(_now + delay, event);
+}
+
+bool SimClock::Cancel(EventId id) {
+    for (size_t i = 0; i < _events.size(); i++) {
+        if (_events[i].Id == id) {
+            _events[i] = _events.back();
+            _events.pop_back();
+            std::make_heap(_events.begin(), _events.end(), Later);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SimClock::RunNext() {
+    if (_events.empty()) {
+        return false;
+    }
+
+    std::pop_heap(_events.begin(), _events.end(), Later);
+    Event e = _events.back();
+    _events.pop_back();
+
+    _now = e.At;
+    // the event may schedule or cancel others, it is off the heap before it runs
+    e.Run();
+
+    return true;
+}
+
+uint32_t SimClock::RunUntil(uint64_t until) {
+    uint32_t count = 0;
+
+    while (!_events.empty() && _events.front().At <= until) {
+        RunNext();
+        count++;
+    }
+
+    _now = std::max(_now, until);
+    return count;
+}
+
+bool SimClock::NextEventTime(uint64_t& at) const {
+    if (_events.empty()) {
+        return false;
+    }
+
+    at = _events.front().At;
+    return true;
+}
+
+size_t SimClock::Pending() const {
+    return _events.size();
+}
+
+void SimClock::Reset() {
+    _events.clear();
+    _now = 0;
+    _sequence = 0;
+}
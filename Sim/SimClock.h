@@ -0,0 +1,108 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimClock virtual time base and event scheduler for host simulation
+ *
+ * @details Time only moves when the next scheduled event is run, so a simulated radio
+ *          spends no wall clock time waiting for airtime or receive windows.  Events at
+ *          the same time run in the order they were scheduled.
+ *
+ */
+
+#ifndef __LORA_SIM_CLOCK_H__
+#define __LORA_SIM_CLOCK_H__
+
+#include "mbed.h"
+#include <stdint.h>
+#include <vector>
+
+namespace lora {
+
+    class SimClock {
+        public:
+            typedef uint32_t EventId;                       //!< Handle of a scheduled event, 0 is never used
+
+            SimClock();
+
+            /**
+             * Current virtual time
+             * @return microseconds since the clock was created or reset
+             */
+            uint64_t Now() const;
+
+            /**
+             * Schedule an event
+             * @param at virtual time in microseconds, an event in the past runs next
+             * @param event called when the clock reaches the time
+             * @return handle to cancel the event
+             */
+            EventId At(uint64_t at, Callback<void()> event);
+
+            /**
+             * Schedule an event relative to now
+             * @param delay microseconds from now
+             * @param event called when the clock reaches the time
+             * @return handle to cancel the event
+             */
+            EventId After(uint64_t delay, Callback<void()> event);
+
+            /**
+             * Cancel a scheduled event
+             * @param id handle returned when the event was scheduled
+             * @return false if the event already ran or was cancelled
+             */
+            bool Cancel(EventId id);
+
+            /**
+             * Run the earliest event and advance time to it
+             * @return false if no events are scheduled
+             */
+            bool RunNext();
+
+            /**
+             * Run all events scheduled up to a time and leave the clock at that time
+             * @param until virtual time in microseconds
+             * @return number of events run
+             */
+            uint32_t RunUntil(uint64_t until);
+
+            /**
+             * Time of the earliest scheduled event
+             * @param at updated with the event time
+             * @return false if no events are scheduled
+             */
+            bool NextEventTime(uint64_t& at) const;
+
+            /**
+             * Number of scheduled events
+             */
+            size_t Pending() const;
+
+            /**
+             * Drop all events and return to time 0
+             */
+            void Reset();
+
+        private:
+            struct Event {
+                uint64_t At;
+                uint32_t Sequence;
+                EventId Id;
+                Callback<void()> Run;
+            };
+
+            static bool Later(const Event& a, const Event& b);
+
+            std::vector<Event> _events;                     //!< min-heap on time then sequence
+            uint64_t _now;
+            uint32_t _sequence;
+            EventId _nextId;
+    };
+
+}
+
+#endif
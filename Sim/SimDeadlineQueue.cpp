@@ -0,0 +1,300 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimDeadlineQueue ordering and cancellation checks of the multicast DeadlineQueue
+ *
+ */
+
+#include "SimDeadlineQueue.h"
+#include "DeadlineQueue.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace lora;
+
+namespace {
+
+    const uint8_t SIM_DEADLINE_SESSIONS = MAX_MULTICAST_SESSIONS + 2;   //!< more deadlines than the queue holds
+
+    /**
+     * A deadline as the queue should hold it
+     */
+    struct ModelDeadline {
+        int64_t Time;                       //!< us on the host clock
+        uint32_t Sequence;                  //!< order scheduled, first scheduled expires first at the same time
+        uint8_t Id;
+        uint8_t Event;
+
+        bool operator<(const ModelDeadline& other) const {
+            return Time != other.Time ? Time < other.Time : Sequence < other.Sequence;
+        }
+    };
+
+    struct Expiry {
+        uint8_t Id;
+        uint8_t Event;
+        int64_t Time;
+
+        bool operator==(const Expiry& other) const {
+            return Id == other.Id && Event == other.Event && Time == other.Time;
+        }
+    };
+
+    class Model {
+        public:
+            Model() : _sequence(0) {}
+
+            bool Schedule(uint8_t id, uint8_t event, int64_t time) {
+                int index = Find(id, event);
+
+                if (index >= 0) {
+                    _deadlines.erase(_deadlines.begin() + index);
+                } else if (_deadlines.size() == MC_DEADLINE_QUEUE_SIZE) {
+                    return false;
+                }
+
+                ModelDeadline deadline = { time, _sequence++, id, event };
+                _deadlines.push_back(deadline);
+                return true;
+            }
+
+            bool Cancel(uint8_t id, uint8_t event) {
+                int index = Find(id, event);
+
+                if (index < 0) {
+                    return false;
+                }
+
+                _deadlines.erase(_deadlines.begin() + index);
+                return true;
+            }
+
+            void CancelAll(uint8_t id) {
+                for (size_t i = _deadlines.size(); i > 0; i--) {
+                    if (_deadlines[i - 1].Id == id) {
+                        _deadlines.erase(_deadlines.begin() + i - 1);
+                    }
+                }
+            }
+
+            void Rebase(int32_t offset) {
+                for (size_t i = 0; i < _deadlines.size(); i++) {
+                    _deadlines[i].Time -= (int64_t) offset * 1000000;
+                }
+            }
+
+            /**
+             * Deadlines expiring while the clock moves from now to until, in the order they expire
+             */
+            std::vector<Expiry> Advance(int64_t now, int64_t until) {
+                std::vector<ModelDeadline> due;
+                std::vector<Expiry> expired;
+
+                for (size_t i = _deadlines.size(); i > 0; i--) {
+                    if (_deadlines[i - 1].Time <= until) {
+                        due.push_back(_deadlines[i - 1]);
+                        _deadlines.erase(_deadlines.begin() + i - 1);
+                    }
+                }
+
+                std::sort(due.begin(), due.end());
+
+                for (size_t i = 0; i < due.size(); i++) {
+                    Expiry expiry = { due[i].Id, due[i].Event, std::max(due[i].Time, now) };
+                    expired.push_back(expiry);
+                }
+
+                return expired;
+            }
+
+            int64_t TimeToNext(int64_t now) const {
+                if (_deadlines.empty()) {
+                    return -1;
+                }
+
+                return std::max(std::min_element(_deadlines.begin(), _deadlines.end())->Time - now, (int64_t) 0);
+            }
+
+            int64_t TimeTo(uint8_t id, uint8_t event, int64_t now) const {
+                int index = Find(id, event);
+
+                if (index < 0) {
+                    return -1;
+                }
+
+                return std::max(_deadlines[index].Time - now, (int64_t) 0);
+            }
+
+            size_t Size() const {
+                return _deadlines.size();
+            }
+
+        private:
+            int Find(uint8_t id, uint8_t event) const {
+                for (size_t i = 0; i < _deadlines.size(); i++) {
+                    if (_deadlines[i].Id == id && _deadlines[i].Event == event) {
+                        return i;
+                    }
+                }
+
+                return -1;
+            }
+
+            std::vector<ModelDeadline> _deadlines;
+            uint32_t _sequence;
+    };
+
+    std::vector<Expiry>* recorded = NULL;
+
+    void Record(uint8_t id, uint8_t event) {
+        Expiry expiry = { id, event, (int64_t) HostClock::Now() };
+        recorded->push_back(expiry);
+    }
+
+}
+
+SimDeadlineQueueConfig::SimDeadlineQueueConfig()
+:   Operations(200000),
+    MaxDelay(30),
+    Seed(1)
+{
+}
+
+bool SimDeadlineQueueReport::Passed() const {
+    return Operations != 0 && Expired != 0 && Cancelled != 0 && Refused != 0 && Mismatches == 0;
+}
+
+void SimDeadlineQueueReport::Log() const {
+    logInfo("deadline queue: %lu operations, %lu expired, %lu cancelled, %lu rebases, %lu refused when full, %lu mismatches",
+            (unsigned long) Operations, (unsigned long) Expired, (unsigned long) Cancelled, (unsigned long) Rebases,
+            (unsigned long) Refused, (unsigned long) Mismatches);
+}
+
+SimDeadlineQueue::SimDeadlineQueue(const SimDeadlineQueueConfig& config)
+:   _config(config)
+{
+}
+
+SimDeadlineQueueReport SimDeadlineQueue::Run() {
+    std::mt19937 random(_config.Seed);
+    std::vector<Expiry> expired;
+    DeadlineQueue queue;
+    Model model;
+    SimDeadlineQueueReport report;
+
+    report.Operations = 0;
+    report.Expired = 0;
+    report.Cancelled = 0;
+    report.Rebases = 0;
+    report.Refused = 0;
+    report.Mismatches = 0;
+
+    recorded = &expired;
+    queue.attach(Record);
+
+    // the queue clock starts where the host clock is, deadlines in the model are on the host clock
+    int64_t start = HostClock::Now();
+
+    for (uint32_t op = 0; op < _config.Operations; op++) {
+        int64_t now = HostClock::Now();
+        uint8_t id = random() % SIM_DEADLINE_SESSIONS;
+        uint8_t event = random() % 2 ? DeadlineQueue::SESSION_STOP : DeadlineQueue::SESSION_START;
+        uint32_t kind = random() % 16;
+        bool ok = true;
+
+        if (kind < 6) {
+            // quarter seconds so deadlines often fall due at the same time, 0 expires at once
+            us_timestamp_t delay = (us_timestamp_t) (random() % (_config.MaxDelay * 4 + 1)) * 250000;
+
+            bool accepted = model.Schedule(id, event, now + delay);
+            ok = queue.schedule(id, event, delay) == accepted;
+
+            if (!accepted) {
+                report.Refused++;
+            }
+        } else if (kind < 8) {
+            bool found = model.Cancel(id, event);
+            ok = queue.cancel(id, event) == found;
+
+            if (found) {
+                report.Cancelled++;
+            }
+        } else if (kind < 9) {
+            size_t before = model.Size();
+
+            model.CancelAll(id);
+            queue.cancelAll(id);
+            report.Cancelled += before - model.Size();
+        } else if (kind < 10) {
+            int32_t offset = (int32_t) (random() % 21) - 10;
+
+            model.Rebase(offset);
+            queue.rebase(offset);
+            report.Rebases++;
+        } else {
+            // whole quarter seconds or an odd number of us, sometimes not at all
+            uint64_t step = random() % 2 ? (random() % 20) * 250000 : random() % 3000000;
+            std::vector<Expiry> expected = model.Advance(now, now + step);
+
+            expired.clear();
+            HostClock::Advance(step);
+
+            ok = expired == expected;
+            report.Expired += expired.size();
+        }
+
+        now = HostClock::Now();
+
+        if (queue.size() != model.Size() || queue.timeToNext() != model.TimeToNext(now) ||
+                queue.timeTo(id, event) != model.TimeTo(id, event, now)) {
+            ok = false;
+        }
+
+        if (!ok) {
+            if (report.Mismatches == 0) {
+                logError("deadline queue: operation %lu kind %lu session %u event %u differs from the model at %lld us",
+                         (unsigned long) op, (unsigned long) kind, id, event, (long long) (now - start));
+            }
+
+            report.Mismatches++;
+        }
+
+        report.Operations++;
+    }
+
+    // every session deadline at once is more than the queue holds, the ones past its size are refused
+    int64_t now = HostClock::Now();
+
+    for (uint8_t id = 0; id < SIM_DEADLINE_SESSIONS; id++) {
+        for (uint8_t event = DeadlineQueue::SESSION_START; event <= DeadlineQueue::SESSION_STOP; event++) {
+            us_timestamp_t delay = (us_timestamp_t) _config.MaxDelay * 1000000;
+            bool accepted = model.Schedule(id, event, now + delay);
+
+            if (queue.schedule(id, event, delay) != accepted || queue.size() != model.Size()) {
+                report.Mismatches++;
+            }
+
+            if (!accepted) {
+                report.Refused++;
+            }
+        }
+    }
+
+    expired.clear();
+    HostClock::Advance((uint64_t) _config.MaxDelay * 1000000);
+
+    if (expired != model.Advance(now, now + (int64_t) _config.MaxDelay * 1000000) || queue.size() != 0) {
+        report.Mismatches++;
+    }
+
+    report.Expired += expired.size();
+    recorded = NULL;
+
+    return report;
+}
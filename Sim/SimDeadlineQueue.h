@@ -0,0 +1,58 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimDeadlineQueue ordering and cancellation checks of the multicast DeadlineQueue
+ *
+ * @details A DeadlineQueue on the host clock is given a random mix of schedules, moves,
+ *          cancels, session cancels, clock rebases and time steps, and a model of the
+ *          deadlines is given the same.  Each deadline has to expire once, at its time or at
+ *          the step it was already due in, in time order and first scheduled first, and
+ *          none that was cancelled or moved may expire.  size(), timeTo() and timeToNext()
+ *          are compared with the model after every call, and a full queue has to refuse.
+ *
+ */
+
+#ifndef __LORA_SIM_DEADLINE_QUEUE_H__
+#define __LORA_SIM_DEADLINE_QUEUE_H__
+
+#include <stdint.h>
+
+namespace lora {
+
+    struct SimDeadlineQueueConfig {
+        SimDeadlineQueueConfig();
+
+        uint32_t Operations;
+        uint32_t MaxDelay;                  //!< s of a scheduled deadline
+        uint32_t Seed;
+    };
+
+    struct SimDeadlineQueueReport {
+        uint32_t Operations;
+        uint32_t Expired;                   //!< deadlines handed out
+        uint32_t Cancelled;
+        uint32_t Rebases;
+        uint32_t Refused;                   //!< schedules refused by a full queue
+        uint32_t Mismatches;                //!< calls or expiries that differ from the model
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimDeadlineQueue {
+        public:
+            SimDeadlineQueue(const SimDeadlineQueueConfig& config = SimDeadlineQueueConfig());
+
+            SimDeadlineQueueReport Run();
+
+        private:
+            SimDeadlineQueueConfig _config;
+    };
+
+}
+
+#endif
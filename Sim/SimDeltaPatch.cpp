@@ -0,0 +1,175 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimDeltaPatch checks of DeltaPatch on a patch made by tools/fota_delta.py
+ *
+ */
+
+#include "SimDeltaPatch.h"
+#include "DeltaPatch.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <stdio.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint32_t TARGET_CRC_OFFSET = 20;  //!< of the target crc64 in the patch header
+
+    std::vector<uint8_t> ReadFixture(const std::string& dir, const char* name) {
+        std::vector<uint8_t> data;
+        std::string path = dir + "/" + name;
+        FILE* file = fopen(path.c_str(), "rb");
+
+        if (file == NULL) {
+            logError("can not open %s", path.c_str());
+            return data;
+        }
+
+        uint8_t buffer[4096];
+        size_t read;
+
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.insert(data.end(), buffer, buffer + read);
+        }
+
+        fclose(file);
+        return data;
+    }
+
+    /**
+     * Apply a patch chunk by chunk until it is through or refused
+     */
+    SimDeltaPatchResult Apply(const std::string& name, const std::vector<uint8_t>& source, const std::vector<uint8_t>& patch,
+                              uint32_t chunk, std::vector<uint8_t>& out) {
+        SimDeltaPatchResult result;
+        DeltaPatch delta(source.data(), source.size(), [&out](const uint8_t* data, uint32_t size) -> int32_t {
+            out.insert(out.end(), data, data + size);
+            return size;
+        });
+
+        result.Name = name;
+        result.Status = DeltaPatch::DELTA_OK;
+        out.clear();
+
+        for (uint32_t i = 0; i < patch.size() && result.Status == DeltaPatch::DELTA_OK; i += chunk) {
+            result.Status = delta.apply(&patch[i], std::min<uint32_t>(chunk, patch.size() - i));
+        }
+
+        result.Complete = delta.complete();
+        result.Passed = false;
+
+        return result;
+    }
+
+}
+
+SimDeltaPatchConfig::SimDeltaPatchConfig()
+:   Fixtures(SIM_FOTA_FIXTURES),
+    FragmentSize(50)
+{
+    // a byte at a time, around the 28 byte header and the 128 byte output buffer, and whole
+    const uint32_t chunks[] = { 1, 3, 27, 28, 29, 127, 128, 129, 1000, 65536 };
+
+    Chunks.assign(chunks, chunks + sizeof(chunks) / sizeof(chunks[0]));
+}
+
+bool SimDeltaPatchReport::Passed() const {
+    for (size_t i = 0; i < Results.size(); i++) {
+        if (!Results[i].Passed) {
+            return false;
+        }
+    }
+
+    return PatchSize != 0 && !Results.empty();
+}
+
+void SimDeltaPatchReport::Log() const {
+    logInfo("patch %lu bytes for a %lu byte image", (unsigned long) PatchSize, (unsigned long) ImageSize);
+
+    for (size_t i = 0; i < Results.size(); i++) {
+        const SimDeltaPatchResult& result = Results[i];
+
+        logInfo("%-16s status %ld, %s, %s", result.Name.c_str(), (long) result.Status,
+                result.Complete ? "complete" : "incomplete", result.Passed ? "ok" : "FAILED");
+    }
+}
+
+SimDeltaPatch::SimDeltaPatch(const SimDeltaPatchConfig& config)
+:   _config(config)
+{
+}
+
+SimDeltaPatchReport SimDeltaPatch::Run() {
+    SimDeltaPatchReport report;
+    std::vector<uint8_t> source = ReadFixture(_config.Fixtures, "old.bin");
+    std::vector<uint8_t> target = ReadFixture(_config.Fixtures, "new.bin");
+    std::vector<uint8_t> patch = ReadFixture(_config.Fixtures, "patch.bin");
+    std::vector<uint8_t> out;
+
+    report.PatchSize = patch.size();
+    report.ImageSize = target.size();
+
+    if (patch.size() <= DELTA_PATCH_HEADER_SIZE) {
+        return report;
+    }
+
+    // the fragmentation session hands over whole fragments, the padding has to be ignored
+    if (_config.FragmentSize > 0 && patch.size() % _config.FragmentSize != 0) {
+        patch.resize(patch.size() + _config.FragmentSize - patch.size() % _config.FragmentSize, 0);
+    }
+
+    for (size_t i = 0; i < _config.Chunks.size(); i++) {
+        char name[32];
+
+        snprintf(name, sizeof(name), "chunk %lu", (unsigned long) _config.Chunks[i]);
+        SimDeltaPatchResult result = Apply(name, source, patch, _config.Chunks[i], out);
+        result.Passed = result.Status == DeltaPatch::DELTA_OK && result.Complete && out == target;
+        report.Results.push_back(result);
+    }
+
+    {
+        // the running image is not the one the patch was made against, nothing may be written
+        std::vector<uint8_t> other = source;
+        other[other.size() / 2] ^= 0x01;
+
+        SimDeltaPatchResult result = Apply("other source", other, patch, 64, out);
+        result.Passed = result.Status == DeltaPatch::DELTA_ERR_SOURCE && !result.Complete && out.empty();
+        report.Results.push_back(result);
+    }
+
+    {
+        std::vector<uint8_t> bad = patch;
+        bad[TARGET_CRC_OFFSET] ^= 0x01;
+
+        SimDeltaPatchResult result = Apply("target crc64", source, bad, 64, out);
+        result.Passed = result.Status == DeltaPatch::DELTA_ERR_TARGET && !result.Complete;
+        report.Results.push_back(result);
+    }
+
+    {
+        // a flipped byte in the records, refused as a bad record or by the target crc64
+        std::vector<uint8_t> bad = patch;
+        bad[DELTA_PATCH_HEADER_SIZE + (report.PatchSize - DELTA_PATCH_HEADER_SIZE) / 2] ^= 0x40;
+
+        SimDeltaPatchResult result = Apply("corrupt record", source, bad, 64, out);
+        result.Passed = result.Status < 0 && !result.Complete;
+        report.Results.push_back(result);
+    }
+
+    {
+        std::vector<uint8_t> bad = patch;
+        bad[0] = 'X';
+
+        SimDeltaPatchResult result = Apply("bad magic", source, bad, 64, out);
+        result.Passed = result.Status == DeltaPatch::DELTA_ERR_HEADER && !result.Complete && out.empty();
+        report.Results.push_back(result);
+    }
+
+    return report;
+}
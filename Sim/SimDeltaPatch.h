@@ -0,0 +1,63 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimDeltaPatch checks of DeltaPatch on a patch made by tools/fota_delta.py
+ *
+ * @details The build runs tools/fota_delta.py fixtures for an old and a new synthetic build
+ *          and the patch between them.  The patch, padded to whole fragments, is applied to
+ *          the old build in pieces of each chunk size and has to rebuild the new build byte
+ *          for byte.  A patch for another source, a target crc64 that does not match, a
+ *          corrupt record and a bad magic have to be refused without completing.
+ *
+ */
+
+#ifndef __LORA_SIM_DELTA_PATCH_H__
+#define __LORA_SIM_DELTA_PATCH_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace lora {
+
+    struct SimDeltaPatchConfig {
+        SimDeltaPatchConfig();
+
+        std::string Fixtures;               //!< directory of old.bin, new.bin and patch.bin
+        std::vector<uint32_t> Chunks;       //!< bytes handed to apply() at a time
+        uint32_t FragmentSize;              //!< the patch is zero padded to a multiple of it
+    };
+
+    struct SimDeltaPatchResult {
+        std::string Name;
+        int32_t Status;                     //!< last apply() result
+        bool Complete;
+        bool Passed;
+    };
+
+    struct SimDeltaPatchReport {
+        uint32_t PatchSize;
+        uint32_t ImageSize;
+        std::vector<SimDeltaPatchResult> Results;
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimDeltaPatch {
+        public:
+            SimDeltaPatch(const SimDeltaPatchConfig& config = SimDeltaPatchConfig());
+
+            SimDeltaPatchReport Run();
+
+        private:
+            SimDeltaPatchConfig _config;
+    };
+
+}
+
+#endif
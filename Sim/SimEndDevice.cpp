@@ -0,0 +1,935 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimEndDevice class A and C device for end-to-end host simulation
+ *
+ */
+
+#include "SimEndDevice.h"
+#include "SimLoRaWAN.h"
+#include "MacCommandCodec.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint64_t RX_LEAD = 1000;             //!< us a window opens before the downlink is due
+    const size_t LINK_HISTORY = 8;              //!< downlinks in the RSSI and SNR statistics
+
+    uint32_t BandwidthIndex(uint32_t bandwidth) {
+        switch (bandwidth) {
+            case 250000:
+                return BW_250;
+            case 500000:
+                return BW_500;
+            default:
+                return BW_125;
+        }
+    }
+
+}
+
+SimEndDevice::SimEndDevice(SimRadio& radio, const SimRegion& region, const uint8_t* devEui, const uint8_t* appEui, const uint8_t* appKey)
+:   _radio(radio),
+    _clock(radio.Medium().Clock()),
+    _region(region),
+    _joined(false),
+    _devNonce(0),
+    _address(0),
+    _fCntUp(0),
+    _fCntDown(0),
+    _hasDownlink(false),
+    _rxDelay(DEFAULT_RX_DELAY / 1000),
+    _rx2Datarate(region.Rx2Datarate),
+    _enabled(region.Channels.size(), true),
+    _datarate(region.MinDatarate),
+    _powerIndex(0),
+    _adr(true),
+    _retries(8),
+    _redundancy(1),
+    _adrAckCounter(0),
+    _policy(NULL),
+    _policyPending(false),
+    _busy(false),
+    _joining(false),
+    _confirmed(false),
+    _acked(false),
+    _ackPending(false),
+    _attempt(0),
+    _channel(0),
+    _txEnd(0),
+    _window(WINDOW_NONE),
+    _rx1(0),
+    _rx2(0),
+    _retry(0),
+    _clockError(0),
+    _correction(0),
+    _timeToken(0),
+    _timePending(false),
+    _fotaComplete(false)
+{
+    memcpy(_devEui, devEui, sizeof(_devEui));
+    memcpy(_appEui, appEui, sizeof(_appEui));
+    memcpy(_appKey, appKey, sizeof(_appKey));
+    memset(&_stats, 0, sizeof(_stats));
+    memset(&_link, 0, sizeof(_link));
+    _link.Rssi = _link.RssiMin = _link.RssiMax = _link.RssiAvg = INVALID_RSSI;
+    _link.Snr = _link.SnrMin = _link.SnrMax = _link.SnrAvg = INVALID_SNR;
+    memset(&_multicast, 0, sizeof(_multicast));
+    _decoder.Active = false;
+
+    _radio.Init(this);
+    _radio.SetModem(SxRadio::MODEM_LORA);
+    _radio.Sleep();
+}
+
+SimEndDevice::~SimEndDevice() {
+    _clock.Cancel(_rx1);
+    _clock.Cancel(_rx2);
+    _clock.Cancel(_retry);
+    _clock.Cancel(_multicast.Start);
+    _clock.Cancel(_multicast.End);
+    _radio.Init(NULL);
+}
+
+void SimEndDevice::SetDatarate(uint8_t datarate) {
+    _datarate = datarate;
+}
+
+uint8_t SimEndDevice::GetDatarate() const {
+    return _datarate;
+}
+
+void SimEndDevice::SetAdr(bool on) {
+    _adr = on;
+}
+
+void SimEndDevice::SetPolicy(AdrPolicy* policy) {
+    _policy = policy;
+    _policyPending = false;
+}
+
+uint8_t SimEndDevice::GetPowerIndex() const {
+    return _powerIndex;
+}
+
+uint8_t SimEndDevice::GetRedundancy() const {
+    return _redundancy;
+}
+
+void SimEndDevice::SetRetries(uint8_t retries) {
+    _retries = retries < 1 ? 1 : (retries > 8 ? 8 : retries);
+}
+
+void SimEndDevice::SetClockError(int32_t seconds) {
+    _clockError = seconds;
+}
+
+bool SimEndDevice::Joined() const {
+    return _joined;
+}
+
+bool SimEndDevice::Busy() const {
+    return _busy;
+}
+
+bool SimEndDevice::Acked() const {
+    return _acked;
+}
+
+bool SimEndDevice::Pending() const {
+    return !_appAnswers.empty();
+}
+
+uint32_t SimEndDevice::GpsTime() const {
+    return SIM_GPS_START + (uint32_t) (_clock.Now() / 1000000) + _clockError + _correction;
+}
+
+bool SimEndDevice::InSession() const {
+    return _multicast.Open;
+}
+
+bool SimEndDevice::FotaComplete() const {
+    return _fotaComplete;
+}
+
+const std::vector<uint8_t>& SimEndDevice::FotaImage() const {
+    return _image;
+}
+
+const SimEndDevice::Stats& SimEndDevice::GetStats() const {
+    return _stats;
+}
+
+const Statistics& SimEndDevice::GetLinkStats() const {
+    return _link;
+}
+
+bool SimEndDevice::Enabled(uint8_t datarate, size_t channel) const {
+    const SimRegion::Channel& chan = _region.Channels[channel];
+    return _enabled[channel] && datarate >= chan.MinDatarate && datarate <= chan.MaxDatarate;
+}
+
+void SimEndDevice::Backoff() {
+    // no downlink for ADR_ACK_DELAY uplinks after asking, first restore power and NbTrans then step the datarate down
+    if (_adrAckCounter >= DEFAULT_ADR_ACK_LIMIT + DEFAULT_ADR_ACK_DELAY
+            && (_adrAckCounter - DEFAULT_ADR_ACK_LIMIT) % DEFAULT_ADR_ACK_DELAY == 0) {
+        if (_powerIndex > 0 || _redundancy > 1) {
+            _powerIndex = 0;
+            _redundancy = 1;
+        } else if (_datarate > _region.MinDatarate) {
+            _datarate--;
+        }
+    }
+}
+
+void SimEndDevice::ApplyPolicy(uint8_t size, bool confirmed) {
+    AdrLimits limits;
+    AdrUplink uplink;
+
+    for (uint8_t dr = 0; dr < _region.Datarates.size(); dr++) {
+        for (size_t i = 0; i < _region.Channels.size(); i++) {
+            if (Enabled(dr, i)) {
+                limits.Allow(dr, _region.Datarates[dr].SpreadingFactor, _region.Datarates[dr].Bandwidth);
+                break;
+            }
+        }
+    }
+
+    limits.MaxPower = _region.MaxPower;
+    limits.MinPower = _region.Power(_region.MaxPowerIndex);
+    limits.PowerStep = 2;
+    limits.MaxRedundancy = 15;
+
+    uplink.Size = size;
+    uplink.Confirmed = confirmed;
+    uplink.Attempts = _retries;
+
+    AdrSettings settings = _policy->Select(uplink, _link, limits);
+
+    _datarate = settings.Datarate;
+    _powerIndex = (uint8_t) ((_region.MaxPower - settings.Power) / 2);
+    _redundancy = settings.Redundancy != 0 ? settings.Redundancy : 1;
+    _policyPending = confirmed;
+}
+
+void SimEndDevice::Measure(int16_t rssi, int16_t snr) {
+    _samples.push_back(std::make_pair(rssi, (int16_t) (snr * 10)));
+    if (_samples.size() > LINK_HISTORY) {
+        _samples.pop_front();
+    }
+
+    int32_t rssiSum = 0;
+    int32_t snrSum = 0;
+
+    _link.Rssi = _link.RssiMin = _link.RssiMax = rssi;
+    _link.Snr = _link.SnrMin = _link.SnrMax = snr * 10;
+
+    for (size_t i = 0; i < _samples.size(); i++) {
+        _link.RssiMin = std::min(_link.RssiMin, _samples[i].first);
+        _link.RssiMax = std::max(_link.RssiMax, _samples[i].first);
+        _link.SnrMin = std::min(_link.SnrMin, _samples[i].second);
+        _link.SnrMax = std::max(_link.SnrMax, _samples[i].second);
+        rssiSum += _samples[i].first;
+        snrSum += _samples[i].second;
+    }
+
+    _link.AvgCount = _samples.size();
+    _link.RssiAvg = rssiSum / _link.AvgCount;
+    _link.SnrAvg = snrSum / _link.AvgCount;
+    _link.Down++;
+}
+
+bool SimEndDevice::Join() {
+    if (_busy) {
+        return false;
+    }
+
+    _busy = true;
+    _joining = true;
+    _joined = false;
+    _attempt = 0;
+    _enabled.assign(_region.Channels.size(), true);
+    StartJoin();
+
+    return true;
+}
+
+void SimEndDevice::StartJoin() {
+    _devNonce++;
+    SimLoRaWAN::EncodeJoinRequest(_appEui, _devEui, _devNonce, _appKey, _frame);
+    _stats.JoinRequests++;
+    Transmit();
+}
+
+bool SimEndDevice::Send(uint8_t port, const std::vector<uint8_t>& payload, bool confirmed) {
+    if (_busy || !_joined) {
+        return false;
+    }
+
+    StartSend(true, port, payload, confirmed);
+    return true;
+}
+
+bool SimEndDevice::Poll() {
+    if (_busy || !_joined) {
+        return false;
+    }
+
+    if (_appAnswers.empty() && _timePending) {
+        // the AppTimeAns was lost, ask again with the same token
+        QueueTimeRequest();
+    }
+
+    if (_appAnswers.empty()) {
+        StartSend(false, 0, std::vector<uint8_t>(), false);
+        return true;
+    }
+
+    std::pair<uint8_t, std::vector<uint8_t> > answer = _appAnswers.front();
+    _appAnswers.pop_front();
+
+    if (answer.first == SIM_PORT_CLOCK_SYNC && answer.second[0] == SIM_APP_TIME) {
+        // DeviceTime is the time of transmission, not of the request
+        SimLoRaWAN::PutUint32(&answer.second[1], GpsTime());
+    }
+    StartSend(true, answer.first, answer.second, false);
+
+    return true;
+}
+
+void SimEndDevice::RequestTime() {
+    _timeToken = (_timeToken + 1) & 0x0F;
+    _timePending = true;
+    QueueTimeRequest();
+}
+
+void SimEndDevice::QueueTimeRequest() {
+    std::vector<uint8_t> request(6);
+
+    // AppTimeReq with AnsRequired so the answer comes even without a correction
+    request[0] = SIM_APP_TIME;
+    SimLoRaWAN::PutUint32(&request[1], GpsTime());
+    request[5] = 0x10 | _timeToken;
+
+    _appAnswers.push_back(std::make_pair(SIM_PORT_CLOCK_SYNC, request));
+}
+
+void SimEndDevice::StartSend(bool hasPort, uint8_t port, const std::vector<uint8_t>& payload, bool confirmed) {
+    SimDataFrame data;
+    bool adrAckReq = false;
+
+    if (_adr) {
+        _adrAckCounter++;
+        Backoff();
+        adrAckReq = _adrAckCounter >= DEFAULT_ADR_ACK_LIMIT;
+    } else if (_policy != NULL) {
+        ApplyPolicy(payload.size(), confirmed);
+    }
+
+    data.Type = confirmed ? FRAME_TYPE_DATA_CONFIRMED_UP : FRAME_TYPE_DATA_UNCONFIRMED_UP;
+    data.Address = _address;
+    data.Counter = _fCntUp++;
+    data.Control = (_adr ? SIM_FCTRL_ADR : 0) | (adrAckReq ? SIM_FCTRL_ADR_ACK_REQ : 0) | (_ackPending ? SIM_FCTRL_ACK : 0);
+    data.HasPort = hasPort;
+    data.Port = port;
+    data.Payload = payload;
+
+    // whole answers only, the rest goes with the next uplink
+    size_t used = 0;
+    while (used < _macAnswers.size()) {
+        uint8_t length = MacCommandCodec::MoteCommandSize(_macAnswers[used]);
+
+        if (length == MAC_CMD_SIZE_UNKNOWN || length == MAC_CMD_SIZE_PLAN || used + length > sizeof(data.Options)) {
+            break;
+        }
+
+        used += length;
+    }
+
+    memcpy(data.Options, _macAnswers.data(), used);
+    data.OptionsLength = used;
+    _macAnswers.erase(_macAnswers.begin(), _macAnswers.begin() + used);
+    _ackPending = false;
+
+    SimLoRaWAN::EncodeData(data, _nwkSKey, _appSKey, _frame);
+
+    _busy = true;
+    _joining = false;
+    _confirmed = confirmed;
+    _acked = false;
+    _attempt = 0;
+    Transmit();
+}
+
+void SimEndDevice::Transmit() {
+    std::vector<size_t> candidates;
+
+    for (size_t i = 0; i < _region.Channels.size(); i++) {
+        if (Enabled(_datarate, i)) {
+            candidates.push_back(i);
+        }
+    }
+
+    if (candidates.empty()) {
+        // the datarate has no channel, fall back to the lowest one of the plan
+        _datarate = _region.MinDatarate;
+        for (size_t i = 0; i < _region.Channels.size(); i++) {
+            if (Enabled(_datarate, i)) {
+                candidates.push_back(i);
+            }
+        }
+    }
+
+    if (candidates.empty()) {
+        logError("no channel enabled for DR%u", _datarate);
+        _busy = false;
+        return;
+    }
+
+    const SimRegion::Datarate& dr = _region.Datarates[_datarate];
+    _channel = candidates[_radio.Random() % candidates.size()];
+    _attempt++;
+    _stats.Uplinks++;
+    if (_attempt > 1 && !_joining) {
+        if (_confirmed) {
+            _stats.Retransmissions++;
+        } else {
+            _stats.Repetitions++;
+        }
+    }
+    if (!_joining) {
+        _link.Up++;
+    }
+
+    _window = WINDOW_NONE;
+    _radio.SetChannel(_region.Channels[_channel].Frequency);
+    _radio.SetTxConfig(SxRadio::MODEM_LORA, _region.Power(_powerIndex), 0, BandwidthIndex(dr.Bandwidth), dr.SpreadingFactor,
+                       DEFAULT_CODE_RATE, DEFAULT_PREAMBLE_LEN, false, true, false, 0, false, 3000);
+    _radio.Send(_frame.data(), _frame.size());
+}
+
+void SimEndDevice::TxDone() {
+    uint64_t delay = _joining ? (uint64_t) PUBLIC_JOIN_DELAY * 1000 : (uint64_t) _rxDelay * 1000000;
+
+    _txEnd = _clock.Now();
+    _radio.Sleep();
+    _rx1 = _clock.At(_txEnd + delay - RX_LEAD, callback(this, &SimEndDevice::OpenRx1));
+    _rx2 = _clock.At(_txEnd + delay + RX2_DELAY_OFFSET * 1000 - RX_LEAD, callback(this, &SimEndDevice::OpenRx2));
+}
+
+void SimEndDevice::OpenWindow(uint32_t frequency, const SimRegion::Datarate& modulation, bool continuous) {
+    uint16_t symbols = modulation.SpreadingFactor < SF_11 ? HI_DR_SYMBOL_TIMEOUT : LO_DR_SYMBOL_TIMEOUT;
+
+    _radio.SetChannel(frequency);
+    _radio.SetRxConfig(SxRadio::MODEM_LORA, BandwidthIndex(modulation.Bandwidth), modulation.SpreadingFactor, DEFAULT_CODE_RATE, 0,
+                       DEFAULT_PREAMBLE_LEN, symbols, false, 0, false, false, 0, true, continuous);
+    _radio.Rx(0);
+}
+
+void SimEndDevice::OpenRx1() {
+    _rx1 = 0;
+    _window = WINDOW_RX1;
+    OpenWindow(_region.Channels[_channel].Rx1Frequency, _region.Rx1[_datarate], false);
+}
+
+void SimEndDevice::OpenRx2() {
+    _rx2 = 0;
+
+    if (_window == WINDOW_RX1) {
+        // RX1 locked on a frame still on the air, its outcome ends the cycle
+        return;
+    }
+
+    _window = WINDOW_RX2;
+    OpenWindow(_region.Rx2Frequency, _region.Downlink[_rx2Datarate], false);
+}
+
+void SimEndDevice::RxTimeout() {
+    RxError();
+}
+
+void SimEndDevice::RxError() {
+    if (_window == WINDOW_RX1) {
+        _window = WINDOW_NONE;
+        _radio.Sleep();
+        if (_rx2 == 0) {
+            WindowsDone(false);
+        }
+    } else if (_window == WINDOW_RX2) {
+        _window = WINDOW_NONE;
+        _radio.Sleep();
+        WindowsDone(false);
+    }
+}
+
+void SimEndDevice::RxDone(uint8_t* payload, uint16_t size, int16_t rssi, int16_t snr) {
+    Window window = _window;
+    bool accepted = Accept(payload, size);
+
+    if (window == WINDOW_CLASS_C) {
+        return;
+    }
+
+    _window = WINDOW_NONE;
+    _radio.Sleep();
+
+    if (accepted) {
+        Measure(rssi, snr);
+        _adrAckCounter = 0;
+        _clock.Cancel(_rx2);
+        _rx2 = 0;
+        WindowsDone(true);
+    } else if (window == WINDOW_RX2 || _rx2 == 0) {
+        WindowsDone(false);
+    }
+}
+
+void SimEndDevice::WindowsDone(bool received) {
+    bool done = true;
+
+    if (_joining && !_joined) {
+        done = false;
+    } else if (!_joining && _confirmed && !_acked && _attempt < _retries) {
+        done = false;
+    } else if (!_joining && !_confirmed && !received && _attempt < _redundancy) {
+        // NbTrans repetitions stop once a downlink is received
+        done = false;
+    }
+
+    if (!_joining && _confirmed && !_acked) {
+        _link.MissedAcks++;
+    }
+
+    if (!done) {
+        uint64_t backoff = (uint64_t) (ACK_TIMEOUT + _radio.Random() % ACK_TIMEOUT_RND) * 1000;
+        _retry = _clock.After(backoff, callback(this, &SimEndDevice::Retry));
+        return;
+    }
+
+    if (_policyPending && !_joining) {
+        _policy->Outcome(_acked ? _attempt - 1 : _attempt, _acked);
+        _policyPending = false;
+    }
+
+    _busy = false;
+    _joining = false;
+    Resume();
+}
+
+void SimEndDevice::Retry() {
+    _retry = 0;
+
+    if (_joining) {
+        StartJoin();
+    } else {
+        Transmit();
+    }
+}
+
+bool SimEndDevice::Accept(const uint8_t* payload, uint16_t size) {
+    if (size < 1) {
+        return false;
+    }
+
+    uint8_t type = payload[PKT_HEADER] >> 5;
+
+    if (type == FRAME_TYPE_JOIN_ACCEPT) {
+        return _joining && JoinAccept(payload, size);
+    }
+
+    uint32_t address = 0;
+
+    if (!SimLoRaWAN::PeekAddress(payload, size, address)) {
+        return false;
+    }
+
+    SimDataFrame data;
+
+    if (_multicast.Defined && address == _multicast.Address) {
+        if (!SimLoRaWAN::DecodeData(payload, size, _multicast.NwkSKey, _multicast.AppSKey, _multicast.MinCounter, data)) {
+            _stats.MicFailures++;
+            return false;
+        }
+
+        if (data.Counter < _multicast.MinCounter || data.Counter > _multicast.MaxCounter) {
+            return false;
+        }
+
+        _multicast.MinCounter = data.Counter + 1;
+
+        if (data.HasPort && data.Port != 0) {
+            Application(data.Port, data.Payload);
+        }
+
+        // multicast never answers a class A uplink
+        return false;
+    }
+
+    if (!_joined || address != _address) {
+        return false;
+    }
+
+    if (!SimLoRaWAN::DecodeData(payload, size, _nwkSKey, _appSKey, _hasDownlink ? _fCntDown : 0, data)) {
+        _stats.MicFailures++;
+        return false;
+    }
+
+    if (_hasDownlink && data.Counter <= _fCntDown) {
+        return false;
+    }
+
+    _hasDownlink = true;
+    _fCntDown = data.Counter;
+    _stats.Downlinks++;
+
+    if (data.Type == FRAME_TYPE_DATA_CONFIRMED_DOWN) {
+        _ackPending = true;
+    }
+
+    if ((data.Control & SIM_FCTRL_ACK) && _confirmed) {
+        _acked = true;
+    }
+
+    MacCommands(data.Options, data.OptionsLength);
+
+    if (data.HasPort && data.Port == 0) {
+        MacCommands(data.Payload.data(), data.Payload.size());
+    } else if (data.HasPort) {
+        Application(data.Port, data.Payload);
+    }
+
+    return true;
+}
+
+bool SimEndDevice::JoinAccept(const uint8_t* payload, uint16_t size) {
+    std::vector<uint8_t> plain;
+
+    if (!SimLoRaWAN::DecodeJoinAccept(payload, size, _appKey, plain)) {
+        _stats.MicFailures++;
+        return false;
+    }
+
+    // MHDR, AppNonce, NetID, DevAddr, DLSettings, RxDelay, CFList
+    SimLoRaWAN::SessionKeys(_appKey, &plain[1], &plain[4], _devNonce, _nwkSKey, _appSKey);
+    _address = SimLoRaWAN::GetUint32(&plain[7]);
+    _rx2Datarate = plain[11] & 0x0F;
+    _rxDelay = (plain[12] & 0x0F) == 0 ? 1 : (plain[12] & 0x0F);
+
+    if (plain.size() >= 29 && plain[28] == 1) {
+        // CFListType 1 is the channel mask
+        for (size_t i = 0; i < _region.Channels.size(); i++) {
+            uint8_t index = _region.Channels[i].Index;
+            _enabled[i] = (plain[13 + index / 8] >> (index % 8)) & 1;
+        }
+    }
+
+    _joined = true;
+    _fCntUp = 0;
+    _fCntDown = 0;
+    _hasDownlink = false;
+    _powerIndex = 0;
+    _redundancy = 1;
+    _adrAckCounter = 0;
+    _macAnswers.clear();
+
+    return true;
+}
+
+void SimEndDevice::MacCommands(const uint8_t* data, uint8_t size) {
+    uint8_t end = 0;
+    uint8_t i = 0;
+
+    // commands before one that is not understood are applied, as the Mac does
+    if (MacCommandCodec::Validate(data, size, end) < 0 || end < size) {
+        logWarning("downlink MAC command %02X not understood", data[end]);
+    }
+
+    while (i < end) {
+        uint8_t cid = data[i];
+        uint8_t length = MacCommandCodec::ServerCommandSize(cid);
+
+        if (cid == SRV_MAC_LINK_ADR_REQ) {
+            // a block of consecutive requests is applied as one
+            uint8_t count = MacCommandCodec::LinkAdrBlock(data, i, end);
+            uint8_t status = LinkAdr(&data[i], count);
+
+            for (uint8_t c = 0; c < count; c++) {
+                _macAnswers.push_back(MOTE_MAC_LINK_ADR_ANS);
+                _macAnswers.push_back(status);
+            }
+
+            i += count * length;
+            continue;
+        }
+
+        if (cid == SRV_MAC_DEVICE_TIME_ANS) {
+            // network time at the end of the uplink that asked
+            uint32_t network = SimLoRaWAN::GetUint32(&data[i + 1]);
+            uint32_t device = SIM_GPS_START + (uint32_t) (_txEnd / 1000000) + _clockError + _correction;
+            _correction += (int32_t) (network - device);
+            _stats.ClockSyncs++;
+        }
+
+        i += length;
+    }
+}
+
+uint8_t SimEndDevice::LinkAdr(const uint8_t* data, uint8_t count) {
+    std::vector<bool> enabled = _enabled;
+    uint8_t last = (count - 1) * 5;
+    uint8_t datarate = data[last + 1] >> 4;
+    uint8_t power = data[last + 1] & 0x0F;
+    uint8_t redundancy = data[last + 4] & 0x0F;
+    bool fixed = _region.FixedChannels();
+
+    _stats.LinkAdrReqs++;
+
+    for (uint8_t c = 0; c < count; c++) {
+        const uint8_t* cmd = &data[c * 5];
+        uint16_t mask = SimLoRaWAN::GetUint16(&cmd[2]);
+        uint8_t cntl = (cmd[4] >> 4) & 0x07;
+
+        for (size_t i = 0; i < _region.Channels.size(); i++) {
+            uint8_t index = _region.Channels[i].Index;
+
+            if (fixed && cntl == 7) {
+                // every 125k channel off, the mask applies to the 500k ones
+                enabled[i] = index >= 64 && ((mask >> (index - 64)) & 1);
+            } else if (fixed && cntl == 6) {
+                enabled[i] = index < 64 || ((mask >> (index - 64)) & 1);
+            } else if (index / 16 == cntl) {
+                enabled[i] = (mask >> (index % 16)) & 1;
+            }
+        }
+    }
+
+    bool anyChannel = false;
+    bool datarateOk = datarate == 0x0F;
+
+    for (size_t i = 0; i < _region.Channels.size(); i++) {
+        anyChannel = anyChannel || enabled[i];
+
+        if (enabled[i] && datarate >= _region.Channels[i].MinDatarate && datarate <= _region.Channels[i].MaxDatarate) {
+            datarateOk = true;
+        }
+    }
+
+    bool powerOk = power == 0x0F || power <= _region.MaxPowerIndex;
+    uint8_t status = (powerOk ? 0x04 : 0) | (datarateOk ? 0x02 : 0) | (anyChannel ? 0x01 : 0);
+
+    if (status == 0x07) {
+        _enabled = enabled;
+        if (datarate != 0x0F) {
+            _datarate = datarate;
+        }
+        if (power != 0x0F) {
+            _powerIndex = power;
+        }
+        // NbTrans 0 keeps the default of one transmission
+        _redundancy = redundancy != 0 ? redundancy : 1;
+    }
+
+    return status;
+}
+
+void SimEndDevice::Application(uint8_t port, const std::vector<uint8_t>& payload) {
+    if (payload.empty()) {
+        return;
+    }
+
+    uint8_t cid = payload[0];
+    std::vector<uint8_t> answer;
+
+    if (port == SIM_PORT_CLOCK_SYNC && cid == SIM_APP_TIME && payload.size() >= 6) {
+        if (_timePending && (payload[5] & 0x0F) == _timeToken) {
+            _timePending = false;
+            _correction += (int32_t) SimLoRaWAN::GetUint32(&payload[1]);
+            _stats.ClockSyncs++;
+        }
+        return;
+    }
+
+    if (port == SIM_PORT_MULTICAST && cid == SIM_MC_GROUP_SETUP && payload.size() >= 30) {
+        uint8_t mcKEKey[16];
+        uint8_t mcKey[16];
+
+        SimLoRaWAN::McKEKey(_appKey, mcKEKey);
+        SimLoRaWAN::Encrypt(mcKEKey, &payload[6], mcKey);
+
+        _multicast.Defined = true;
+        _multicast.Address = SimLoRaWAN::GetUint32(&payload[2]);
+        SimLoRaWAN::MulticastKeys(mcKey, _multicast.Address, _multicast.NwkSKey, _multicast.AppSKey);
+        _multicast.MinCounter = SimLoRaWAN::GetUint32(&payload[22]);
+        _multicast.MaxCounter = SimLoRaWAN::GetUint32(&payload[26]);
+
+        answer.push_back(SIM_MC_GROUP_SETUP);
+        answer.push_back(payload[1] & 0x03);
+    } else if (port == SIM_PORT_MULTICAST && cid == SIM_MC_CLASS_C_SESSION && payload.size() >= 11) {
+        answer.push_back(SIM_MC_CLASS_C_SESSION);
+
+        if (!_multicast.Defined) {
+            answer.push_back(0x10 | (payload[1] & 0x03));
+        } else {
+            // the session time is read on the device clock, an unsynced clock opens it at the wrong time
+            uint32_t start = SimLoRaWAN::GetUint32(&payload[2]);
+            uint32_t now = GpsTime();
+            uint32_t toStart = start > now ? start - now : 0;
+            uint64_t duration = (uint64_t) 1000000 << (payload[6] & 0x0F);
+
+            _multicast.Frequency = SimLoRaWAN::GetUint24(&payload[7]) * 100;
+            _multicast.Datarate = payload[10];
+
+            _clock.Cancel(_multicast.Start);
+            _clock.Cancel(_multicast.End);
+            _multicast.Start = _clock.After((uint64_t) toStart * 1000000, callback(this, &SimEndDevice::SessionStart));
+            _multicast.End = _clock.After((uint64_t) toStart * 1000000 + duration, callback(this, &SimEndDevice::SessionEnd));
+
+            answer.push_back(payload[1] & 0x03);
+            answer.resize(5);
+            SimLoRaWAN::PutUint24(&answer[2], toStart);
+        }
+    } else if (port == SIM_PORT_FRAGMENTATION && cid == SIM_FRAG_SESSION_SETUP && payload.size() >= 11) {
+        uint16_t count = SimLoRaWAN::GetUint16(&payload[2]);
+
+        _decoder.Active = true;
+        _decoder.Count = count;
+        _decoder.Size = payload[4];
+        _decoder.Padding = payload[6];
+        _decoder.Rank = 0;
+        _decoder.Pivot.assign(count, -1);
+        _decoder.Coefficients.clear();
+        _decoder.Data.clear();
+        _fotaComplete = false;
+        _image.clear();
+
+        answer.push_back(SIM_FRAG_SESSION_SETUP);
+        answer.push_back((payload[1] & 0x30) << 2);
+    } else if (port == SIM_PORT_FRAGMENTATION && cid == SIM_DATA_FRAGMENT && payload.size() >= 3) {
+        if (_decoder.Active && payload.size() >= 3u + _decoder.Size) {
+            Fragment(SimLoRaWAN::GetUint16(&payload[1]) & 0x3FFF, &payload[3]);
+        }
+        return;
+    } else {
+        return;
+    }
+
+    _appAnswers.push_back(std::make_pair(port, answer));
+}
+
+void SimEndDevice::Fragment(uint16_t index, const uint8_t* data) {
+    Decoder& d = _decoder;
+    size_t words = (d.Count + 63) / 64;
+    std::vector<uint64_t> row(words, 0);
+    std::vector<uint8_t> bytes(data, data + d.Size);
+
+    if (_fotaComplete || index == 0) {
+        return;
+    }
+
+    _stats.Fragments++;
+
+    if (index <= d.Count) {
+        row[(index - 1) / 64] |= 1ULL << ((index - 1) % 64);
+    } else {
+        std::vector<uint8_t> parity;
+        SimLoRaWAN::ParityRow(index - d.Count, d.Count, parity);
+
+        for (uint16_t j = 0; j < d.Count; j++) {
+            if (parity[j]) {
+                row[j / 64] |= 1ULL << (j % 64);
+            }
+        }
+    }
+
+    // forward elimination against the stored rows, each stored row starts at its pivot column
+    for (uint16_t col = 0; col < d.Count; col++) {
+        if (!((row[col / 64] >> (col % 64)) & 1)) {
+            continue;
+        }
+
+        if (d.Pivot[col] < 0) {
+            d.Pivot[col] = d.Coefficients.size();
+            d.Coefficients.push_back(row);
+            d.Data.push_back(bytes);
+            d.Rank++;
+            break;
+        }
+
+        const std::vector<uint64_t>& other = d.Coefficients[d.Pivot[col]];
+        const std::vector<uint8_t>& otherData = d.Data[d.Pivot[col]];
+
+        for (size_t w = 0; w < words; w++) {
+            row[w] ^= other[w];
+        }
+
+        for (size_t k = 0; k < bytes.size(); k++) {
+            bytes[k] ^= otherData[k];
+        }
+    }
+
+    if (d.Rank < d.Count) {
+        return;
+    }
+
+    // back substitution leaves each pivot row with its own column only
+    for (int col = d.Count - 1; col >= 0; col--) {
+        std::vector<uint64_t>& coeff = d.Coefficients[d.Pivot[col]];
+        std::vector<uint8_t>& value = d.Data[d.Pivot[col]];
+
+        for (uint16_t k = col + 1; k < d.Count; k++) {
+            if ((coeff[k / 64] >> (k % 64)) & 1) {
+                const std::vector<uint8_t>& other = d.Data[d.Pivot[k]];
+
+                for (size_t b = 0; b < value.size(); b++) {
+                    value[b] ^= other[b];
+                }
+                coeff[k / 64] &= ~(1ULL << (k % 64));
+            }
+        }
+    }
+
+    _image.clear();
+    for (uint16_t col = 0; col < d.Count; col++) {
+        _image.insert(_image.end(), d.Data[d.Pivot[col]].begin(), d.Data[d.Pivot[col]].end());
+    }
+    _image.resize(_image.size() - d.Padding);
+
+    _fotaComplete = true;
+    _decoder.Active = false;
+    _stats.Blocks++;
+    logInfo("data block of %u bytes rebuilt from %u fragments", _image.size(), _stats.Fragments);
+}
+
+void SimEndDevice::SessionStart() {
+    _multicast.Start = 0;
+    _multicast.Open = true;
+    Resume();
+}
+
+void SimEndDevice::SessionEnd() {
+    _multicast.End = 0;
+    _multicast.Open = false;
+
+    if (_window == WINDOW_CLASS_C) {
+        _window = WINDOW_NONE;
+        _radio.Sleep();
+    }
+}
+
+void SimEndDevice::Resume() {
+    if (!_multicast.Open || _busy) {
+        return;
+    }
+
+    // class C listens on the session channel between class A cycles
+    _window = WINDOW_CLASS_C;
+    OpenWindow(_multicast.Frequency, _region.Downlink[_multicast.Datarate], true);
+}
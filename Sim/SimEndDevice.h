@@ -0,0 +1,283 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimEndDevice class A and C device for end-to-end host simulation
+ *
+ * @details Stands in for the Mote on a SimRadio where the Mac is not available, with the
+ *          same timing: RX1 and RX2 after each uplink, ACK_TIMEOUT based retries and join
+ *          retries with a fresh DevNonce.  It applies LinkADRReq blocks including NbTrans,
+ *          backs off after ADR_ACK_LIMIT + ADR_ACK_DELAY uplinks without a downlink, or lets
+ *          an AdrPolicy pick its settings with ADR off.  It keeps a device
+ *          clock with a configurable error that clock sync corrects, joins the multicast
+ *          group and class C session set up on port 200 and rebuilds a data block from the
+ *          fragments of port 201.
+ *
+ */
+
+#ifndef __LORA_SIM_END_DEVICE_H__
+#define __LORA_SIM_END_DEVICE_H__
+
+#include "SimRadio.h"
+#include "SimRegion.h"
+#include "SxRadioEvents.h"
+#include "AdrPolicy.h"
+#include <deque>
+#include <vector>
+
+namespace lora {
+
+    class SimEndDevice : public SxRadioEvents {
+        public:
+            /**
+             * Counters of device activity
+             */
+            struct Stats {
+                uint32_t JoinRequests;
+                uint32_t Uplinks;               //!< frames sent including retransmissions
+                uint32_t Retransmissions;       //!< confirmed uplinks sent again for a missing ACK
+                uint32_t Repetitions;           //!< unconfirmed uplinks sent again for NbTrans
+                uint32_t Downlinks;             //!< class A downlinks accepted
+                uint32_t MicFailures;
+                uint32_t LinkAdrReqs;
+                uint32_t Fragments;             //!< data fragments accepted
+                uint32_t Blocks;                //!< data blocks rebuilt
+                uint32_t ClockSyncs;
+            };
+
+            /**
+             * @param radio radio of the device, its events are taken over
+             * @param region channels and datarates
+             * @param devEui 8 bytes, MSB first
+             * @param appEui 8 bytes, MSB first
+             * @param appKey 16 bytes
+             */
+            SimEndDevice(SimRadio& radio, const SimRegion& region, const uint8_t* devEui, const uint8_t* appEui, const uint8_t* appKey);
+            virtual ~SimEndDevice();
+
+            void SetDatarate(uint8_t datarate);
+            uint8_t GetDatarate() const;
+            void SetAdr(bool on);
+
+            /**
+             * Policy picking datarate, power and NbTrans of each new uplink while ADR is off
+             * @param policy NULL for none, owned by the caller
+             */
+            void SetPolicy(AdrPolicy* policy);
+
+            /**
+             * TX power index
+             */
+            uint8_t GetPowerIndex() const;
+
+            /**
+             * Transmissions of an unconfirmed uplink
+             */
+            uint8_t GetRedundancy() const;
+
+            /**
+             * Attempts of a confirmed uplink
+             * @param retries 1-8, default 8
+             */
+            void SetRetries(uint8_t retries);
+
+            /**
+             * Offset of the device clock from network time before any sync
+             * @param seconds positive when the device is ahead
+             */
+            void SetClockError(int32_t seconds);
+
+            /**
+             * Join over the air, retried until a join accept is received
+             * @return false if an operation is in progress
+             */
+            bool Join();
+
+            /**
+             * Send an uplink with pending MAC answers in FOpts
+             * @return false if not joined or an operation is in progress
+             */
+            bool Send(uint8_t port, const std::vector<uint8_t>& payload, bool confirmed);
+
+            /**
+             * Send the next application package answer, or an empty frame to open the receive windows
+             * @return false if not joined or an operation is in progress
+             */
+            bool Poll();
+
+            /**
+             * Queue an AppTimeReq for the next Poll, repeated by later polls until answered
+             */
+            void RequestTime();
+
+            bool Joined() const;
+
+            /**
+             * Whether a join or an uplink with its windows and retries is in progress
+             */
+            bool Busy() const;
+
+            /**
+             * Whether the last confirmed uplink was acknowledged
+             */
+            bool Acked() const;
+
+            /**
+             * Whether application package answers are waiting for an uplink
+             */
+            bool Pending() const;
+
+            /**
+             * Device clock
+             * @return GPS seconds
+             */
+            uint32_t GpsTime() const;
+
+            /**
+             * Whether the class C session of the multicast group is open
+             */
+            bool InSession() const;
+
+            /**
+             * Whether the fragmented data block has been rebuilt
+             */
+            bool FotaComplete() const;
+            const std::vector<uint8_t>& FotaImage() const;
+
+            const Stats& GetStats() const;
+
+            /**
+             * Session statistics as the Mote keeps them, SNR in cB
+             */
+            const Statistics& GetLinkStats() const;
+
+            virtual void TxDone();
+            virtual void RxDone(uint8_t* payload, uint16_t size, int16_t rssi, int16_t snr);
+            virtual void RxTimeout();
+            virtual void RxError();
+
+        private:
+            enum Window {
+                WINDOW_NONE,
+                WINDOW_RX1,
+                WINDOW_RX2,
+                WINDOW_CLASS_C
+            };
+
+            struct Multicast {
+                bool Defined;
+                uint32_t Address;
+                uint8_t NwkSKey[16];
+                uint8_t AppSKey[16];
+                uint32_t MinCounter;
+                uint32_t MaxCounter;
+                uint32_t Frequency;
+                uint8_t Datarate;
+                SimClock::EventId Start;
+                SimClock::EventId End;
+                bool Open;
+            };
+
+            /**
+             * Fragments received so far as rows of a GF(2) system in echelon form
+             */
+            struct Decoder {
+                bool Active;
+                uint16_t Count;                 //!< uncoded fragments
+                uint8_t Size;
+                uint8_t Padding;
+                uint16_t Rank;
+                std::vector<int> Pivot;         //!< row of each column, -1 if none
+                std::vector<std::vector<uint64_t> > Coefficients;
+                std::vector<std::vector<uint8_t> > Data;
+            };
+
+            void Transmit();
+            void StartJoin();
+            void StartSend(bool hasPort, uint8_t port, const std::vector<uint8_t>& payload, bool confirmed);
+            void OpenRx1();
+            void OpenRx2();
+            void OpenWindow(uint32_t frequency, const SimRegion::Datarate& modulation, bool continuous);
+            void WindowsDone(bool received);
+            void Retry();
+            bool Accept(const uint8_t* payload, uint16_t size);
+            bool JoinAccept(const uint8_t* payload, uint16_t size);
+            void MacCommands(const uint8_t* data, uint8_t size);
+            uint8_t LinkAdr(const uint8_t* data, uint8_t count);
+            void Application(uint8_t port, const std::vector<uint8_t>& payload);
+            void Fragment(uint16_t index, const uint8_t* data);
+            void SessionStart();
+            void SessionEnd();
+            void Resume();
+            void QueueTimeRequest();
+            bool Enabled(uint8_t datarate, size_t channel) const;
+            void Backoff();
+            void ApplyPolicy(uint8_t size, bool confirmed);
+            void Measure(int16_t rssi, int16_t snr);
+
+            SimRadio& _radio;
+            SimClock& _clock;
+            SimRegion _region;
+            uint8_t _devEui[8];
+            uint8_t _appEui[8];
+            uint8_t _appKey[16];
+
+            bool _joined;
+            uint16_t _devNonce;
+            uint32_t _address;
+            uint8_t _nwkSKey[16];
+            uint8_t _appSKey[16];
+            uint32_t _fCntUp;
+            uint32_t _fCntDown;
+            bool _hasDownlink;
+            uint8_t _rxDelay;                   //!< seconds
+            uint8_t _rx2Datarate;
+            std::vector<bool> _enabled;         //!< by index into the region channels
+
+            uint8_t _datarate;
+            uint8_t _powerIndex;
+            bool _adr;
+            uint8_t _retries;
+            uint8_t _redundancy;                //!< NbTrans
+            uint32_t _adrAckCounter;
+            AdrPolicy* _policy;
+            bool _policyPending;                //!< confirmed uplink picked by the policy, outcome not reported
+
+            bool _busy;
+            bool _joining;
+            bool _confirmed;
+            bool _acked;
+            bool _ackPending;                   //!< a confirmed downlink is acknowledged in the next uplink
+            uint8_t _attempt;
+            std::vector<uint8_t> _frame;
+            size_t _channel;
+            uint64_t _txEnd;
+            Window _window;
+            SimClock::EventId _rx1;
+            SimClock::EventId _rx2;
+            SimClock::EventId _retry;
+
+            std::vector<uint8_t> _macAnswers;
+            std::deque<std::pair<uint8_t, std::vector<uint8_t> > > _appAnswers;
+
+            int32_t _clockError;
+            int32_t _correction;
+            uint8_t _timeToken;
+            bool _timePending;                  //!< AppTimeReq sent and not yet answered
+
+            Multicast _multicast;
+            Decoder _decoder;
+            bool _fotaComplete;
+            std::vector<uint8_t> _image;
+
+            Stats _stats;
+            Statistics _link;
+            std::deque<std::pair<int16_t, int16_t> > _samples;  //!< RSSI and SNR of the last downlinks
+    };
+
+}
+
+#endif
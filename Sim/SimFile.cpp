@@ -0,0 +1,137 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFile FileDevice in host memory with the costs of a SPIFFS file
+ *
+ */
+
+#include "SimFile.h"
+#include <string.h>
+
+using namespace lora;
+
+SimFileConfig::SimFileConfig()
+:   PageSize(256),
+    PagesPerBlock(16),
+    WriteCall(300),
+    PageProgram(800),
+    ReadCall(100),
+    PageRead(60)
+{
+}
+
+SimFile::SimFile(const SimFileConfig& config)
+:   _config(config),
+    _position(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+int32_t SimFile::Read(uint8_t* data, uint32_t size) {
+    uint32_t count = _position < _data.size() ? _data.size() - _position : 0;
+
+    if (count > size) {
+        count = size;
+    }
+
+    if (count != 0) {
+        memcpy(data, _data.data() + _position, count);
+    }
+
+    _stats.Reads++;
+    _stats.Time += _config.ReadCall + (uint64_t) Pages(_position, count) * _config.PageRead;
+    _position += count;
+
+    return count;
+}
+
+int32_t SimFile::Write(const uint8_t* data, uint32_t size) {
+    uint32_t end = _position + size;
+    uint32_t page = _config.PageSize;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    // a page part filled at the end of the file is programmed in place, any other page
+    // touched is written anew, and the index page moves on every write
+    uint32_t programs = Pages(_position, size) + 1;
+    uint32_t taken = programs;
+
+    if (_position == _data.size() && _position % page != 0) {
+        taken--;
+    }
+
+    if (end > _data.size()) {
+        _data.resize(end);
+    }
+
+    memcpy(_data.data() + _position, data, size);
+    _position = end;
+
+    _stats.Writes++;
+    _stats.PagePrograms += programs;
+    _stats.PagesTaken += taken;
+    _stats.Time += _config.WriteCall + (uint64_t) programs * _config.PageProgram;
+
+    return size;
+}
+
+int32_t SimFile::Seek(int32_t offset, int whence) {
+    int64_t target;
+
+    switch (whence) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = (int64_t) _position + offset;
+            break;
+        case SEEK_END:
+            target = (int64_t) _data.size() + offset;
+            break;
+        default:
+            return -1;
+    }
+
+    if (target < 0 || target > (int64_t) _data.size()) {
+        return -1;
+    }
+
+    _position = target;
+    _stats.Seeks++;
+
+    return 0;
+}
+
+uint32_t SimFile::Tell() const {
+    return _position;
+}
+
+uint32_t SimFile::Size() const {
+    return _data.size();
+}
+
+double SimFile::Erases() const {
+    return (double) _stats.PagesTaken / _config.PagesPerBlock;
+}
+
+const std::vector<uint8_t>& SimFile::Data() const {
+    return _data;
+}
+
+const SimFileStats& SimFile::GetStats() const {
+    return _stats;
+}
+
+uint32_t SimFile::Pages(uint32_t from, uint32_t size) const {
+    if (size == 0) {
+        return 0;
+    }
+
+    return (from + size - 1) / _config.PageSize - from / _config.PageSize + 1;
+}
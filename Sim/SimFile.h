@@ -0,0 +1,80 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFile FileDevice in host memory with the costs of a SPIFFS file
+ *
+ * @details A rough model of SPIFFS on the mDot SPI flash.  Each write programs every page
+ *          it touches, a part filled last page in place, and rewrites the object index page
+ *          that holds the file size into a new page.  New pages are taken from free blocks,
+ *          so every PagesPerBlock pages taken cost one erase once the file system is full
+ *          and collects garbage.  Calls and page programs are given a time to compare
+ *          throughput; the defaults are guesses to be replaced by measurements.
+ *
+ */
+
+#ifndef __LORA_SIM_FILE_H__
+#define __LORA_SIM_FILE_H__
+
+#include "FileDevice.h"
+#include <vector>
+
+namespace lora {
+
+    struct SimFileConfig {
+        SimFileConfig();
+
+        uint32_t PageSize;
+        uint32_t PagesPerBlock;
+        uint32_t WriteCall;                 //!< us of a write besides its page programs
+        uint32_t PageProgram;               //!< us
+        uint32_t ReadCall;                  //!< us of a read besides its page reads
+        uint32_t PageRead;                  //!< us
+    };
+
+    struct SimFileStats {
+        uint32_t Reads;
+        uint32_t Writes;
+        uint32_t Seeks;
+        uint32_t PagePrograms;              //!< data and index pages programmed
+        uint32_t PagesTaken;                //!< new pages, each a 1 / PagesPerBlock share of an erase
+        uint64_t Time;                      //!< us spent in the file system
+    };
+
+    class SimFile : public FileDevice {
+        public:
+            SimFile(const SimFileConfig& config = SimFileConfig());
+
+            virtual int32_t Read(uint8_t* data, uint32_t size);
+            virtual int32_t Write(const uint8_t* data, uint32_t size);
+            virtual int32_t Seek(int32_t offset, int whence);
+            virtual uint32_t Tell() const;
+            virtual uint32_t Size() const;
+
+            /**
+             * @return erases the pages taken will cost
+             */
+            double Erases() const;
+
+            const std::vector<uint8_t>& Data() const;
+
+            const SimFileStats& GetStats() const;
+
+        private:
+            /**
+             * @return pages holding bytes [from, from + size)
+             */
+            uint32_t Pages(uint32_t from, uint32_t size) const;
+
+            SimFileConfig _config;
+            std::vector<uint8_t> _data;
+            uint32_t _position;
+            SimFileStats _stats;
+    };
+
+}
+
+#endif
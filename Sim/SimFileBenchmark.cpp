@@ -0,0 +1,183 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFileBenchmark small appends and reads through the user file layers
+ *
+ */
+
+#include "SimFileBenchmark.h"
+#include "FileStream.h"
+#include "LogFile.h"
+#include "Lora.h"
+#include "MTSLog.h"
+#include <chrono>
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    /**
+     * Run figures from the file statistics before and after
+     */
+    void Account(SimFileRun& run, const SimFile& file, const SimFileStats& before, double erases, uint32_t samples,
+                 std::chrono::steady_clock::time_point begin) {
+        const SimFileStats& after = file.GetStats();
+
+        run.Calls = after.Reads + after.Writes - before.Reads - before.Writes;
+        run.PagePrograms = after.PagePrograms - before.PagePrograms;
+        run.Erases = file.Erases() - erases;
+        run.Time = (after.Time - before.Time) / 1e6;
+        run.Rate = run.Time > 0 ? samples / run.Time : 0.0;
+        run.HostTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / samples;
+    }
+
+}
+
+SimFileBenchmarkConfig::SimFileBenchmarkConfig()
+:   Samples(10000),
+    SampleSize(16),
+    BufferSize(1024),
+    FlushEvery(100),
+    ReadSize(16)
+{
+}
+
+void SimFileBenchmarkReport::Log() const {
+    for (size_t i = 0; i < Runs.size(); i++) {
+        const SimFileRun& run = Runs[i];
+
+        logInfo("%-14s %7lu calls %7lu page programs %8.1f erases %8.2f s %9.0f samples/s %7.1f ns/sample host %s",
+                run.Name, (unsigned long) run.Calls, (unsigned long) run.PagePrograms, run.Erases, run.Time, run.Rate,
+                run.HostTime, run.Verified ? "ok" : "MISMATCH");
+    }
+}
+
+SimFileBenchmark::SimFileBenchmark(const SimFileBenchmarkConfig& config)
+:   _config(config)
+{
+}
+
+SimFileBenchmarkReport SimFileBenchmark::Run() {
+    SimFileBenchmarkReport report;
+    std::vector<uint8_t> samples(_config.Samples * _config.SampleSize);
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = (uint8_t) (i * 7 + i / 251);
+    }
+
+    SimFile device(_config.File);
+    SimFile stream(_config.File);
+    SimFile log(_config.File);
+
+    report.Runs.push_back(Append(METHOD_DEVICE, samples, device));
+    report.Runs.push_back(Append(METHOD_STREAM, samples, stream));
+    report.Runs.push_back(Append(METHOD_LOG, samples, log));
+
+    report.Runs.push_back(ReadBack(METHOD_DEVICE, samples, log));
+    report.Runs.push_back(ReadBack(METHOD_STREAM, samples, log));
+    report.Runs.push_back(ReadBack(METHOD_NEXT, samples, log));
+
+    return report;
+}
+
+SimFileRun SimFileBenchmark::Append(Method method, const std::vector<uint8_t>& samples, SimFile& file) {
+    std::vector<uint8_t> buffer(_config.BufferSize);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    SimFileStats before = file.GetStats();
+    SimFileRun run;
+    bool ok = true;
+
+    memset(&run, 0, sizeof(run));
+
+    if (method == METHOD_DEVICE) {
+        run.Name = "append device";
+
+        for (uint32_t i = 0; i < _config.Samples && ok; i++) {
+            ok = file.Write(&samples[i * _config.SampleSize], _config.SampleSize) == (int32_t) _config.SampleSize;
+        }
+    } else if (method == METHOD_STREAM) {
+        FileStream stream(file, buffer.data(), buffer.size());
+
+        run.Name = "append stream";
+
+        for (uint32_t i = 0; i < _config.Samples && ok; i++) {
+            ok = stream.Write(&samples[i * _config.SampleSize], _config.SampleSize) == (int32_t) _config.SampleSize;
+
+            if (ok && _config.FlushEvery != 0 && (i + 1) % _config.FlushEvery == 0) {
+                ok = stream.Flush() == LORA_OK;
+            }
+        }
+
+        ok = ok && stream.Flush() == LORA_OK;
+    } else {
+        LogFile log(file, buffer.data(), buffer.size(), _config.File.PageSize);
+
+        run.Name = "append log";
+
+        for (uint32_t i = 0; i < _config.Samples && ok; i++) {
+            ok = log.Append(&samples[i * _config.SampleSize], _config.SampleSize) == LORA_OK;
+
+            if (ok && _config.FlushEvery != 0 && (i + 1) % _config.FlushEvery == 0) {
+                ok = log.Flush() == LORA_OK;
+            }
+        }
+
+        ok = ok && log.Flush() == LORA_OK;
+    }
+
+    Account(run, file, before, 0.0, _config.Samples, begin);
+    run.Verified = ok && file.Data() == samples;
+
+    return run;
+}
+
+SimFileRun SimFileBenchmark::ReadBack(Method method, const std::vector<uint8_t>& samples, const SimFile& written) {
+    SimFile file(_config.File);
+    std::vector<uint8_t> buffer(_config.BufferSize);
+    std::vector<uint8_t> chunk(_config.ReadSize);
+    std::vector<uint8_t> read;
+    SimFileRun run;
+
+    memset(&run, 0, sizeof(run));
+    file.Write(written.Data().data(), written.Data().size());
+    file.Seek(0, SEEK_SET);
+    read.reserve(samples.size());
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    SimFileStats before = file.GetStats();
+    double erases = file.Erases();
+
+    if (method == METHOD_DEVICE) {
+        run.Name = "read device";
+
+        for (int32_t got; (got = file.Read(chunk.data(), chunk.size())) > 0; ) {
+            read.insert(read.end(), chunk.begin(), chunk.begin() + got);
+        }
+    } else if (method == METHOD_STREAM) {
+        FileStream stream(file, buffer.data(), buffer.size());
+
+        run.Name = "read stream";
+
+        for (int32_t got; (got = stream.ReadInto(mbed::Span<uint8_t>(chunk.data(), chunk.size()))) > 0; ) {
+            read.insert(read.end(), chunk.begin(), chunk.begin() + got);
+        }
+    } else {
+        FileStream stream(file, buffer.data(), buffer.size());
+
+        run.Name = "read next";
+
+        for (mbed::Span<const uint8_t> next; !(next = stream.Next(_config.ReadSize)).empty(); ) {
+            read.insert(read.end(), next.begin(), next.end());
+        }
+    }
+
+    Account(run, file, before, erases, _config.Samples, begin);
+    run.Verified = read == samples;
+
+    return run;
+}
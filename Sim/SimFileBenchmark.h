@@ -0,0 +1,77 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFileBenchmark small appends and reads through the user file layers
+ *
+ * @details Logs the same samples to a SimFile three ways: a FileDevice write per sample as
+ *          writeUserFile does today, a FileStream and a LogFile, flushing the buffered ones now
+ *          and then as an application does before it sleeps.  The log is then read back
+ *          in small chunks straight from the FileDevice, through a FileStream and through
+ *          FileStream::Next().  Each run reports file system calls, page programs, the
+ *          erases the pages taken will cost and the modelled time, and checks the bytes.
+ *
+ */
+
+#ifndef __LORA_SIM_FILE_BENCHMARK_H__
+#define __LORA_SIM_FILE_BENCHMARK_H__
+
+#include "SimFile.h"
+#include <vector>
+
+namespace lora {
+
+    struct SimFileBenchmarkConfig {
+        SimFileBenchmarkConfig();
+
+        SimFileConfig File;
+        uint32_t Samples;
+        uint32_t SampleSize;                //!< bytes
+        uint32_t BufferSize;                //!< of the FileStream and the LogFile
+        uint32_t FlushEvery;                //!< samples between flushes, as before a deep sleep, 0 for none
+        uint32_t ReadSize;                  //!< bytes per read back
+    };
+
+    struct SimFileRun {
+        const char* Name;
+        uint32_t Calls;                     //!< FileDevice reads and writes
+        uint32_t PagePrograms;
+        double Erases;
+        double Time;                        //!< s modelled in the file system
+        double Rate;                        //!< samples per s of modelled time
+        double HostTime;                    //!< ns per sample on the host, the layer itself
+        bool Verified;                      //!< bytes written or read back as logged
+    };
+
+    struct SimFileBenchmarkReport {
+        std::vector<SimFileRun> Runs;
+
+        void Log() const;
+    };
+
+    class SimFileBenchmark {
+        public:
+            SimFileBenchmark(const SimFileBenchmarkConfig& config = SimFileBenchmarkConfig());
+
+            SimFileBenchmarkReport Run();
+
+        private:
+            enum Method {
+                METHOD_DEVICE,
+                METHOD_STREAM,
+                METHOD_LOG,
+                METHOD_NEXT
+            };
+
+            SimFileRun Append(Method method, const std::vector<uint8_t>& samples, SimFile& file);
+            SimFileRun ReadBack(Method method, const std::vector<uint8_t>& samples, const SimFile& written);
+
+            SimFileBenchmarkConfig _config;
+    };
+
+}
+
+#endif
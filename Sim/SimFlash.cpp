@@ -0,0 +1,181 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFlash NvmDevice in host memory that loses power on request
+ *
+ */
+
+#include "SimFlash.h"
+#include <string.h>
+
+using namespace lora;
+
+SimFlashConfig::SimFlashConfig()
+:   Size(0x1800),
+    EraseSize(256),
+    ProgramSize(4),
+    Reprogrammable(true),
+    Seed(1)
+{
+}
+
+SimFlash::SimFlash(const SimFlashConfig& config)
+:   _config(config),
+    _memory(config.Size, NVM_ERASED),
+    _written(config.Size / config.ProgramSize, 0),
+    _wear(config.Size / config.EraseSize, 0),
+    _random(config.Seed),
+    _armed(false),
+    _lost(false),
+    _steps(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+int32_t SimFlash::Read(uint32_t address, uint8_t* data, uint32_t size) {
+    if (address + size > _memory.size()) {
+        return -1;
+    }
+
+    memcpy(data, &_memory[address], size);
+    return 0;
+}
+
+int32_t SimFlash::Program(uint32_t address, const uint8_t* data, uint32_t size) {
+    uint32_t unit = _config.ProgramSize;
+
+    if (address % unit != 0 || size % unit != 0 || address + size > _memory.size()) {
+        _stats.Violations++;
+        return -1;
+    }
+
+    for (uint32_t done = 0; done < size; done += unit) {
+        if (_lost) {
+            return -1;
+        }
+
+        uint32_t index = (address + done) / unit;
+        uint8_t* target = &_memory[address + done];
+        bool torn = !Step();
+
+        if (_written[index] && !_config.Reprogrammable) {
+            _stats.Violations++;
+        }
+
+        for (uint32_t i = 0; i < unit; i++) {
+            uint8_t clear = target[i] & ~data[done + i];
+
+            if (data[done + i] & ~target[i]) {
+                // a program cannot set bits
+                _stats.Violations++;
+            }
+
+            if (torn) {
+                clear &= _random();
+            }
+
+            target[i] &= ~clear;
+        }
+
+        _written[index] = 1;
+        _stats.Programs++;
+        _stats.Bytes += unit;
+
+        if (torn) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int32_t SimFlash::Erase(uint32_t address, uint32_t size) {
+    uint32_t block = _config.EraseSize;
+
+    if (address % block != 0 || size % block != 0 || address + size > _memory.size()) {
+        _stats.Violations++;
+        return -1;
+    }
+
+    for (uint32_t done = 0; done < size; done += block) {
+        if (_lost) {
+            return -1;
+        }
+
+        bool torn = !Step();
+        uint32_t index = (address + done) / block;
+
+        for (uint32_t i = 0; i < block; i++) {
+            _memory[address + done + i] |= torn ? (uint8_t) _random() : NVM_ERASED;
+        }
+
+        // units of a torn erase have to be erased again before they are programmed
+        memset(&_written[(address + done) / _config.ProgramSize], torn ? 1 : 0, block / _config.ProgramSize);
+
+        _wear[index]++;
+        _stats.Erases++;
+
+        if (_wear[index] > _stats.MaxWear) {
+            _stats.MaxWear = _wear[index];
+        }
+
+        if (torn) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+uint32_t SimFlash::EraseSize() const {
+    return _config.EraseSize;
+}
+
+uint32_t SimFlash::ProgramSize() const {
+    return _config.ProgramSize;
+}
+
+bool SimFlash::Reprogrammable() const {
+    return _config.Reprogrammable;
+}
+
+void SimFlash::CutPowerAfter(uint32_t steps) {
+    _armed = true;
+    _steps = steps;
+}
+
+void SimFlash::RestorePower() {
+    _armed = false;
+    _lost = false;
+}
+
+bool SimFlash::PowerLost() const {
+    return _lost;
+}
+
+uint32_t SimFlash::Wear(uint32_t address) const {
+    uint32_t index = address / _config.EraseSize;
+    return index < _wear.size() ? _wear[index] : 0;
+}
+
+const SimFlashStats& SimFlash::GetStats() const {
+    return _stats;
+}
+
+bool SimFlash::Step() {
+    if (!_armed) {
+        return true;
+    }
+
+    if (_steps == 0) {
+        _lost = true;
+        return false;
+    }
+
+    _steps--;
+    return true;
+}
@@ -0,0 +1,95 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFlash NvmDevice in host memory that loses power on request
+ *
+ * @details Programs and erases are counted in steps of one program unit or one erase block.
+ *          After the number of steps given to CutPowerAfter() the step in progress is left
+ *          torn, a program with a random part of its bits cleared and an erase with a random
+ *          part set, and every later program and erase fails until RestorePower().  Programs
+ *          that would set bits, or program a unit twice on flash that is not reprogrammable,
+ *          are counted as violations.  Erases are counted per block for wear.
+ *
+ */
+
+#ifndef __LORA_SIM_FLASH_H__
+#define __LORA_SIM_FLASH_H__
+
+#include "NvmDevice.h"
+#include <random>
+#include <vector>
+
+namespace lora {
+
+    struct SimFlashConfig {
+        SimFlashConfig();
+
+        uint32_t Size;                      //!< bytes
+        uint32_t EraseSize;
+        uint32_t ProgramSize;
+        bool Reprogrammable;
+        uint32_t Seed;                      //!< of the torn bits
+    };
+
+    struct SimFlashStats {
+        uint32_t Programs;                  //!< program units written
+        uint32_t Bytes;                     //!< bytes programmed
+        uint32_t Erases;                    //!< blocks erased
+        uint32_t MaxWear;                   //!< most erases of one block
+        uint32_t Violations;
+    };
+
+    class SimFlash : public NvmDevice {
+        public:
+            SimFlash(const SimFlashConfig& config = SimFlashConfig());
+
+            virtual int32_t Read(uint32_t address, uint8_t* data, uint32_t size);
+            virtual int32_t Program(uint32_t address, const uint8_t* data, uint32_t size);
+            virtual int32_t Erase(uint32_t address, uint32_t size);
+            virtual uint32_t EraseSize() const;
+            virtual uint32_t ProgramSize() const;
+            virtual bool Reprogrammable() const;
+
+            /**
+             * Lose power during the step after the given number of steps
+             */
+            void CutPowerAfter(uint32_t steps);
+
+            void RestorePower();
+
+            /**
+             * @return true once a step was torn
+             */
+            bool PowerLost() const;
+
+            /**
+             * @return erases of the block holding address
+             */
+            uint32_t Wear(uint32_t address) const;
+
+            const SimFlashStats& GetStats() const;
+
+        private:
+            /**
+             * @return false if the power went during this step
+             */
+            bool Step();
+
+            SimFlashConfig _config;
+            std::vector<uint8_t> _memory;
+            std::vector<uint8_t> _written;      //!< per program unit, programmed since its erase
+            std::vector<uint32_t> _wear;        //!< per erase block
+            std::mt19937 _random;
+            bool _armed;
+            bool _lost;
+            uint32_t _steps;                    //!< left before the cut
+            SimFlashStats _stats;
+    };
+
+}
+
+#endif
@@ -0,0 +1,663 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFleet parallel discrete-event simulation of a device fleet and gateway
+ *
+ */
+
+#include "SimFleet.h"
+#include "SimMedium.h"
+#include "SimRadio.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+using namespace lora;
+
+static const uint8_t ADR_HISTORY = 20;
+static const uint8_t LINK_ADR_REQ_SIZE = 5;
+
+SimFleetConfig::SimFleetConfig()
+:   Region(SimRegion::US915()),
+    Devices(1000),
+    Duration(24ULL * 3600 * 1000000),
+    UplinkPeriod(600ULL * 1000000),
+    PayloadSize(10),
+    Datarate(DR_0),
+    Adr(true),
+    Radius(3000.0),
+    ReferenceLoss(32.0),
+    PathLossExponent(3.5),
+    Fading(3.0),
+    CaptureThreshold(6.0),
+    NoiseFigure(6.0),
+    AdrMargin(10.0),
+    DownlinkLoss(0.0),
+    SettleTime(6ULL * 3600 * 1000000),
+    Threads(0),
+    Seed(1)
+{
+}
+
+double SimFleetReport::Pdr() const {
+    return Uplinks == 0 ? 0.0 : (double) Delivered / Uplinks;
+}
+
+double SimFleetReport::CollisionRate() const {
+    return Uplinks == 0 ? 0.0 : (double) Collisions / Uplinks;
+}
+
+void SimFleetReport::Log() const {
+    logInfo("fleet: %lu devices %.1f h in %.1f s on %u threads, %llu windows",
+            (unsigned long) Devices, Duration / 3.6e9, WallTime, Threads, (unsigned long long) Windows);
+    logInfo("uplinks: %llu pdr %.2f%% collisions %.2f%% below sensitivity %llu gateway busy %llu",
+            (unsigned long long) Uplinks, Pdr() * 100.0, CollisionRate() * 100.0,
+            (unsigned long long) BelowSensitivity, (unsigned long long) GatewayBusy);
+    logInfo("downlinks: %llu lost %llu link adr %llu",
+            (unsigned long long) Downlinks, (unsigned long long) DownlinksLost, (unsigned long long) AdrCommands);
+
+    for (size_t i = 0; i < Bands.size(); i++) {
+        // without a duty cycle the fractions are of the whole time
+        logInfo("band %lu-%lu duty 1/%u: airtime %.1f s mean %.2f%% max %.2f%% deferred %lu",
+                (unsigned long) Bands[i].FrequencyMin, (unsigned long) Bands[i].FrequencyMax, Bands[i].DutyCycle > 0 ? Bands[i].DutyCycle : 1,
+                Bands[i].Airtime / 1e6, Bands[i].Mean * 100.0, Bands[i].Max * 100.0, (unsigned long) Bands[i].Deferred);
+    }
+
+    for (size_t i = 0; i < Datarates.size(); i++) {
+        if (Datarates[i] > 0) {
+            logInfo("DR%lu: %lu devices", (unsigned long) i, (unsigned long) Datarates[i]);
+        }
+    }
+
+    logInfo("adr: %lu converged, last change median %.1f h 90%% %.1f h",
+            (unsigned long) Converged, ConvergenceMedian / 3.6e9, Convergence90 / 3.6e9);
+}
+
+void SimFleet::Device::Wake() {
+    Fleet->Send(*this);
+}
+
+SimFleet::SimFleet(const SimFleetConfig& config)
+:   _config(config),
+    _workers(config.Threads),
+    _random(config.Seed),
+    _window(DEFAULT_RX_DELAY * 1000ULL),
+    _downlinks(0),
+    _downlinksLost(0),
+    _adrCommands(0)
+{
+    const SimRegion& region = _config.Region;
+    size_t bands = region.Bands.size();
+    size_t shards = std::max<size_t>(1, std::min<size_t>(_config.Devices, _workers.Threads() * 4));
+
+    if (_config.Datarate < region.MinDatarate || _config.Datarate > region.MaxDatarate) {
+        logWarning("Datarate %d outside region, using DR%d", _config.Datarate, region.MinDatarate);
+        _config.Datarate = region.MinDatarate;
+    }
+
+    _shards.resize(shards);
+    for (size_t i = 0; i < shards; i++) {
+        _shards[i].Sent.resize(region.Channels.size());
+        _shards[i].Deferred.assign(bands, 0);
+        _shards[i].Uplinks = 0;
+    }
+
+    _channels.resize(region.Channels.size());
+    for (size_t i = 0; i < _channels.size(); i++) {
+        _channels[i].Delivered = 0;
+        _channels[i].Collisions = 0;
+        _channels[i].BelowSensitivity = 0;
+        _channels[i].GatewayBusy = 0;
+        _channelBand.push_back(region.FindBand(region.Channels[i].Frequency));
+    }
+
+    // devices are scheduled by address, the vector is not resized after this
+    _devices.resize(_config.Devices);
+    _sessions.resize(_config.Devices);
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    for (uint32_t i = 0; i < _config.Devices; i++) {
+        Device& device = _devices[i];
+        std::seed_seq seed = { _config.Seed, i };
+
+        device.Fleet = this;
+        device.Owner = &_shards[i % shards];
+        device.Id = i;
+        device.Random.seed(seed);
+
+        // even density over the disc
+        double distance = std::max(1.0, _config.Radius * sqrt(unit(device.Random)));
+        device.PathLoss = _config.ReferenceLoss + 10.0 * _config.PathLossExponent * log10(distance);
+
+        device.Datarate = _config.Datarate;
+        device.PowerIndex = 0;
+        device.AdrAckCounter = 0;
+        device.LastAdrChange = 0;
+        device.TimeOff.assign(bands, 0);
+        device.Airtime.assign(bands, 0);
+
+        Session& session = _sessions[i];
+        session.Count = 0;
+        session.Head = 0;
+        session.Datarate = device.Datarate;
+        session.PowerIndex = 0;
+
+        uint64_t first = (uint64_t) (unit(device.Random) * _config.UplinkPeriod);
+        device.Owner->Clock.At(first, callback(&device, &Device::Wake));
+    }
+
+    _report.Windows = 0;
+    _report.WallTime = 0.0;
+    Report();
+}
+
+SimFleet::~SimFleet() {
+}
+
+double SimFleet::NoiseFloor(uint32_t bandwidth) const {
+    return -174.0 + 10.0 * log10((double) bandwidth) + _config.NoiseFigure;
+}
+
+double SimFleet::Sensitivity(uint8_t datarate) const {
+    const SimRegion::Datarate& dr = _config.Region.Datarates[datarate];
+    return NoiseFloor(dr.Bandwidth) + SimMedium::DemodulationFloor(dr.SpreadingFactor);
+}
+
+uint64_t SimFleet::Airtime(const SimRegion::Datarate& dr, uint8_t size) const {
+    return SimRadio::LoRaAirtime(dr.SpreadingFactor, dr.Bandwidth, DEFAULT_CODE_RATE, DEFAULT_PREAMBLE_LEN, false, true, size);
+}
+
+void SimFleet::Receive(Device& device, uint64_t now) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < device.Inbox.size(); i++) {
+        const Downlink& dl = device.Inbox[i];
+
+        if (dl.At > now) {
+            device.Inbox[kept++] = dl;
+            continue;
+        }
+
+        device.AdrAckCounter = 0;
+
+        if (dl.Adr && (dl.Datarate != device.Datarate || dl.PowerIndex != device.PowerIndex)) {
+            device.Datarate = dl.Datarate;
+            device.PowerIndex = dl.PowerIndex;
+            device.LastAdrChange = dl.At;
+        }
+    }
+
+    device.Inbox.resize(kept);
+}
+
+void SimFleet::Backoff(Device& device, uint64_t now) {
+    if (!_config.Adr) {
+        return;
+    }
+
+    // no downlink for ADR_ACK_DELAY uplinks after asking, first restore power then step the datarate down
+    if (device.AdrAckCounter >= DEFAULT_ADR_ACK_LIMIT + DEFAULT_ADR_ACK_DELAY
+            && (device.AdrAckCounter - DEFAULT_ADR_ACK_LIMIT) % DEFAULT_ADR_ACK_DELAY == 0) {
+        if (device.PowerIndex > 0) {
+            device.PowerIndex = 0;
+        } else if (device.Datarate > _config.Region.MinDatarate) {
+            device.Datarate--;
+        } else {
+            return;
+        }
+
+        device.LastAdrChange = now;
+    }
+}
+
+void SimFleet::Send(Device& device) {
+    Shard& shard = *device.Owner;
+    const SimRegion& region = _config.Region;
+    uint64_t now = shard.Clock.Now();
+
+    Receive(device, now);
+
+    uint64_t retry = UINT64_MAX;
+    uint32_t blocked = 0;
+    size_t available = 0;
+
+    for (size_t i = 0; i < region.Channels.size(); i++) {
+        const SimRegion::Channel& chan = region.Channels[i];
+
+        if (device.Datarate < chan.MinDatarate || device.Datarate > chan.MaxDatarate) {
+            continue;
+        }
+
+        int band = _channelBand[i];
+        if (band >= 0 && device.TimeOff[band] > now) {
+            retry = std::min(retry, device.TimeOff[band]);
+            blocked |= 1UL << band;
+        } else {
+            available++;
+        }
+    }
+
+    if (available == 0) {
+        if (retry == UINT64_MAX) {
+            // nothing to schedule, stops the device
+            return;
+        }
+
+        for (size_t b = 0; b < shard.Deferred.size(); b++) {
+            if (blocked & (1UL << b)) {
+                shard.Deferred[b]++;
+            }
+        }
+
+        shard.Clock.At(retry, callback(&device, &Device::Wake));
+        return;
+    }
+
+    size_t pick = device.Random() % available;
+    size_t index = 0;
+
+    for (size_t i = 0; i < region.Channels.size(); i++) {
+        const SimRegion::Channel& chan = region.Channels[i];
+        int band = _channelBand[i];
+
+        if (device.Datarate < chan.MinDatarate || device.Datarate > chan.MaxDatarate || (band >= 0 && device.TimeOff[band] > now)) {
+            continue;
+        }
+
+        if (pick-- == 0) {
+            index = i;
+            break;
+        }
+    }
+
+    const SimRegion::Datarate& dr = region.Datarates[device.Datarate];
+    uint64_t airtime = Airtime(dr, _config.PayloadSize + FRAME_OVERHEAD);
+
+    Uplink frame;
+    frame.Device = device.Id;
+    frame.Frequency = region.Channels[index].Frequency;
+    frame.Datarate = device.Datarate;
+    frame.SpreadingFactor = dr.SpreadingFactor;
+    frame.Bandwidth = dr.Bandwidth;
+    frame.Start = now;
+    frame.End = now + airtime;
+    frame.Rssi = region.Power(device.PowerIndex) - device.PathLoss;
+    frame.AdrAckReq = false;
+    frame.Resolved = false;
+
+    if (_config.Adr) {
+        device.AdrAckCounter++;
+        frame.AdrAckReq = device.AdrAckCounter >= DEFAULT_ADR_ACK_LIMIT;
+    }
+
+    if (_config.Fading > 0.0) {
+        std::normal_distribution<double> fading(0.0, _config.Fading);
+        frame.Rssi += fading(device.Random);
+    }
+
+    shard.Sent[index].push_back(frame);
+    shard.Uplinks++;
+
+    int band = _channelBand[index];
+    if (band >= 0) {
+        device.Airtime[band] += airtime;
+
+        if (region.Bands[band].DutyCycle > 0) {
+            device.TimeOff[band] = now + airtime * region.Bands[band].DutyCycle;
+        }
+    }
+
+    // applies from the next uplink, a deferred uplink is not counted twice
+    Backoff(device, now);
+
+    // +/- 10% jitter, a class A device cannot send again before RX2 is over
+    std::uniform_real_distribution<double> jitter(0.9, 1.1);
+    uint64_t next = now + (uint64_t) (_config.UplinkPeriod * jitter(device.Random));
+    next = std::max<uint64_t>(next, frame.End + (DEFAULT_RX_DELAY + RX2_DELAY_OFFSET) * 1000ULL + 1);
+
+    shard.Clock.At(next, callback(&device, &Device::Wake));
+}
+
+bool SimFleet::GatewaySending(uint64_t start, uint64_t end) const {
+    // downlinks never overlap each other so both start and end are ordered
+    size_t lo = 0;
+    size_t hi = _gatewayTx.size();
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (_gatewayTx[mid].End <= start) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo < _gatewayTx.size() && _gatewayTx[lo].Start < end;
+}
+
+void SimFleet::Resolve(size_t index, uint64_t until) {
+    Channel& channel = _channels[index];
+    size_t first = channel.Frames.size();
+
+    for (size_t i = 0; i < _shards.size(); i++) {
+        std::vector<Uplink>& sent = _shards[i].Sent[index];
+        channel.Frames.insert(channel.Frames.end(), sent.begin(), sent.end());
+        sent.clear();
+    }
+
+    // frames of earlier windows all started before these
+    std::sort(channel.Frames.begin() + first, channel.Frames.end(), [](const Uplink& a, const Uplink& b) {
+        return a.Start < b.Start || (a.Start == b.Start && a.Device < b.Device);
+    });
+
+    for (size_t i = 0; i < channel.Frames.size(); i++) {
+        Uplink& frame = channel.Frames[i];
+
+        if (frame.Resolved || frame.End > until) {
+            continue;
+        }
+
+        frame.Resolved = true;
+
+        double snr = frame.Rssi - NoiseFloor(frame.Bandwidth);
+
+        if (snr < SimMedium::DemodulationFloor(frame.SpreadingFactor)) {
+            channel.BelowSensitivity++;
+            continue;
+        }
+
+        if (GatewaySending(frame.Start, frame.End)) {
+            channel.GatewayBusy++;
+            continue;
+        }
+
+        bool lost = false;
+
+        for (size_t j = 0; j < channel.Frames.size() && channel.Frames[j].Start < frame.End; j++) {
+            const Uplink& other = channel.Frames[j];
+
+            if (j != i && other.End > frame.Start && other.SpreadingFactor == frame.SpreadingFactor
+                    && frame.Rssi - other.Rssi < _config.CaptureThreshold) {
+                lost = true;
+                break;
+            }
+        }
+
+        if (lost) {
+            channel.Collisions++;
+            continue;
+        }
+
+        channel.Delivered++;
+
+        Received heard;
+        heard.Device = frame.Device;
+        heard.Datarate = frame.Datarate;
+        heard.End = frame.End;
+        heard.Snr = snr;
+        heard.AdrAckReq = frame.AdrAckReq;
+        channel.Heard.push_back(heard);
+    }
+
+    // drop resolved frames that cannot overlap one still to be resolved
+    uint64_t oldest = until;
+    for (size_t i = 0; i < channel.Frames.size(); i++) {
+        if (!channel.Frames[i].Resolved) {
+            oldest = channel.Frames[i].Start;
+            break;
+        }
+    }
+
+    size_t drop = 0;
+    while (drop < channel.Frames.size() && channel.Frames[drop].Resolved && channel.Frames[drop].End <= oldest) {
+        drop++;
+    }
+
+    channel.Frames.erase(channel.Frames.begin(), channel.Frames.begin() + drop);
+}
+
+bool SimFleet::Adr(Session& session, const Received& frame, uint8_t& datarate, uint8_t& powerIndex) {
+    const SimRegion& region = _config.Region;
+
+    if (session.Count < ADR_HISTORY) {
+        return false;
+    }
+
+    double best = session.Snr[0];
+    for (uint8_t i = 1; i < ADR_HISTORY; i++) {
+        best = std::max(best, session.Snr[i]);
+    }
+
+    // strongest recent uplink at the current power, the datarate is raised as far as the margin allows
+    double rssi = best + NoiseFloor(region.Datarates[frame.Datarate].Bandwidth);
+
+    datarate = frame.Datarate;
+    powerIndex = session.PowerIndex;
+
+    while (datarate < region.MaxDatarate && rssi - Sensitivity(datarate + 1) >= _config.AdrMargin) {
+        datarate++;
+    }
+
+    // remaining margin in 3 dB steps lowers the power, a negative margin raises it
+    int steps = (int) floor((rssi - Sensitivity(datarate) - _config.AdrMargin) / 3.0);
+
+    while (steps > 0 && powerIndex < region.MaxPowerIndex) {
+        powerIndex++;
+        steps--;
+    }
+
+    while (steps < 0 && powerIndex > 0) {
+        powerIndex--;
+        steps++;
+    }
+
+    return datarate != frame.Datarate || powerIndex != session.PowerIndex;
+}
+
+void SimFleet::Serve(uint64_t until) {
+    const SimRegion& region = _config.Region;
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    _received.clear();
+
+    for (size_t i = 0; i < _channels.size(); i++) {
+        _received.insert(_received.end(), _channels[i].Heard.begin(), _channels[i].Heard.end());
+        _channels[i].Heard.clear();
+    }
+
+    std::sort(_received.begin(), _received.end(), [](const Received& a, const Received& b) {
+        return a.End < b.End || (a.End == b.End && a.Device < b.Device);
+    });
+
+    for (size_t i = 0; i < _received.size(); i++) {
+        const Received& frame = _received[i];
+        Session& session = _sessions[frame.Device];
+
+        if (frame.Datarate != session.Datarate) {
+            // the device backed off or missed a LinkADRReq, history at the old datarate no longer applies
+            session.Datarate = frame.Datarate;
+            session.PowerIndex = 0;
+            session.Count = 0;
+            session.Head = 0;
+        }
+
+        session.Snr[session.Head] = frame.Snr;
+        session.Head = (session.Head + 1) % ADR_HISTORY;
+        if (session.Count < ADR_HISTORY) {
+            session.Count++;
+        }
+
+        uint8_t datarate = frame.Datarate;
+        uint8_t powerIndex = session.PowerIndex;
+        bool adr = _config.Adr && Adr(session, frame, datarate, powerIndex);
+
+        if (!adr && !frame.AdrAckReq) {
+            continue;
+        }
+
+        uint64_t start = frame.End + _window;
+        uint64_t end = start + Airtime(region.Rx1[frame.Datarate], FRAME_OVERHEAD + (adr ? LINK_ADR_REQ_SIZE : 0));
+
+        if (GatewaySending(start, end)) {
+            // the gateway already answers another device in that RX1
+            _downlinksLost++;
+            continue;
+        }
+
+        Interval tx;
+        tx.Start = start;
+        tx.End = end;
+        _gatewayTx.push_back(tx);
+        _downlinks++;
+
+        if (adr) {
+            _adrCommands++;
+            session.Datarate = datarate;
+            session.PowerIndex = powerIndex;
+            session.Count = 0;
+            session.Head = 0;
+        }
+
+        if (_config.DownlinkLoss > 0.0 && unit(_random) < _config.DownlinkLoss) {
+            _downlinksLost++;
+            continue;
+        }
+
+        Downlink dl;
+        dl.At = start;
+        dl.Adr = adr;
+        dl.Datarate = datarate;
+        dl.PowerIndex = powerIndex;
+        _devices[frame.Device].Inbox.push_back(dl);
+    }
+
+    // downlinks ending before the oldest frame still to be resolved are no longer needed
+    uint64_t oldest = until;
+    for (size_t i = 0; i < _channels.size(); i++) {
+        const std::vector<Uplink>& frames = _channels[i].Frames;
+        for (size_t j = 0; j < frames.size(); j++) {
+            if (!frames[j].Resolved) {
+                oldest = std::min(oldest, frames[j].Start);
+                break;
+            }
+        }
+    }
+
+    size_t drop = 0;
+    while (drop < _gatewayTx.size() && _gatewayTx[drop].End <= oldest) {
+        drop++;
+    }
+
+    _gatewayTx.erase(_gatewayTx.begin(), _gatewayTx.begin() + drop);
+}
+
+const SimFleetReport& SimFleet::Run() {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    for (uint64_t start = 0; start < _config.Duration; start += _window) {
+        uint64_t until = std::min(start + _window, _config.Duration);
+
+        _workers.Run(_shards.size(), [this, until](size_t i) {
+            _shards[i].Clock.RunUntil(until - 1);
+        });
+
+        _workers.Run(_channels.size(), [this, until](size_t i) {
+            Resolve(i, until);
+        });
+
+        Serve(until);
+        _report.Windows++;
+    }
+
+    // frames still on the air at the end are resolved against what was sent
+    _workers.Run(_channels.size(), [this](size_t i) {
+        Resolve(i, UINT64_MAX);
+    });
+
+    _report.WallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    Report();
+
+    return _report;
+}
+
+const SimFleetReport& SimFleet::GetReport() const {
+    return _report;
+}
+
+void SimFleet::Report() {
+    const SimRegion& region = _config.Region;
+
+    _report.Devices = _config.Devices;
+    _report.Duration = _config.Duration;
+    _report.Threads = _workers.Threads();
+    _report.Uplinks = 0;
+    _report.Delivered = 0;
+    _report.Collisions = 0;
+    _report.BelowSensitivity = 0;
+    _report.GatewayBusy = 0;
+    _report.Downlinks = _downlinks;
+    _report.DownlinksLost = _downlinksLost;
+    _report.AdrCommands = _adrCommands;
+
+    for (size_t i = 0; i < _shards.size(); i++) {
+        _report.Uplinks += _shards[i].Uplinks;
+    }
+
+    for (size_t i = 0; i < _channels.size(); i++) {
+        _report.Delivered += _channels[i].Delivered;
+        _report.Collisions += _channels[i].Collisions;
+        _report.BelowSensitivity += _channels[i].BelowSensitivity;
+        _report.GatewayBusy += _channels[i].GatewayBusy;
+    }
+
+    _report.Bands.clear();
+
+    for (size_t b = 0; b < region.Bands.size(); b++) {
+        SimFleetReport::Band band;
+        // fraction of the time a device may send, all of it without a duty cycle
+        double allowed = region.Bands[b].DutyCycle > 0 ? 1.0 / region.Bands[b].DutyCycle : 1.0;
+
+        band.FrequencyMin = region.Bands[b].FrequencyMin;
+        band.FrequencyMax = region.Bands[b].FrequencyMax;
+        band.DutyCycle = region.Bands[b].DutyCycle;
+        band.Airtime = 0;
+        band.Max = 0.0;
+        band.Deferred = 0;
+
+        for (size_t i = 0; i < _devices.size(); i++) {
+            band.Airtime += _devices[i].Airtime[b];
+            band.Max = std::max(band.Max, _devices[i].Airtime[b] / (_config.Duration * allowed));
+        }
+
+        for (size_t i = 0; i < _shards.size(); i++) {
+            band.Deferred += _shards[i].Deferred[b];
+        }
+
+        band.Mean = _devices.empty() ? 0.0 : band.Airtime / (_config.Duration * allowed * _devices.size());
+        _report.Bands.push_back(band);
+    }
+
+    _report.Datarates.assign(region.Datarates.size(), 0);
+
+    std::vector<uint64_t> settled;
+
+    for (size_t i = 0; i < _devices.size(); i++) {
+        const Device& device = _devices[i];
+        _report.Datarates[device.Datarate]++;
+
+        if (device.LastAdrChange + _config.SettleTime <= _config.Duration) {
+            settled.push_back(device.LastAdrChange);
+        }
+    }
+
+    std::sort(settled.begin(), settled.end());
+
+    _report.Converged = settled.size();
+    _report.ConvergenceMedian = settled.empty() ? 0 : settled[settled.size() / 2];
+    _report.Convergence90 = settled.empty() ? 0 : settled[settled.size() * 9 / 10];
+}
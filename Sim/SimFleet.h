@@ -0,0 +1,240 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFleet parallel discrete-event simulation of a device fleet and gateway
+ *
+ * @details Thousands of class A devices send periodic uplinks to one gateway and a
+ *          network server running the LoRaWAN ADR algorithm.  Each device keeps the
+ *          state the MAC keeps for the uplink path: datarate, power index, ADR ACK counter
+ *          and the time off of each duty cycle band.
+ *
+ *          Devices only affect each other through the gateway, and a downlink cannot
+ *          reach a device earlier than the RX1 delay after the uplink that caused it.  The
+ *          run advances in windows of that length, each in three phases:
+ *          - devices are split into shards with their own SimClock, the shards run their
+ *            uplinks up to the end of the window in parallel
+ *          - every channel resolves reception of the frames that ended in the window in
+ *            parallel, all frames overlapping them have been sent by then
+ *          - the network server answers the received frames, the downlinks land in device
+ *            inboxes after the end of the window
+ *          Devices, channels and the server each draw from their own random generator, so
+ *          a run gives the same report for any number of threads.
+ *
+ */
+
+#ifndef __LORA_SIM_FLEET_H__
+#define __LORA_SIM_FLEET_H__
+
+#include "SimClock.h"
+#include "SimRegion.h"
+#include "SimWorkers.h"
+#include <random>
+#include <vector>
+
+namespace lora {
+
+    /**
+     * Parameters of a fleet run
+     */
+    struct SimFleetConfig {
+        SimFleetConfig();
+
+        SimRegion Region;
+        uint32_t Devices;
+        uint64_t Duration;              //!< us of virtual time
+        uint64_t UplinkPeriod;          //!< us between uplinks of a device, +/- 10% jitter
+        uint8_t PayloadSize;            //!< application bytes, FRAME_OVERHEAD is added
+        uint8_t Datarate;               //!< datarate after join
+        bool Adr;
+        double Radius;                  //!< m, devices are spread evenly over a disc around the gateway
+        double ReferenceLoss;           //!< dB of path loss at 1 m
+        double PathLossExponent;
+        double Fading;                  //!< dB standard deviation per frame
+        double CaptureThreshold;        //!< dB a frame must exceed each same SF interferer by
+        double NoiseFigure;             //!< dB of the gateway receiver
+        double AdrMargin;               //!< dB of SNR the network server leaves above the demodulation floor
+        double DownlinkLoss;            //!< probability a downlink is not received
+        uint64_t SettleTime;            //!< us at the end of the run without an ADR change for a device to count as converged
+        unsigned Threads;               //!< 0 for one per core
+        uint32_t Seed;
+    };
+
+    /**
+     * Results of a fleet run
+     */
+    struct SimFleetReport {
+        /**
+         * Airtime of a duty cycle band
+         */
+        struct Band {
+            uint32_t FrequencyMin;
+            uint32_t FrequencyMax;
+            uint16_t DutyCycle;
+            uint64_t Airtime;           //!< us summed over devices
+            double Mean;                //!< mean fraction of the allowed airtime a device used
+            double Max;                 //!< highest fraction of the allowed airtime a device used
+            uint32_t Deferred;          //!< uplinks delayed because the band was off
+        };
+
+        uint32_t Devices;
+        uint64_t Duration;
+        uint64_t Uplinks;
+        uint64_t Delivered;
+        uint64_t Collisions;
+        uint64_t BelowSensitivity;
+        uint64_t GatewayBusy;           //!< lost because the gateway was sending a downlink
+        uint64_t Downlinks;
+        uint64_t DownlinksLost;
+        uint64_t AdrCommands;           //!< LinkADRReq sent
+        std::vector<Band> Bands;
+        std::vector<uint32_t> Datarates; //!< devices at each datarate at the end of the run
+        uint32_t Converged;             //!< devices without an ADR change during the settle time
+        uint64_t ConvergenceMedian;     //!< us to the last ADR change of converged devices
+        uint64_t Convergence90;         //!< 90th percentile of the same
+        uint64_t Windows;
+        unsigned Threads;
+        double WallTime;                //!< seconds
+
+        /**
+         * Packet delivery ratio
+         * @return fraction of uplinks received by the gateway
+         */
+        double Pdr() const;
+
+        /**
+         * @return fraction of uplinks lost to a collision
+         */
+        double CollisionRate() const;
+
+        /**
+         * Write the report with logInfo
+         */
+        void Log() const;
+    };
+
+    class SimFleet {
+        public:
+            SimFleet(const SimFleetConfig& config);
+            ~SimFleet();
+
+            /**
+             * Simulate the whole duration
+             * @return report of the run
+             */
+            const SimFleetReport& Run();
+
+            const SimFleetReport& GetReport() const;
+
+        private:
+            struct Shard;
+
+            struct Downlink {
+                uint64_t At;            //!< us, RX1 of the uplink it answers
+                bool Adr;               //!< carries a LinkADRReq
+                uint8_t Datarate;
+                uint8_t PowerIndex;
+            };
+
+            struct Device {
+                SimFleet* Fleet;
+                Shard* Owner;
+                uint32_t Id;
+                std::mt19937 Random;
+                double PathLoss;
+                uint8_t Datarate;
+                uint8_t PowerIndex;
+                uint32_t AdrAckCounter;
+                uint64_t LastAdrChange;
+                std::vector<uint64_t> TimeOff;      //!< end of time off per band
+                std::vector<uint64_t> Airtime;      //!< us per band
+                std::vector<Downlink> Inbox;
+
+                void Wake();
+            };
+
+            struct Uplink {
+                uint32_t Device;
+                uint32_t Frequency;
+                uint8_t Datarate;
+                uint8_t SpreadingFactor;
+                uint32_t Bandwidth;
+                uint64_t Start;
+                uint64_t End;
+                double Rssi;
+                bool AdrAckReq;
+                bool Resolved;
+            };
+
+            struct Received {
+                uint32_t Device;
+                uint8_t Datarate;
+                uint64_t End;
+                double Snr;
+                bool AdrAckReq;
+            };
+
+            struct Shard {
+                SimClock Clock;
+                std::vector<std::vector<Uplink> > Sent;     //!< per channel, frames sent this window
+                std::vector<uint32_t> Deferred;             //!< per band
+                uint64_t Uplinks;
+            };
+
+            struct Channel {
+                std::vector<Uplink> Frames;     //!< ordered by start, unresolved or overlapping an unresolved frame
+                std::vector<Received> Heard;    //!< frames received this window
+                uint64_t Delivered;
+                uint64_t Collisions;
+                uint64_t BelowSensitivity;
+                uint64_t GatewayBusy;
+            };
+
+            struct Session {
+                double Snr[20];         //!< history of the last uplinks for ADR
+                uint8_t Count;
+                uint8_t Head;
+                uint8_t Datarate;       //!< last datarate heard
+                uint8_t PowerIndex;     //!< last power index commanded
+            };
+
+            struct Interval {
+                uint64_t Start;
+                uint64_t End;
+            };
+
+            void Send(Device& device);
+            void Receive(Device& device, uint64_t now);
+            void Backoff(Device& device, uint64_t now);
+            void Resolve(size_t index, uint64_t until);
+            void Serve(uint64_t until);
+            bool Adr(Session& session, const Received& frame, uint8_t& datarate, uint8_t& powerIndex);
+            bool GatewaySending(uint64_t start, uint64_t end) const;
+            double NoiseFloor(uint32_t bandwidth) const;
+            double Sensitivity(uint8_t datarate) const;
+            uint64_t Airtime(const SimRegion::Datarate& dr, uint8_t size) const;
+            void Report();
+
+            SimFleetConfig _config;
+            SimWorkers _workers;
+            std::vector<Device> _devices;
+            std::vector<Shard> _shards;
+            std::vector<Channel> _channels;
+            std::vector<int> _channelBand;      //!< duty cycle band of each channel
+            std::vector<Session> _sessions;
+            std::vector<Interval> _gatewayTx;   //!< downlinks ordered by start
+            std::vector<Received> _received;
+            std::mt19937 _random;
+            uint64_t _window;                   //!< us, RX1 delay
+            uint64_t _downlinks;
+            uint64_t _downlinksLost;
+            uint64_t _adrCommands;
+            SimFleetReport _report;
+    };
+
+}
+
+#endif
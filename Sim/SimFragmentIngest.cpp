@@ -0,0 +1,189 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFragmentIngest checks of the FOTA FragmentIngestQueue
+ *
+ */
+
+#include "SimFragmentIngest.h"
+#include "FragmentIngestQueue.h"
+#include "Fota.h"
+#include "MTSLog.h"
+#include <atomic>
+#include <thread>
+
+using namespace lora;
+
+namespace {
+
+    const uint8_t DATA_FRAGMENT = 0x08;
+    const uint8_t FRAG_SESSION_STATUS_REQ = 0x01;
+    const uint8_t MIN_SIZE = 7;             //!< command, IndexAndN and the sequence number
+
+    /**
+     * Message seq of the stream, a fragment or a control command on one of the three ports
+     */
+    ApplicationPayload Message(uint32_t seq, uint8_t& port, uint8_t size = 0) {
+        ApplicationPayload payload;
+
+        port = APP_PORT_MULTICAST + seq % 3;
+        size = size != 0 ? size : MIN_SIZE + seq % (APP_MAX_PAYLOAD_SIZE - MIN_SIZE + 1);
+
+        payload.appendU8(port == APP_PORT_FRAGMENTATION && seq % 2 == 0 ? DATA_FRAGMENT : FRAG_SESSION_STATUS_REQ);
+        payload.appendU16(1);               // fragment 1 of session 0
+        payload.appendU32(seq);
+
+        while (payload.size() < size) {
+            payload.appendU8(seq + payload.size());
+        }
+
+        return payload;
+    }
+
+    /**
+     * Compares what Fota is handed against the stream from seq 0
+     */
+    class Receiver {
+        public:
+            Receiver(uint8_t size = 0) : Count(0), Ok(true), _size(size) {
+                Fota::getInstance()->Received = callback(this, &Receiver::Received);
+            }
+
+            ~Receiver() {
+                Fota::getInstance()->Received = Callback<void(uint8_t*, uint8_t, uint8_t)>();
+            }
+
+            void Received(uint8_t* payload, uint8_t port, uint8_t size) {
+                uint8_t expected_port;
+                ApplicationPayload expected = Message(Count++, expected_port, _size);
+
+                Ok = Ok && port == expected_port && size == expected.size() && memcmp(payload, expected.data(), size) == 0;
+            }
+
+            uint32_t Count;
+            bool Ok;
+
+        private:
+            uint8_t _size;
+    };
+
+}
+
+SimFragmentIngestConfig::SimFragmentIngestConfig()
+:   Messages(20000)
+{
+}
+
+bool SimFragmentIngestReport::Passed() const {
+    return Rejected && BackPressure && Drained && Ordered;
+}
+
+void SimFragmentIngestReport::Log() const {
+    logInfo("rejected %s, back pressure %s after %lu full size messages, drained %s",
+            Rejected ? "ok" : "FAILED", BackPressure ? "ok" : "FAILED", (unsigned long) Queued, Drained ? "ok" : "FAILED");
+    logInfo("threaded stream %s, %lu refusals retried, high water %lu",
+            Ordered ? "ok" : "FAILED", (unsigned long) Dropped, (unsigned long) HighWater);
+}
+
+SimFragmentIngest::SimFragmentIngest(const SimFragmentIngestConfig& config)
+:   _config(config)
+{
+}
+
+SimFragmentIngestReport SimFragmentIngest::Run() {
+    SimFragmentIngestReport report;
+
+    {
+        FragmentIngestQueue queue;
+        uint8_t port;
+        ApplicationPayload fragment = Message(0, port);
+        ApplicationPayload empty_fragment = Message(0, port);
+        ApplicationPayload first_fragment = Message(0, port);
+
+        fragment[0] = DATA_FRAGMENT;
+        empty_fragment.resize(3);
+        empty_fragment[0] = DATA_FRAGMENT;
+        first_fragment[0] = DATA_FRAGMENT;
+        first_fragment[1] = 0x00;           // fragment 0 does not exist
+
+        bool refused = !queue.enqueue(fragment.data(), 2, fragment.size()) &&
+                       !queue.enqueue(fragment.data(), APP_PORT_FRAGMENTATION, 0) &&
+                       !queue.enqueue(empty_fragment.data(), APP_PORT_FRAGMENTATION, empty_fragment.size()) &&
+                       !queue.enqueue(first_fragment.data(), APP_PORT_FRAGMENTATION, first_fragment.size());
+
+        report.Rejected = refused && queue.rejected() == 4 && queue.pending() == 0 && queue.dropped() == 0;
+    }
+
+    CheckBackPressure(report);
+    CheckThreaded(report);
+
+    return report;
+}
+
+void SimFragmentIngest::CheckBackPressure(SimFragmentIngestReport& report) {
+    FragmentIngestQueue queue;
+    Receiver receiver(APP_MAX_PAYLOAD_SIZE);
+    uint8_t port;
+    ApplicationPayload payload;
+
+    report.Queued = 0;
+
+    // nothing drains, the RX side fills the ring until it refuses
+    for (;;) {
+        payload = Message(report.Queued, port, APP_MAX_PAYLOAD_SIZE);
+
+        if (!queue.enqueue(payload.data(), port, payload.size())) {
+            break;
+        }
+        report.Queued++;
+    }
+
+    report.BackPressure = report.Queued >= FRAG_INGEST_SLOTS && queue.dropped() == 1 && queue.rejected() == 0 &&
+                          queue.pending() == report.Queued && queue.highWater() == report.Queued;
+
+    uint16_t drained = queue.drain();
+
+    // the refused message is the next one of the stream once there is room again
+    bool room = queue.enqueue(payload.data(), port, payload.size()) && queue.drain() == 1;
+
+    report.Drained = drained == report.Queued && room && receiver.Ok && receiver.Count == report.Queued + 1 &&
+                     queue.pending() == 0;
+}
+
+void SimFragmentIngest::CheckThreaded(SimFragmentIngestReport& report) {
+    FragmentIngestQueue queue;
+    Receiver receiver;
+    uint32_t total = _config.Messages;
+    std::atomic<bool> sent(false);
+
+    std::thread rx([&queue, &sent, total]() {
+        for (uint32_t seq = 0; seq < total; seq++) {
+            uint8_t port;
+            ApplicationPayload payload = Message(seq, port);
+
+            // the MAC would lose the message, the stream retries so every one has to arrive
+            while (!queue.enqueue(payload.data(), port, payload.size())) {
+                std::this_thread::yield();
+            }
+        }
+
+        sent = true;
+    });
+
+    // drain as the worker would until the RX thread is through and the ring is empty
+    while (!sent || queue.pending() > 0) {
+        if (queue.drain() == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    rx.join();
+
+    report.Ordered = receiver.Ok && receiver.Count == total && queue.rejected() == 0;
+    report.Dropped = queue.dropped();
+    report.HighWater = queue.highWater();
+}
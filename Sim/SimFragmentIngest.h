@@ -0,0 +1,61 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimFragmentIngest checks of the FOTA FragmentIngestQueue
+ *
+ * @details The queue runs on the host with Sim/host/Fota.h standing in for Fota, which hands
+ *          each processed command back to the harness.  Messages with a bad port, size or
+ *          fragment header have to be refused, a ring full of full size messages has to
+ *          refuse and count the next one and give every queued one back in order once
+ *          drained.  Then an RX thread enqueues a stream of fragments and control commands
+ *          of every size, retrying when the ring is full, while the harness drains it as the
+ *          worker would, and every message has to arrive once, in order and unchanged.
+ *
+ */
+
+#ifndef __LORA_SIM_FRAGMENT_INGEST_H__
+#define __LORA_SIM_FRAGMENT_INGEST_H__
+
+#include <stdint.h>
+
+namespace lora {
+
+    struct SimFragmentIngestConfig {
+        SimFragmentIngestConfig();
+
+        uint32_t Messages;                  //!< streamed from the RX thread to the worker
+    };
+
+    struct SimFragmentIngestReport {
+        bool Rejected;                      //!< bad messages were refused and never queued
+        bool BackPressure;                  //!< a full ring refused and counted the next message
+        bool Drained;                       //!< the full ring came back in order and took more
+        bool Ordered;                       //!< the threaded stream arrived once, in order and unchanged
+        uint32_t Queued;                    //!< full size messages the ring took
+        uint32_t Dropped;                   //!< enqueue() refusals the RX thread retried
+        uint32_t HighWater;
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimFragmentIngest {
+        public:
+            SimFragmentIngest(const SimFragmentIngestConfig& config = SimFragmentIngestConfig());
+
+            SimFragmentIngestReport Run();
+
+        private:
+            void CheckBackPressure(SimFragmentIngestReport& report);
+            void CheckThreaded(SimFragmentIngestReport& report);
+
+            SimFragmentIngestConfig _config;
+    };
+
+}
+
+#endif
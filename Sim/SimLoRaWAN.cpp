@@ -0,0 +1,542 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimLoRaWAN LoRaWAN 1.0.x frame coding and security for host simulation
+ *
+ */
+
+#include "SimLoRaWAN.h"
+#include <algorithm>
+#include <string.h>
+
+using namespace lora;
+
+static const uint8_t SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static uint8_t INV_SBOX[256];
+
+static uint8_t Xtime(uint8_t x) {
+    return (uint8_t) ((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+static uint8_t Multiply(uint8_t x, uint8_t y) {
+    uint8_t r = 0;
+
+    while (y) {
+        if (y & 1) {
+            r ^= x;
+        }
+        x = Xtime(x);
+        y >>= 1;
+    }
+
+    return r;
+}
+
+static void ExpandKey(const uint8_t* key, uint8_t* rk) {
+    uint8_t rcon = 0x01;
+
+    memcpy(rk, key, 16);
+
+    for (int i = 16; i < 176; i += 4) {
+        uint8_t t[4] = { rk[i - 4], rk[i - 3], rk[i - 2], rk[i - 1] };
+
+        if (i % 16 == 0) {
+            uint8_t first = t[0];
+            t[0] = SBOX[t[1]] ^ rcon;
+            t[1] = SBOX[t[2]];
+            t[2] = SBOX[t[3]];
+            t[3] = SBOX[first];
+            rcon = Xtime(rcon);
+        }
+
+        for (int j = 0; j < 4; j++) {
+            rk[i + j] = rk[i - 16 + j] ^ t[j];
+        }
+    }
+}
+
+static void InitInverse() {
+    if (INV_SBOX[SBOX[1]] == 1) {
+        return;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        INV_SBOX[SBOX[i]] = (uint8_t) i;
+    }
+}
+
+void SimLoRaWAN::Encrypt(const uint8_t* key, const uint8_t* in, uint8_t* out) {
+    uint8_t rk[176];
+    uint8_t s[16];
+
+    ExpandKey(key, rk);
+
+    for (int i = 0; i < 16; i++) {
+        s[i] = in[i] ^ rk[i];
+    }
+
+    for (int round = 1; round <= 10; round++) {
+        uint8_t t[16];
+
+        // SubBytes and ShiftRows, the state is column major
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                t[c * 4 + r] = SBOX[s[((c + r) % 4) * 4 + r]];
+            }
+        }
+
+        if (round < 10) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t* col = &t[c * 4];
+                uint8_t a = col[0] ^ col[1] ^ col[2] ^ col[3];
+                uint8_t first = col[0];
+                col[0] ^= a ^ Xtime(col[0] ^ col[1]);
+                col[1] ^= a ^ Xtime(col[1] ^ col[2]);
+                col[2] ^= a ^ Xtime(col[2] ^ col[3]);
+                col[3] ^= a ^ Xtime(col[3] ^ first);
+            }
+        }
+
+        for (int i = 0; i < 16; i++) {
+            s[i] = t[i] ^ rk[round * 16 + i];
+        }
+    }
+
+    memcpy(out, s, 16);
+}
+
+void SimLoRaWAN::Decrypt(const uint8_t* key, const uint8_t* in, uint8_t* out) {
+    uint8_t rk[176];
+    uint8_t s[16];
+
+    InitInverse();
+    ExpandKey(key, rk);
+
+    for (int i = 0; i < 16; i++) {
+        s[i] = in[i] ^ rk[160 + i];
+    }
+
+    for (int round = 9; round >= 0; round--) {
+        uint8_t t[16];
+
+        // InvShiftRows and InvSubBytes
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                t[((c + r) % 4) * 4 + r] = INV_SBOX[s[c * 4 + r]];
+            }
+        }
+
+        for (int i = 0; i < 16; i++) {
+            t[i] ^= rk[round * 16 + i];
+        }
+
+        if (round > 0) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t* col = &t[c * 4];
+                uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+                col[0] = Multiply(a0, 14) ^ Multiply(a1, 11) ^ Multiply(a2, 13) ^ Multiply(a3, 9);
+                col[1] = Multiply(a0, 9) ^ Multiply(a1, 14) ^ Multiply(a2, 11) ^ Multiply(a3, 13);
+                col[2] = Multiply(a0, 13) ^ Multiply(a1, 9) ^ Multiply(a2, 14) ^ Multiply(a3, 11);
+                col[3] = Multiply(a0, 11) ^ Multiply(a1, 13) ^ Multiply(a2, 9) ^ Multiply(a3, 14);
+            }
+        }
+
+        memcpy(s, t, 16);
+    }
+
+    memcpy(out, s, 16);
+}
+
+static void Subkey(uint8_t* k) {
+    uint8_t carry = k[0] & 0x80;
+
+    for (int i = 0; i < 15; i++) {
+        k[i] = (uint8_t) ((k[i] << 1) | (k[i + 1] >> 7));
+    }
+
+    k[15] = (uint8_t) (k[15] << 1);
+
+    if (carry) {
+        k[15] ^= 0x87;
+    }
+}
+
+void SimLoRaWAN::Cmac(const uint8_t* key, const uint8_t* data, size_t size, uint8_t* mac) {
+    uint8_t k[16] = { 0 };
+    uint8_t x[16] = { 0 };
+    uint8_t last[16] = { 0 };
+
+    Encrypt(key, k, k);
+    Subkey(k);
+
+    size_t blocks = (size + 15) / 16;
+    bool complete = size > 0 && size % 16 == 0;
+
+    if (blocks == 0) {
+        blocks = 1;
+    }
+
+    // at most one block is left for the last, empty for an empty message
+    size_t tail = std::min(size - (blocks - 1) * 16, sizeof(last));
+    memcpy(last, data + (blocks - 1) * 16, tail);
+
+    if (!complete) {
+        last[tail] = 0x80;
+        Subkey(k);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        last[i] ^= k[i];
+    }
+
+    for (size_t b = 0; b + 1 < blocks; b++) {
+        for (int i = 0; i < 16; i++) {
+            x[i] ^= data[b * 16 + i];
+        }
+        Encrypt(key, x, x);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        x[i] ^= last[i];
+    }
+
+    Encrypt(key, x, mac);
+}
+
+void SimLoRaWAN::PutUint16(uint8_t* buf, uint16_t value) {
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+void SimLoRaWAN::PutUint24(uint8_t* buf, uint32_t value) {
+    buf[0] = value & 0xFF;
+    buf[1] = (value >> 8) & 0xFF;
+    buf[2] = (value >> 16) & 0xFF;
+}
+
+void SimLoRaWAN::PutUint32(uint8_t* buf, uint32_t value) {
+    buf[0] = value & 0xFF;
+    buf[1] = (value >> 8) & 0xFF;
+    buf[2] = (value >> 16) & 0xFF;
+    buf[3] = value >> 24;
+}
+
+uint16_t SimLoRaWAN::GetUint16(const uint8_t* buf) {
+    return buf[0] | (buf[1] << 8);
+}
+
+uint32_t SimLoRaWAN::GetUint24(const uint8_t* buf) {
+    return buf[0] | (buf[1] << 8) | ((uint32_t) buf[2] << 16);
+}
+
+uint32_t SimLoRaWAN::GetUint32(const uint8_t* buf) {
+    return buf[0] | (buf[1] << 8) | ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+static void Block(uint8_t* block, uint8_t first, uint8_t dir, uint32_t address, uint32_t counter, uint8_t last) {
+    memset(block, 0, 16);
+    block[0] = first;
+    block[5] = dir;
+    SimLoRaWAN::PutUint32(&block[6], address);
+    SimLoRaWAN::PutUint32(&block[10], counter);
+    block[15] = last;
+}
+
+uint32_t SimLoRaWAN::DataMic(const uint8_t* key, uint8_t dir, uint32_t address, uint32_t counter, const uint8_t* frame, size_t size) {
+    std::vector<uint8_t> msg;
+    uint8_t b0[16];
+    uint8_t mac[16];
+
+    Block(b0, 0x49, dir, address, counter, (uint8_t) size);
+    msg.reserve(sizeof(b0) + size);
+    msg.insert(msg.end(), b0, b0 + sizeof(b0));
+    msg.insert(msg.end(), frame, frame + size);
+    Cmac(key, msg.data(), msg.size(), mac);
+
+    return GetUint32(mac);
+}
+
+void SimLoRaWAN::Crypt(const uint8_t* key, uint8_t dir, uint32_t address, uint32_t counter, uint8_t* data, size_t size) {
+    uint8_t a[16];
+    uint8_t s[16];
+
+    for (size_t i = 0; i < size; i += 16) {
+        Block(a, 0x01, dir, address, counter, (uint8_t) (i / 16 + 1));
+        Encrypt(key, a, s);
+
+        for (size_t j = 0; j < 16 && i + j < size; j++) {
+            data[i + j] ^= s[j];
+        }
+    }
+}
+
+void SimLoRaWAN::SessionKeys(const uint8_t* appKey, const uint8_t* appNonce, const uint8_t* netId, uint16_t devNonce, uint8_t* nwkSKey, uint8_t* appSKey) {
+    uint8_t block[16] = { 0 };
+
+    memcpy(&block[1], appNonce, 3);
+    memcpy(&block[4], netId, 3);
+    PutUint16(&block[7], devNonce);
+
+    block[0] = 0x01;
+    Encrypt(appKey, block, nwkSKey);
+    block[0] = 0x02;
+    Encrypt(appKey, block, appSKey);
+}
+
+void SimLoRaWAN::McKEKey(const uint8_t* appKey, uint8_t* mcKEKey) {
+    uint8_t zero[16] = { 0 };
+    uint8_t root[16];
+
+    Encrypt(appKey, zero, root);
+    Encrypt(root, zero, mcKEKey);
+}
+
+void SimLoRaWAN::MulticastKeys(const uint8_t* mcKey, uint32_t mcAddress, uint8_t* mcNwkSKey, uint8_t* mcAppSKey) {
+    uint8_t block[16] = { 0 };
+
+    PutUint32(&block[1], mcAddress);
+
+    block[0] = 0x01;
+    Encrypt(mcKey, block, mcAppSKey);
+    block[0] = 0x02;
+    Encrypt(mcKey, block, mcNwkSKey);
+}
+
+static void Reverse(uint8_t* dst, const uint8_t* src) {
+    for (int i = 0; i < EUI_SIZE; i++) {
+        dst[i] = src[EUI_SIZE - 1 - i];
+    }
+}
+
+void SimLoRaWAN::EncodeJoinRequest(const uint8_t* appEui, const uint8_t* devEui, uint16_t devNonce, const uint8_t* appKey, std::vector<uint8_t>& out) {
+    uint8_t mac[16];
+
+    out.assign(23, 0);
+    out[0] = FRAME_TYPE_JOIN_REQ << 5;
+    // EUIs are held most significant byte first and sent least significant first
+    Reverse(&out[1], appEui);
+    Reverse(&out[9], devEui);
+    PutUint16(&out[17], devNonce);
+
+    Cmac(appKey, &out[0], 19, mac);
+    memcpy(&out[19], mac, 4);
+}
+
+bool SimLoRaWAN::PeekJoinRequest(const uint8_t* frame, size_t size, uint8_t* appEui, uint8_t* devEui, uint16_t& devNonce) {
+    if (size != 23 || (frame[0] >> 5) != FRAME_TYPE_JOIN_REQ) {
+        return false;
+    }
+
+    Reverse(appEui, &frame[1]);
+    Reverse(devEui, &frame[9]);
+    devNonce = GetUint16(&frame[17]);
+    return true;
+}
+
+bool SimLoRaWAN::CheckJoinRequest(const uint8_t* frame, size_t size, const uint8_t* appKey) {
+    uint8_t mac[16];
+
+    if (size != 23) {
+        return false;
+    }
+
+    Cmac(appKey, frame, 19, mac);
+    return memcmp(mac, &frame[19], 4) == 0;
+}
+
+void SimLoRaWAN::EncodeJoinAccept(const uint8_t* appNonce, const uint8_t* netId, uint32_t address, uint8_t dlSettings, uint8_t rxDelay,
+                                  const uint8_t* cfList, const uint8_t* appKey, std::vector<uint8_t>& out) {
+    std::vector<uint8_t> plain(13);
+    uint8_t mac[16];
+
+    plain[0] = FRAME_TYPE_JOIN_ACCEPT << 5;
+    memcpy(&plain[PKT_JOIN_APP_NONCE], appNonce, 3);
+    memcpy(&plain[PKT_JOIN_NETWORK_ID], netId, 3);
+    PutUint32(&plain[PKT_JOIN_NETWORK_ADDRESS], address);
+    plain[PKT_JOIN_DL_SETTINGS] = dlSettings;
+    plain[PKT_JOIN_RX_DELAY] = rxDelay;
+
+    if (cfList != NULL) {
+        plain.insert(plain.end(), cfList, cfList + 16);
+    }
+
+    Cmac(appKey, &plain[0], plain.size(), mac);
+    plain.insert(plain.end(), mac, mac + 4);
+
+    // the server decrypts so the device only needs the AES encrypt it has for everything else
+    out.assign(plain.size(), 0);
+    out[0] = plain[0];
+
+    for (size_t i = 1; i < plain.size(); i += 16) {
+        Decrypt(appKey, &plain[i], &out[i]);
+    }
+}
+
+bool SimLoRaWAN::DecodeJoinAccept(const uint8_t* frame, size_t size, const uint8_t* appKey, std::vector<uint8_t>& plain) {
+    uint8_t mac[16];
+
+    if ((size != 17 && size != 33) || (frame[0] >> 5) != FRAME_TYPE_JOIN_ACCEPT) {
+        return false;
+    }
+
+    plain.assign(size, 0);
+    plain[0] = frame[0];
+
+    for (size_t i = 1; i < size; i += 16) {
+        Encrypt(appKey, &frame[i], &plain[i]);
+    }
+
+    Cmac(appKey, &plain[0], size - 4, mac);
+
+    if (memcmp(mac, &plain[size - 4], 4) != 0) {
+        return false;
+    }
+
+    plain.resize(size - 4);
+    return true;
+}
+
+SimDataFrame::SimDataFrame()
+:   Type(FRAME_TYPE_DATA_UNCONFIRMED_UP),
+    Address(0),
+    Control(0),
+    Counter(0),
+    OptionsLength(0),
+    HasPort(false),
+    Port(0)
+{
+    memset(Options, 0, sizeof(Options));
+}
+
+static uint8_t FrameDirection(uint8_t type) {
+    return (type == FRAME_TYPE_DATA_UNCONFIRMED_UP || type == FRAME_TYPE_DATA_CONFIRMED_UP) ? DIR_UP : DIR_DOWN;
+}
+
+void SimLoRaWAN::EncodeData(const SimDataFrame& frame, const uint8_t* nwkSKey, const uint8_t* appSKey, std::vector<uint8_t>& out) {
+    uint8_t dir = FrameDirection(frame.Type);
+
+    out.assign(PKT_OPTIONS_START, 0);
+    out[PKT_HEADER] = frame.Type << 5;
+    PutUint32(&out[PKT_ADDRESS], frame.Address);
+    out[PKT_FRAME_CONTROL] = (frame.Control & 0xF0) | (frame.OptionsLength & 0x0F);
+    PutUint16(&out[PKT_FRAME_COUNTER], frame.Counter & 0xFFFF);
+    out.insert(out.end(), frame.Options, frame.Options + frame.OptionsLength);
+
+    if (frame.HasPort) {
+        size_t start = out.size() + 1;
+        out.push_back(frame.Port);
+        out.insert(out.end(), frame.Payload.begin(), frame.Payload.end());
+
+        if (!frame.Payload.empty()) {
+            Crypt(frame.Port == 0 ? nwkSKey : appSKey, dir, frame.Address, frame.Counter, &out[start], frame.Payload.size());
+        }
+    }
+
+    uint32_t mic = DataMic(nwkSKey, dir, frame.Address, frame.Counter, &out[0], out.size());
+    out.resize(out.size() + 4);
+    PutUint32(&out[out.size() - 4], mic);
+}
+
+bool SimLoRaWAN::PeekAddress(const uint8_t* frame, size_t size, uint32_t& address) {
+    uint8_t type = frame[PKT_HEADER] >> 5;
+
+    if (size < (size_t) PKT_OPTIONS_START + 4 || type < FRAME_TYPE_DATA_UNCONFIRMED_UP || type > FRAME_TYPE_DATA_CONFIRMED_DOWN) {
+        return false;
+    }
+
+    address = GetUint32(&frame[PKT_ADDRESS]);
+    return true;
+}
+
+bool SimLoRaWAN::DecodeData(const uint8_t* frame, size_t size, const uint8_t* nwkSKey, const uint8_t* appSKey, uint32_t last, SimDataFrame& out) {
+    if (!PeekAddress(frame, size, out.Address)) {
+        return false;
+    }
+
+    out.Type = frame[PKT_HEADER] >> 5;
+    out.Control = frame[PKT_FRAME_CONTROL] & 0xF0;
+    out.OptionsLength = frame[PKT_FRAME_CONTROL] & 0x0F;
+
+    size_t body = size - 4;
+    if ((size_t) PKT_OPTIONS_START + out.OptionsLength > body) {
+        return false;
+    }
+
+    uint16_t counter = GetUint16(&frame[PKT_FRAME_COUNTER]);
+    out.Counter = (last & 0xFFFF0000) | counter;
+    if (counter < (last & 0xFFFF)) {
+        out.Counter += 0x10000;
+    }
+
+    uint8_t dir = FrameDirection(out.Type);
+
+    if (DataMic(nwkSKey, dir, out.Address, out.Counter, frame, body) != GetUint32(&frame[body])) {
+        return false;
+    }
+
+    memcpy(out.Options, &frame[PKT_OPTIONS_START], out.OptionsLength);
+
+    size_t index = PKT_OPTIONS_START + out.OptionsLength;
+    out.HasPort = index < body;
+    out.Payload.clear();
+
+    if (out.HasPort) {
+        out.Port = frame[index++];
+        out.Payload.assign(frame + index, frame + body);
+
+        if (!out.Payload.empty()) {
+            Crypt(out.Port == 0 ? nwkSKey : appSKey, dir, out.Address, out.Counter, &out.Payload[0], out.Payload.size());
+        }
+    }
+
+    return true;
+}
+
+static int Prbs23(int x) {
+    int b0 = x & 1;
+    int b1 = (x & 0x20) >> 5;
+    return (x >> 1) + ((b0 ^ b1) << 22);
+}
+
+void SimLoRaWAN::ParityRow(int n, int m, std::vector<uint8_t>& row) {
+    // same generator as FragmentationMath::FragmentationGetParityMatrixRow
+    int mm = (m & (m - 1)) == 0 ? 1 : 0;
+    int x = 1 + 1001 * n;
+    int coefficients = 0;
+
+    row.assign(m, 0);
+
+    while (coefficients < (m >> 1)) {
+        int r = 1 << 16;
+
+        while (r >= m) {
+            x = Prbs23(x);
+            r = x % (m + mm);
+        }
+
+        row[r] = 1;
+        coefficients++;
+    }
+}
@@ -0,0 +1,168 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimLoRaWAN LoRaWAN 1.0.x frame coding and security for host simulation
+ *
+ * @details AES-128, CMAC, MIC, payload encryption and key derivation of LoRaWAN 1.0.x
+ *          and the Remote Multicast Setup package, with encoders and decoders for join
+ *          and data frames.  The device build gets its crypto from mbedtls, this is a
+ *          self contained copy for the host where mbedtls is not available.
+ *
+ */
+
+#ifndef __LORA_SIM_LORAWAN_H__
+#define __LORA_SIM_LORAWAN_H__
+
+#include "Lora.h"
+#include <vector>
+
+namespace lora {
+
+    const uint32_t SIM_GPS_START = 1300000000;      //!< GPS seconds at virtual time 0
+
+    // application package ports and commands, ApplicationLayerPackage.h needs the device build
+    const uint8_t SIM_PORT_MULTICAST = 200;
+    const uint8_t SIM_PORT_FRAGMENTATION = 201;
+    const uint8_t SIM_PORT_CLOCK_SYNC = 202;
+
+    const uint8_t SIM_APP_TIME = 0x01;
+    const uint8_t SIM_MC_GROUP_SETUP = 0x02;
+    const uint8_t SIM_MC_CLASS_C_SESSION = 0x04;
+    const uint8_t SIM_FRAG_SESSION_SETUP = 0x02;
+    const uint8_t SIM_DATA_FRAGMENT = 0x08;
+
+    // FCtrl bits
+    const uint8_t SIM_FCTRL_ADR = 0x80;
+    const uint8_t SIM_FCTRL_ADR_ACK_REQ = 0x40;
+    const uint8_t SIM_FCTRL_ACK = 0x20;
+    const uint8_t SIM_FCTRL_PENDING = 0x10;
+
+    /**
+     * Data frame fields, FRMPayload in plain text
+     */
+    struct SimDataFrame {
+        SimDataFrame();
+
+        uint8_t Type;                       //!< FRAME_TYPE_DATA_*
+        uint32_t Address;
+        uint8_t Control;                    //!< FCtrl without the options length
+        uint32_t Counter;                   //!< full 32 bit frame counter
+        uint8_t Options[15];
+        uint8_t OptionsLength;
+        bool HasPort;
+        uint8_t Port;
+        std::vector<uint8_t> Payload;
+    };
+
+    class SimLoRaWAN {
+        public:
+            /**
+             * AES-128 encryption of one block
+             */
+            static void Encrypt(const uint8_t* key, const uint8_t* in, uint8_t* out);
+
+            /**
+             * AES-128 decryption of one block
+             */
+            static void Decrypt(const uint8_t* key, const uint8_t* in, uint8_t* out);
+
+            /**
+             * AES-CMAC of RFC 4493
+             * @param[out] mac 16 bytes
+             */
+            static void Cmac(const uint8_t* key, const uint8_t* data, size_t size, uint8_t* mac);
+
+            /**
+             * MIC of a data frame, CMAC of the B0 block and the frame
+             * @param dir DIR_UP or DIR_DOWN
+             */
+            static uint32_t DataMic(const uint8_t* key, uint8_t dir, uint32_t address, uint32_t counter, const uint8_t* frame, size_t size);
+
+            /**
+             * Encrypt or decrypt FRMPayload in place with the A blocks
+             * @param dir DIR_UP or DIR_DOWN
+             */
+            static void Crypt(const uint8_t* key, uint8_t dir, uint32_t address, uint32_t counter, uint8_t* data, size_t size);
+
+            /**
+             * NwkSKey and AppSKey from the join accept
+             * @param appNonce 3 bytes as sent
+             * @param netId 3 bytes as sent
+             */
+            static void SessionKeys(const uint8_t* appKey, const uint8_t* appNonce, const uint8_t* netId, uint16_t devNonce, uint8_t* nwkSKey, uint8_t* appSKey);
+
+            /**
+             * McKEKey of a 1.0.x device, McRootKey is derived from the AppKey
+             */
+            static void McKEKey(const uint8_t* appKey, uint8_t* mcKEKey);
+
+            /**
+             * McNwkSKey and McAppSKey of a multicast group
+             */
+            static void MulticastKeys(const uint8_t* mcKey, uint32_t mcAddress, uint8_t* mcNwkSKey, uint8_t* mcAppSKey);
+
+            static void EncodeJoinRequest(const uint8_t* appEui, const uint8_t* devEui, uint16_t devNonce, const uint8_t* appKey, std::vector<uint8_t>& out);
+
+            /**
+             * Read the EUIs and nonce of a join request without checking the MIC
+             * @return false if the frame is not a join request
+             */
+            static bool PeekJoinRequest(const uint8_t* frame, size_t size, uint8_t* appEui, uint8_t* devEui, uint16_t& devNonce);
+
+            static bool CheckJoinRequest(const uint8_t* frame, size_t size, const uint8_t* appKey);
+
+            /**
+             * Build an encrypted join accept
+             * @param cfList 16 bytes or NULL
+             */
+            static void EncodeJoinAccept(const uint8_t* appNonce, const uint8_t* netId, uint32_t address, uint8_t dlSettings, uint8_t rxDelay,
+                                         const uint8_t* cfList, const uint8_t* appKey, std::vector<uint8_t>& out);
+
+            /**
+             * Decrypt and check a join accept
+             * @param[out] plain MHDR through CFList without the MIC
+             * @return false if the MIC does not match
+             */
+            static bool DecodeJoinAccept(const uint8_t* frame, size_t size, const uint8_t* appKey, std::vector<uint8_t>& plain);
+
+            /**
+             * Build a data frame, FRMPayload is encrypted with the NwkSKey on port 0
+             */
+            static void EncodeData(const SimDataFrame& frame, const uint8_t* nwkSKey, const uint8_t* appSKey, std::vector<uint8_t>& out);
+
+            /**
+             * Device address of a data frame
+             * @return false if the frame is too short or not a data frame
+             */
+            static bool PeekAddress(const uint8_t* frame, size_t size, uint32_t& address);
+
+            /**
+             * Check and decrypt a data frame
+             * @param last last counter accepted, the upper 16 bits of the counter are taken from it
+             * @return false if the frame is malformed or the MIC does not match
+             */
+            static bool DecodeData(const uint8_t* frame, size_t size, const uint8_t* nwkSKey, const uint8_t* appSKey, uint32_t last, SimDataFrame& out);
+
+            /**
+             * Row of the parity matrix of the Fragmented Data Block Transport package
+             * @param n index of the coded fragment counted from 1 after the uncoded ones
+             * @param m number of uncoded fragments
+             * @param[out] row m entries of 0 or 1
+             */
+            static void ParityRow(int n, int m, std::vector<uint8_t>& row);
+
+            static void PutUint16(uint8_t* buf, uint16_t value);
+            static void PutUint24(uint8_t* buf, uint32_t value);
+            static void PutUint32(uint8_t* buf, uint32_t value);
+            static uint16_t GetUint16(const uint8_t* buf);
+            static uint32_t GetUint24(const uint8_t* buf);
+            static uint32_t GetUint32(const uint8_t* buf);
+    };
+
+}
+
+#endif
@@ -0,0 +1,188 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimLzDecoder checks of LzDecoder on an image compressed by tools/fota_lz.py
+ *
+ */
+
+#include "SimLzDecoder.h"
+#include "LzDecoder.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <stdio.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint32_t IMAGE_SIZE_OFFSET = 4;   //!< of the uncompressed size in the stream header
+    const uint32_t WINDOW_BITS_OFFSET = 8;  //!< of the window bits in the stream header
+
+    std::vector<uint8_t> ReadFixture(const std::string& dir, const char* name) {
+        std::vector<uint8_t> data;
+        std::string path = dir + "/" + name;
+        FILE* file = fopen(path.c_str(), "rb");
+
+        if (file == NULL) {
+            logError("can not open %s", path.c_str());
+            return data;
+        }
+
+        uint8_t buffer[4096];
+        size_t read;
+
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.insert(data.end(), buffer, buffer + read);
+        }
+
+        fclose(file);
+        return data;
+    }
+
+    /**
+     * Decode a stream chunk by chunk until it is through or refused, the target takes
+     * at most accept bytes before its writes fail
+     */
+    SimLzDecoderResult Decode(const std::string& name, const std::vector<uint8_t>& stream, uint32_t chunk,
+                              std::vector<uint8_t>& out, uint32_t accept = UINT32_MAX) {
+        SimLzDecoderResult result;
+        LzDecoder lz([&out, accept](const uint8_t* data, uint32_t size) -> int32_t {
+            if (out.size() + size > accept) {
+                return -1;
+            }
+            out.insert(out.end(), data, data + size);
+            return size;
+        });
+
+        result.Name = name;
+        result.Status = LzDecoder::LZ_OK;
+        out.clear();
+
+        for (uint32_t i = 0; i < stream.size() && result.Status == LzDecoder::LZ_OK; i += chunk) {
+            result.Status = lz.decode(&stream[i], std::min<uint32_t>(chunk, stream.size() - i));
+        }
+
+        result.Complete = lz.complete();
+        result.Passed = false;
+
+        return result;
+    }
+
+}
+
+SimLzDecoderConfig::SimLzDecoderConfig()
+:   Fixtures(SIM_FOTA_FIXTURES),
+    FragmentSize(50)
+{
+    // a byte at a time, around the 9 byte header and the window, and whole
+    const uint32_t chunks[] = { 1, 2, 8, 9, 10, (1 << LZ_WINDOW_BITS) - 1, 1 << LZ_WINDOW_BITS, (1 << LZ_WINDOW_BITS) + 1, 4096, 65536 };
+
+    Chunks.assign(chunks, chunks + sizeof(chunks) / sizeof(chunks[0]));
+}
+
+bool SimLzDecoderReport::Passed() const {
+    for (size_t i = 0; i < Results.size(); i++) {
+        if (!Results[i].Passed) {
+            return false;
+        }
+    }
+
+    return StreamSize != 0 && !Results.empty();
+}
+
+void SimLzDecoderReport::Log() const {
+    logInfo("stream %lu bytes for a %lu byte image", (unsigned long) StreamSize, (unsigned long) ImageSize);
+
+    for (size_t i = 0; i < Results.size(); i++) {
+        const SimLzDecoderResult& result = Results[i];
+
+        logInfo("%-16s status %ld, %s, %s", result.Name.c_str(), (long) result.Status,
+                result.Complete ? "complete" : "incomplete", result.Passed ? "ok" : "FAILED");
+    }
+}
+
+SimLzDecoder::SimLzDecoder(const SimLzDecoderConfig& config)
+:   _config(config)
+{
+}
+
+SimLzDecoderReport SimLzDecoder::Run() {
+    SimLzDecoderReport report;
+    std::vector<uint8_t> image = ReadFixture(_config.Fixtures, "image.bin");
+    std::vector<uint8_t> stream = ReadFixture(_config.Fixtures, "image.lz");
+    std::vector<uint8_t> out;
+
+    report.StreamSize = stream.size();
+    report.ImageSize = image.size();
+
+    if (stream.size() <= LZ_HEADER_SIZE) {
+        return report;
+    }
+
+    // the fragmentation session hands over whole fragments, the padding has to be ignored
+    if (_config.FragmentSize > 0 && stream.size() % _config.FragmentSize != 0) {
+        stream.resize(stream.size() + _config.FragmentSize - stream.size() % _config.FragmentSize, 0);
+    }
+
+    for (size_t i = 0; i < _config.Chunks.size(); i++) {
+        char name[32];
+
+        snprintf(name, sizeof(name), "chunk %lu", (unsigned long) _config.Chunks[i]);
+        SimLzDecoderResult result = Decode(name, stream, _config.Chunks[i], out);
+        result.Passed = result.Status == LzDecoder::LZ_OK && result.Complete && out == image;
+        report.Results.push_back(result);
+    }
+
+    {
+        std::vector<uint8_t> bad = stream;
+        bad[0] = 'X';
+
+        SimLzDecoderResult result = Decode("bad magic", bad, 64, out);
+        result.Passed = result.Status == LzDecoder::LZ_ERR_HEADER && !result.Complete && out.empty();
+        report.Results.push_back(result);
+    }
+
+    {
+        // made for a window the decoder does not have room for
+        std::vector<uint8_t> bad = stream;
+        bad[WINDOW_BITS_OFFSET] = LZ_WINDOW_BITS + 1;
+
+        SimLzDecoderResult result = Decode("wide window", bad, 64, out);
+        result.Passed = result.Status == LzDecoder::LZ_ERR_HEADER && !result.Complete && out.empty();
+        report.Results.push_back(result);
+    }
+
+    {
+        // one literal, then a match two bytes back
+        std::vector<uint8_t> bad(stream.begin(), stream.begin() + LZ_HEADER_SIZE);
+        const uint8_t sequence[] = { 0x10, 'a', 0x02, 0x00 };
+
+        bad.insert(bad.end(), sequence, sequence + sizeof(sequence));
+
+        SimLzDecoderResult result = Decode("bad offset", bad, 64, out);
+        result.Passed = result.Status == LzDecoder::LZ_ERR_FORMAT && !result.Complete;
+        report.Results.push_back(result);
+    }
+
+    {
+        // the header claims a byte less than the sequences produce
+        std::vector<uint8_t> bad = stream;
+        bad[IMAGE_SIZE_OFFSET] -= 1;
+
+        SimLzDecoderResult result = Decode("short header", bad, 64, out);
+        result.Passed = result.Status == LzDecoder::LZ_ERR_FORMAT && !result.Complete;
+        report.Results.push_back(result);
+    }
+
+    {
+        SimLzDecoderResult result = Decode("failed write", stream, 64, out, image.size() / 2);
+        result.Passed = result.Status == LzDecoder::LZ_ERR_WRITE && !result.Complete;
+        report.Results.push_back(result);
+    }
+
+    return report;
+}
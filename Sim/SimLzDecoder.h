@@ -0,0 +1,63 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimLzDecoder checks of LzDecoder on an image compressed by tools/fota_lz.py
+ *
+ * @details The build runs tools/fota_lz.py fixtures for a synthetic build and its compressed
+ *          stream.  The stream, padded to whole fragments, is decoded in pieces of each chunk
+ *          size and has to expand to the build byte for byte.  A bad magic, a window wider than
+ *          LZ_WINDOW_BITS, an offset outside the output, a stream longer than its header says
+ *          and a failing target have to be refused without completing.
+ *
+ */
+
+#ifndef __LORA_SIM_LZ_DECODER_H__
+#define __LORA_SIM_LZ_DECODER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace lora {
+
+    struct SimLzDecoderConfig {
+        SimLzDecoderConfig();
+
+        std::string Fixtures;               //!< directory of image.bin and image.lz
+        std::vector<uint32_t> Chunks;       //!< bytes handed to decode() at a time
+        uint32_t FragmentSize;              //!< the stream is zero padded to a multiple of it
+    };
+
+    struct SimLzDecoderResult {
+        std::string Name;
+        int32_t Status;                     //!< last decode() result
+        bool Complete;
+        bool Passed;
+    };
+
+    struct SimLzDecoderReport {
+        uint32_t StreamSize;
+        uint32_t ImageSize;
+        std::vector<SimLzDecoderResult> Results;
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimLzDecoder {
+        public:
+            SimLzDecoder(const SimLzDecoderConfig& config = SimLzDecoderConfig());
+
+            SimLzDecoderReport Run();
+
+        private:
+            SimLzDecoderConfig _config;
+    };
+
+}
+
+#endif
@@ -0,0 +1,320 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  Host runner for the simulator harnesses
+ *
+ * @details sim_runner [name...] runs the named harnesses, or all of them, logs their
+ *          reports and exits non zero if one of them fails its checks.
+ *
+ */
+
+#include "SimAdrEvaluation.h"
+#include "SimAdrTransaction.h"
+#include "SimBenchmark.h"
+#include "SimChannelMask.h"
+#include "SimDeadlineQueue.h"
+#include "SimDeltaPatch.h"
+#include "SimFileBenchmark.h"
+#include "SimFleet.h"
+#include "SimFragmentIngest.h"
+#include "SimLzDecoder.h"
+#include "SimPingSlot.h"
+#include "SimPowerLoss.h"
+#include "SimRadio.h"
+#include "SimSpscBuffer.h"
+#include "SimTextEncode.h"
+#include "MTSLog.h"
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    /**
+     * Receiver recording what the radio raises
+     */
+    class Listener : public SxRadioEvents {
+        public:
+            Listener() : Frames(0), Timeouts(0) {}
+
+            virtual void RxDone(uint8_t* payload, uint16_t size, int16_t rssi, int16_t snr) {
+                Payload.assign(payload, payload + size);
+                Frames++;
+            }
+
+            virtual void RxTimeout(void) {
+                Timeouts++;
+            }
+
+            std::vector<uint8_t> Payload;
+            uint32_t Frames;
+            uint32_t Timeouts;
+    };
+
+    /**
+     * A frame sent from one SimRadio to another, then a window with nothing to receive
+     */
+    bool RunRadio() {
+        SimClock clock;
+        SimMedium medium(clock);
+        SimRadio sender(medium);
+        SimRadio receiver(medium);
+        Listener idle;
+        Listener listener;
+        const uint8_t frame[] = { 0x40, 0x01, 0x02, 0x03, 0x04, 0x00, 0x01, 0x00, 0x01, 0xAA };
+
+        sender.Init(&idle);
+        receiver.Init(&listener);
+        medium.SetPathLoss(100.0);
+
+        sender.SetChannel(902300000);
+        receiver.SetChannel(902300000);
+        sender.SetTxConfig(SxRadio::MODEM_LORA, 20, 0, BW_125, SF_7, 1, 8, false, true, false, 0, false, 3000);
+        receiver.SetRxConfig(SxRadio::MODEM_LORA, BW_125, SF_7, 1, 0, 8, 8, false, 0, true, false, 0, false, true);
+
+        receiver.Rx(0);
+        sender.Send(frame, sizeof(frame));
+        while (clock.RunNext()) {
+        }
+
+        receiver.SetRxConfig(SxRadio::MODEM_LORA, BW_125, SF_7, 1, 0, 8, 8, false, 0, true, false, 0, false, false);
+        receiver.Rx(0);
+        while (clock.RunNext()) {
+        }
+
+        uint64_t airtime = SimRadio::LoRaAirtime(SF_7, 125000, 1, 8, false, true, sizeof(frame));
+
+        logInfo("radio: %lu frames received, %lu timeouts, %lu us on air",
+                (unsigned long) listener.Frames, (unsigned long) listener.Timeouts, (unsigned long) sender.GetStats().TxTime);
+
+        return listener.Frames == 1
+            && listener.Payload == std::vector<uint8_t>(frame, frame + sizeof(frame))
+            && listener.Timeouts == 1
+            && sender.GetStats().TxTime == airtime;
+    }
+
+    bool RunFleet() {
+        SimFleetConfig config;
+
+        config.Devices = 500;
+        config.Duration = 12ULL * 3600 * 1000000;
+        config.SettleTime = 3ULL * 3600 * 1000000;
+
+        SimFleet fleet(config);
+        const SimFleetReport& report = fleet.Run();
+
+        report.Log();
+
+        return report.Uplinks != 0 && report.Delivered != 0 && report.Delivered <= report.Uplinks;
+    }
+
+    bool RunBenchmark() {
+        SimBenchmarkConfig config;
+
+        config.Joins = 5;
+        config.Uplinks = 20;
+        config.FotaSessions = 1;
+
+        SimBenchmark benchmark(config);
+        SimBenchmarkReport report = benchmark.Run();
+
+        report.Log();
+
+        return report.Join.Count == config.Joins
+            && report.Ack.Count != 0
+            && report.FotaVerified == config.FotaSessions;
+    }
+
+    bool RunAdrEvaluation() {
+        SimAdrEvaluationConfig config;
+        SimAdrEvaluation evaluation(config);
+        SimAdrReport report = evaluation.Run();
+
+        report.Log();
+
+        return report.Network.Delivered != 0 && report.Policy.Delivered != 0;
+    }
+
+    bool RunPowerLoss() {
+        SimPowerLossConfig config;
+
+        config.Cycles = 500;
+
+        SimPowerLoss harness(config);
+        SimPowerLossReport report = harness.Run();
+
+        report.Log();
+
+        return report.Reused == 0 && report.Lost == 0 && report.Failed == 0 && report.Violations == 0;
+    }
+
+    bool RunFileBenchmark() {
+        SimFileBenchmarkConfig config;
+
+        config.Samples = 2000;
+
+        SimFileBenchmark benchmark(config);
+        SimFileBenchmarkReport report = benchmark.Run();
+        bool verified = true;
+
+        report.Log();
+
+        for (size_t i = 0; i < report.Runs.size(); i++) {
+            verified = verified && report.Runs[i].Verified;
+        }
+
+        return verified;
+    }
+
+    bool RunSpscBuffer() {
+        SimSpscBuffer harness;
+        SimSpscBufferReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    bool RunTextEncode() {
+        SimTextEncode harness;
+        SimTextEncodeReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    bool RunChannelMask() {
+        SimChannelMask harness;
+        SimChannelMaskReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    bool RunDeadlineQueue() {
+        SimDeadlineQueue harness;
+        SimDeadlineQueueReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    bool RunAdrTransaction() {
+        SimAdrTransaction harness;
+        SimAdrTransactionReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    bool RunPingSlot() {
+        SimPingSlot harness;
+        SimPingSlotReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    bool RunDeltaPatch() {
+        SimDeltaPatch harness;
+        SimDeltaPatchReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    bool RunLzDecoder() {
+        SimLzDecoder harness;
+        SimLzDecoderReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    bool RunFragmentIngest() {
+        SimFragmentIngest harness;
+        SimFragmentIngestReport report = harness.Run();
+
+        report.Log();
+
+        return report.Passed();
+    }
+
+    struct Harness {
+        const char* Name;
+        bool (*Run)();
+    };
+
+    const Harness HARNESSES[] = {
+        { "radio", RunRadio },
+        { "fleet", RunFleet },
+        { "benchmark", RunBenchmark },
+        { "adr", RunAdrEvaluation },
+        { "powerloss", RunPowerLoss },
+        { "file", RunFileBenchmark },
+        { "spsc", RunSpscBuffer },
+        { "text", RunTextEncode },
+        { "channels", RunChannelMask },
+        { "deadline", RunDeadlineQueue },
+        { "adrblock", RunAdrTransaction },
+        { "pingslot", RunPingSlot },
+        { "delta", RunDeltaPatch },
+        { "lz", RunLzDecoder },
+        { "ingest", RunFragmentIngest }
+    };
+
+    const size_t NUM_HARNESSES = sizeof(HARNESSES) / sizeof(HARNESSES[0]);
+
+    bool Run(const Harness& harness) {
+        bool passed = harness.Run();
+
+        if (passed) {
+            logInfo("%s: passed", harness.Name);
+        } else {
+            logError("%s: FAILED", harness.Name);
+        }
+
+        return passed;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    bool passed = true;
+
+    if (argc < 2) {
+        for (size_t i = 0; i < NUM_HARNESSES; i++) {
+            passed = Run(HARNESSES[i]) && passed;
+        }
+
+        return passed ? 0 : 1;
+    }
+
+    for (int arg = 1; arg < argc; arg++) {
+        size_t i = 0;
+
+        while (i < NUM_HARNESSES && strcmp(HARNESSES[i].Name, argv[arg]) != 0) {
+            i++;
+        }
+
+        if (i == NUM_HARNESSES) {
+            logError("unknown harness %s", argv[arg]);
+            return 2;
+        }
+
+        passed = Run(HARNESSES[i]) && passed;
+    }
+
+    return passed ? 0 : 1;
+}
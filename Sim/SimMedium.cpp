@@ -0,0 +1,276 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimMedium shared air interface for simulated radios
+ *
+ */
+
+#include "SimMedium.h"
+#include "SimRadio.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace lora;
+
+SimMedium::SimMedium(SimClock& clock, uint32_t seed)
+:   _clock(clock),
+    _loss(NULL),
+    _random(seed),
+    _fading(0.0, 1.0),
+    _pathLoss(100.0),
+    _sigma(0.0),
+    _capture(6.0),
+    _noiseFigure(6.0),
+    _nextId(1)
+{
+    ResetStats();
+}
+
+SimClock& SimMedium::Clock() {
+    return _clock;
+}
+
+void SimMedium::Attach(SimRadio* radio) {
+    if (std::find(_radios.begin(), _radios.end(), radio) == _radios.end()) {
+        _radios.push_back(radio);
+    }
+}
+
+void SimMedium::Detach(SimRadio* radio) {
+    _radios.erase(std::remove(_radios.begin(), _radios.end(), radio), _radios.end());
+}
+
+void SimMedium::Attach(SimMonitor* monitor) {
+    if (std::find(_monitors.begin(), _monitors.end(), monitor) == _monitors.end()) {
+        _monitors.push_back(monitor);
+    }
+}
+
+void SimMedium::Detach(SimMonitor* monitor) {
+    _monitors.erase(std::remove(_monitors.begin(), _monitors.end(), monitor), _monitors.end());
+}
+
+void SimMedium::SetLoss(SimLoss* loss) {
+    _loss = loss;
+}
+
+void SimMedium::SetPathLoss(double db) {
+    _pathLoss = db;
+}
+
+void SimMedium::SetPathLoss(const SimRadio* a, const SimRadio* b, double db) {
+    _links[std::make_pair(std::min(a, b), std::max(a, b))] = db;
+}
+
+void SimMedium::SetFading(double sigma) {
+    _sigma = sigma;
+}
+
+void SimMedium::SetCaptureThreshold(double db) {
+    _capture = db;
+}
+
+void SimMedium::SetNoiseFigure(double db) {
+    _noiseFigure = db;
+}
+
+double SimMedium::PathLoss(const SimRadio* a, const SimRadio* b) const {
+    std::map<std::pair<const SimRadio*, const SimRadio*>, double>::const_iterator it = _links.find(std::make_pair(std::min(a, b), std::max(a, b)));
+    return it == _links.end() ? _pathLoss : it->second;
+}
+
+double SimMedium::Rssi(const SimFrame& frame, const SimRadio* listener) {
+    double rssi = frame.Power - PathLoss(frame.Sender, listener);
+
+    if (_sigma > 0.0) {
+        rssi += _sigma * _fading(_random);
+    }
+
+    return rssi;
+}
+
+double SimMedium::NoiseFloor(uint32_t bandwidth) const {
+    return -174.0 + 10.0 * log10((double) bandwidth) + _noiseFigure;
+}
+
+double SimMedium::DemodulationFloor(uint8_t sf) {
+    if (sf == 0) {
+        return 10.0;
+    }
+
+    // SX126x datasheet, 2.5 dB per spreading factor from -7.5 dB at SF7
+    return -7.5 - 2.5 * (sf - 7);
+}
+
+bool SimMedium::SameChannel(const SimFrame& frame, uint32_t frequency, uint32_t bandwidth) const {
+    uint32_t offset = frame.Frequency > frequency ? frame.Frequency - frequency : frequency - frame.Frequency;
+    return offset < std::max(frame.Bandwidth, bandwidth) / 2;
+}
+
+uint32_t SimMedium::Transmit(SimFrame& frame, uint64_t airtime) {
+    frame.Id = _nextId++;
+    frame.Start = _clock.Now();
+    frame.End = frame.Start + airtime;
+
+    Prune();
+    _frames.push_back(frame);
+    _stats.Frames++;
+
+    Start(frame.Id);
+    _clock.At(frame.End, callback(this, &SimMedium::EndNext));
+
+    return frame.Id;
+}
+
+const SimFrame* SimMedium::Find(uint32_t id) const {
+    for (size_t i = 0; i < _frames.size(); i++) {
+        if (_frames[i].Id == id) {
+            return &_frames[i];
+        }
+    }
+
+    return NULL;
+}
+
+void SimMedium::Start(uint32_t id) {
+    const SimFrame* frame = Find(id);
+
+    for (size_t i = 0; i < _radios.size(); i++) {
+        if (_radios[i] != frame->Sender) {
+            _radios[i]->FrameStart(*frame);
+        }
+    }
+}
+
+void SimMedium::EndNext() {
+    // end events are scheduled at each frame end, the earliest unfinished frame is the one due
+    const SimFrame* due = NULL;
+    uint64_t now = _clock.Now();
+
+    for (size_t i = 0; i < _frames.size(); i++) {
+        const SimFrame& f = _frames[i];
+        if (f.End <= now && std::find(_ended.begin(), _ended.end(), f.Id) == _ended.end()) {
+            if (due == NULL || f.End < due->End) {
+                due = &f;
+            }
+        }
+    }
+
+    if (due == NULL) {
+        return;
+    }
+
+    _ended.push_back(due->Id);
+
+    // copy, a receiver may send from its RxDone callback and grow the frame list
+    SimFrame frame = *due;
+
+    for (size_t i = 0; i < _radios.size(); i++) {
+        if (_radios[i] != frame.Sender) {
+            _radios[i]->FrameEnd(frame);
+        }
+    }
+
+    for (size_t i = 0; i < _monitors.size(); i++) {
+        _monitors[i]->FrameEnd(frame);
+    }
+}
+
+bool SimMedium::OnAir(const SimFrame& frame) const {
+    return std::find(_ended.begin(), _ended.end(), frame.Id) == _ended.end();
+}
+
+void SimMedium::Prune() {
+    // ended frames are kept while they may still overlap a frame on the air
+    uint64_t oldest = _clock.Now();
+
+    for (size_t i = 0; i < _frames.size(); i++) {
+        if (OnAir(_frames[i])) {
+            oldest = std::min(oldest, _frames[i].Start);
+        }
+    }
+
+    while (!_frames.empty() && !OnAir(_frames.front()) && _frames.front().End <= oldest) {
+        _ended.erase(std::remove(_ended.begin(), _ended.end(), _frames.front().Id), _ended.end());
+        _frames.pop_front();
+    }
+}
+
+double SimMedium::ChannelRssi(const SimRadio* listener, uint32_t frequency, uint32_t bandwidth) const {
+    double rssi = NoiseFloor(bandwidth);
+    uint64_t now = _clock.Now();
+
+    for (size_t i = 0; i < _frames.size(); i++) {
+        const SimFrame& f = _frames[i];
+        if (f.Sender != listener && f.Start <= now && f.End > now && SameChannel(f, frequency, bandwidth)) {
+            rssi = std::max(rssi, f.Power - PathLoss(f.Sender, listener));
+        }
+    }
+
+    return rssi;
+}
+
+bool SimMedium::ChannelActivity(const SimRadio* listener, uint32_t frequency, uint32_t bandwidth, uint8_t sf) const {
+    uint64_t now = _clock.Now();
+
+    for (size_t i = 0; i < _frames.size(); i++) {
+        const SimFrame& f = _frames[i];
+        if (f.Sender != listener && f.Start <= now && f.End > now && f.SpreadingFactor == sf && SameChannel(f, frequency, bandwidth)) {
+            double snr = f.Power - PathLoss(f.Sender, listener) - NoiseFloor(f.Bandwidth);
+            if (snr >= DemodulationFloor(sf)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool SimMedium::Survives(const SimFrame& frame, const SimRadio* listener, double rssi) {
+    if (_loss != NULL && _loss->Drop(frame, listener)) {
+        _stats.Dropped++;
+        return false;
+    }
+
+    for (size_t i = 0; i < _frames.size(); i++) {
+        const SimFrame& f = _frames[i];
+
+        if (f.Id == frame.Id || f.SpreadingFactor != frame.SpreadingFactor) {
+            continue;
+        }
+
+        if (f.Start < frame.End && f.End > frame.Start && SameChannel(f, frame.Frequency, frame.Bandwidth)) {
+            if (rssi - (f.Power - PathLoss(f.Sender, listener)) < _capture) {
+                _stats.Collisions++;
+                return false;
+            }
+        }
+    }
+
+    _stats.Delivered++;
+    return true;
+}
+
+uint32_t SimMedium::Random() {
+    return _random();
+}
+
+const SimMedium::Stats& SimMedium::GetStats() const {
+    return _stats;
+}
+
+void SimMedium::ResetStats() {
+    _stats.Frames = 0;
+    _stats.Delivered = 0;
+    _stats.Collisions = 0;
+    _stats.BelowSensitivity = 0;
+    _stats.Dropped = 0;
+}
+
+void SimMedium::CountBelowSensitivity() {
+    _stats.BelowSensitivity++;
+}
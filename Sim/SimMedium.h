@@ -0,0 +1,220 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimMedium shared air interface for simulated radios
+ *
+ * @details Frames sent by one SimRadio are heard by every other attached radio at the
+ *          sender power less the path loss between the two.  A receiver locks on a frame
+ *          when its preamble starts while the receiver is listening with the same
+ *          frequency, bandwidth, spreading factor and IQ polarity, and the SNR is above
+ *          the demodulation floor of the spreading factor.  The frame is lost if another
+ *          frame with the same spreading factor overlaps it on the same channel at less
+ *          than the capture threshold below it.  Different spreading factors are treated
+ *          as orthogonal.
+ *
+ */
+
+#ifndef __LORA_SIM_MEDIUM_H__
+#define __LORA_SIM_MEDIUM_H__
+
+#include "SimClock.h"
+#include <deque>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace lora {
+
+    class SimRadio;
+
+    /**
+     * Frame on the air
+     */
+    struct SimFrame {
+        uint32_t Id;                        //!< Assigned by the medium
+        const SimRadio* Sender;
+        uint32_t Frequency;                 //!< Hz
+        uint32_t Bandwidth;                 //!< Hz
+        uint8_t SpreadingFactor;            //!< 7-12, 0 for FSK
+        bool IqInverted;
+        int8_t Power;                       //!< dBm
+        uint64_t Start;                     //!< us virtual time
+        uint64_t End;                       //!< us virtual time
+        std::vector<uint8_t> Payload;
+    };
+
+    /**
+     * Receiver outside the radio model that is offered every frame when it ends, such as
+     * a gateway demodulating all channels and spreading factors at once
+     */
+    class SimMonitor {
+        public:
+            virtual ~SimMonitor() {}
+            virtual void FrameEnd(const SimFrame& frame) = 0;
+    };
+
+    /**
+     * Scripted frame loss on top of the radio model
+     */
+    class SimLoss {
+        public:
+            virtual ~SimLoss() {}
+
+            /**
+             * @return true to lose the frame at this receiver
+             */
+            virtual bool Drop(const SimFrame& frame, const SimRadio* listener) = 0;
+    };
+
+    class SimMedium {
+        public:
+            /**
+             * Counters of frame outcomes at receivers that were listening on the frame channel
+             */
+            struct Stats {
+                uint32_t Frames;            //!< Frames sent
+                uint32_t Delivered;         //!< Frames received intact
+                uint32_t Collisions;        //!< Frames lost to an overlapping frame
+                uint32_t BelowSensitivity;  //!< Frames too weak to detect
+                uint32_t Dropped;           //!< Frames lost by the SimLoss script
+            };
+
+            /**
+             * @param clock virtual time of all attached radios
+             * @param seed seed of the fading and SimRadio::Random generator
+             */
+            SimMedium(SimClock& clock, uint32_t seed = 1);
+
+            SimClock& Clock();
+
+            void Attach(SimRadio* radio);
+            void Detach(SimRadio* radio);
+            void Attach(SimMonitor* monitor);
+            void Detach(SimMonitor* monitor);
+
+            /**
+             * Lose frames at receivers as the script decides, checked before interference
+             * @param loss script or NULL for none
+             */
+            void SetLoss(SimLoss* loss);
+
+            /**
+             * Path loss between radios without an explicit link
+             * @param db loss in dB, default 100
+             */
+            void SetPathLoss(double db);
+
+            /**
+             * Path loss of one link, applies in both directions
+             * @param db loss in dB
+             */
+            void SetPathLoss(const SimRadio* a, const SimRadio* b, double db);
+
+            /**
+             * Standard deviation of log-normal fading added per frame and receiver
+             * @param sigma dB, default 0
+             */
+            void SetFading(double sigma);
+
+            /**
+             * Minimum margin of a frame over each co-channel interferer to survive
+             * @param db default 6
+             */
+            void SetCaptureThreshold(double db);
+
+            /**
+             * Receiver noise figure used for the noise floor
+             * @param db default 6
+             */
+            void SetNoiseFigure(double db);
+
+            /**
+             * Put a frame on the air starting now
+             * Every attached radio except the sender is offered the frame.
+             * @param frame frame to send, Id, Start and End are filled in
+             * @param airtime microseconds
+             * @return frame id
+             */
+            uint32_t Transmit(SimFrame& frame, uint64_t airtime);
+
+            /**
+             * Strongest signal on a channel at a radio, or the noise floor when the channel is idle
+             * @param listener radio measuring
+             * @param frequency channel in Hz
+             * @param bandwidth channel bandwidth in Hz
+             * @return dBm
+             */
+            double ChannelRssi(const SimRadio* listener, uint32_t frequency, uint32_t bandwidth) const;
+
+            /**
+             * Whether a frame with a spreading factor is on a channel, used for CAD
+             */
+            bool ChannelActivity(const SimRadio* listener, uint32_t frequency, uint32_t bandwidth, uint8_t sf) const;
+
+            /**
+             * Check whether a locked frame survives interference at a receiver
+             * @param frame frame the receiver locked on
+             * @param listener receiving radio, a monitor passes the radio it transmits with
+             * @param rssi received signal strength of the frame
+             * @return true if the frame is received intact
+             */
+            bool Survives(const SimFrame& frame, const SimRadio* listener, double rssi);
+
+            /**
+             * Received signal strength of a frame at a radio including fading
+             */
+            double Rssi(const SimFrame& frame, const SimRadio* listener);
+
+            double NoiseFloor(uint32_t bandwidth) const;
+
+            /**
+             * Lowest SNR a LoRa receiver demodulates at
+             * @param sf spreading factor, 0 for FSK
+             * @return dB
+             */
+            static double DemodulationFloor(uint8_t sf);
+
+            uint32_t Random();
+
+            const Stats& GetStats() const;
+            void ResetStats();
+
+            /**
+             * Record that a receiver was listening on a frame but the frame was too weak
+             */
+            void CountBelowSensitivity();
+
+        private:
+            double PathLoss(const SimRadio* a, const SimRadio* b) const;
+            bool SameChannel(const SimFrame& frame, uint32_t frequency, uint32_t bandwidth) const;
+            void Start(uint32_t id);
+            void EndNext();
+            bool OnAir(const SimFrame& frame) const;
+            const SimFrame* Find(uint32_t id) const;
+            void Prune();
+
+            SimClock& _clock;
+            std::vector<SimRadio*> _radios;
+            std::vector<SimMonitor*> _monitors;
+            SimLoss* _loss;
+            std::map<std::pair<const SimRadio*, const SimRadio*>, double> _links;
+            std::deque<SimFrame> _frames;       //!< on the air or recently ended, ordered by start
+            std::vector<uint32_t> _ended;       //!< ids of frames in _frames that are off the air
+            std::mt19937 _random;
+            std::normal_distribution<double> _fading;
+            double _pathLoss;
+            double _sigma;
+            double _capture;
+            double _noiseFigure;
+            uint32_t _nextId;
+            Stats _stats;
+    };
+
+}
+
+#endif
@@ -0,0 +1,821 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimNetworkServer in-process gateway and network server for host simulation
+ *
+ */
+
+#include "SimNetworkServer.h"
+#include "SimLoRaWAN.h"
+#include "MacCommandCodec.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint64_t FRAGMENT_GAP = 100000;       //!< us between multicast fragments
+    const uint64_t SESSION_GUARD = 1000000;     //!< us after the session start before the first fragment
+
+    uint32_t BandwidthIndex(uint32_t bandwidth) {
+        switch (bandwidth) {
+            case 250000:
+                return BW_250;
+            case 500000:
+                return BW_500;
+            default:
+                return BW_125;
+        }
+    }
+
+}
+
+SimNetworkServerConfig::SimNetworkServerConfig()
+:   Region(SimRegion::US915()),
+    NetId(0x000013),
+    JoinDelay(PUBLIC_JOIN_DELAY),
+    RxDelay(DEFAULT_RX_DELAY),
+    Power(27),
+    Adr(true),
+    AdrMargin(10.0),
+    Seed(1)
+{
+}
+
+SimNetworkServer::SimNetworkServer(SimMedium& medium, const SimNetworkServerConfig& config)
+:   _medium(medium),
+    _clock(medium.Clock()),
+    _config(config),
+    _radio(medium),
+    _random(config.Seed),
+    _appNonce(1)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _fota.Active = false;
+    _fota.Next = 0;
+    _fota.Uncoded = 0;
+    _fota.Parity = 0;
+
+    _radio.Init(this);
+    _radio.SetModem(SxRadio::MODEM_LORA);
+    _radio.Sleep();
+    _medium.Attach(this);
+}
+
+SimNetworkServer::~SimNetworkServer() {
+    _medium.Detach(this);
+}
+
+void SimNetworkServer::AddDevice(const uint8_t* devEui, const uint8_t* appEui, const uint8_t* appKey) {
+    Device device;
+
+    memcpy(device.DevEui, devEui, sizeof(device.DevEui));
+    memcpy(device.AppEui, appEui, sizeof(device.AppEui));
+    memcpy(device.AppKey, appKey, sizeof(device.AppKey));
+    device.Joined = false;
+    device.Address = 0;
+    device.HasUplink = false;
+    device.FCntUp = 0;
+    device.FCntDown = 0;
+    device.Count = 0;
+    device.Head = 0;
+    device.Datarate = 0;
+    device.PowerIndex = 0;
+
+    _devices.push_back(device);
+}
+
+SimNetworkServer::Device* SimNetworkServer::Find(const uint8_t* devEui) {
+    for (size_t i = 0; i < _devices.size(); i++) {
+        if (memcmp(_devices[i].DevEui, devEui, sizeof(_devices[i].DevEui)) == 0) {
+            return &_devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+const SimNetworkServer::Device* SimNetworkServer::Find(const uint8_t* devEui) const {
+    return const_cast<SimNetworkServer*>(this)->Find(devEui);
+}
+
+SimNetworkServer::Device* SimNetworkServer::FindAddress(uint32_t address) {
+    std::map<uint32_t, size_t>::iterator it = _addresses.find(address);
+    return it == _addresses.end() ? NULL : &_devices[it->second];
+}
+
+bool SimNetworkServer::Joined(const uint8_t* devEui) const {
+    const Device* device = Find(devEui);
+    return device != NULL && device->Joined;
+}
+
+bool SimNetworkServer::Queue(const uint8_t* devEui, uint8_t port, const std::vector<uint8_t>& payload, bool confirmed) {
+    Device* device = Find(devEui);
+
+    if (device == NULL) {
+        return false;
+    }
+
+    AppDownlink downlink;
+    downlink.Port = port;
+    downlink.Payload = payload;
+    downlink.Confirmed = confirmed;
+    downlink.SessionStart = false;
+    downlink.AwaitAnswer = false;
+    device->Queue.push_back(downlink);
+
+    return true;
+}
+
+uint32_t SimNetworkServer::GpsTime() const {
+    return SIM_GPS_START + (uint32_t) (_clock.Now() / 1000000);
+}
+
+SimRadio& SimNetworkServer::Radio() {
+    return _radio;
+}
+
+const SimNetworkServer::Stats& SimNetworkServer::GetStats() const {
+    return _stats;
+}
+
+double SimNetworkServer::Sensitivity(uint8_t datarate) const {
+    const SimRegion::Datarate& dr = _config.Region.Datarates[datarate];
+    return SimMedium::DemodulationFloor(dr.SpreadingFactor) + _medium.NoiseFloor(dr.Bandwidth);
+}
+
+bool SimNetworkServer::Sending(uint64_t start, uint64_t end) const {
+    for (size_t i = 0; i < _sent.size(); i++) {
+        if (_sent[i].first < end && _sent[i].second > start) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SimNetworkServer::Heard(const SimFrame& frame, double& snr) {
+    // half duplex, nothing is heard while the gateway sends
+    if (Sending(frame.Start, frame.End)) {
+        _stats.Missed++;
+        return false;
+    }
+
+    double rssi = _medium.Rssi(frame, &_radio);
+    snr = rssi - _medium.NoiseFloor(frame.Bandwidth);
+
+    if (snr < SimMedium::DemodulationFloor(frame.SpreadingFactor)) {
+        _medium.CountBelowSensitivity();
+        return false;
+    }
+
+    return _medium.Survives(frame, &_radio, rssi);
+}
+
+void SimNetworkServer::FrameEnd(const SimFrame& frame) {
+    if (frame.Sender == &_radio || frame.IqInverted || frame.Payload.empty()) {
+        return;
+    }
+
+    int channel = _config.Region.FindChannel(frame.Frequency);
+    int datarate = _config.Region.FindDatarate(frame.SpreadingFactor, frame.Bandwidth);
+
+    if (channel < 0 || datarate < 0) {
+        return;
+    }
+
+    double snr = 0.0;
+
+    if (!Heard(frame, snr)) {
+        return;
+    }
+
+    // drop gateway transmissions that ended long ago
+    while (!_sent.empty() && _sent.front().second + 60000000ULL < _clock.Now()) {
+        _sent.pop_front();
+    }
+
+    uint8_t type = frame.Payload[PKT_HEADER] >> 5;
+
+    if (type == FRAME_TYPE_JOIN_REQ) {
+        Join(frame, channel, datarate);
+    } else if (type == FRAME_TYPE_DATA_UNCONFIRMED_UP || type == FRAME_TYPE_DATA_CONFIRMED_UP) {
+        Uplink(frame, channel, datarate, snr);
+    }
+}
+
+void SimNetworkServer::Join(const SimFrame& frame, int channel, int datarate) {
+    const SimRegion& region = _config.Region;
+    uint8_t appEui[8];
+    uint8_t devEui[8];
+    uint16_t devNonce = 0;
+
+    if (!SimLoRaWAN::PeekJoinRequest(frame.Payload.data(), frame.Payload.size(), appEui, devEui, devNonce)) {
+        return;
+    }
+
+    Device* device = Find(devEui);
+
+    if (device == NULL || memcmp(device->AppEui, appEui, sizeof(appEui)) != 0) {
+        logDebug("join from unknown device");
+        return;
+    }
+
+    if (!SimLoRaWAN::CheckJoinRequest(frame.Payload.data(), frame.Payload.size(), device->AppKey)) {
+        _stats.MicFailures++;
+        return;
+    }
+
+    if (std::find(device->DevNonces.begin(), device->DevNonces.end(), devNonce) != device->DevNonces.end()) {
+        logWarning("join with a used DevNonce %u rejected", devNonce);
+        return;
+    }
+
+    device->DevNonces.push_back(devNonce);
+
+    uint8_t appNonce[3];
+    uint8_t netId[3];
+    uint8_t cfList[16];
+    SimLoRaWAN::PutUint24(appNonce, _appNonce++);
+    SimLoRaWAN::PutUint24(netId, _config.NetId);
+    region.JoinCFList(cfList);
+
+    if (device->Joined) {
+        _addresses.erase(device->Address);
+    }
+
+    // NwkID is the low 7 bits of the NetID
+    device->Address = ((_config.NetId & 0x7F) << 25) | (uint32_t) (device - &_devices[0] + 1);
+    _addresses[device->Address] = device - &_devices[0];
+
+    SimLoRaWAN::SessionKeys(device->AppKey, appNonce, netId, devNonce, device->NwkSKey, device->AppSKey);
+    device->Joined = true;
+    device->HasUplink = false;
+    device->FCntUp = 0;
+    device->FCntDown = 0;
+    device->Count = 0;
+    device->Head = 0;
+    device->Datarate = datarate;
+    device->PowerIndex = 0;
+    device->MacAnswers.clear();
+
+    Transmission tx;
+    SimLoRaWAN::EncodeJoinAccept(appNonce, netId, device->Address, region.Rx2Datarate, _config.RxDelay / 1000, cfList, device->AppKey, tx.Frame);
+
+    tx.At = frame.End + (uint64_t) _config.JoinDelay * 1000;
+    tx.Frequency = region.Channels[channel].Rx1Frequency;
+    tx.Modulation = region.Rx1[datarate];
+    tx.HasFallback = true;
+    tx.FallbackAt = tx.At + (uint64_t) RX2_DELAY_OFFSET * 1000;
+
+    _stats.Joins++;
+    Schedule(tx);
+}
+
+void SimNetworkServer::Uplink(const SimFrame& frame, int channel, int datarate, double snr) {
+    uint32_t address = 0;
+
+    if (!SimLoRaWAN::PeekAddress(frame.Payload.data(), frame.Payload.size(), address)) {
+        return;
+    }
+
+    Device* device = FindAddress(address);
+
+    if (device == NULL) {
+        return;
+    }
+
+    SimDataFrame data;
+
+    if (!SimLoRaWAN::DecodeData(frame.Payload.data(), frame.Payload.size(), device->NwkSKey, device->AppSKey,
+                                device->HasUplink ? device->FCntUp : 0, data)) {
+        _stats.MicFailures++;
+        return;
+    }
+
+    bool confirmed = data.Type == FRAME_TYPE_DATA_CONFIRMED_UP;
+
+    if (device->HasUplink && data.Counter <= device->FCntUp) {
+        if (data.Counter == device->FCntUp && confirmed) {
+            // the ACK was lost, acknowledge the retransmission without processing it again
+            _stats.Duplicates++;
+            Answer(*device, frame, channel, datarate, true);
+        }
+        return;
+    }
+
+    device->HasUplink = true;
+    device->FCntUp = data.Counter;
+    _stats.Uplinks++;
+
+    MacCommands(*device, data.Options, data.OptionsLength, frame, snr);
+
+    if (data.HasPort && data.Port == 0) {
+        MacCommands(*device, data.Payload.data(), data.Payload.size(), frame, snr);
+    } else if (data.HasPort) {
+        Application(*device, data.Port, data.Payload, frame);
+    }
+
+    std::vector<uint8_t> commands;
+
+    if (_config.Adr && (data.Control & SIM_FCTRL_ADR) && Adr(*device, datarate, snr, commands)) {
+        device->MacAnswers.insert(device->MacAnswers.end(), commands.begin(), commands.end());
+    }
+
+    if (confirmed || (data.Control & SIM_FCTRL_ADR_ACK_REQ) || !device->MacAnswers.empty() || !device->Queue.empty()) {
+        Answer(*device, frame, channel, datarate, confirmed);
+    }
+}
+
+void SimNetworkServer::MacCommands(Device& device, const uint8_t* data, uint8_t size, const SimFrame& frame, double snr) {
+    uint8_t i = 0;
+
+    while (i < size) {
+        uint8_t cid = data[i];
+        uint8_t length = MacCommandCodec::MoteCommandSize(cid);
+
+        if (length == MAC_CMD_SIZE_UNKNOWN || length == MAC_CMD_SIZE_PLAN || i + length > size) {
+            logWarning("uplink MAC command %02X not understood", cid);
+            return;
+        }
+
+        switch (cid) {
+            case MOTE_MAC_LINK_CHECK_REQ: {
+                uint8_t margin = (uint8_t) std::max(0.0, snr - SimMedium::DemodulationFloor(frame.SpreadingFactor));
+                device.MacAnswers.push_back(SRV_MAC_LINK_CHECK_ANS);
+                device.MacAnswers.push_back(margin);
+                device.MacAnswers.push_back(1);
+                break;
+            }
+            case MOTE_MAC_LINK_ADR_ANS:
+                if ((data[i + 1] & 0x07) != 0x07) {
+                    // the device kept its settings, start over at what it sends with
+                    _stats.LinkAdrRejected++;
+                    device.Count = 0;
+                    device.Head = 0;
+                }
+                break;
+            case MOTE_MAC_DEVICE_TIME_REQ: {
+                // time of the end of the uplink, fractions in 1/256 s
+                uint64_t end = frame.End;
+                uint8_t answer[6];
+                answer[0] = SRV_MAC_DEVICE_TIME_ANS;
+                SimLoRaWAN::PutUint32(&answer[1], SIM_GPS_START + (uint32_t) (end / 1000000));
+                answer[5] = (uint8_t) ((end % 1000000) * 256 / 1000000);
+                device.MacAnswers.insert(device.MacAnswers.end(), answer, answer + sizeof(answer));
+                break;
+            }
+            default:
+                break;
+        }
+
+        i += length;
+    }
+}
+
+void SimNetworkServer::Application(Device& device, uint8_t port, const std::vector<uint8_t>& payload, const SimFrame& frame) {
+    if (payload.empty()) {
+        return;
+    }
+
+    uint8_t cid = payload[0];
+
+    if (port == SIM_PORT_CLOCK_SYNC && cid == SIM_APP_TIME && payload.size() >= 6) {
+        // DeviceTime was read when the uplink started
+        int32_t correction = (int32_t) (SIM_GPS_START + (uint32_t) (frame.Start / 1000000) - SimLoRaWAN::GetUint32(&payload[1]));
+        uint8_t param = payload[5];
+
+        if (correction == 0 && !(param & 0x10)) {
+            return;
+        }
+
+        AppDownlink downlink;
+        downlink.Port = SIM_PORT_CLOCK_SYNC;
+        downlink.Payload.resize(6);
+        downlink.Payload[0] = SIM_APP_TIME;
+        SimLoRaWAN::PutUint32(&downlink.Payload[1], (uint32_t) correction);
+        downlink.Payload[5] = param & 0x0F;
+        downlink.Confirmed = false;
+        downlink.SessionStart = false;
+        downlink.AwaitAnswer = false;
+        device.Queue.push_front(downlink);
+        return;
+    }
+
+    if (port != SIM_PORT_MULTICAST && port != SIM_PORT_FRAGMENTATION) {
+        return;
+    }
+
+    // answers of the FUOTA setup release the request they answer
+    for (std::deque<AppDownlink>::iterator it = device.Queue.begin(); it != device.Queue.end(); ++it) {
+        if (!it->AwaitAnswer || it->Port != port || it->Payload[0] != cid) {
+            continue;
+        }
+
+        bool failed = payload.size() < 2 || (port == SIM_PORT_MULTICAST ? (payload[1] & 0x1C) != 0 : (payload[1] & 0x0F) != 0);
+
+        if (failed) {
+            logError("FUOTA setup %02X on port %u refused with status %02X", cid, port, payload.size() < 2 ? 0xFF : payload[1]);
+            return;
+        }
+
+        if (it->SessionStart && _fota.Active) {
+            uint32_t start = SimLoRaWAN::GetUint32(&it->Payload[2]) - SIM_GPS_START;
+            uint64_t at = std::max<uint64_t>(_clock.Now(), (uint64_t) start * 1000000 + SESSION_GUARD);
+            _clock.At(at, callback(this, &SimNetworkServer::Fragment));
+        }
+
+        device.Queue.erase(it);
+        return;
+    }
+}
+
+bool SimNetworkServer::Adr(Device& device, uint8_t datarate, double snr, std::vector<uint8_t>& commands) {
+    const SimRegion& region = _config.Region;
+
+    if (datarate != device.Datarate) {
+        // the device backed off or missed a LinkADRReq, history at the old datarate no longer applies
+        device.Datarate = datarate;
+        device.PowerIndex = 0;
+        device.Count = 0;
+        device.Head = 0;
+    }
+
+    device.Snr[device.Head] = snr;
+    device.Head = (device.Head + 1) % ADR_HISTORY;
+    if (device.Count < ADR_HISTORY) {
+        device.Count++;
+    }
+
+    if (device.Count < ADR_HISTORY) {
+        return false;
+    }
+
+    double best = device.Snr[0];
+    for (uint8_t i = 1; i < ADR_HISTORY; i++) {
+        best = std::max(best, device.Snr[i]);
+    }
+
+    // same rule as SimFleet, datarate first then power in 3 dB steps
+    double rssi = best + _medium.NoiseFloor(region.Datarates[datarate].Bandwidth);
+    uint8_t target = datarate;
+    uint8_t powerIndex = device.PowerIndex;
+
+    while (target < region.MaxDatarate && region.Datarates[target + 1].Bandwidth == region.Datarates[target].Bandwidth
+            && rssi - Sensitivity(target + 1) >= _config.AdrMargin) {
+        target++;
+    }
+
+    int steps = (int) floor((rssi - Sensitivity(target) - _config.AdrMargin) / 3.0);
+
+    while (steps > 0 && powerIndex < region.MaxPowerIndex) {
+        powerIndex++;
+        steps--;
+    }
+
+    while (steps < 0 && powerIndex > 0) {
+        powerIndex--;
+        steps++;
+    }
+
+    if (target == datarate && powerIndex == device.PowerIndex) {
+        return false;
+    }
+
+    uint16_t masks[5] = { 0, 0, 0, 0, 0 };
+    uint8_t blocks[5];
+    uint16_t values[5];
+    uint8_t count = 0;
+
+    for (size_t i = 0; i < region.Channels.size(); i++) {
+        masks[region.Channels[i].Index / 16] |= 1 << (region.Channels[i].Index % 16);
+    }
+
+    if (region.FixedChannels()) {
+        // ChMaskCntl 7 turns every 125k channel off and sets the 500k ones, then each 125k block is enabled
+        blocks[count] = 7;
+        values[count++] = masks[4];
+
+        for (uint8_t b = 0; b < 4; b++) {
+            if (masks[b] != 0) {
+                blocks[count] = b;
+                values[count++] = masks[b];
+            }
+        }
+    } else {
+        blocks[count] = 0;
+        values[count++] = masks[0];
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        commands.push_back(SRV_MAC_LINK_ADR_REQ);
+        commands.push_back((target << 4) | powerIndex);
+        commands.push_back(values[i] & 0xFF);
+        commands.push_back(values[i] >> 8);
+        commands.push_back((blocks[i] << 4) | 1);
+    }
+
+    _stats.LinkAdrReqs++;
+    device.Datarate = target;
+    device.PowerIndex = powerIndex;
+    device.Count = 0;
+    device.Head = 0;
+
+    return true;
+}
+
+void SimNetworkServer::Answer(Device& device, const SimFrame& frame, int channel, int datarate, bool ack) {
+    const SimRegion& region = _config.Region;
+    SimDataFrame data;
+
+    data.Address = device.Address;
+    data.Counter = device.FCntDown;
+    data.Type = FRAME_TYPE_DATA_UNCONFIRMED_DOWN;
+    data.Control = (_config.Adr ? SIM_FCTRL_ADR : 0) | (ack ? SIM_FCTRL_ACK : 0);
+
+    // whole commands only, the rest waits for the next downlink
+    size_t used = 0;
+    while (used < device.MacAnswers.size()) {
+        uint8_t length = MacCommandCodec::ServerCommandSize(device.MacAnswers[used]);
+
+        if (length == MAC_CMD_SIZE_UNKNOWN || length == MAC_CMD_SIZE_PLAN) {
+            length = 5;
+        }
+
+        if (used + length > sizeof(data.Options)) {
+            break;
+        }
+
+        used += length;
+    }
+
+    memcpy(data.Options, device.MacAnswers.data(), used);
+    data.OptionsLength = used;
+    device.MacAnswers.erase(device.MacAnswers.begin(), device.MacAnswers.begin() + used);
+
+    uint64_t at = frame.End + (uint64_t) _config.RxDelay * 1000;
+
+    if (!device.Queue.empty()) {
+        AppDownlink& downlink = device.Queue.front();
+
+        if (downlink.SessionStart) {
+            // the session starts a lead time after this downlink
+            SimLoRaWAN::PutUint32(&downlink.Payload[2], SIM_GPS_START + (uint32_t) (at / 1000000) + _fota.Lead);
+        }
+
+        data.HasPort = true;
+        data.Port = downlink.Port;
+        data.Payload = downlink.Payload;
+
+        if (downlink.Confirmed) {
+            data.Type = FRAME_TYPE_DATA_CONFIRMED_DOWN;
+        }
+
+        if (!downlink.AwaitAnswer) {
+            device.Queue.pop_front();
+        }
+    }
+
+    if (!device.Queue.empty() || !device.MacAnswers.empty()) {
+        data.Control |= SIM_FCTRL_PENDING;
+    }
+
+    if (!ack && data.OptionsLength == 0 && !data.HasPort) {
+        return;
+    }
+
+    device.FCntDown++;
+
+    Transmission tx;
+    SimLoRaWAN::EncodeData(data, device.NwkSKey, device.AppSKey, tx.Frame);
+    tx.At = at;
+    tx.Frequency = region.Channels[channel].Rx1Frequency;
+    tx.Modulation = region.Rx1[datarate];
+    tx.HasFallback = true;
+    tx.FallbackAt = at + (uint64_t) RX2_DELAY_OFFSET * 1000;
+
+    Schedule(tx);
+}
+
+void SimNetworkServer::Schedule(const Transmission& tx) {
+    const SimRegion& region = _config.Region;
+    Transmission sched = tx;
+    uint64_t airtime = SimRadio::LoRaAirtime(sched.Modulation.SpreadingFactor, sched.Modulation.Bandwidth, DEFAULT_CODE_RATE,
+                                             DEFAULT_PREAMBLE_LEN, false, false, sched.Frame.size());
+
+    if (Sending(sched.At, sched.At + airtime)) {
+        if (!sched.HasFallback) {
+            _stats.DownlinksBlocked++;
+            return;
+        }
+
+        sched.At = sched.FallbackAt;
+        sched.Frequency = region.Rx2Frequency;
+        sched.Modulation = region.Downlink[region.Rx2Datarate];
+        sched.HasFallback = false;
+        airtime = SimRadio::LoRaAirtime(sched.Modulation.SpreadingFactor, sched.Modulation.Bandwidth, DEFAULT_CODE_RATE,
+                                        DEFAULT_PREAMBLE_LEN, false, false, sched.Frame.size());
+
+        if (Sending(sched.At, sched.At + airtime)) {
+            _stats.DownlinksBlocked++;
+            return;
+        }
+    }
+
+    _sent.push_back(std::make_pair(sched.At, sched.At + airtime));
+    _pending.insert(std::make_pair(sched.At, sched));
+    _clock.At(sched.At, callback(this, &SimNetworkServer::SendNext));
+}
+
+void SimNetworkServer::SendNext() {
+    if (_pending.empty() || _pending.begin()->first > _clock.Now()) {
+        return;
+    }
+
+    Transmission tx = _pending.begin()->second;
+    _pending.erase(_pending.begin());
+
+    _radio.SetChannel(tx.Frequency);
+    _radio.SetTxConfig(SxRadio::MODEM_LORA, _config.Power, 0, BandwidthIndex(tx.Modulation.Bandwidth), tx.Modulation.SpreadingFactor,
+                       DEFAULT_CODE_RATE, DEFAULT_PREAMBLE_LEN, false, false, false, 0, true, 3000);
+    _radio.Send(tx.Frame.data(), tx.Frame.size());
+    _stats.Downlinks++;
+}
+
+void SimNetworkServer::TxDone() {
+    _radio.Sleep();
+}
+
+bool SimNetworkServer::StartFota(const uint8_t* devEui, const std::vector<uint8_t>& image, uint8_t fragmentSize, uint16_t parity,
+                                 uint8_t datarate, uint32_t frequency, uint32_t lead) {
+    Device* device = Find(devEui);
+
+    if (device == NULL || !device->Joined || _fota.Active || fragmentSize == 0 || image.empty()) {
+        return false;
+    }
+
+    uint8_t mcKey[16];
+    uint8_t mcKEKey[16];
+    uint8_t encrypted[16];
+
+    for (uint8_t i = 0; i < sizeof(mcKey); i++) {
+        mcKey[i] = (uint8_t) _random();
+    }
+
+    _fota.Active = true;
+    _fota.Address = 0xFC000000 | (_random() & 0x00FFFFFF);
+    _fota.Counter = 0;
+    _fota.Frequency = frequency;
+    _fota.Datarate = datarate;
+    _fota.Lead = lead;
+    _fota.Image = image;
+    _fota.FragmentSize = fragmentSize;
+    _fota.Uncoded = (image.size() + fragmentSize - 1) / fragmentSize;
+    _fota.Parity = parity;
+    _fota.Next = 1;
+
+    SimLoRaWAN::MulticastKeys(mcKey, _fota.Address, _fota.NwkSKey, _fota.AppSKey);
+    SimLoRaWAN::McKEKey(device->AppKey, mcKEKey);
+    // the device encrypts with the McKEKey to recover the McKey
+    SimLoRaWAN::Decrypt(mcKEKey, mcKey, encrypted);
+
+    uint16_t total = _fota.Uncoded + _fota.Parity;
+    uint64_t airtime = SimRadio::LoRaAirtime(_config.Region.Downlink[datarate].SpreadingFactor, _config.Region.Downlink[datarate].Bandwidth,
+                                             DEFAULT_CODE_RATE, DEFAULT_PREAMBLE_LEN, false, false, FRAME_OVERHEAD + 3 + fragmentSize);
+    uint64_t duration = (SESSION_GUARD + total * (airtime + FRAGMENT_GAP)) / 1000000 + 1;
+    uint8_t timeout = 0;
+
+    while (timeout < 15 && (1ULL << timeout) < duration) {
+        timeout++;
+    }
+
+    AppDownlink downlink;
+    downlink.Confirmed = false;
+    downlink.AwaitAnswer = true;
+    downlink.SessionStart = false;
+
+    // McGroupSetupReq group 0, frame counters 0 to the last fragment
+    downlink.Port = SIM_PORT_MULTICAST;
+    downlink.Payload.assign(30, 0);
+    downlink.Payload[0] = SIM_MC_GROUP_SETUP;
+    SimLoRaWAN::PutUint32(&downlink.Payload[2], _fota.Address);
+    memcpy(&downlink.Payload[6], encrypted, sizeof(encrypted));
+    SimLoRaWAN::PutUint32(&downlink.Payload[22], 0);
+    SimLoRaWAN::PutUint32(&downlink.Payload[26], total);
+    device->Queue.push_back(downlink);
+
+    // FragSessionSetupReq index 0 on group 0
+    uint8_t padding = _fota.Uncoded * fragmentSize - image.size();
+    downlink.Port = SIM_PORT_FRAGMENTATION;
+    downlink.Payload.assign(11, 0);
+    downlink.Payload[0] = SIM_FRAG_SESSION_SETUP;
+    downlink.Payload[1] = 0x01;
+    SimLoRaWAN::PutUint16(&downlink.Payload[2], _fota.Uncoded);
+    downlink.Payload[4] = fragmentSize;
+    downlink.Payload[5] = 0;
+    downlink.Payload[6] = padding;
+    device->Queue.push_back(downlink);
+
+    // McClassCSessionReq, the session time is filled in when it is sent
+    downlink.Port = SIM_PORT_MULTICAST;
+    downlink.Payload.assign(11, 0);
+    downlink.Payload[0] = SIM_MC_CLASS_C_SESSION;
+    downlink.Payload[6] = timeout;
+    SimLoRaWAN::PutUint24(&downlink.Payload[7], frequency / 100);
+    downlink.Payload[10] = datarate;
+    downlink.SessionStart = true;
+    device->Queue.push_back(downlink);
+
+    logInfo("FUOTA %u bytes in %u+%u fragments of %u to %08X", image.size(), _fota.Uncoded, _fota.Parity, fragmentSize, _fota.Address);
+    return true;
+}
+
+bool SimNetworkServer::FotaSent() const {
+    return !_fota.Active && _fota.Next > 0;
+}
+
+void SimNetworkServer::FragmentPayload(uint16_t index, std::vector<uint8_t>& payload) const {
+    uint8_t size = _fota.FragmentSize;
+
+    payload.assign(3 + size, 0);
+    payload[0] = SIM_DATA_FRAGMENT;
+    SimLoRaWAN::PutUint16(&payload[1], index & 0x3FFF);
+
+    if (index <= _fota.Uncoded) {
+        size_t offset = (size_t) (index - 1) * size;
+        size_t count = std::min<size_t>(size, _fota.Image.size() - offset);
+        memcpy(&payload[3], &_fota.Image[offset], count);
+        return;
+    }
+
+    // coded fragment, XOR of the uncoded fragments selected by the parity row
+    std::vector<uint8_t> row;
+    SimLoRaWAN::ParityRow(index - _fota.Uncoded, _fota.Uncoded, row);
+
+    for (uint16_t j = 0; j < _fota.Uncoded; j++) {
+        if (!row[j]) {
+            continue;
+        }
+
+        size_t offset = (size_t) j * size;
+        size_t count = std::min<size_t>(size, _fota.Image.size() - offset);
+
+        for (size_t k = 0; k < count; k++) {
+            payload[3 + k] ^= _fota.Image[offset + k];
+        }
+    }
+}
+
+void SimNetworkServer::Fragment() {
+    if (!_fota.Active) {
+        return;
+    }
+
+    SimDataFrame data;
+    data.Type = FRAME_TYPE_DATA_UNCONFIRMED_DOWN;
+    data.Address = _fota.Address;
+    data.Counter = _fota.Counter++;
+    data.HasPort = true;
+    data.Port = SIM_PORT_FRAGMENTATION;
+    FragmentPayload(_fota.Next, data.Payload);
+
+    Transmission tx;
+    SimLoRaWAN::EncodeData(data, _fota.NwkSKey, _fota.AppSKey, tx.Frame);
+    tx.Frequency = _fota.Frequency;
+    tx.Modulation = _config.Region.Downlink[_fota.Datarate];
+    tx.HasFallback = false;
+    tx.FallbackAt = 0;
+
+    uint64_t airtime = SimRadio::LoRaAirtime(tx.Modulation.SpreadingFactor, tx.Modulation.Bandwidth, DEFAULT_CODE_RATE,
+                                             DEFAULT_PREAMBLE_LEN, false, false, tx.Frame.size());
+    tx.At = _clock.Now();
+
+    // class A answers have the gateway first, the fragment waits for the radio
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        for (size_t i = 0; i < _sent.size(); i++) {
+            if (_sent[i].first < tx.At + airtime && _sent[i].second > tx.At) {
+                tx.At = _sent[i].second + 1000;
+                moved = true;
+            }
+        }
+    }
+
+    Schedule(tx);
+    _stats.Fragments++;
+
+    if (++_fota.Next > _fota.Uncoded + _fota.Parity) {
+        _fota.Active = false;
+        return;
+    }
+
+    _clock.At(tx.At + airtime + FRAGMENT_GAP, callback(this, &SimNetworkServer::Fragment));
+}
@@ -0,0 +1,212 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimNetworkServer in-process gateway and network server for host simulation
+ *
+ * @details A single gateway that hears every channel and spreading factor of a SimRegion
+ *          through a SimMonitor and answers through its own SimRadio.  It joins provisioned
+ *          devices over the air, checks and decrypts uplinks, acknowledges confirmed frames,
+ *          runs ADR, answers LinkCheckReq and DeviceTimeReq, and serves the application
+ *          packages of a FUOTA campaign: clock sync on port 202, remote multicast setup on
+ *          port 200 and fragmented data blocks on port 201.  Downlinks go out in RX1, or in
+ *          RX2 when the gateway is already sending at RX1.
+ *
+ */
+
+#ifndef __LORA_SIM_NETWORK_SERVER_H__
+#define __LORA_SIM_NETWORK_SERVER_H__
+
+#include "SimMedium.h"
+#include "SimRadio.h"
+#include "SimRegion.h"
+#include "SxRadioEvents.h"
+#include <deque>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace lora {
+
+    struct SimNetworkServerConfig {
+        SimNetworkServerConfig();
+
+        SimRegion Region;
+        uint32_t NetId;
+        uint16_t JoinDelay;                 //!< ms from the join request to RX1
+        uint16_t RxDelay;                   //!< ms from an uplink to RX1
+        int8_t Power;                       //!< gateway dBm
+        bool Adr;
+        double AdrMargin;                   //!< dB kept over the demodulation floor
+        uint32_t Seed;                      //!< join nonces and multicast keys
+    };
+
+    class SimNetworkServer : public SimMonitor, public SxRadioEvents {
+        public:
+            /**
+             * Counters of network server activity
+             */
+            struct Stats {
+                uint32_t Joins;
+                uint32_t Uplinks;               //!< data frames accepted
+                uint32_t Duplicates;            //!< retransmissions of an accepted frame
+                uint32_t MicFailures;
+                uint32_t Missed;                //!< frames lost while the gateway was sending
+                uint32_t Downlinks;
+                uint32_t DownlinksBlocked;      //!< no free window, the gateway was sending at RX1 and RX2
+                uint32_t LinkAdrReqs;
+                uint32_t LinkAdrRejected;       //!< LinkADRAns with a status bit clear
+                uint32_t Fragments;             //!< multicast fragments sent
+            };
+
+            /**
+             * @param medium air interface the gateway radio is attached to
+             */
+            SimNetworkServer(SimMedium& medium, const SimNetworkServerConfig& config = SimNetworkServerConfig());
+            virtual ~SimNetworkServer();
+
+            /**
+             * Provision a device for OTAA
+             * @param devEui 8 bytes, MSB first
+             * @param appEui 8 bytes, MSB first
+             * @param appKey 16 bytes
+             */
+            void AddDevice(const uint8_t* devEui, const uint8_t* appEui, const uint8_t* appKey);
+
+            /**
+             * Whether a provisioned device has an active session
+             */
+            bool Joined(const uint8_t* devEui) const;
+
+            /**
+             * Queue an application downlink for the next class A window of a device
+             * @return false if the device is unknown
+             */
+            bool Queue(const uint8_t* devEui, uint8_t port, const std::vector<uint8_t>& payload, bool confirmed = false);
+
+            /**
+             * Start a FUOTA campaign to one device
+             * Queues McGroupSetupReq, FragSessionSetupReq and McClassCSessionReq for the device class A
+             * windows, then sends the image as multicast fragments from the session start.
+             * @param image data block to transfer
+             * @param fragmentSize bytes of image per fragment
+             * @param parity number of coded fragments sent after the uncoded ones
+             * @param datarate multicast downlink datarate
+             * @param frequency multicast frequency in Hz
+             * @param lead seconds between the McClassCSessionReq downlink and the session start
+             * @return false if the device has not joined or a campaign is running
+             */
+            bool StartFota(const uint8_t* devEui, const std::vector<uint8_t>& image, uint8_t fragmentSize, uint16_t parity,
+                           uint8_t datarate, uint32_t frequency, uint32_t lead);
+
+            /**
+             * Whether the fragments of the last campaign are all sent
+             */
+            bool FotaSent() const;
+
+            /**
+             * Network GPS time
+             * @return seconds
+             */
+            uint32_t GpsTime() const;
+
+            SimRadio& Radio();
+            const Stats& GetStats() const;
+
+            virtual void FrameEnd(const SimFrame& frame);
+            virtual void TxDone();
+
+        private:
+            static const uint8_t ADR_HISTORY = 20;
+
+            struct AppDownlink {
+                uint8_t Port;
+                std::vector<uint8_t> Payload;
+                bool Confirmed;
+                bool AwaitAnswer;               //!< FUOTA setup request, sent again until the device answers it
+                bool SessionStart;              //!< McClassCSessionReq, the session time is set when it is sent
+            };
+
+            struct Device {
+                uint8_t DevEui[8];
+                uint8_t AppEui[8];
+                uint8_t AppKey[16];
+                std::vector<uint16_t> DevNonces;
+                bool Joined;
+                uint32_t Address;
+                uint8_t NwkSKey[16];
+                uint8_t AppSKey[16];
+                bool HasUplink;
+                uint32_t FCntUp;
+                uint32_t FCntDown;
+                double Snr[ADR_HISTORY];
+                uint8_t Count;
+                uint8_t Head;
+                uint8_t Datarate;
+                uint8_t PowerIndex;
+                std::vector<uint8_t> MacAnswers;
+                std::deque<AppDownlink> Queue;
+            };
+
+            struct Transmission {
+                uint64_t At;
+                uint32_t Frequency;
+                SimRegion::Datarate Modulation;
+                std::vector<uint8_t> Frame;
+                bool HasFallback;               //!< RX2 if the gateway is sending at RX1
+                uint64_t FallbackAt;
+            };
+
+            struct Fota {
+                bool Active;
+                uint32_t Address;
+                uint8_t NwkSKey[16];
+                uint8_t AppSKey[16];
+                uint32_t Counter;
+                uint32_t Frequency;
+                uint8_t Datarate;
+                uint32_t Lead;
+                std::vector<uint8_t> Image;
+                uint8_t FragmentSize;
+                uint16_t Uncoded;
+                uint16_t Parity;
+                uint16_t Next;                  //!< next fragment index counted from 1
+            };
+
+            Device* Find(const uint8_t* devEui);
+            const Device* Find(const uint8_t* devEui) const;
+            Device* FindAddress(uint32_t address);
+            bool Heard(const SimFrame& frame, double& snr);
+            void Join(const SimFrame& frame, int channel, int datarate);
+            void Uplink(const SimFrame& frame, int channel, int datarate, double snr);
+            void MacCommands(Device& device, const uint8_t* data, uint8_t size, const SimFrame& frame, double snr);
+            void Application(Device& device, uint8_t port, const std::vector<uint8_t>& payload, const SimFrame& frame);
+            bool Adr(Device& device, uint8_t datarate, double snr, std::vector<uint8_t>& commands);
+            double Sensitivity(uint8_t datarate) const;
+            void Answer(Device& device, const SimFrame& frame, int channel, int datarate, bool ack);
+            void Schedule(const Transmission& tx);
+            void SendNext();
+            bool Sending(uint64_t start, uint64_t end) const;
+            void Fragment();
+            void FragmentPayload(uint16_t index, std::vector<uint8_t>& payload) const;
+
+            SimMedium& _medium;
+            SimClock& _clock;
+            SimNetworkServerConfig _config;
+            SimRadio _radio;
+            std::vector<Device> _devices;
+            std::map<uint32_t, size_t> _addresses;
+            std::multimap<uint64_t, Transmission> _pending;
+            std::deque<std::pair<uint64_t, uint64_t> > _sent;   //!< recent gateway transmissions
+            std::mt19937 _random;
+            uint32_t _appNonce;
+            Fota _fota;
+            Stats _stats;
+    };
+
+}
+
+#endif
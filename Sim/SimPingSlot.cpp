@@ -0,0 +1,146 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimPingSlot checks of PingSlotSchedule against the class B ping offset
+ *
+ */
+
+#include "SimPingSlot.h"
+#include "PingSlotSchedule.h"
+#include "mbedtls/aes.h"
+#include "MTSLog.h"
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint8_t MAX_PERIODICITY = 7;
+
+    /**
+     * Every ping of a session alone in the schedule, from its offset on
+     */
+    bool CheckSchedule(const PingSlotSchedule& schedule, uint16_t offset, uint16_t period, int8_t id) {
+        if (schedule.Size() != PING_SLOTS_PER_BEACON / period || schedule.Conflicts() != 0 || schedule.Truncated() != 0) {
+            return false;
+        }
+
+        for (uint16_t i = 0; i < schedule.Size(); i++) {
+            PingSlot slot = schedule.At(i);
+
+            if (slot.MSec != BEACON_RESERVED_TIME + (offset + i * period) * PING_SLOT_LENGTH || slot.Id != id) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+SimPingSlotConfig::SimPingSlotConfig() {
+    // AES-128 ECB under a zero key of the beacon time and address, little endian and zero padded, from openssl
+    SimPingSlotVector vectors[9] = {
+        { 0, 0x26011BDA, 55004 },
+        { 0, 0x00000001, 48051 },
+        { 0, 0xFFFFFFFF, 25693 },
+        { 1234567936, 0x26011BDA, 11129 },
+        { 1234567936, 0x00000001, 12367 },
+        { 1234567936, 0xFFFFFFFF, 26548 },
+        { 1356998528, 0x26011BDA, 47648 },
+        { 1356998528, 0x00000001, 38275 },
+        { 1356998528, 0xFFFFFFFF, 62170 }
+    };
+
+    Vectors.assign(vectors, vectors + 9);
+}
+
+bool SimPingSlotReport::Passed() const {
+    return Offsets != 0 && Schedules != 0 && Mismatches == 0;
+}
+
+void SimPingSlotReport::Log() const {
+    logInfo("%lu offsets and %lu schedules checked, %lu mismatches",
+            (unsigned long) Offsets, (unsigned long) Schedules, (unsigned long) Mismatches);
+}
+
+SimPingSlot::SimPingSlot(const SimPingSlotConfig& config)
+:   _config(config)
+{
+}
+
+SimPingSlotReport SimPingSlot::Run() {
+    SimPingSlotReport report;
+
+    report.Offsets = 0;
+    report.Schedules = 0;
+    report.Mismatches = 0;
+
+    // the cipher on its own, FIPS-197 zero key and block
+    const uint8_t zero[16] = { 0 };
+    const uint8_t cipher[16] = { 0x66, 0xE9, 0x4B, 0xD4, 0xEF, 0x8A, 0x2C, 0x3B, 0x88, 0x4C, 0xFA, 0x59, 0xCA, 0x34, 0x2B, 0x2E };
+    uint8_t block[16];
+    mbedtls_aes_context ctx;
+
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, zero, 128);
+    mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, zero, block);
+    mbedtls_aes_free(&ctx);
+
+    if (memcmp(block, cipher, sizeof(block)) != 0) {
+        logError("AES-128 of the zero block is wrong");
+        report.Mismatches++;
+    }
+
+    for (size_t v = 0; v < _config.Vectors.size(); v++) {
+        const SimPingSlotVector& vector = _config.Vectors[v];
+
+        for (uint8_t periodicity = 0; periodicity <= MAX_PERIODICITY; periodicity++) {
+            uint16_t period = 1U << (5 + periodicity);
+            uint16_t expected = vector.Rand % period;
+            uint16_t offset = PingSlotSchedule::PingOffset(vector.BeaconTime, vector.Address, period);
+
+            report.Offsets++;
+
+            if (offset != expected) {
+                logError("beacon %lu address %08lx periodicity %u offset %u, expected %u", (unsigned long) vector.BeaconTime,
+                         (unsigned long) vector.Address, periodicity, offset, expected);
+                report.Mismatches++;
+            }
+
+            Settings settings = Settings();
+            PingSlotSchedule schedule;
+
+            settings.Session.Address = vector.Address;
+            settings.Network.PingPeriodicity = periodicity;
+            schedule.Build(settings, vector.BeaconTime);
+            report.Schedules++;
+
+            if (!CheckSchedule(schedule, expected, period, -1)) {
+                logError("beacon %lu address %08lx periodicity %u unicast schedule wrong", (unsigned long) vector.BeaconTime,
+                         (unsigned long) vector.Address, periodicity);
+                report.Mismatches++;
+            }
+
+            // the same address as the last multicast group
+            settings = Settings();
+            settings.Multicast[MAX_MULTICAST_SESSIONS - 1].Address = vector.Address;
+            settings.Multicast[MAX_MULTICAST_SESSIONS - 1].Active = true;
+            settings.Multicast[MAX_MULTICAST_SESSIONS - 1].Periodicity = periodicity;
+            schedule.Build(settings, vector.BeaconTime, false);
+            report.Schedules++;
+
+            if (!CheckSchedule(schedule, expected, period, MAX_MULTICAST_SESSIONS - 1)) {
+                logError("beacon %lu address %08lx periodicity %u multicast schedule wrong", (unsigned long) vector.BeaconTime,
+                         (unsigned long) vector.Address, periodicity);
+                report.Mismatches++;
+            }
+        }
+    }
+
+    return report;
+}
@@ -0,0 +1,61 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimPingSlot checks of PingSlotSchedule against the class B ping offset
+ *
+ * @details The class B specification puts the first ping of a session at
+ *          (Rand[0] + Rand[1] * 256) mod 2^(5 + periodicity), Rand being the AES-128 of the
+ *          beacon time and the address under a zero key.  Each vector holds the 16 bit value
+ *          computed outside the library for a beacon time and an address.  At every
+ *          periodicity PingOffset() has to give that offset, and a schedule built for a
+ *          unicast or a multicast session alone has to hold every ping of the beacon period
+ *          at it and every ping period after it.
+ *
+ */
+
+#ifndef __LORA_SIM_PING_SLOT_H__
+#define __LORA_SIM_PING_SLOT_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace lora {
+
+    struct SimPingSlotVector {
+        uint32_t BeaconTime;                //!< GPS s
+        uint32_t Address;
+        uint16_t Rand;                      //!< Rand[0] + Rand[1] * 256
+    };
+
+    struct SimPingSlotConfig {
+        SimPingSlotConfig();
+
+        std::vector<SimPingSlotVector> Vectors;
+    };
+
+    struct SimPingSlotReport {
+        uint32_t Offsets;                   //!< PingOffset() results checked
+        uint32_t Schedules;                 //!< schedules built and checked
+        uint32_t Mismatches;                //!< offsets, slots or cipher blocks that differ
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimPingSlot {
+        public:
+            SimPingSlot(const SimPingSlotConfig& config = SimPingSlotConfig());
+
+            SimPingSlotReport Run();
+
+        private:
+            SimPingSlotConfig _config;
+    };
+
+}
+
+#endif
@@ -0,0 +1,226 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimPowerLoss SettingsStore and CounterLog recovery under power cuts
+ *
+ */
+
+#include "SimPowerLoss.h"
+#include "MTSLog.h"
+#include <chrono>
+#include <random>
+#include <string.h>
+
+using namespace lora;
+
+namespace {
+
+    const uint32_t MAX_UPLINKS = 100000;        //!< per cycle, in case no save ever writes
+
+    /**
+     * Defaults a device boots with
+     */
+    void Defaults(Settings& settings) {
+        settings = Settings();
+        settings.Network.TxPower = 14;
+        settings.Network.ADREnabled = 1;
+        settings.Session.TxDatarate = 0;
+        settings.Session.Redundancy = 1;
+    }
+
+    /**
+     * Settings as compared after a boot, statistics are not saved and counters are checked apart
+     */
+    bool Same(const Settings& a, const Settings& b) {
+        Settings left = a;
+        Settings right = b;
+
+        left.Stats = right.Stats;
+        left.Session.UplinkCounter = right.Session.UplinkCounter;
+        left.Session.DownlinkCounter = right.Session.DownlinkCounter;
+
+        for (uint8_t i = 0; i < MAX_MULTICAST_SESSIONS; i++) {
+            left.Multicast[i].DownlinkCounter = right.Multicast[i].DownlinkCounter;
+        }
+
+        return memcmp(&left, &right, sizeof(Settings)) == 0;
+    }
+
+    /**
+     * A downlink counter loaded has to be one saved, or between them if the save counted up
+     */
+    bool Between(uint32_t loaded, uint32_t saved, uint32_t pending) {
+        if (saved <= pending) {
+            return loaded >= saved && loaded <= pending;
+        }
+
+        return loaded == saved || loaded == pending;
+    }
+
+    void Join(Settings& settings, uint32_t session) {
+        settings.Session.Joined = 1;
+        settings.Session.Address = 0x26000000 | session;
+        settings.Session.NetworkSessionKey[0] = session;
+        settings.Session.UplinkCounter = 0;
+        settings.Session.DownlinkCounter = 0;
+        settings.Session.AdrCounter = 0;
+    }
+
+    /**
+     * What the MAC changes around one uplink
+     */
+    void Uplink(Settings& settings, std::mt19937& random, uint32_t downlinkEvery) {
+        settings.Session.UplinkCounter++;
+        settings.Session.AdrCounter++;
+        settings.Session.AggregatedTimeOffEnd += 1000 + random() % 1000;
+        settings.Stats.Up++;
+
+        if (downlinkEvery != 0 && random() % downlinkEvery == 0) {
+            settings.Session.DownlinkCounter += 1 + random() % 2;
+            settings.Session.AdrCounter = 0;
+            settings.Stats.Down++;
+
+            // now and then a LinkADRReq
+            if (random() % 8 == 0) {
+                settings.Session.TxDatarate = random() % 6;
+                settings.Session.TxPower = 2 * (random() % 8);
+            }
+        }
+    }
+
+}
+
+SimPowerLossConfig::SimPowerLossConfig()
+:   Cycles(2000),
+    MaxSteps(2000),
+    DownlinkEvery(4),
+    JoinEvery(5000),
+    Seed(1)
+{
+}
+
+void SimPowerLossReport::Log() const {
+    logInfo("power loss: %lu boots in %.2f s, %lu uplinks, reused %lu, lost %lu, failed %lu, %.1f counter values skipped per boot",
+            (unsigned long) Cycles, WallTime, (unsigned long) Uplinks, (unsigned long) Reused, (unsigned long) Lost,
+            (unsigned long) Failed, Cycles != 0 ? (double) Skipped / Cycles : 0.0);
+    logInfo("flash: %.1f bytes per uplink, %.1f of them counters, %lu erases, max wear %lu, violations %lu",
+            Uplinks != 0 ? (double) Bytes / Uplinks : 0.0, Uplinks != 0 ? (double) CounterBytes / Uplinks : 0.0,
+            (unsigned long) Erases, (unsigned long) MaxWear, (unsigned long) Violations);
+}
+
+SimPowerLoss::SimPowerLoss(const SimPowerLossConfig& config)
+:   _config(config)
+{
+}
+
+SimPowerLossReport SimPowerLoss::Run() {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::mt19937 random(_config.Seed);
+    SimFlash flash(_config.Flash);
+    SimPowerLossReport report;
+
+    memset(&report, 0, sizeof(report));
+
+    Settings defaults;
+    Settings saved;                         // as of the last save that completed
+    Settings pending;                       // of the save the power went in
+    uint32_t sent = 0;                      // highest uplink counter of the session sent
+    uint32_t sentBefore = 0;                // of the session before the last join
+    uint32_t session = 1;
+    uint32_t sessionUplinks = 0;
+    bool started = false;
+
+    Defaults(defaults);
+    saved = defaults;
+    pending = defaults;
+
+    for (uint32_t cycle = 0; cycle < _config.Cycles; cycle++) {
+        Settings settings = defaults;
+        SettingsStore store(flash, _config.Store);
+
+        flash.RestorePower();
+        report.Cycles++;
+
+        if (store.Mount(settings) != LORA_OK) {
+            report.Failed++;
+            continue;
+        }
+
+        if (started) {
+            // a join cut short loads the session before it
+            if (settings.Session.Address != pending.Session.Address) {
+                sent = sentBefore;
+            }
+
+            // the next uplink goes out with the counter loaded plus one
+            if (settings.Session.UplinkCounter < sent) {
+                report.Reused++;
+            } else {
+                report.Skipped += settings.Session.UplinkCounter - sent;
+            }
+
+            bool kept = Same(settings, saved) || Same(settings, pending);
+
+            kept = kept && Between(settings.Session.DownlinkCounter, saved.Session.DownlinkCounter, pending.Session.DownlinkCounter);
+
+            for (uint8_t i = 0; i < MAX_MULTICAST_SESSIONS; i++) {
+                kept = kept && Between(settings.Multicast[i].DownlinkCounter, saved.Multicast[i].DownlinkCounter, pending.Multicast[i].DownlinkCounter);
+            }
+
+            if (!kept) {
+                report.Lost++;
+            }
+        } else {
+            Join(settings, session);
+            sessionUplinks = 0;
+            sent = 0;
+            started = true;
+        }
+
+        saved = settings;
+        flash.CutPowerAfter(random() % _config.MaxSteps);
+
+        for (uint32_t i = 0; i < MAX_UPLINKS; i++) {
+            pending = settings;
+
+            if (_config.JoinEvery != 0 && sessionUplinks >= _config.JoinEvery) {
+                Join(pending, ++session);
+                sessionUplinks = 0;
+                sentBefore = sent;
+                sent = 0;
+            } else {
+                Uplink(pending, random, _config.DownlinkEvery);
+                sessionUplinks++;
+                report.Uplinks++;
+
+                // the frame goes out before the settings are saved
+                sent = pending.Session.UplinkCounter;
+            }
+
+            if (store.Save(pending) != LORA_OK) {
+                break;
+            }
+
+            settings = pending;
+            saved = pending;
+        }
+
+        if (!flash.PowerLost()) {
+            report.Failed++;
+        }
+
+        report.CounterBytes += store.Counters().GetStats().Bytes;
+    }
+
+    report.Bytes = flash.GetStats().Bytes;
+    report.Erases = flash.GetStats().Erases;
+    report.MaxWear = flash.GetStats().MaxWear;
+    report.Violations = flash.GetStats().Violations;
+    report.WallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    return report;
+}
@@ -0,0 +1,68 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimPowerLoss SettingsStore and CounterLog recovery under power cuts
+ *
+ * @details Each cycle mounts a SettingsStore on a SimFlash as a device does at boot, checks
+ *          what was loaded, then sends uplinks and saves after each one until the power is
+ *          cut at a random step of a program or erase.  An uplink counter loaded below the
+ *          last one sent counts as reused.  The other settings have to come back as of the
+ *          last completed save or the one that was cut, a downlink counter anywhere between
+ *          the two.  Sessions are rejoined now and then, which sets the counters back to zero.
+ *
+ */
+
+#ifndef __LORA_SIM_POWER_LOSS_H__
+#define __LORA_SIM_POWER_LOSS_H__
+
+#include "SimFlash.h"
+#include "SettingsStore.h"
+
+namespace lora {
+
+    struct SimPowerLossConfig {
+        SimPowerLossConfig();
+
+        SimFlashConfig Flash;
+        SettingsStoreConfig Store;
+        uint32_t Cycles;                    //!< power cuts
+        uint32_t MaxSteps;                  //!< a cut comes after up to this many program and erase steps
+        uint32_t DownlinkEvery;             //!< every Nth uplink gets a downlink
+        uint32_t JoinEvery;                 //!< uplinks of a session, 0 to never rejoin
+        uint32_t Seed;
+    };
+
+    struct SimPowerLossReport {
+        uint32_t Cycles;
+        uint32_t Uplinks;
+        uint32_t Reused;                    //!< boots that loaded an uplink counter below the last one sent
+        uint32_t Lost;                      //!< boots that loaded settings or a downlink counter not saved
+        uint32_t Failed;                    //!< mounts or saves after a boot that failed
+        uint64_t Skipped;                   //!< uplink counter values passed over after boots
+        uint32_t Bytes;                     //!< programmed
+        uint32_t CounterBytes;              //!< programmed by the counter log
+        uint32_t Erases;
+        uint32_t MaxWear;                   //!< most erases of one block
+        uint32_t Violations;                //!< programs SimFlash does not allow
+        double WallTime;                    //!< s
+
+        void Log() const;
+    };
+
+    class SimPowerLoss {
+        public:
+            SimPowerLoss(const SimPowerLossConfig& config = SimPowerLossConfig());
+
+            SimPowerLossReport Run();
+
+        private:
+            SimPowerLossConfig _config;
+    };
+
+}
+
+#endif
@@ -0,0 +1,479 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimRadio SxRadio on a virtual clock for host testing
+ *
+ */
+
+#include "SimRadio.h"
+#include <math.h>
+#include <string.h>
+
+using namespace lora;
+
+static const uint32_t CAD_SYMBOLS = 2;
+
+SimRadio::SimRadio(SimMedium& medium, uint32_t wakeupTime)
+:   SxRadio(wakeupTime),
+    _medium(medium),
+    _clock(medium.Clock()),
+    _events(NULL),
+    _frequency(0),
+    _power(0),
+    _lastAirtime(0),
+    _rxStart(0),
+    _timer(0),
+    _locked(0),
+    _lockedRssi(0.0),
+    _cadActivity(false),
+    _trace(NULL),
+    _meter(NULL)
+{
+    memset(&_tx, 0, sizeof(_tx));
+    memset(&_rx, 0, sizeof(_rx));
+    memset(&_stats, 0, sizeof(_stats));
+#if !defined(TARGET_XDOT_MAX32670)
+    memset(_registers, 0, sizeof(_registers));
+#else
+    _vddMin = 0;
+#if defined(MTS_RADIO_CTRL_COMMANDS)
+    _lna = 0;
+    _paDutyCycle = 0;
+    _hpMax = 0;
+    _xtaTrim = 0;
+    _xtbTrim = 0;
+    _swState = 0;
+    _rampTime = 0;
+    _infPreamble = 0;
+#endif
+#endif
+    _medium.Attach(this);
+}
+
+SimRadio::~SimRadio() {
+    Idle();
+    _medium.Detach(this);
+}
+
+void SimRadio::Init(SxRadioEvents* events) {
+    _events = events;
+    Idle();
+}
+
+void SimRadio::Terminate(void) {
+    Idle();
+    _events = NULL;
+}
+
+void SimRadio::SetModem(RadioModems_t modem) {
+    Modem = modem;
+}
+
+void SimRadio::SetChannel(uint32_t freq) {
+    _frequency = freq;
+    Trace(TRACE_SET_CHANNEL, 0, 0, freq);
+}
+
+uint32_t SimRadio::LoRaBandwidth(uint32_t bandwidth) {
+    switch (bandwidth) {
+        case BW_125:
+            return 125000;
+        case BW_250:
+            return 250000;
+        case BW_500:
+            return 500000;
+        default:
+            return bandwidth;
+    }
+}
+
+bool SimRadio::IsChannelFree(RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t timeout, int16_t* rssiVal) {
+    // the hardware samples the channel for the timeout, the simulation samples it once without
+    // blocking since the caller may itself be running from SimClock::RunNext()
+    SetModem(modem);
+    _frequency = freq;
+
+    int16_t rssi = (int16_t) floor(_medium.ChannelRssi(this, freq, modem == MODEM_LORA ? LoRaBandwidth(_rx.Bandwidth) : _rx.Bandwidth));
+
+    if (rssiVal != NULL) {
+        *rssiVal = rssi;
+    }
+
+    return rssi <= rssiThresh;
+}
+
+uint32_t SimRadio::Random(void) {
+    return _medium.Random();
+}
+
+void SimRadio::SetRxConfig(RadioModems_t modem, uint32_t bandwidth,
+                           uint32_t datarate, uint8_t coderate,
+                           uint32_t bandwidthAfc, uint16_t preambleLen,
+                           uint16_t symbTimeout, bool fixLen,
+                           uint8_t payloadLen,
+                           bool crcOn, bool FreqHopOn, uint8_t HopPeriod,
+                           bool iqInverted, bool rxContinuous, uint32_t fskPad) {
+    SetModem(modem);
+    _rx.Bandwidth = modem == MODEM_LORA ? LoRaBandwidth(bandwidth) : bandwidth;
+    _rx.Datarate = datarate;
+    _rx.Coderate = coderate;
+    _rx.Preamble = preambleLen;
+    _rx.SymbolTimeout = symbTimeout;
+    _rx.FixLen = fixLen;
+    _rx.CrcOn = crcOn;
+    _rx.IqInverted = iqInverted;
+    _rx.Continuous = rxContinuous;
+    Trace(TRACE_SET_RX_CONFIG, datarate, bandwidth, symbTimeout);
+}
+
+void SimRadio::SetTxConfig(RadioModems_t modem, int8_t power, uint32_t fdev,
+                           uint32_t bandwidth, uint32_t datarate,
+                           uint8_t coderate, uint16_t preambleLen,
+                           bool fixLen, bool crcOn, bool FreqHopOn,
+                           uint8_t HopPeriod, bool iqInverted, uint32_t timeout) {
+    SetModem(modem);
+    _power = power;
+    // FSK occupies about twice the deviation plus the datarate
+    _tx.Bandwidth = modem == MODEM_LORA ? LoRaBandwidth(bandwidth) : 2 * fdev + datarate;
+    _tx.Datarate = datarate;
+    _tx.Coderate = coderate;
+    _tx.Preamble = preambleLen;
+    _tx.FixLen = fixLen;
+    _tx.CrcOn = crcOn;
+    _tx.IqInverted = iqInverted;
+    _tx.Continuous = false;
+    Trace(TRACE_SET_TX_CONFIG, datarate, bandwidth, (uint32_t) power);
+}
+
+void SimRadio::SetTxPower(int8_t power) {
+    _power = power;
+}
+
+void SimRadio::SetTxContinuousWave(uint32_t freq, int8_t power, uint16_t time) {
+    logWarning("SimRadio continuous wave is not simulated");
+}
+
+void SimRadio::SetTxContinuousWave(uint32_t freq, int8_t pa, int8_t hp, int8_t tx, uint16_t time) {
+    SetTxContinuousWave(freq, tx, time);
+}
+
+uint64_t SimRadio::LoRaAirtime(uint8_t sf, uint32_t bandwidth, uint8_t coderate, uint16_t preambleLen, bool fixLen, bool crcOn, uint8_t pktLen) {
+    double tsym = (double) (1UL << sf) / bandwidth;
+    // low datarate optimization is mandated when a symbol is longer than 16 ms
+    int de = tsym > 0.016 ? 1 : 0;
+    double symbols = ceil((8.0 * pktLen - 4.0 * sf + 28 + 16 * (crcOn ? 1 : 0) - 20 * (fixLen ? 1 : 0)) / (4.0 * (sf - 2 * de)));
+
+    if (symbols < 0) {
+        symbols = 0;
+    }
+
+    double seconds = (preambleLen + 4.25) * tsym + (8 + symbols * (coderate + 4)) * tsym;
+    return (uint64_t) ceil(seconds * 1e6);
+}
+
+uint64_t SimRadio::FskAirtime(uint32_t datarate, uint16_t preambleLen, bool fixLen, bool crcOn, uint8_t pktLen) {
+    uint32_t bits = 8 * (preambleLen + 3 + (fixLen ? 0 : 1) + pktLen + (crcOn ? 2 : 0));
+    return datarate == 0 ? 0 : ((uint64_t) bits * 1000000 + datarate - 1) / datarate;
+}
+
+uint64_t SimRadio::Airtime(const Config& config, uint8_t pktLen) const {
+    if (Modem == MODEM_LORA) {
+        return LoRaAirtime(config.Datarate, config.Bandwidth, config.Coderate, config.Preamble, config.FixLen, config.CrcOn, pktLen);
+    }
+
+    return FskAirtime(config.Datarate, config.Preamble, config.FixLen, config.CrcOn, pktLen);
+}
+
+uint8_t SimRadio::SpreadingFactor(const Config& config) const {
+    return Modem == MODEM_LORA ? config.Datarate : 0;
+}
+
+double SimRadio::TimeOnAir(RadioModems_t modem, uint8_t pktLen) {
+    uint64_t us = modem == MODEM_LORA
+        ? LoRaAirtime(_tx.Datarate, _tx.Bandwidth, _tx.Coderate, _tx.Preamble, _tx.FixLen, _tx.CrcOn, pktLen)
+        : FskAirtime(_tx.Datarate, _tx.Preamble, _tx.FixLen, _tx.CrcOn, pktLen);
+
+    // ms rounded up as the SX126x driver does
+    return floor(us / 1000.0 + 0.999);
+}
+
+uint32_t SimRadio::GetTimeOnAir(void) {
+    return _lastAirtime;
+}
+
+void SimRadio::Idle() {
+    if (_timer != 0) {
+        _clock.Cancel(_timer);
+        _timer = 0;
+    }
+
+    if (State == RF_RX_RUNNING) {
+        _stats.RxTime += _clock.Now() - _rxStart;
+    }
+
+    _locked = 0;
+    State = RF_IDLE;
+    Meter(ENERGY_RADIO_STANDBY);
+}
+
+void SimRadio::Send(const uint8_t* buffer, uint8_t size) {
+    Idle();
+    Trace(TRACE_SEND, size);
+
+    SimFrame frame;
+    frame.Sender = this;
+    frame.Frequency = _frequency;
+    frame.Bandwidth = _tx.Bandwidth;
+    frame.SpreadingFactor = SpreadingFactor(_tx);
+    frame.IqInverted = _tx.IqInverted;
+    frame.Power = _power;
+    frame.Payload.assign(buffer, buffer + size);
+
+    uint64_t airtime = Airtime(_tx, size);
+    _lastAirtime = (uint32_t) ((airtime + 999) / 1000);
+
+    State = RF_TX_RUNNING;
+    Meter(ENERGY_RADIO_TX);
+    _stats.TxFrames++;
+    _stats.TxTime += airtime;
+
+    if (_events != NULL) {
+        _events->TxStart();
+    }
+
+    _medium.Transmit(frame, airtime);
+    _timer = _clock.After(airtime, callback(this, &SimRadio::OnTxDone));
+}
+
+void SimRadio::OnTxDone() {
+    _timer = 0;
+    State = RF_IDLE;
+    Meter(ENERGY_RADIO_STANDBY);
+    Trace(TRACE_TX_DONE);
+
+    if (_events != NULL) {
+        _events->TxDone();
+    }
+}
+
+void SimRadio::Sleep(bool warm_start) {
+    Idle();
+    Meter(ENERGY_RADIO_SLEEP);
+    Trace(TRACE_SLEEP);
+}
+
+void SimRadio::Wakeup(bool warm_start) {
+}
+
+void SimRadio::Standby(bool use_rc) {
+    Idle();
+    Trace(TRACE_STANDBY);
+}
+
+void SimRadio::Rx(uint32_t timeout) {
+    Idle();
+    Trace(TRACE_RX, 0, 0, timeout);
+
+    State = RF_RX_RUNNING;
+    Meter(ENERGY_RADIO_RX);
+    _rxStart = _clock.Now();
+
+    uint64_t window = timeout;
+
+    if (window == 0 && !_rx.Continuous && Modem == MODEM_LORA && _rx.SymbolTimeout != 0) {
+        window = (uint64_t) _rx.SymbolTimeout * (1UL << _rx.Datarate) * 1000000 / _rx.Bandwidth;
+    }
+
+    if (window != 0) {
+        _timer = _clock.After(window, callback(this, &SimRadio::OnRxTimeout));
+    }
+}
+
+void SimRadio::OnRxTimeout() {
+    _timer = 0;
+    Idle();
+    _stats.RxTimeouts++;
+    Trace(TRACE_RX_TIMEOUT);
+
+    if (_events != NULL) {
+        _events->RxTimeout();
+    }
+}
+
+void SimRadio::FrameStart(const SimFrame& frame) {
+    if (State != RF_RX_RUNNING || _locked != 0) {
+        return;
+    }
+
+    uint32_t offset = frame.Frequency > _frequency ? frame.Frequency - _frequency : _frequency - frame.Frequency;
+
+    if (offset >= _rx.Bandwidth / 2 || frame.Bandwidth != _rx.Bandwidth
+            || frame.SpreadingFactor != SpreadingFactor(_rx) || frame.IqInverted != _rx.IqInverted) {
+        return;
+    }
+
+    double rssi = _medium.Rssi(frame, this);
+
+    if (rssi - _medium.NoiseFloor(_rx.Bandwidth) < SimMedium::DemodulationFloor(frame.SpreadingFactor)) {
+        _medium.CountBelowSensitivity();
+        return;
+    }
+
+    // preamble detected, the receive window no longer times out
+    if (_timer != 0) {
+        _clock.Cancel(_timer);
+        _timer = 0;
+    }
+
+    _locked = frame.Id;
+    _lockedRssi = rssi;
+}
+
+void SimRadio::FrameEnd(const SimFrame& frame) {
+    if (_locked != frame.Id) {
+        return;
+    }
+
+    double rssi = _lockedRssi;
+    bool ok = _medium.Survives(frame, this, rssi);
+
+    _locked = 0;
+    if (!_rx.Continuous) {
+        Idle();
+    }
+
+    if (!ok) {
+        _stats.RxErrors++;
+        Trace(TRACE_RX_ERROR);
+        if (_events != NULL) {
+            _events->RxError();
+        }
+        return;
+    }
+
+    _stats.RxFrames++;
+
+    int16_t snr = (int16_t) floor(rssi - _medium.NoiseFloor(frame.Bandwidth));
+    Trace(TRACE_RX_DONE, 0, frame.Payload.size(), ((uint32_t) (uint16_t) snr << 16) | (uint16_t) (int16_t) floor(rssi));
+
+    if (_events != NULL) {
+        // the callback may reuse the radio, it gets its own copy of the payload
+        uint8_t payload[256];
+        uint16_t size = frame.Payload.size();
+        memcpy(payload, frame.Payload.data(), size);
+
+        _events->RxDone(payload, size, (int16_t) floor(rssi), snr);
+    }
+}
+
+void SimRadio::StartCad(void) {
+    Idle();
+
+    State = RF_CAD;
+    Meter(ENERGY_RADIO_RX);
+
+    uint64_t duration = (uint64_t) CAD_SYMBOLS * (1UL << _rx.Datarate) * 1000000 / _rx.Bandwidth;
+    _cadActivity = _medium.ChannelActivity(this, _frequency, _rx.Bandwidth, SpreadingFactor(_rx));
+    _timer = _clock.After(duration, callback(this, &SimRadio::OnCadDone));
+}
+
+void SimRadio::OnCadDone() {
+    _timer = 0;
+    // activity at the end of the CAD also counts, a preamble may have started during it
+    bool activity = _cadActivity || _medium.ChannelActivity(this, _frequency, _rx.Bandwidth, SpreadingFactor(_rx));
+    State = RF_IDLE;
+    Meter(ENERGY_RADIO_STANDBY);
+
+    if (_events != NULL) {
+        _events->CadDone(activity);
+    }
+}
+
+int16_t SimRadio::Rssi(RadioModems_t modem) {
+    return (int16_t) floor(_medium.ChannelRssi(this, _frequency, _rx.Bandwidth));
+}
+
+#if !defined(TARGET_XDOT_MAX32670)
+void SimRadio::Write(uint8_t addr, uint8_t data) {
+    _registers[addr] = data;
+}
+
+uint8_t SimRadio::Read(uint8_t addr) {
+    return _registers[addr];
+}
+
+void SimRadio::WriteBuffer(uint8_t addr, const uint8_t* buffer, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+        _registers[(uint8_t) (addr + i)] = buffer[i];
+    }
+}
+
+void SimRadio::ReadBuffer(uint8_t addr, uint8_t* buffer, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+        buffer[i] = _registers[(uint8_t) (addr + i)];
+    }
+}
+#else
+void SimRadio::SetSyncWord(int mode) {
+}
+
+uint8_t SimRadio::GetVddMin(void) {
+    return _vddMin;
+}
+
+void SimRadio::SetVddMin(uint8_t vdd) {
+    _vddMin = vdd;
+}
+
+#if defined(MTS_RADIO_CTRL_COMMANDS)
+void SimRadio::SetLNA(uint8_t rxBoosted) { _lna = rxBoosted; }
+uint8_t SimRadio::GetLNA(void) { return _lna; }
+void SimRadio::SetPaDutyCycle(uint8_t paDutyCycle) { _paDutyCycle = paDutyCycle; }
+uint8_t SimRadio::GetPaDutyCycle(void) { return _paDutyCycle; }
+void SimRadio::SetHpMax(uint8_t hpMax) { _hpMax = hpMax; }
+uint8_t SimRadio::GetHpMax(void) { return _hpMax; }
+void SimRadio::SetXTATrim(uint8_t xtaTrim) { _xtaTrim = xtaTrim; }
+uint8_t SimRadio::GetXTATrim(void) { return _xtaTrim; }
+void SimRadio::SetXTBTrim(uint8_t xtbTrim) { _xtbTrim = xtbTrim; }
+uint8_t SimRadio::GetXTBTrim(void) { return _xtbTrim; }
+void SimRadio::setSWState(uint8_t value) { _swState = value; }
+uint8_t SimRadio::getSWState(void) { return _swState; }
+void SimRadio::SetRampTime(uint8_t rampTime) { _rampTime = rampTime; }
+uint8_t SimRadio::GetRampTime(void) { return _rampTime; }
+void SimRadio::SetTxInfPreamble(uint8_t enable, int8_t power, uint32_t frequency, uint32_t bandwidth, uint8_t spreadingFactor) { _infPreamble = enable; }
+uint8_t SimRadio::GetTxInfPreamble(void) { return _infPreamble; }
+#endif
+#endif
+
+const SimRadio::Stats& SimRadio::GetStats() const {
+    return _stats;
+}
+
+SimMedium& SimRadio::Medium() {
+    return _medium;
+}
+
+void SimRadio::SetTrace(TraceRing* ring) {
+    _trace = ring;
+}
+
+void SimRadio::SetEnergyMeter(EnergyMeter* meter) {
+    _meter = meter;
+    Meter(State == RF_IDLE ? ENERGY_RADIO_STANDBY : State == RF_TX_RUNNING ? ENERGY_RADIO_TX : ENERGY_RADIO_RX);
+}
+
+void SimRadio::Meter(EnergyRadioState state) {
+    if (_meter != NULL) {
+        _meter->SetRadioStateAt(_clock.Now(), state, _power);
+    }
+}
+
+void SimRadio::Trace(uint8_t event, uint8_t arg8, uint16_t arg16, uint32_t arg32) {
+    if (_trace != NULL) {
+        _trace->RecordAt((uint32_t) _clock.Now(), event, arg8, arg16, arg32);
+    }
+}
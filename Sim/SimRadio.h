@@ -0,0 +1,240 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimRadio SxRadio on a virtual clock for host testing
+ *
+ * @details Implements the whole SxRadio interface without hardware.  Send() puts the
+ *          frame on a SimMedium for the LoRa or FSK time on air and raises TxDone when
+ *          it ends, Rx() listens until a frame is received or the timeout expires.  All
+ *          SxRadioEvents callbacks run from SimClock::RunNext() at the virtual time the
+ *          hardware would raise its interrupt, so a channel plan or MAC driven by the
+ *          clock runs thousands of TX/RX cycles per second.
+ *
+ *          The Sim directory is only built for the host, it is listed in .mbedignore.
+ *
+ */
+
+#ifndef __LORA_SIM_RADIO_H__
+#define __LORA_SIM_RADIO_H__
+
+#include "Lora.h"
+#include "SxRadio.h"
+#include "SimClock.h"
+#include "SimMedium.h"
+#include "TraceRing.h"
+#include "EnergyMeter.h"
+
+namespace lora {
+
+    class SimRadio : public SxRadio {
+        public:
+            /**
+             * Counters of radio activity
+             */
+            struct Stats {
+                uint32_t TxFrames;
+                uint32_t RxFrames;              //!< RxDone raised
+                uint32_t RxErrors;              //!< RxError raised for a frame lost to a collision
+                uint32_t RxTimeouts;
+                uint64_t TxTime;                //!< us spent transmitting
+                uint64_t RxTime;                //!< us spent listening
+            };
+
+            /**
+             * @param medium air interface shared with the other radios, supplies the clock
+             * @param wakeupTime reported through SxRadio::WakeupTime in us
+             */
+            SimRadio(SimMedium& medium, uint32_t wakeupTime = 0);
+            virtual ~SimRadio();
+
+            virtual void Init(SxRadioEvents* events);
+            virtual void Terminate(void);
+            virtual void SetModem(RadioModems_t modem);
+            virtual void SetChannel(uint32_t freq);
+            virtual bool IsChannelFree(RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t timeout = 5000, int16_t* rssiVal = NULL);
+            virtual uint32_t Random(void);
+
+            virtual void SetRxConfig(RadioModems_t modem, uint32_t bandwidth,
+                                     uint32_t datarate, uint8_t coderate,
+                                     uint32_t bandwidthAfc, uint16_t preambleLen,
+                                     uint16_t symbTimeout, bool fixLen,
+                                     uint8_t payloadLen,
+                                     bool crcOn, bool FreqHopOn, uint8_t HopPeriod,
+                                     bool iqInverted, bool rxContinuous, uint32_t fskPad = 0);
+
+            virtual void SetTxConfig(RadioModems_t modem, int8_t power, uint32_t fdev,
+                                     uint32_t bandwidth, uint32_t datarate,
+                                     uint8_t coderate, uint16_t preambleLen,
+                                     bool fixLen, bool crcOn, bool FreqHopOn,
+                                     uint8_t HopPeriod, bool iqInverted, uint32_t timeout);
+
+            virtual void SetTxPower(int8_t power);
+            virtual void SetTxContinuousWave(uint32_t freq, int8_t power, uint16_t time);
+            virtual void SetTxContinuousWave(uint32_t freq, int8_t pa, int8_t hp, int8_t tx, uint16_t time);
+
+            /**
+             * Time on air of a packet with the current TX configuration
+             * @return ms rounded up like the hardware driver
+             */
+            virtual double TimeOnAir(RadioModems_t modem, uint8_t pktLen);
+
+            virtual void Send(const uint8_t* buffer, uint8_t size);
+            virtual void Sleep(bool warm_start = false);
+            virtual void Wakeup(bool warm_start = false);
+            virtual void Standby(bool use_rc = false);
+
+            /**
+             * Listen for a frame
+             * @param timeout us, 0 listens until a frame is received or forever in continuous
+             *                mode.  A LoRa single receive with a symbol timeout set stops after
+             *                that many symbols without a preamble.
+             */
+            virtual void Rx(uint32_t timeout);
+            virtual void StartCad(void);
+            virtual int16_t Rssi(RadioModems_t modem);
+
+#if !defined(TARGET_XDOT_MAX32670)
+            virtual void Write(uint8_t addr, uint8_t data);
+            virtual uint8_t Read(uint8_t addr);
+            virtual void WriteBuffer(uint8_t addr, const uint8_t* buffer, uint8_t size);
+            virtual void ReadBuffer(uint8_t addr, uint8_t* buffer, uint8_t size);
+#else
+            virtual void SetSyncWord(int mode);
+#endif
+
+            /**
+             * Time on air of the last frame sent
+             * @return ms
+             */
+            virtual uint32_t GetTimeOnAir(void);
+
+#if defined(TARGET_XDOT_MAX32670)
+            virtual uint8_t GetVddMin(void);
+            virtual void SetVddMin(uint8_t vdd);
+#if defined(MTS_RADIO_CTRL_COMMANDS)
+            virtual void SetLNA(uint8_t rxBoosted);
+            virtual uint8_t GetLNA(void);
+            virtual void SetPaDutyCycle(uint8_t paDutyCycle);
+            virtual uint8_t GetPaDutyCycle(void);
+            virtual void SetHpMax(uint8_t hpMax);
+            virtual uint8_t GetHpMax(void);
+            virtual void SetXTATrim(uint8_t xtaTrim);
+            virtual uint8_t GetXTATrim(void);
+            virtual void SetXTBTrim(uint8_t xtbTrim);
+            virtual uint8_t GetXTBTrim(void);
+            virtual void setSWState(uint8_t value);
+            virtual uint8_t getSWState(void);
+            virtual void SetRampTime(uint8_t rampTime);
+            virtual uint8_t GetRampTime(void);
+            virtual void SetTxInfPreamble(uint8_t enable, int8_t power, uint32_t frequency, uint32_t bandwidth, uint8_t spreadingFactor);
+            virtual uint8_t GetTxInfPreamble(void);
+#endif
+#endif
+
+            /**
+             * LoRa time on air without the rounding of TimeOnAir()
+             * @param sf spreading factor 6-12
+             * @param bandwidth Hz
+             * @param coderate 1-4 for 4/5 to 4/8
+             * @param preambleLen programmed preamble symbols
+             * @param fixLen implicit header
+             * @param crcOn payload CRC
+             * @param pktLen payload bytes
+             * @return us
+             */
+            static uint64_t LoRaAirtime(uint8_t sf, uint32_t bandwidth, uint8_t coderate, uint16_t preambleLen, bool fixLen, bool crcOn, uint8_t pktLen);
+
+            /**
+             * FSK time on air with a 3 byte sync word and length byte
+             * @return us
+             */
+            static uint64_t FskAirtime(uint32_t datarate, uint16_t preambleLen, bool fixLen, bool crcOn, uint8_t pktLen);
+
+            const Stats& GetStats() const;
+            SimMedium& Medium();
+
+            /**
+             * Record radio commands and events in a trace ring with virtual time stamps in us
+             * @param ring trace ring, NULL to stop
+             */
+            void SetTrace(TraceRing* ring);
+
+            /**
+             * Report radio state changes to an energy meter with virtual time stamps in us
+             * @param meter energy meter, NULL to stop
+             */
+            void SetEnergyMeter(EnergyMeter* meter);
+
+            /**
+             * Called by SimMedium when a frame starts on the air
+             */
+            void FrameStart(const SimFrame& frame);
+
+            /**
+             * Called by SimMedium when a frame ends
+             */
+            void FrameEnd(const SimFrame& frame);
+
+        private:
+            struct Config {
+                uint32_t Bandwidth;             //!< Hz
+                uint32_t Datarate;              //!< spreading factor or FSK bps
+                uint8_t Coderate;
+                uint16_t Preamble;
+                uint16_t SymbolTimeout;
+                bool FixLen;
+                bool CrcOn;
+                bool IqInverted;
+                bool Continuous;
+            };
+
+            static uint32_t LoRaBandwidth(uint32_t bandwidth);
+            uint64_t Airtime(const Config& config, uint8_t pktLen) const;
+            uint8_t SpreadingFactor(const Config& config) const;
+            void Idle();
+            void OnTxDone();
+            void OnRxTimeout();
+            void OnCadDone();
+            void Trace(uint8_t event, uint8_t arg8 = 0, uint16_t arg16 = 0, uint32_t arg32 = 0);
+            void Meter(EnergyRadioState state);
+
+            SimMedium& _medium;
+            SimClock& _clock;
+            SxRadioEvents* _events;
+            Config _tx;
+            Config _rx;
+            Stats _stats;
+            uint32_t _frequency;
+            int8_t _power;
+            uint32_t _lastAirtime;              //!< ms
+            uint64_t _rxStart;
+            SimClock::EventId _timer;           //!< TX done, RX timeout or CAD done
+            uint32_t _locked;                   //!< id of the frame being received, 0 if none
+            double _lockedRssi;
+            bool _cadActivity;
+            TraceRing* _trace;
+            EnergyMeter* _meter;
+#if !defined(TARGET_XDOT_MAX32670)
+            uint8_t _registers[256];
+#else
+            uint8_t _vddMin;
+#if defined(MTS_RADIO_CTRL_COMMANDS)
+            uint8_t _lna;
+            uint8_t _paDutyCycle;
+            uint8_t _hpMax;
+            uint8_t _xtaTrim;
+            uint8_t _xtbTrim;
+            uint8_t _swState;
+            uint8_t _rampTime;
+            uint8_t _infPreamble;
+#endif
+#endif
+    };
+
+}
+
+#endif
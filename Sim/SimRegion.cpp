@@ -0,0 +1,228 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimRegion regional parameters of a simulated fleet
+ *
+ */
+
+#include "SimRegion.h"
+#include "ChannelPlan_US915.h"
+#include "ChannelPlan_EU868.h"
+#include "SimLoRaWAN.h"
+#include <string.h>
+
+using namespace lora;
+
+int8_t SimRegion::Power(uint8_t index) const {
+    if (index > MaxPowerIndex) {
+        index = MaxPowerIndex;
+    }
+
+    return MaxPower - 2 * index;
+}
+
+int SimRegion::FindBand(uint32_t frequency) const {
+    for (size_t i = 0; i < Bands.size(); i++) {
+        if (frequency >= Bands[i].FrequencyMin && frequency <= Bands[i].FrequencyMax) {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+int SimRegion::FindChannel(uint32_t frequency) const {
+    for (size_t i = 0; i < Channels.size(); i++) {
+        if (Channels[i].Frequency == frequency) {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+int SimRegion::FindDatarate(uint8_t spreadingFactor, uint32_t bandwidth) const {
+    for (size_t i = MinDatarate; i <= MaxDatarate && i < Datarates.size(); i++) {
+        if (Datarates[i].SpreadingFactor == spreadingFactor && Datarates[i].Bandwidth == bandwidth) {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+bool SimRegion::FixedChannels() const {
+    for (size_t i = 0; i < Channels.size(); i++) {
+        if (Channels[i].Index >= 16) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SimRegion::JoinCFList(uint8_t* cfList) const {
+    memset(cfList, 0, 16);
+
+    if (FixedChannels()) {
+        // CFListType 1, ChMask 0-4 of 16 channels each
+        for (size_t i = 0; i < Channels.size(); i++) {
+            uint8_t index = Channels[i].Index;
+            cfList[index / 8] |= 1 << (index % 8);
+        }
+
+        cfList[15] = 1;
+        return;
+    }
+
+    // CFListType 0, frequencies of channels 3-7 in 100 Hz
+    for (size_t i = 0; i < Channels.size(); i++) {
+        uint8_t index = Channels[i].Index;
+
+        if (index >= 3 && index <= 7) {
+            SimLoRaWAN::PutUint24(&cfList[(index - 3) * 3], Channels[i].Frequency / 100);
+        }
+    }
+}
+
+SimRegion SimRegion::US915(uint8_t subband) {
+    SimRegion region;
+    SimRegion::Channel chan;
+    SimRegion::Datarate dr;
+    SimRegion::Band band;
+
+    if (subband < 1 || subband > 8) {
+        subband = 2;
+    }
+
+    region.Name = "US915";
+
+    for (uint8_t i = 0; i < 8; i++) {
+        chan.Index = (subband - 1) * 8 + i;
+        chan.Frequency = US915_125K_FREQ_BASE + chan.Index * US915_125K_FREQ_STEP;
+        chan.Rx1Frequency = US915_500K_DBASE + (chan.Index % 8) * US915_500K_DSTEP;
+        chan.MinDatarate = DR_0;
+        chan.MaxDatarate = DR_3;
+        region.Channels.push_back(chan);
+    }
+
+    chan.Index = US915_125K_NUM_CHANS + subband - 1;
+    chan.Frequency = US915_500K_FREQ_BASE + (subband - 1) * US915_500K_FREQ_STEP;
+    chan.Rx1Frequency = US915_500K_DBASE + ((subband - 1) % 8) * US915_500K_DSTEP;
+    chan.MinDatarate = DR_4;
+    chan.MaxDatarate = DR_4;
+    region.Channels.push_back(chan);
+
+    // DR0-3 SF10-SF7 at 125k, DR4 SF8 at 500k
+    for (uint8_t sf = SF_10; sf >= SF_7; sf--) {
+        dr.SpreadingFactor = sf;
+        dr.Bandwidth = 125000;
+        region.Datarates.push_back(dr);
+    }
+
+    dr.SpreadingFactor = SF_8;
+    dr.Bandwidth = 500000;
+    region.Datarates.push_back(dr);
+
+    // RX1 DR10-13 at 500k with no offset, DR4 maps to DR13
+    for (uint8_t sf = SF_10; sf >= SF_7; sf--) {
+        dr.SpreadingFactor = sf;
+        dr.Bandwidth = 500000;
+        region.Rx1.push_back(dr);
+    }
+
+    region.Rx1.push_back(region.Rx1.back());
+
+    // DR8-13 SF12-SF7 at 500k, DR5-7 are not defined
+    region.Downlink = region.Datarates;
+    dr.SpreadingFactor = 0;
+    dr.Bandwidth = 0;
+    region.Downlink.resize(DR_8, dr);
+
+    for (uint8_t sf = SF_12; sf >= SF_7; sf--) {
+        dr.SpreadingFactor = sf;
+        dr.Bandwidth = 500000;
+        region.Downlink.push_back(dr);
+    }
+
+    region.Rx2Frequency = US915_500K_DBASE;
+    region.Rx2Datarate = DR_8;
+
+    band.FrequencyMin = US915_FREQ_MIN;
+    band.FrequencyMax = US915_FREQ_MAX;
+    band.DutyCycle = 0;
+    region.Bands.push_back(band);
+
+    region.MinDatarate = US915_MIN_DATARATE;
+    region.MaxDatarate = US915_MAX_DATARATE;
+    // conducted limit of the xDot rather than the 30 dBm of the regional parameters
+    region.MaxPower = 20;
+    region.MaxPowerIndex = 7;
+
+    return region;
+}
+
+SimRegion SimRegion::EU868() {
+    SimRegion region;
+    SimRegion::Channel chan;
+    SimRegion::Datarate dr;
+    SimRegion::Band band;
+
+    region.Name = "EU868";
+
+    for (uint8_t i = 0; i < EU868_DEFAULT_NUM_CHANS; i++) {
+        chan.Index = i;
+        chan.Frequency = EU868_125K_FREQ_BASE + i * EU868_125K_FREQ_STEP;
+        chan.Rx1Frequency = chan.Frequency;
+        chan.MinDatarate = DR_0;
+        chan.MaxDatarate = DR_5;
+        region.Channels.push_back(chan);
+    }
+
+    for (uint8_t i = 0; i < 5; i++) {
+        chan.Index = EU868_DEFAULT_NUM_CHANS + i;
+        chan.Frequency = 867100000 + i * EU868_125K_FREQ_STEP;
+        chan.Rx1Frequency = chan.Frequency;
+        chan.MinDatarate = DR_0;
+        chan.MaxDatarate = DR_5;
+        region.Channels.push_back(chan);
+    }
+
+    // DR0-5 SF12-SF7 at 125k
+    for (uint8_t sf = SF_12; sf >= SF_7; sf--) {
+        dr.SpreadingFactor = sf;
+        dr.Bandwidth = 125000;
+        region.Datarates.push_back(dr);
+    }
+
+    region.Rx1 = region.Datarates;
+    region.Downlink = region.Datarates;
+    region.Rx2Frequency = EU868_RX2_FREQ;
+    region.Rx2Datarate = DR_0;
+
+    band.FrequencyMin = EU868_MILLI_FREQ_MIN;
+    band.FrequencyMax = EU868_MILLI_FREQ_MAX;
+    band.DutyCycle = 100;
+    region.Bands.push_back(band);
+
+    band.FrequencyMin = EU868_CENTI_FREQ_MIN;
+    band.FrequencyMax = EU868_CENTI_FREQ_MAX;
+    band.DutyCycle = 100;
+    region.Bands.push_back(band);
+
+    band.FrequencyMin = EU868_DECI_FREQ_MIN;
+    band.FrequencyMax = EU868_DECI_FREQ_MAX;
+    band.DutyCycle = 10;
+    region.Bands.push_back(band);
+
+    region.MinDatarate = EU868_MIN_DATARATE;
+    region.MaxDatarate = EU868_MAX_DATARATE;
+    region.MaxPower = EU868_TX_POWER_MAX;
+    region.MaxPowerIndex = 7;
+
+    return region;
+}
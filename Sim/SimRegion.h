@@ -0,0 +1,117 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimRegion regional parameters of a simulated fleet
+ *
+ * @details Channels, datarates, transmit powers and duty cycle bands a SimFleet device
+ *          uses in place of a full ChannelPlan.  The presets take their values from the
+ *          constants of the matching channel plan.
+ *
+ */
+
+#ifndef __LORA_SIM_REGION_H__
+#define __LORA_SIM_REGION_H__
+
+#include "Lora.h"
+#include <string>
+#include <vector>
+
+namespace lora {
+
+    struct SimRegion {
+        /**
+         * Uplink channel
+         */
+        struct Channel {
+            uint8_t Index;                  //!< channel number in the plan and in LinkADRReq masks
+            uint32_t Frequency;             //!< Hz
+            uint32_t Rx1Frequency;          //!< Hz of RX1 after an uplink on this channel
+            uint8_t MinDatarate;
+            uint8_t MaxDatarate;
+        };
+
+        /**
+         * Modulation of a datarate
+         */
+        struct Datarate {
+            uint8_t SpreadingFactor;
+            uint32_t Bandwidth;             //!< Hz
+        };
+
+        /**
+         * Duty cycle band, same convention as ChannelPlan::DutyBand
+         */
+        struct Band {
+            uint32_t FrequencyMin;
+            uint32_t FrequencyMax;
+            uint16_t DutyCycle;             //!< Time off is time on air times this, 0 for no limit
+        };
+
+        std::string Name;
+        std::vector<Channel> Channels;
+        std::vector<Datarate> Datarates;    //!< Uplink modulation indexed by datarate
+        std::vector<Datarate> Rx1;          //!< RX1 modulation indexed by uplink datarate
+        std::vector<Datarate> Downlink;     //!< Downlink modulation indexed by datarate, SF 0 where undefined
+        std::vector<Band> Bands;
+        uint32_t Rx2Frequency;
+        uint8_t Rx2Datarate;
+        uint8_t MinDatarate;
+        uint8_t MaxDatarate;
+        int8_t MaxPower;                    //!< dBm at power index 0
+        uint8_t MaxPowerIndex;              //!< Each index lowers the power 2 dB
+
+        /**
+         * Transmit power of a LinkADRReq power index
+         * @return dBm
+         */
+        int8_t Power(uint8_t index) const;
+
+        /**
+         * Duty cycle band of a frequency
+         * @return index into Bands, -1 if the frequency is outside every band
+         */
+        int FindBand(uint32_t frequency) const;
+
+        /**
+         * Uplink channel of a frequency
+         * @return index into Channels, -1 if not a channel of the region
+         */
+        int FindChannel(uint32_t frequency) const;
+
+        /**
+         * Uplink datarate of a modulation
+         * @return datarate, -1 if no uplink datarate matches
+         */
+        int FindDatarate(uint8_t spreadingFactor, uint32_t bandwidth) const;
+
+        /**
+         * CFList of the join accept enabling the channels of the region
+         * EU868 style plans list the frequencies of channels 3-7, US915 style plans send the channel mask.
+         * @param[out] cfList 16 bytes
+         */
+        void JoinCFList(uint8_t* cfList) const;
+
+        /**
+         * Whether the plan has fixed 64+8 channels controlled by masks
+         */
+        bool FixedChannels() const;
+
+        /**
+         * US915 with one sub-band of 125k channels and its 500k channel enabled
+         * @param subband 1-8
+         */
+        static SimRegion US915(uint8_t subband = 2);
+
+        /**
+         * EU868 with the three default channels and five network channels from 867.1 MHz
+         */
+        static SimRegion EU868();
+    };
+
+}
+
+#endif
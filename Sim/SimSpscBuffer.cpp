@@ -0,0 +1,381 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimSpscBuffer wraparound check and benchmark of mts::MTSSpscCircularBuffer
+ *
+ */
+
+#include "SimSpscBuffer.h"
+#include "MTSSpscCircularBuffer.h"
+#include "MTSLog.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string.h>
+#include <thread>
+
+using namespace lora;
+using namespace mts;
+
+namespace {
+
+    const uint64_t INDEX_RANGE = 1ULL << 32;
+
+    volatile uint32_t sink;                     //!< keeps the benchmark reads from being optimised out
+
+    /**
+     * Byte at a position of the stream, not periodic in any power of two
+     */
+    char Expected(uint64_t position) {
+        return (char) (position * 131 + (position >> 8));
+    }
+
+    /**
+     * Move the free running indexes of an empty buffer on without copying
+     */
+    void Advance(MTSSpscCircularBuffer& buffer, uint64_t bytes) {
+        char* unused;
+
+        while (bytes != 0) {
+            int count = std::min((uint64_t) buffer.reserveContiguous(unused), bytes);
+
+            buffer.commit(count);
+            buffer.consume(count);
+            bytes -= count;
+        }
+    }
+
+    double Elapsed(std::chrono::steady_clock::time_point begin, uint32_t bytes) {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / bytes;
+    }
+
+}
+
+SimSpscBufferConfig::SimSpscBufferConfig()
+:   CheckCapacity(64),
+    CheckOperations(200000),
+    ThreadedBytes(4000000),
+    Capacity(1024),
+    Bytes(4000000),
+    Seed(1)
+{
+    uint32_t chunks[4] = { 1, 16, 64, 256 };
+
+    Chunks.assign(chunks, chunks + 4);
+}
+
+bool SimSpscBufferReport::Passed() const {
+    return Capacity && Wraparound && IndexWrap && Threaded;
+}
+
+void SimSpscBufferReport::Log() const {
+    logInfo("spsc buffer: capacity %s, %llu operations %s, index wrap %s, threaded %s",
+            Capacity ? "ok" : "WRONG", (unsigned long long) Operations, Wraparound ? "ok" : "MISMATCH",
+            IndexWrap ? "crossed" : "NOT REACHED", Threaded ? "ok" : "MISMATCH");
+
+    for (size_t i = 0; i < Runs.size(); i++) {
+        logInfo("%-10s %4lu byte chunks %6.2f ns/byte", Runs[i].Name, (unsigned long) Runs[i].Chunk, Runs[i].Time);
+    }
+}
+
+SimSpscBuffer::SimSpscBuffer(const SimSpscBufferConfig& config)
+:   _config(config)
+{
+}
+
+SimSpscBufferReport SimSpscBuffer::Run() {
+    SimSpscBufferReport report;
+
+    report.Capacity = false;
+    report.Wraparound = false;
+    report.IndexWrap = false;
+    report.Operations = 0;
+
+    Check(report);
+    report.Threaded = CheckThreaded();
+
+    for (size_t i = 0; i < _config.Chunks.size(); i++) {
+        report.Runs.push_back(Copy(_config.Chunks[i]));
+        report.Runs.push_back(ZeroCopy(_config.Chunks[i]));
+    }
+
+    return report;
+}
+
+void SimSpscBuffer::Check(SimSpscBufferReport& report) {
+    std::mt19937 random(_config.Seed);
+    MTSSpscCircularBuffer buffer(_config.CheckCapacity / 2 + 1);
+    uint32_t capacity = _config.CheckCapacity;
+    std::vector<char> data(capacity * 2);
+    bool ok = true;
+
+    // sizes below 1 used to never stop doubling
+    report.Capacity = buffer.capacity() == (int) capacity && MTSSpscCircularBuffer(0).capacity() == 1 &&
+                      MTSSpscCircularBuffer(-1).capacity() == 1;
+
+    if (!report.Capacity) {
+        return;
+    }
+
+    // start part way into a storage pass, 64 passes before the indexes wrap
+    uint64_t start = INDEX_RANGE - 64 * capacity - capacity / 2 - 3;
+    uint64_t produced = start;
+    uint64_t consumed = start;
+
+    Advance(buffer, start);
+
+    for (uint32_t op = 0; op < _config.CheckOperations && ok; op++) {
+        uint32_t stored = produced - consumed;
+        uint32_t free = capacity - stored;
+        uint32_t length = random() % (capacity + capacity / 2 + 1);
+
+        switch (random() % 8) {
+            case 0:
+            case 1: {
+                for (uint32_t i = 0; i < length; i++) {
+                    data[i] = Expected(produced + i);
+                }
+
+                int count = buffer.write(data.data(), length);
+
+                ok = count == (int) std::min(length, free);
+                produced += count;
+                break;
+            }
+            case 2: {
+                int count = buffer.write(Expected(produced));
+
+                ok = count == (free != 0 ? 1 : 0);
+                produced += count;
+                break;
+            }
+            case 3: {
+                char* region;
+                int count = buffer.reserveContiguous(region);
+
+                ok = count == (int) std::min(free, capacity - (uint32_t) (produced % capacity));
+
+                if (ok) {
+                    int used = count != 0 ? random() % (count + 1) : 0;
+
+                    for (int i = 0; i < used; i++) {
+                        region[i] = Expected(produced + i);
+                    }
+
+                    ok = buffer.commit(used) == used;
+                    produced += used;
+                }
+                break;
+            }
+            case 4:
+            case 5: {
+                int count = buffer.read(data.data(), length);
+
+                ok = count == (int) std::min(length, stored);
+
+                for (int i = 0; ok && i < count; i++) {
+                    ok = data[i] == Expected(consumed + i);
+                }
+
+                consumed += count;
+                break;
+            }
+            case 6: {
+                char byte = 0;
+                int count = buffer.read(byte);
+
+                ok = count == (stored != 0 ? 1 : 0) && (count == 0 || byte == Expected(consumed));
+                consumed += count;
+                break;
+            }
+            default: {
+                const char* region;
+                int count = buffer.peekContiguous(region);
+
+                ok = count == (int) std::min(stored, capacity - (uint32_t) (consumed % capacity));
+
+                for (int i = 0; ok && i < count; i++) {
+                    ok = region[i] == Expected(consumed + i);
+                }
+
+                // now and then ask for more than is there, consume() clamps to what is stored
+                uint32_t release = random() % (count + 3);
+
+                if (ok) {
+                    int released = buffer.consume(release);
+
+                    ok = released == (int) std::min(release, stored);
+                    consumed += released;
+                }
+                break;
+            }
+        }
+
+        if (ok && random() % 256 == 0) {
+            buffer.clear();
+            consumed = produced;
+        }
+
+        stored = produced - consumed;
+        ok = ok && buffer.size() == (int) stored && buffer.remaining() == (int) (capacity - stored)
+                && buffer.isEmpty() == (stored == 0) && buffer.isFull() == (stored == capacity);
+
+        report.Operations++;
+    }
+
+    report.Wraparound = ok;
+    report.IndexWrap = consumed > INDEX_RANGE;
+}
+
+bool SimSpscBuffer::CheckThreaded() {
+    MTSSpscCircularBuffer buffer(256);
+    uint32_t total = _config.ThreadedBytes;
+    uint32_t seed = _config.Seed;
+
+    std::thread producer([&buffer, total, seed]() {
+        std::mt19937 random(seed);
+        std::vector<char> data(128);
+        uint64_t produced = 0;
+
+        while (produced < total) {
+            uint32_t length = std::min<uint64_t>(random() % data.size() + 1, total - produced);
+            int count;
+
+            if (random() % 2 == 0) {
+                for (uint32_t i = 0; i < length; i++) {
+                    data[i] = Expected(produced + i);
+                }
+
+                count = buffer.write(data.data(), length);
+            } else {
+                char* region;
+
+                count = std::min<int>(buffer.reserveContiguous(region), length);
+
+                for (int i = 0; i < count; i++) {
+                    region[i] = Expected(produced + i);
+                }
+
+                buffer.commit(count);
+            }
+
+            produced += count;
+
+            // hand over after every call, on one core the threads would otherwise fill and
+            // drain the whole buffer in turn and never split a read or write at the wrap
+            std::this_thread::yield();
+        }
+    });
+
+    std::mt19937 random(seed + 1);
+    std::vector<char> data(128);
+    uint64_t consumed = 0;
+    bool ok = true;
+
+    while (consumed < total && ok) {
+        int count;
+
+        if (random() % 2 == 0) {
+            count = buffer.read(data.data(), random() % data.size() + 1);
+
+            for (int i = 0; ok && i < count; i++) {
+                ok = data[i] == Expected(consumed + i);
+            }
+        } else {
+            const char* region;
+
+            count = buffer.peekContiguous(region);
+
+            for (int i = 0; ok && i < count; i++) {
+                ok = region[i] == Expected(consumed + i);
+            }
+
+            buffer.consume(count);
+        }
+
+        consumed += count;
+        std::this_thread::yield();
+    }
+
+    // let the producer finish if the check stopped early
+    while (!ok && consumed < total) {
+        const char* region;
+
+        consumed += buffer.consume(buffer.peekContiguous(region));
+        std::this_thread::yield();
+    }
+
+    producer.join();
+
+    return ok && buffer.isEmpty();
+}
+
+SimSpscRun SimSpscBuffer::Copy(uint32_t chunk) {
+    MTSSpscCircularBuffer buffer(_config.Capacity);
+    std::vector<char> source(chunk, 0x5A);
+    std::vector<char> staging(chunk);
+    std::vector<char> destination(chunk);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    uint32_t sum = 0;
+    SimSpscRun run;
+
+    // data lands in a staging buffer, is copied into the ring, and copied out again to be used
+    for (uint32_t moved = 0; moved < _config.Bytes; ) {
+        memcpy(staging.data(), source.data(), chunk);
+        buffer.write(staging.data(), chunk);
+
+        int count = buffer.read(destination.data(), chunk);
+
+        for (int i = 0; i < count; i++) {
+            sum += (uint8_t) destination[i];
+        }
+
+        moved += count;
+    }
+
+    sink = sum;
+    run.Name = "copy";
+    run.Chunk = chunk;
+    run.Time = Elapsed(begin, _config.Bytes);
+
+    return run;
+}
+
+SimSpscRun SimSpscBuffer::ZeroCopy(uint32_t chunk) {
+    MTSSpscCircularBuffer buffer(_config.Capacity);
+    std::vector<char> source(chunk, 0x5A);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    uint32_t sum = 0;
+    SimSpscRun run;
+
+    // data lands in the ring and is used where it is, a wrapped chunk takes two calls
+    for (uint32_t moved = 0; moved < _config.Bytes; ) {
+        char* free;
+        int count = std::min<int>(buffer.reserveContiguous(free), chunk);
+
+        memcpy(free, source.data(), count);
+        buffer.commit(count);
+
+        const char* used;
+
+        count = buffer.peekContiguous(used);
+
+        for (int i = 0; i < count; i++) {
+            sum += (uint8_t) used[i];
+        }
+
+        buffer.consume(count);
+        moved += count;
+    }
+
+    sink = sum;
+    run.Name = "zero-copy";
+    run.Chunk = chunk;
+    run.Time = Elapsed(begin, _config.Bytes);
+
+    return run;
+}
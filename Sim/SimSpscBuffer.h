@@ -0,0 +1,74 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimSpscBuffer wraparound check and benchmark of mts::MTSSpscCircularBuffer
+ *
+ * @details The check drives a small buffer with a random mix of the copy, single byte and
+ *          zero-copy calls against a model of its contents, across many wraps of the storage
+ *          and across the wrap of the free running 32 bit indexes, then streams a sequence
+ *          from a producer thread to a consumer thread.  The benchmark moves the same bytes
+ *          through write()/read() and through reserveContiguous()/commit() and
+ *          peekContiguous()/consume() in chunks of each configured size.
+ *
+ */
+
+#ifndef __LORA_SIM_SPSC_BUFFER_H__
+#define __LORA_SIM_SPSC_BUFFER_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace lora {
+
+    struct SimSpscBufferConfig {
+        SimSpscBufferConfig();
+
+        uint32_t CheckCapacity;             //!< bytes of the buffer checked, small so it wraps often
+        uint32_t CheckOperations;           //!< random calls of the wraparound check
+        uint32_t ThreadedBytes;             //!< streamed between the producer and consumer threads
+        uint32_t Capacity;                  //!< bytes of the buffer benchmarked
+        uint32_t Bytes;                     //!< moved per benchmark run
+        std::vector<uint32_t> Chunks;       //!< bytes per call of each run
+        uint32_t Seed;
+    };
+
+    struct SimSpscRun {
+        const char* Name;
+        uint32_t Chunk;
+        double Time;                        //!< ns per byte on the host
+    };
+
+    struct SimSpscBufferReport {
+        bool Capacity;                      //!< rounded up to a power of two
+        bool Wraparound;                    //!< every byte and size matched the model
+        bool IndexWrap;                     //!< the check ran across the 32 bit index wrap
+        bool Threaded;                      //!< the consumer thread read the sequence in order
+        uint64_t Operations;
+        std::vector<SimSpscRun> Runs;
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimSpscBuffer {
+        public:
+            SimSpscBuffer(const SimSpscBufferConfig& config = SimSpscBufferConfig());
+
+            SimSpscBufferReport Run();
+
+        private:
+            void Check(SimSpscBufferReport& report);
+            bool CheckThreaded();
+            SimSpscRun Copy(uint32_t chunk);
+            SimSpscRun ZeroCopy(uint32_t chunk);
+
+            SimSpscBufferConfig _config;
+    };
+
+}
+
+#endif
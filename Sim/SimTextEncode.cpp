@@ -0,0 +1,284 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimTextEncode round trip check and benchmark of the mts::Text hex and base64 kernels
+ *
+ */
+
+#include "SimTextEncode.h"
+#include "MTSText.h"
+#include "MTSLog.h"
+#include <chrono>
+#include <ctype.h>
+#include <random>
+#include <string>
+
+using namespace lora;
+using namespace mts;
+
+namespace {
+
+    const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    volatile uint32_t sink;                     //!< keeps the benchmarked output from being optimised out
+
+    /**
+     * Hex a byte at a time with snprintf
+     */
+    std::string ReferenceHex(const uint8_t* data, size_t len, const char* delim) {
+        std::string hex;
+        char pair[3];
+
+        for (size_t i = 0; i < len; i++) {
+            if (i > 0) {
+                hex += delim;
+            }
+
+            snprintf(pair, sizeof(pair), "%02x", data[i]);
+            hex += pair;
+        }
+
+        return hex;
+    }
+
+    /**
+     * Base64 six bits at a time
+     */
+    std::string ReferenceBase64(const uint8_t* data, size_t len) {
+        std::string base64;
+        uint32_t bits = 0;
+        uint32_t count = 0;
+
+        for (size_t i = 0; i < len; i++) {
+            bits = (bits << 8) | data[i];
+            count += 8;
+
+            while (count >= 6) {
+                count -= 6;
+                base64 += BASE64_ALPHABET[(bits >> count) & 0x3F];
+            }
+        }
+
+        if (count > 0) {
+            base64 += BASE64_ALPHABET[(bits << (6 - count)) & 0x3F];
+        }
+
+        while (base64.size() % 4 != 0) {
+            base64 += '=';
+        }
+
+        return base64;
+    }
+
+    /**
+     * ns per call of a kernel run count times
+     */
+    template<typename F>
+    double Time(uint32_t count, F kernel) {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        uint32_t sum = 0;
+
+        for (uint32_t i = 0; i < count; i++) {
+            sum += kernel();
+        }
+
+        sink = sum;
+
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / count;
+    }
+
+}
+
+SimTextEncodeConfig::SimTextEncodeConfig()
+:   MaxLength(242),
+    Bytes(4000000),
+    Seed(1)
+{
+    uint32_t sizes[6] = { 1, 11, 51, 115, 222, 242 };
+
+    Sizes.assign(sizes, sizes + 6);
+}
+
+bool SimTextEncodeReport::Passed() const {
+    return Checked != 0 && Mismatches == 0 && Accepted == 0;
+}
+
+void SimTextEncodeReport::Log() const {
+    logInfo("text encode: %lu lengths round tripped, %lu mismatches, %lu bad inputs accepted",
+            (unsigned long) Checked, (unsigned long) Mismatches, (unsigned long) Accepted);
+
+    for (size_t i = 0; i < Runs.size(); i++) {
+        logInfo("%-13s %3lu bytes %8.1f ns/call", Runs[i].Name, (unsigned long) Runs[i].Size, Runs[i].Time);
+    }
+}
+
+SimTextEncode::SimTextEncode(const SimTextEncodeConfig& config)
+:   _config(config)
+{
+}
+
+SimTextEncodeReport SimTextEncode::Run() {
+    std::mt19937 random(_config.Seed);
+    std::vector<uint8_t> data(_config.MaxLength);
+    SimTextEncodeReport report;
+
+    report.Checked = 0;
+    report.Mismatches = 0;
+    report.Accepted = 0;
+
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = random();
+    }
+
+    Check(data, report);
+
+    for (size_t i = 0; i < _config.Sizes.size(); i++) {
+        Benchmark(_config.Sizes[i], data, report);
+    }
+
+    return report;
+}
+
+void SimTextEncode::Check(const std::vector<uint8_t>& data, SimTextEncodeReport& report) {
+    std::vector<char> text(_config.MaxLength * 3 + 1);
+    std::vector<uint8_t> back(_config.MaxLength);
+
+    for (uint32_t len = 0; len <= _config.MaxLength && len <= data.size(); len++) {
+        const uint8_t* bytes = data.data();
+        std::string hex = ReferenceHex(bytes, len, "");
+        std::string delimited = ReferenceHex(bytes, len, ":");
+        std::string base64 = ReferenceBase64(bytes, len);
+        uint32_t mismatches = report.Mismatches;
+
+        // hex, the output buffer has to hold the terminator too
+        if (Text::bin2hex(bytes, len, text.data(), hex.size() + 1) != (int) hex.size() || hex != text.data()) {
+            report.Mismatches++;
+        }
+        if (Text::hex2bin(text.data(), hex.size(), back.data(), len) != (int) len || memcmp(back.data(), bytes, len) != 0) {
+            report.Mismatches++;
+        }
+        if (Text::bin2hex(bytes, len, text.data(), hex.size()) != -1) {
+            report.Accepted++;
+        }
+
+        for (size_t i = 0; i < hex.size(); i++) {
+            text[i] = toupper(text[i]);
+        }
+        if (Text::hex2bin(text.data(), hex.size(), back.data(), len) != (int) len || memcmp(back.data(), bytes, len) != 0) {
+            report.Mismatches++;
+        }
+
+        if (Text::bin2hex(bytes, len, text.data(), delimited.size() + 1, ":") != (int) delimited.size() || delimited != text.data()) {
+            report.Mismatches++;
+        }
+
+        if (len > 0) {
+            Text::bin2hex(bytes, len, text.data(), hex.size() + 1);
+
+            if (Text::hex2bin(text.data(), hex.size() - 1, back.data(), len) != -1) {
+                report.Accepted++;
+            }
+            if (Text::hex2bin(text.data(), hex.size(), back.data(), len - 1) != -1) {
+                report.Accepted++;
+            }
+
+            text[hex.size() - 1] = 'g';
+
+            if (Text::hex2bin(text.data(), hex.size(), back.data(), len) != -1) {
+                report.Accepted++;
+            }
+        }
+
+        // base64
+        if (Text::bin2base64(bytes, len, text.data(), base64.size() + 1) != (int) base64.size() || base64 != text.data()) {
+            report.Mismatches++;
+        }
+        if (Text::base642bin(text.data(), base64.size(), back.data(), len) != (int) len || memcmp(back.data(), bytes, len) != 0) {
+            report.Mismatches++;
+        }
+        if (Text::bin2base64(bytes, len, text.data(), base64.size()) != -1) {
+            report.Accepted++;
+        }
+
+        if (len > 0) {
+            Text::bin2base64(bytes, len, text.data(), base64.size() + 1);
+
+            if (Text::base642bin(text.data(), base64.size() - 1, back.data(), len) != -1) {
+                report.Accepted++;
+            }
+            if (Text::base642bin(text.data(), base64.size(), back.data(), len - 1) != -1) {
+                report.Accepted++;
+            }
+
+            text[0] = '*';
+
+            if (Text::base642bin(text.data(), base64.size(), back.data(), len) != -1) {
+                report.Accepted++;
+            }
+        }
+
+        if (report.Mismatches != mismatches) {
+            logError("text encode: %lu bytes did not round trip", (unsigned long) len);
+        }
+
+        report.Checked++;
+    }
+}
+
+void SimTextEncode::Benchmark(uint32_t size, const std::vector<uint8_t>& data, SimTextEncodeReport& report) {
+    if (size == 0 || size > data.size()) {
+        return;
+    }
+
+    uint32_t count = _config.Bytes / size + 1;
+    std::vector<char> hex(size * 2 + 1);
+    std::vector<char> base64((size + 2) / 3 * 4 + 1);
+    std::vector<uint8_t> back(size);
+    const uint8_t* bytes = data.data();
+    SimTextRun run;
+
+    Text::bin2hex(bytes, size, hex.data(), hex.size());
+    Text::bin2base64(bytes, size, base64.data(), base64.size());
+
+    run.Size = size;
+
+    run.Name = "hex snprintf";
+    run.Time = Time(count, [&]() {
+        char* p = hex.data();
+
+        for (uint32_t i = 0; i < size; i++) {
+            p += snprintf(p, 3, "%02x", bytes[i]);
+        }
+
+        return (uint32_t) hex[0];
+    });
+    report.Runs.push_back(run);
+
+    run.Name = "bin2hex";
+    run.Time = Time(count, [&]() {
+        return (uint32_t) Text::bin2hex(bytes, size, hex.data(), hex.size()) + hex[0];
+    });
+    report.Runs.push_back(run);
+
+    run.Name = "hex2bin";
+    run.Time = Time(count, [&]() {
+        return (uint32_t) Text::hex2bin(hex.data(), size * 2, back.data(), back.size()) + back[0];
+    });
+    report.Runs.push_back(run);
+
+    run.Name = "bin2base64";
+    run.Time = Time(count, [&]() {
+        return (uint32_t) Text::bin2base64(bytes, size, base64.data(), base64.size()) + base64[0];
+    });
+    report.Runs.push_back(run);
+
+    run.Name = "base642bin";
+    run.Time = Time(count, [&]() {
+        return (uint32_t) Text::base642bin(base64.data(), base64.size() - 1, back.data(), back.size()) + back[0];
+    });
+    report.Runs.push_back(run);
+}
@@ -0,0 +1,66 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimTextEncode round trip check and benchmark of the mts::Text hex and base64 kernels
+ *
+ * @details Every length from 0 to the largest LoRaWAN payload is encoded as hex, with and
+ *          without a delimiter, and as base64, compared with a plain reference encoder and
+ *          decoded back, upper case hex too.  Short output buffers, odd lengths and characters
+ *          outside the alphabet have to be refused.  The benchmark times each kernel and an
+ *          snprintf per byte, as hex was built before, on buffers of the configured sizes.
+ *
+ */
+
+#ifndef __LORA_SIM_TEXT_ENCODE_H__
+#define __LORA_SIM_TEXT_ENCODE_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace lora {
+
+    struct SimTextEncodeConfig {
+        SimTextEncodeConfig();
+
+        uint32_t MaxLength;                 //!< bytes, every length up to it is checked
+        std::vector<uint32_t> Sizes;        //!< bytes of the benchmarked buffers
+        uint32_t Bytes;                     //!< encoded per benchmark run
+        uint32_t Seed;
+    };
+
+    struct SimTextRun {
+        const char* Name;
+        uint32_t Size;
+        double Time;                        //!< ns per call on the host
+    };
+
+    struct SimTextEncodeReport {
+        uint32_t Checked;                   //!< lengths round tripped
+        uint32_t Mismatches;                //!< encodings or decodings that differ
+        uint32_t Accepted;                  //!< bad input or short buffers not refused
+        std::vector<SimTextRun> Runs;
+
+        bool Passed() const;
+        void Log() const;
+    };
+
+    class SimTextEncode {
+        public:
+            SimTextEncode(const SimTextEncodeConfig& config = SimTextEncodeConfig());
+
+            SimTextEncodeReport Run();
+
+        private:
+            void Check(const std::vector<uint8_t>& data, SimTextEncodeReport& report);
+            void Benchmark(uint32_t size, const std::vector<uint8_t>& data, SimTextEncodeReport& report);
+
+            SimTextEncodeConfig _config;
+    };
+
+}
+
+#endif
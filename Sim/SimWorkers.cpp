@@ -0,0 +1,105 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimWorkers host thread pool for the fleet simulator
+ *
+ */
+
+#include "SimWorkers.h"
+
+using namespace lora;
+
+SimWorkers::SimWorkers(unsigned threads)
+:   _task(NULL),
+    _count(0),
+    _next(0),
+    _busy(0),
+    _batch(0),
+    _stop(false)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+
+    for (unsigned i = 1; i < threads; i++) {
+        _threads.push_back(std::thread(&SimWorkers::Work, this));
+    }
+}
+
+SimWorkers::~SimWorkers() {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stop = true;
+    }
+
+    _start.notify_all();
+
+    for (size_t i = 0; i < _threads.size(); i++) {
+        _threads[i].join();
+    }
+}
+
+unsigned SimWorkers::Threads() const {
+    return _threads.size() + 1;
+}
+
+void SimWorkers::Drain() {
+    size_t index;
+
+    while ((index = _next.fetch_add(1)) < _count) {
+        (*_task)(index);
+    }
+}
+
+void SimWorkers::Run(size_t count, const std::function<void(size_t)>& task) {
+    if (_threads.empty() || count < 2) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _task = &task;
+        _count = count;
+        _next = 0;
+        _busy = _threads.size();
+        _batch++;
+    }
+
+    _start.notify_all();
+    Drain();
+
+    std::unique_lock<std::mutex> guard(_lock);
+    _done.wait(guard, [this] { return _busy == 0; });
+    _task = NULL;
+}
+
+void SimWorkers::Work() {
+    uint32_t batch = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _start.wait(guard, [this, batch] { return _stop || _batch != batch; });
+
+            if (_stop) {
+                return;
+            }
+
+            batch = _batch;
+        }
+
+        Drain();
+
+        std::lock_guard<std::mutex> guard(_lock);
+        if (--_busy == 0) {
+            _done.notify_one();
+        }
+    }
+}
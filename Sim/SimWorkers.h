@@ -0,0 +1,68 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::SimWorkers host thread pool for the fleet simulator
+ *
+ * @details Run() hands a batch of independent tasks to the pool and returns when all of
+ *          them are done, so each call is a barrier between simulation phases.  The
+ *          calling thread works on the batch too.
+ *
+ */
+
+#ifndef __LORA_SIM_WORKERS_H__
+#define __LORA_SIM_WORKERS_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace lora {
+
+    class SimWorkers {
+        public:
+            /**
+             * @param threads threads working on each batch including the caller, 0 for one per core
+             */
+            SimWorkers(unsigned threads = 0);
+            ~SimWorkers();
+
+            unsigned Threads() const;
+
+            /**
+             * Run task(0) to task(count - 1) across the pool
+             * @param count number of tasks in the batch
+             * @param task called once per index, from any thread
+             */
+            void Run(size_t count, const std::function<void(size_t)>& task);
+
+        private:
+            SimWorkers(const SimWorkers&);
+            SimWorkers& operator=(const SimWorkers&);
+
+            void Work();
+            void Drain();
+
+            std::vector<std::thread> _threads;
+            std::mutex _lock;
+            std::condition_variable _start;
+            std::condition_variable _done;
+            const std::function<void(size_t)>* _task;
+            size_t _count;
+            std::atomic<size_t> _next;
+            size_t _busy;                       //!< workers not finished with the current batch
+            uint32_t _batch;
+            bool _stop;
+    };
+
+}
+
+#endif
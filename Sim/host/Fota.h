@@ -0,0 +1,39 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  Host stand in for the prebuilt Fota, hands each command to a harness
+ *
+ */
+
+#ifndef __SIM_HOST_FOTA_H__
+#define __SIM_HOST_FOTA_H__
+
+#include "mbed.h"
+
+enum ApplicationPackagePort {
+   APP_PORT_MULTICAST      = 200,
+   APP_PORT_FRAGMENTATION  = 201,
+   APP_PORT_CLOCK_SYNC     = 202
+};
+
+class Fota {
+    public:
+        static Fota* getInstance() {
+            static Fota fota;
+            return &fota;
+        }
+
+        void processCmd(uint8_t* payload, uint8_t port, uint8_t size) {
+            if (Received) {
+                Received(payload, port, size);
+            }
+        }
+
+        Callback<void(uint8_t*, uint8_t, uint8_t)> Received;    //!< host only, set by the harness
+};
+
+#endif
@@ -0,0 +1,522 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  Host version of the lora::ChannelPlan base the regional plans derive from
+ *
+ * @details The base is built into the prebuilt library.  This one keeps the channel mask,
+ *          datarates, duty bands and settings the way the plans expect so a plan can be
+ *          initialized and handed MAC commands on the host.  It has no radio, no duty cycle
+ *          timer and no event queue, whatever needs them returns a default.  Only built
+ *          into the host runner.
+ *
+ */
+
+#include "ChannelPlan.h"
+
+using namespace lora;
+
+const uint8_t* ChannelPlan::TX_POWERS = 0;
+const uint8_t ChannelPlan::RADIO_POWERS[RADIO_POWERS_SIZE] = { 0 };
+const uint8_t* ChannelPlan::MAX_PAYLOAD_SIZE = 0;
+const uint8_t* ChannelPlan::MAX_PAYLOAD_SIZE_REPEATER = 0;
+
+namespace lora {
+
+uint8_t CountBits(uint16_t mask) {
+    uint8_t count = 0;
+
+    while (mask) {
+        count += mask & 1;
+        mask >>= 1;
+    }
+
+    return count;
+}
+
+Datarate::Datarate()
+:   Index(0),
+    Bandwidth(BW_125),
+    Coderate(1),
+    PreambleLength(8),
+    SpreadingFactor(SF_10),
+    Crc(1),
+    TxIQ(0),
+    RxIQ(0)
+{
+}
+
+uint16_t Datarate::SymbolTimeout(uint16_t pad_ms) {
+    return 8;
+}
+
+void RandomChannel::ChannelState125K(uint64_t mask) {
+}
+
+void RandomChannel::ChannelState500K(uint32_t mask) {
+}
+
+}
+
+ChannelPlan::ChannelPlan(SxRadio* radio, Settings* settings)
+:   _txChannel(0),
+    _txFrequencySubBand(0),
+    _maxTxPower(0),
+    _minTxPower(0),
+    _minFrequency(0),
+    _maxFrequency(0),
+    _minDatarate(0),
+    _maxDatarate(0),
+    _defaultRx2Frequency(0),
+    _defaultRx2Datarate(0),
+    _minRx2Datarate(0),
+    _maxRx2Datarate(0),
+    _minDatarateOffset(0),
+    _maxDatarateOffset(0),
+    _freqUBase125k(0),
+    _freqUStep125k(0),
+    _freqUBase500k(0),
+    _freqUStep500k(0),
+    _freqDBase500k(0),
+    _freqDStep500k(0),
+    _numChans(0),
+    _numChans125k(0),
+    _numChans500k(0),
+    _numDefaultChans(0),
+    _LBT_TimeUs(0),
+    _LBT_Threshold(0),
+    _txDutyEvtId(0),
+    _txDutyCyclePending(false),
+    _beaconSize(0),
+    _plan(NONE),
+    _radio(radio),
+    _settings(settings),
+    _evtQueue(0)
+{
+}
+
+ChannelPlan::~ChannelPlan() {
+}
+
+uint8_t ChannelPlan::ValidateAdrDatarate(uint8_t status) {
+    return status;
+}
+
+void ChannelPlan::SetRadio(SxRadio* radio) {
+    _radio = radio;
+}
+
+void ChannelPlan::SetSettings(Settings* settings) {
+    _settings = settings;
+}
+
+void ChannelPlan::SetEventQueue(EventQueue* queue) {
+    _evtQueue = queue;
+}
+
+void ChannelPlan::SetNumberOfChannels(uint8_t channels, bool resize) {
+    if (resize) {
+        _channels.resize(channels);
+    }
+
+    _channelMask.resize((channels + CHAN_MASK_SIZE - 1) / CHAN_MASK_SIZE, 0);
+    _numChans = channels;
+}
+
+uint8_t ChannelPlan::GetNumberOfChannels() {
+    return _numChans;
+}
+
+bool ChannelPlan::IsChannelEnabled(uint8_t channel) {
+    uint8_t index = channel / CHAN_MASK_SIZE;
+
+    return index < _channelMask.size() && (_channelMask[index] & (1 << (channel % CHAN_MASK_SIZE))) != 0;
+}
+
+bool ChannelPlan::SetChannelMask(uint8_t index, uint16_t mask) {
+    if (index >= _channelMask.size()) {
+        return false;
+    }
+
+    _channelMask[index] = mask;
+    return true;
+}
+
+std::vector<uint16_t> ChannelPlan::GetChannelMask() {
+    return _channelMask;
+}
+
+uint8_t ChannelPlan::AddDownlinkChannel(int8_t index, Channel channel) {
+    if (index < 0) {
+        _dlChannels.push_back(channel);
+    } else {
+        if ((size_t) index >= _dlChannels.size()) {
+            _dlChannels.resize(index + 1);
+        }
+
+        _dlChannels[index] = channel;
+    }
+
+    return LORA_OK;
+}
+
+Channel ChannelPlan::GetDownlinkChannel(uint8_t index) {
+    Channel channel = Channel();
+
+    if (index < _dlChannels.size()) {
+        channel = _dlChannels[index];
+    }
+
+    return channel;
+}
+
+void ChannelPlan::SetNumberOfDatarates(uint8_t datarates) {
+    _datarates.resize(datarates);
+}
+
+uint8_t ChannelPlan::AddDatarate(int8_t index, Datarate datarate) {
+    if (index < 0) {
+        _datarates.push_back(datarate);
+    } else {
+        if ((size_t) index >= _datarates.size()) {
+            _datarates.resize(index + 1);
+        }
+
+        _datarates[index] = datarate;
+    }
+
+    return LORA_OK;
+}
+
+Datarate ChannelPlan::GetDatarate(int8_t index) {
+    if (index < 0 || (size_t) index >= _datarates.size()) {
+        return Datarate();
+    }
+
+    return _datarates[index];
+}
+
+uint8_t ChannelPlan::GetMaxPayloadSize() {
+    return GetMaxPayloadSize(GetSettings()->Session.TxDatarate);
+}
+
+uint8_t ChannelPlan::GetMaxPayloadSize(uint8_t dr, Direction dir) {
+    return MAX_PAYLOAD_SIZE ? MAX_PAYLOAD_SIZE[dr] : 0;
+}
+
+uint8_t ChannelPlan::SetTxChannel(uint8_t channel) {
+    _txChannel = channel;
+    return LORA_OK;
+}
+
+uint16_t ChannelPlan::GetJoinCount() {
+    return 0;
+}
+
+uint8_t ChannelPlan::CalculateJoinBackoff(uint8_t size) {
+    return LORA_OK;
+}
+
+Datarate ChannelPlan::GetTxDatarate() {
+    return GetDatarate(GetSettings()->Session.TxDatarate);
+}
+
+uint8_t ChannelPlan::SetTxDatarate(uint8_t index) {
+    GetSettings()->Session.TxDatarate = index;
+    return LORA_OK;
+}
+
+uint8_t ChannelPlan::getTxPowerIndex(int8_t power) {
+    return 0;
+}
+
+uint8_t ChannelPlan::SetRx1Offset(uint8_t offset) {
+    GetSettings()->Session.Rx1DatarateOffset = offset;
+    return LORA_OK;
+}
+
+uint8_t ChannelPlan::SetRx2Frequency(uint32_t freq) {
+    GetSettings()->Session.Rx2Frequency = freq;
+    return LORA_OK;
+}
+
+uint8_t ChannelPlan::SetRx2DatarateIndex(uint8_t index) {
+    GetSettings()->Session.Rx2DatarateIndex = index;
+    return LORA_OK;
+}
+
+uint32_t ChannelPlan::GetRx2DefaultFrequency() {
+    return _defaultRx2Frequency;
+}
+
+uint8_t ChannelPlan::GetRx2DefaultDatarateIndex() {
+    return _defaultRx2Datarate;
+}
+
+uint8_t ChannelPlan::SetRxConfig(uint8_t window, bool continuous, uint16_t wnd_growth, uint16_t pad_ms, int8_t id) {
+    return LORA_OK;
+}
+
+uint8_t ChannelPlan::GetFrequencySubBand() {
+    return _txFrequencySubBand;
+}
+
+void ChannelPlan::FhssChangeChannel(uint8_t currentChannel) {
+}
+
+uint32_t ChannelPlan::GetAckTimeout() {
+    return 0;
+}
+
+uint8_t ChannelPlan::HandleAckTimeout() {
+    return LORA_OK;
+}
+
+uint8_t ChannelPlan::HandleDownlinkChannelReq(const uint8_t* payload, uint8_t index, uint8_t size, uint8_t& status) {
+    status = 0;
+    return LORA_ERROR;
+}
+
+bool ChannelPlan::CheckRfFrequency(uint32_t freq) {
+    return freq >= _minFrequency && freq <= _maxFrequency;
+}
+
+bool ChannelPlan::IsAdrEnabled() {
+    return GetSettings()->Network.ADREnabled;
+}
+
+bool ChannelPlan::AdrAckReq() {
+    return false;
+}
+
+uint8_t ChannelPlan::IncAdrCounter() {
+    return 0;
+}
+
+void ChannelPlan::ResetAdrCounter() {
+}
+
+std::vector<uint32_t> ChannelPlan::GetDownlinkChannels() {
+    std::vector<uint32_t> channels;
+
+    for (size_t i = 0; i < _dlChannels.size(); i++) {
+        channels.push_back(_dlChannels[i].Frequency);
+    }
+
+    return channels;
+}
+
+void ChannelPlan::SetDutyBandTimeOff(uint8_t band, uint32_t timeoff) {
+}
+
+uint32_t ChannelPlan::GetDutyBandTimeOff(uint8_t band) {
+    return 0;
+}
+
+uint8_t ChannelPlan::SetDutyBandDutyCycle(uint8_t band, uint16_t dutyCycle) {
+    if (band >= _dutyBands.size()) {
+        return LORA_ERROR;
+    }
+
+    _dutyBands[band].DutyCycle = dutyCycle;
+    return LORA_OK;
+}
+
+uint8_t ChannelPlan::GetNumDutyBands() {
+    return _dutyBands.size();
+}
+
+int8_t ChannelPlan::GetDutyBand(uint32_t freq) {
+    for (size_t i = 0; i < _dutyBands.size(); i++) {
+        if (freq >= _dutyBands[i].FrequencyMin && freq <= _dutyBands[i].FrequencyMax) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void ChannelPlan::GetDutyBand(uint8_t index, const DutyBand** band) const {
+    *band = index < _dutyBands.size() ? &_dutyBands[index] : 0;
+}
+
+uint8_t ChannelPlan::AddDutyBand(int8_t index, DutyBand band) {
+    if (index < 0) {
+        _dutyBands.push_back(band);
+    } else {
+        if ((size_t) index >= _dutyBands.size()) {
+            _dutyBands.resize(index + 1);
+        }
+
+        _dutyBands[index] = band;
+    }
+
+    return LORA_OK;
+}
+
+void ChannelPlan::UpdateDutyCycle(uint32_t freq, uint32_t time_on_air_ms) {
+}
+
+uint32_t ChannelPlan::GetTimeOnAir(uint8_t bytes, RadioCfg_t cfg) {
+    return 0;
+}
+
+void ChannelPlan::ResetDutyCycleTimer() {
+}
+
+bool ChannelPlan::P2PEnabled() {
+    return false;
+}
+
+uint16_t ChannelPlan::P2PTimeout() {
+    return 0;
+}
+
+uint16_t ChannelPlan::P2PBackoff() {
+    return 0;
+}
+
+void ChannelPlan::MacEvent() {
+}
+
+uint8_t ChannelPlan::HandleMacCommand(uint8_t* payload, uint8_t& index) {
+    return LORA_ERROR;
+}
+
+void ChannelPlan::DecrementDatarate() {
+}
+
+void ChannelPlan::IncrementDatarate() {
+}
+
+std::string ChannelPlan::GetPlanName() {
+    return _planName;
+}
+
+uint8_t ChannelPlan::GetPlan() {
+    return _plan;
+}
+
+bool ChannelPlan::IsPlanFixed() {
+    return IsPlanFixed(_plan);
+}
+
+bool ChannelPlan::IsPlanDynamic() {
+    return IsPlanDynamic(_plan);
+}
+
+bool ChannelPlan::IsPlanFixed(uint8_t plan) {
+    return plan != NONE && (plan & FIXED) != 0;
+}
+
+bool ChannelPlan::IsPlanDynamic(uint8_t plan) {
+    return plan != NONE && (plan & DYNAMIC) != 0;
+}
+
+uint32_t ChannelPlan::GetMinFrequency() {
+    return _minFrequency;
+}
+
+uint32_t ChannelPlan::GetMaxFrequency() {
+    return _maxFrequency;
+}
+
+uint8_t ChannelPlan::GetMinDatarate() {
+    return _minDatarate;
+}
+
+uint8_t ChannelPlan::GetMaxDatarate() {
+    return _maxDatarate;
+}
+
+uint8_t ChannelPlan::GetMinDatarateOffset() {
+    return _minDatarateOffset;
+}
+
+uint8_t ChannelPlan::GetMaxDatarateOffset() {
+    return _maxDatarateOffset;
+}
+
+uint8_t ChannelPlan::GetMinRx2Datarate() {
+    return _minRx2Datarate;
+}
+
+uint8_t ChannelPlan::GetMaxRx2Datarate() {
+    return _maxRx2Datarate;
+}
+
+uint8_t ChannelPlan::GetMaxTxPower() {
+    return _maxTxPower;
+}
+
+uint8_t ChannelPlan::GetMinTxPower() {
+    return _minTxPower;
+}
+
+uint16_t ChannelPlan::GetLBT_TimeUs() {
+    return _LBT_TimeUs;
+}
+
+void ChannelPlan::SetLBT_TimeUs(uint16_t us) {
+    _LBT_TimeUs = us;
+}
+
+int8_t ChannelPlan::GetLBT_Threshold() {
+    return _LBT_Threshold;
+}
+
+void ChannelPlan::SetLBT_Threshold(int8_t rssi) {
+    _LBT_Threshold = rssi;
+}
+
+void ChannelPlan::DefaultLBT() {
+    _LBT_TimeUs = 0;
+    _LBT_Threshold = 0;
+}
+
+bool ChannelPlan::ListenBeforeTalk() {
+    return true;
+}
+
+void ChannelPlan::ClearChannels() {
+    _channels.clear();
+    _dlChannels.clear();
+    _channelMask.assign(_channelMask.size(), 0);
+}
+
+uint8_t ChannelPlan::GetNumDefaultChans() {
+    return _numDefaultChans;
+}
+
+uint8_t ChannelPlan::GetMinEnabledDatarate() {
+    return _minDatarate;
+}
+
+SxRadio* ChannelPlan::GetRadio() {
+    return _radio;
+}
+
+Settings* ChannelPlan::GetSettings() {
+    return _settings;
+}
+
+RandomChannel* ChannelPlan::GetRandomChannel() {
+    return &_randomChannel;
+}
+
+uint16_t ChannelPlan::CRC16(const uint8_t* data, size_t size) {
+    uint16_t crc = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        crc ^= (uint16_t) data[i] << 8;
+
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,134 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  Host versions of the library pieces the simulator links against
+ *
+ * @details MTSLog prints to stdout, crc32 is the zlib polynomial the device library uses,
+ *          crc64 the reflected Jones polynomial of tools/fota_delta.py and rand_r draws from
+ *          a fixed seed so runs repeat.  Only built into the host runner.
+ *
+ */
+
+#include "MTSLog.h"
+#include "Lora.h"
+#include "RandomChannel.h"
+#include "crc32.h"
+#include "crc64.h"
+#include <random>
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace mts {
+
+const char* MTSLog::NONE_LABEL = "NONE";
+const char* MTSLog::FATAL_LABEL = "FATAL";
+const char* MTSLog::ERROR_LABEL = "ERROR";
+const char* MTSLog::WARNING_LABEL = "WARNING";
+const char* MTSLog::INFO_LABEL = "INFO";
+const char* MTSLog::DEBUG_LABEL = "DEBUG";
+const char* MTSLog::TRACE_LABEL = "TRACE";
+
+int MTSLog::currentLevel = MTSLog::INFO_LEVEL;
+
+void MTSLog::printMessage(int level, const char* format, ...) {
+    va_list args;
+
+    if (!printable(level)) {
+        return;
+    }
+
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+bool MTSLog::printable(int level) {
+    return level <= currentLevel;
+}
+
+void MTSLog::setLogLevel(int level) {
+    currentLevel = level;
+}
+
+int MTSLog::getLogLevel() {
+    return currentLevel;
+}
+
+const char* MTSLog::getLogLevelString() {
+    return getLogLevelString(currentLevel);
+}
+
+const char* MTSLog::getLogLevelString(int level) {
+    switch (level) {
+        case FATAL_LEVEL:
+            return FATAL_LABEL;
+        case ERROR_LEVEL:
+            return ERROR_LABEL;
+        case WARNING_LEVEL:
+            return WARNING_LABEL;
+        case INFO_LEVEL:
+            return INFO_LABEL;
+        case DEBUG_LEVEL:
+            return DEBUG_LABEL;
+        case TRACE_LEVEL:
+            return TRACE_LABEL;
+        default:
+            return NONE_LABEL;
+    }
+}
+
+std::string MTSLog::getTime() {
+    return std::string();
+}
+
+}
+
+extern "C" uint32_t crc32(uint32_t crc, const uint8_t* data, uint32_t len) {
+    crc = ~crc;
+
+    while (len--) {
+        crc ^= *data++;
+
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+extern "C" uint64_t crc64(uint64_t crc, const unsigned char* s, uint64_t l) {
+    while (l--) {
+        crc ^= *s++;
+
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0x95AC9329AC4BC9B5ULL & -(crc & 1));
+        }
+    }
+
+    return crc;
+}
+
+namespace {
+
+std::mt19937 hostRandom(1);
+
+}
+
+namespace lora {
+
+int32_t rand_r(int32_t min, int32_t max) {
+    return std::uniform_int_distribution<int32_t>(min, max)(hostRandom);
+}
+
+void RandomChannel::MarkAllSubbandChannelsUnused(uint8_t subband) {
+    if (subband < NUM_SUBBANDS) {
+        _unusedChannels[subband] = ALL_SUBBAND_CHANNELS_UNUSED;
+    }
+}
+
+}
@@ -0,0 +1,289 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  Host stand in for the parts of mbed-os the simulator sources use
+ *
+ * @details Only on the include path of the host build in this directory, a device build
+ *          never sees it.  Callback and Span keep the mbed interface, locks do nothing
+ *          and threads never start.  Timer and Timeout run on a HostClock a harness moves
+ *          on, the simulator itself keeps its own SimClock.
+ *
+ */
+
+#ifndef __SIM_HOST_MBED_H__
+#define __SIM_HOST_MBED_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include "rtos/mbed_rtos_types.h"
+
+using namespace std::chrono_literals;
+
+namespace mbed {
+
+    template<typename F> class Callback;
+
+    template<typename R, typename... A>
+    class Callback<R(A...)> {
+        public:
+            Callback() {}
+
+            Callback(R (*function)(A...)) : _function(function) {}
+
+            template<typename T>
+            Callback(T* object, R (T::*method)(A...)) : _function([object, method](A... args) { return (object->*method)(args...); }) {}
+
+            template<typename L>
+            Callback(L lambda) : _function(lambda) {}
+
+            R operator()(A... args) const { return _function(args...); }
+
+            explicit operator bool() const { return (bool) _function; }
+
+        private:
+            std::function<R(A...)> _function;
+    };
+
+    template<typename T, typename R, typename... A>
+    Callback<R(A...)> callback(T* object, R (T::*method)(A...)) {
+        return Callback<R(A...)>(object, method);
+    }
+
+    template<typename R, typename... A>
+    Callback<R(A...)> callback(R (*function)(A...)) {
+        return Callback<R(A...)>(function);
+    }
+
+    template<typename T>
+    class Span {
+        public:
+            Span() : _data(NULL), _size(0) {}
+
+            Span(T* data, size_t size) : _data(data), _size(size) {}
+
+            T* data() const { return _data; }
+            size_t size() const { return _size; }
+            bool empty() const { return _size == 0; }
+            T* begin() const { return _data; }
+            T* end() const { return _data + _size; }
+
+        private:
+            T* _data;
+            size_t _size;
+    };
+
+    class Timeout;
+
+    /**
+     * Virtual time of the host Timer and Timeout, it only moves when a harness advances it
+     */
+    class HostClock {
+        public:
+            static uint64_t Now() {
+                return State().Now;
+            }
+
+            /**
+             * Move time on, running each Timeout that comes due at its own time, earliest first
+             */
+            static void Advance(uint64_t us);
+
+            static void Arm(Timeout* timeout) {
+                std::vector<Timeout*>& armed = State().Armed;
+
+                if (std::find(armed.begin(), armed.end(), timeout) == armed.end()) {
+                    armed.push_back(timeout);
+                }
+            }
+
+            static void Disarm(Timeout* timeout) {
+                std::vector<Timeout*>& armed = State().Armed;
+
+                armed.erase(std::remove(armed.begin(), armed.end(), timeout), armed.end());
+            }
+
+        private:
+            struct Clock {
+                uint64_t Now;
+                std::vector<Timeout*> Armed;
+            };
+
+            static Clock& State() {
+                static Clock clock = Clock();
+                return clock;
+            }
+    };
+
+    class Timer {
+        public:
+            Timer() : _start(0), _elapsed(0), _running(false) {}
+
+            void start() {
+                if (!_running) {
+                    _start = HostClock::Now();
+                    _running = true;
+                }
+            }
+
+            void stop() {
+                _elapsed = Elapsed();
+                _running = false;
+            }
+
+            void reset() {
+                _start = HostClock::Now();
+                _elapsed = 0;
+            }
+
+            std::chrono::microseconds elapsed_time() const {
+                return std::chrono::microseconds(Elapsed());
+            }
+
+        private:
+            uint64_t Elapsed() const {
+                return _running ? _elapsed + HostClock::Now() - _start : _elapsed;
+            }
+
+            uint64_t _start;
+            uint64_t _elapsed;
+            bool _running;
+    };
+
+    class Timeout {
+        public:
+            Timeout() : _deadline(0) {}
+            ~Timeout() { detach(); }
+
+            void attach(Callback<void()> function, std::chrono::microseconds delay) {
+                _function = function;
+                _deadline = HostClock::Now() + delay.count();
+                HostClock::Arm(this);
+            }
+
+            void detach() {
+                HostClock::Disarm(this);
+            }
+
+            uint64_t Deadline() const { return _deadline; }
+
+            void Fire() {
+                HostClock::Disarm(this);
+                _function();
+            }
+
+        private:
+            Callback<void()> _function;
+            uint64_t _deadline;
+    };
+
+    inline void HostClock::Advance(uint64_t us) {
+        Clock& clock = State();
+        uint64_t until = clock.Now + us;
+
+        while (true) {
+            Timeout* next = NULL;
+
+            for (size_t i = 0; i < clock.Armed.size(); i++) {
+                if (clock.Armed[i]->Deadline() <= until && (next == NULL || clock.Armed[i]->Deadline() < next->Deadline())) {
+                    next = clock.Armed[i];
+                }
+            }
+
+            if (next == NULL) {
+                break;
+            }
+
+            clock.Now = std::max(clock.Now, next->Deadline());
+            next->Fire();
+        }
+
+        clock.Now = until;
+    }
+
+    class CriticalSectionLock {
+        public:
+            CriticalSectionLock() {}
+    };
+
+    typedef Timer LowPowerTimer;
+    typedef Timeout LowPowerTimeout;
+
+}
+
+typedef uint64_t us_timestamp_t;
+
+using namespace mbed;
+
+namespace rtos {
+
+    class Mutex {
+        public:
+            void lock() {}
+            void unlock() {}
+    };
+
+    namespace Kernel {
+
+        struct Clock {
+            typedef std::chrono::milliseconds duration;
+            typedef std::chrono::time_point<std::chrono::steady_clock, duration> time_point;
+
+            static time_point now() {
+                return std::chrono::time_point_cast<duration>(std::chrono::steady_clock::now());
+            }
+        };
+
+    }
+
+    /**
+     * Never runs its task, a harness calls what the task would from its own threads
+     */
+    class Thread {
+        public:
+            Thread(osPriority priority = osPriorityNormal, uint32_t stack_size = 0, unsigned char* stack_mem = NULL, const char* name = NULL) {}
+
+            void start(Callback<void()> task) {}
+            void terminate() {}
+            uint32_t flags_set(uint32_t flags) { return flags; }
+    };
+
+    namespace ThisThread {
+
+        inline uint32_t flags_wait_any(uint32_t flags) {
+            return flags;
+        }
+
+    }
+
+}
+
+using namespace rtos;
+
+namespace events {
+
+    class EventQueue {
+    };
+
+}
+
+using namespace events;
+
+inline uint32_t us_ticker_read() {
+    return (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void core_util_critical_section_enter() {}
+inline void core_util_critical_section_exit() {}
+
+#endif
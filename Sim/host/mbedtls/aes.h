@@ -0,0 +1,68 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  Host stand in for the mbedtls AES calls the library makes, AES-128 ECB only
+ *
+ * @details The block cipher is the SimLoRaWAN copy, so the host and the device compute the
+ *          same blocks without mbedtls.
+ *
+ */
+
+#ifndef __SIM_HOST_MBEDTLS_AES_H__
+#define __SIM_HOST_MBEDTLS_AES_H__
+
+#include "SimLoRaWAN.h"
+#include <string.h>
+
+#define MBEDTLS_AES_ENCRYPT     1
+#define MBEDTLS_AES_DECRYPT     0
+
+#define MBEDTLS_ERR_AES_INVALID_KEY_LENGTH  -0x0020
+#define MBEDTLS_ERR_AES_BAD_INPUT_DATA      -0x0021
+
+typedef struct mbedtls_aes_context {
+    unsigned char key[16];
+    unsigned int keybits;
+} mbedtls_aes_context;
+
+inline void mbedtls_aes_init(mbedtls_aes_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+inline void mbedtls_aes_free(mbedtls_aes_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+inline int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    if (keybits != 128) {
+        return MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+    }
+
+    memcpy(ctx->key, key, 16);
+    ctx->keybits = keybits;
+    return 0;
+}
+
+inline int mbedtls_aes_setkey_dec(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    return mbedtls_aes_setkey_enc(ctx, key, keybits);
+}
+
+inline int mbedtls_aes_crypt_ecb(mbedtls_aes_context* ctx, int mode, const unsigned char input[16], unsigned char output[16]) {
+    if (ctx->keybits != 128) {
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+
+    if (mode == MBEDTLS_AES_ENCRYPT) {
+        lora::SimLoRaWAN::Encrypt(ctx->key, input, output);
+    } else {
+        lora::SimLoRaWAN::Decrypt(ctx->key, input, output);
+    }
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,21 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  Host stand in for the CMSIS-RTOS types MTSDeferredLog.h names
+ *
+ */
+
+#ifndef __SIM_HOST_MBED_RTOS_TYPES_H__
+#define __SIM_HOST_MBED_RTOS_TYPES_H__
+
+typedef enum {
+    osPriorityLow = 8,
+    osPriorityBelowNormal = 16,
+    osPriorityNormal = 24
+} osPriority;
+
+#endif
@@ -0,0 +1,145 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::TraceRing binary trace of MAC states, radio commands and radio events
+ *
+ */
+
+#include "TraceRing.h"
+
+using namespace lora;
+
+namespace {
+
+    void PutUint32(uint8_t* buffer, uint32_t value) {
+        buffer[0] = value & 0xFF;
+        buffer[1] = (value >> 8) & 0xFF;
+        buffer[2] = (value >> 16) & 0xFF;
+        buffer[3] = (value >> 24) & 0xFF;
+    }
+
+}
+
+TraceRing::TraceRing()
+:   _write(0)
+{
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        _slots[i].Sequence.store(0, std::memory_order_relaxed);
+    }
+}
+
+TraceRing& TraceRing::Global() {
+    static TraceRing ring;
+    return ring;
+}
+
+void TraceRing::Start() {
+#if LORA_TRACE_CYCLES
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+uint32_t TraceRing::TickRate() {
+#if LORA_TRACE_CYCLES
+    return SystemCoreClock;
+#else
+    return 1000000;
+#endif
+}
+
+bool TraceRing::Copy(uint32_t pos, TraceEntry& entry) const {
+    const Slot& slot = _slots[pos & RING_MASK];
+
+    if (slot.Sequence.load(std::memory_order_acquire) != pos + 1) {
+        return false;
+    }
+
+    entry = slot.Entry;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // false if overwritten while copying
+    return slot.Sequence.load(std::memory_order_relaxed) == pos + 1;
+}
+
+uint32_t TraceRing::Snapshot(TraceEntry* entries, uint32_t& first) const {
+    uint32_t end = _write.load(std::memory_order_acquire);
+    uint32_t count = 0;
+
+    first = end;
+
+    for (uint32_t pos = end > RECORDS ? end - RECORDS : 0; pos != end; pos++) {
+        if (!Copy(pos, entries[count])) {
+            continue;
+        }
+
+        if (count == 0) {
+            first = pos;
+        }
+
+        count++;
+    }
+
+    return count;
+}
+
+uint32_t TraceRing::Dump(uint8_t* buffer, uint32_t size) const {
+    uint32_t end = _write.load(std::memory_order_acquire);
+    uint32_t first = end;
+    uint32_t count = 0;
+    TraceEntry entry;
+
+    if (size < 16) {
+        return 0;
+    }
+
+    for (uint32_t pos = end > RECORDS ? end - RECORDS : 0; pos != end; pos++) {
+        if (!Copy(pos, entry)) {
+            continue;
+        }
+
+        if (16 + (count + 1) * 12 > size) {
+            return 0;
+        }
+
+        if (count == 0) {
+            first = pos;
+        }
+
+        uint8_t* out = &buffer[16 + count * 12];
+        PutUint32(&out[0], entry.Time);
+        out[4] = entry.Event;
+        out[5] = entry.Arg8;
+        out[6] = entry.Arg16 & 0xFF;
+        out[7] = (entry.Arg16 >> 8) & 0xFF;
+        PutUint32(&out[8], entry.Arg32);
+        count++;
+    }
+
+    buffer[0] = 'M';
+    buffer[1] = 'T';
+    buffer[2] = 'T';
+    buffer[3] = TRACE_DUMP_VERSION;
+    PutUint32(&buffer[4], TickRate());
+    PutUint32(&buffer[8], first);
+    PutUint32(&buffer[12], count);
+
+    return 16 + count * 12;
+}
+
+uint32_t TraceRing::Written() const {
+    return _write.load(std::memory_order_relaxed);
+}
+
+void TraceRing::Clear() {
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        _slots[i].Sequence.store(0, std::memory_order_relaxed);
+    }
+
+    _write.store(0, std::memory_order_release);
+}
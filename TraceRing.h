@@ -0,0 +1,193 @@
+/**   __  ___     ____  _    ______        __     ____         __                  ____
+ *   /  |/  /_ __/ / /_(_)__/_  __/__ ____/ /    / __/_ _____ / /____ __ _  ___   /  _/__  ____
+ *  / /|_/ / // / / __/ /___// / / -_) __/ _ \  _\ \/ // (_-</ __/ -_)  ' \(_-<  _/ // _ \/ __/ __
+ * /_/  /_/\_,_/_/\__/_/    /_/  \__/\__/_//_/ /___/\_, /___/\__/\__/_/_/_/___/ /___/_//_/\__/ /_/
+ * Copyright (C) 2015 by Multi-Tech Systems        /___/
+ *
+ *
+ * @brief  lora::TraceRing binary trace of MAC states, radio commands and radio events
+ *
+ * @details Records are 16 bytes in a fixed ring that overwrites the oldest.  Recording takes
+ *          a timestamp, an atomic increment and a few stores, with no formatting and no lock,
+ *          so it can run in the radio interrupt path without moving the RX windows the way
+ *          logTrace does.  Timestamps come from the us ticker, or from the DWT cycle counter
+ *          with LORA_TRACE_CYCLES on cores that have one; the cycle counter stops in deep
+ *          sleep.  Dump() output is rendered as a Chrome trace by tools/mac_trace.py.
+ *
+ *          Trace points use LORA_TRACE() so they compile to nothing unless LORA_TRACE_ENABLE
+ *          is set in mbed_app.json.
+ *
+ */
+
+#ifndef __LORA_TRACE_RING_H__
+#define __LORA_TRACE_RING_H__
+
+#include "mbed.h"
+#include <atomic>
+
+#ifndef LORA_TRACE_ENABLE
+#define LORA_TRACE_ENABLE 0
+#endif
+
+#ifndef LORA_TRACE_RECORDS
+#define LORA_TRACE_RECORDS 128
+#endif
+
+#ifndef LORA_TRACE_CYCLES
+#define LORA_TRACE_CYCLES 0
+#endif
+
+#if LORA_TRACE_ENABLE
+#define LORA_TRACE(event, ...) lora::TraceRing::Global().Record(event, ##__VA_ARGS__)
+#else
+#define LORA_TRACE(event, ...) do {} while (0)
+#endif
+
+namespace lora {
+
+    const uint8_t TRACE_DUMP_VERSION = 1;
+
+    /**
+     * Trace events and the meaning of their arguments
+     */
+    enum TraceEvent {
+        TRACE_NONE = 0,
+        TRACE_MAC_STATE,        //!< Arg8 new lora::MacState, not recorded yet
+        TRACE_LINK_STATE,       //!< Arg8 new lora::LinkState, not recorded yet
+        TRACE_SET_CHANNEL,      //!< Arg32 frequency in Hz, SET_CHANNEL to STANDBY come from SimRadio only
+        TRACE_SET_RX_CONFIG,    //!< Arg8 spreading factor, Arg16 bandwidth index, Arg32 symbol timeout
+        TRACE_SET_TX_CONFIG,    //!< Arg8 spreading factor, Arg16 bandwidth index, Arg32 power in dBm
+        TRACE_SEND,             //!< Arg8 payload size
+        TRACE_RX,               //!< Arg32 timeout in us, 0 for continuous
+        TRACE_SLEEP,
+        TRACE_STANDBY,
+        TRACE_TX_START,
+        TRACE_TX_DONE,          //!< Arg8 datarate
+        TRACE_TX_TIMEOUT,
+        TRACE_RX_DONE,          //!< Arg8 slot, Arg16 payload size, Arg32 rssi and snr as two int16
+        TRACE_RX_TIMEOUT,       //!< Arg8 slot
+        TRACE_RX_ERROR,         //!< Arg8 slot
+        TRACE_USER = 0x80       //!< first application defined event
+    };
+
+    struct TraceEntry {
+        uint32_t Time;                      //!< ticks, see TraceRing::TickRate
+        uint8_t Event;
+        uint8_t Arg8;
+        uint16_t Arg16;
+        uint32_t Arg32;
+    };
+
+    class TraceRing {
+        public:
+            static const uint32_t RECORDS = LORA_TRACE_RECORDS;
+
+            /**
+             * Bytes of Dump output for a full ring
+             */
+            static const uint32_t MAX_DUMP_SIZE = 16 + RECORDS * 12;
+
+            TraceRing();
+
+            /**
+             * Ring the LORA_TRACE points record into
+             */
+            static TraceRing& Global();
+
+            /**
+             * Start the DWT cycle counter if LORA_TRACE_CYCLES is set, no effect otherwise
+             */
+            static void Start();
+
+            /**
+             * Timestamp of a record taken now
+             */
+            static inline uint32_t Now() {
+#if LORA_TRACE_CYCLES
+                return DWT->CYCCNT;
+#else
+                return us_ticker_read();
+#endif
+            }
+
+            /**
+             * Timestamp ticks per second
+             */
+            static uint32_t TickRate();
+
+            /**
+             * Add a record, safe from threads and interrupts
+             */
+            inline void Record(uint8_t event, uint8_t arg8 = 0, uint16_t arg16 = 0, uint32_t arg32 = 0) {
+                RecordAt(Now(), event, arg8, arg16, arg32);
+            }
+
+            /**
+             * Add a record with a timestamp taken elsewhere, e.g. from a simulated clock
+             */
+            inline void RecordAt(uint32_t time, uint8_t event, uint8_t arg8 = 0, uint16_t arg16 = 0, uint32_t arg32 = 0) {
+                uint32_t pos = _write.fetch_add(1, std::memory_order_relaxed);
+                Slot& slot = _slots[pos & RING_MASK];
+
+                // a snapshot skips the slot until the sequence matches its position again
+                slot.Sequence.store(0, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.Entry.Time = time;
+                slot.Entry.Event = event;
+                slot.Entry.Arg8 = arg8;
+                slot.Entry.Arg16 = arg16;
+                slot.Entry.Arg32 = arg32;
+                slot.Sequence.store(pos + 1, std::memory_order_release);
+            }
+
+            /**
+             * Copy the complete records, oldest first
+             * Records being written while the snapshot runs are left out.
+             * @param entries destination for up to RECORDS records
+             * @param first updated with the position of the first record copied since the ring was cleared
+             * @return number of records copied
+             */
+            uint32_t Snapshot(TraceEntry* entries, uint32_t& first) const;
+
+            /**
+             * Write a snapshot in the binary dump format, all integers little endian
+             *   "MTT", u8 version, u32 tick rate, u32 first position, u32 record count
+             *   per record: u32 time, u8 event, u8 arg8, u16 arg16, u32 arg32
+             * @param buffer destination, MAX_DUMP_SIZE bytes is always enough
+             * @param size of buffer
+             * @return bytes written, 0 if the buffer is too small
+             */
+            uint32_t Dump(uint8_t* buffer, uint32_t size) const;
+
+            /**
+             * Records added since the ring was cleared, including overwritten ones
+             */
+            uint32_t Written() const;
+
+            /**
+             * Discard all records
+             */
+            void Clear();
+
+        private:
+            static const uint32_t RING_MASK = RECORDS - 1;
+
+            static_assert((RECORDS & RING_MASK) == 0, "LORA_TRACE_RECORDS must be a power of two");
+
+            /**
+             * Copy the record at a position if it is complete and still in the ring
+             */
+            bool Copy(uint32_t pos, TraceEntry& entry) const;
+
+            struct Slot {
+                std::atomic<uint32_t> Sequence;     //!< position + 1 once complete, 0 while written
+                TraceEntry Entry;
+            };
+
+            Slot _slots[RECORDS];
+            std::atomic<uint32_t> _write;
+    };
+
+}
+
+#endif
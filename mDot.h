@@ -37,6 +37,12 @@
 #include <string>
 
 #include "FlashRecordStore.h"
+#include "PerfStats.h"
+#include "EnergyMeter.h"
+#include "AdrPolicy.h"
+#include "SettingsStore.h"
+#include "FileStream.h"
+#include "LogFile.h"
 
 const uint8_t MULTICAST_SESSIONS = 8;
 
@@ -1781,6 +1787,16 @@ class mDot {
 
         bool repairFlashFileSystem();
 
+        // Open a user file as a lora::FileDevice for a lora::FileStream or lora::LogFile
+        // file - name of file max 30 chars
+        // mode - as for openUserFile, FM_APPEND | FM_CREAT | FM_WRONLY for a LogFile
+        // returns NULL if the file could not be opened, counts toward the 4 open files
+        lora::FileDevice* openUserFileDevice(const char* file, int mode);
+
+        // Close a file opened with openUserFileDevice, flush its stream or log first
+        // returns true if successful
+        bool closeUserFileDevice(lora::FileDevice* file);
+
         /**
          * Write Device EUI, Network ID, Netowrk Key, and Gen App Key to OTP.
          * @return Number of write remaining if positive. A negative number
@@ -1812,6 +1828,10 @@ class mDot {
         // size - size of buffer
         // returns true if successful
         bool nvmRead(uint16_t addr, void* data, uint16_t size);
+
+        // Get the EEPROM as an NvmDevice for a lora::SettingsStore
+        // erase writes 0xFF, the default SettingsStoreConfig uses 0xA00 - 0x17FF
+        lora::NvmDevice& getNvmDevice();
 #endif /* TARGET_MTS_MDOT_F411RE */
 
         // Get low voltage indication
@@ -1827,6 +1847,55 @@ class mDot {
         // Join Attempts, Join Fails, Up Packets, Down Packets, Missed Acks
         void resetStats();
 
+        // The perf stats, energy meter, ADR policy and settings store behind the accessors below
+        // are globals, so the mDot layout of the prebuilt library is unchanged and the stack can
+        // reach them without the mDot instance
+
+        // get latency histograms and counters
+        // send, duty cycle wait, RX window to downlink done, join, flash save and FOTA fragment latency
+        // no channels, no free channel, aggregated duty cycle and LBT busy counts
+        lora::PerfStats& getPerfStats();
+
+        // reset latency histograms and counters
+        void resetPerfStats();
+
+        // write latency histograms and counters in the binary format of lora::PerfStats::Dump
+        // buffer - destination, lora::PerfStats::MAX_DUMP_SIZE bytes is always enough
+        // size - size of buffer
+        // returns bytes written, 0 if buffer is too small
+        uint16_t dumpPerfStats(uint8_t* buffer, uint16_t size);
+
+        // get the energy meter
+        // charge per radio and MCU state, per uplink, join and FOTA session, projected battery lifetime
+        lora::EnergyMeter& getEnergyMeter();
+
+        // set the supply current of each radio and MCU state and the battery capacity
+        void setEnergyProfile(const lora::EnergyProfile& profile);
+
+        // set the policy that picks datarate, TX power and repeats while ADR is off
+        // policy - NULL for none, the application keeps ownership
+        void setAdrPolicy(lora::AdrPolicy* policy);
+
+        // get the policy set with setAdrPolicy, NULL if none
+        lora::AdrPolicy* getAdrPolicy();
+
+        // let the policy set datarate, TX power and repeats for the next send
+        // call before each send, the outcome of the last confirmed send is reported from the missed ack count
+        // size - application payload bytes
+        // returns MDOT_OK if success, MDOT_ERROR if no policy is set or ADR is on
+        int32_t applyAdrPolicy(uint8_t size);
+
+        // keep settings in a store that only writes what changed, in place of saveConfig and saveNetworkSession
+        // set before joining, stored settings and frame counters are loaded into the stack
+        // store - NULL to stop, the application keeps ownership
+        // returns MDOT_OK if success, MDOT_ERROR if the store could not be mounted
+        int32_t setSettingsStore(lora::SettingsStore* store);
+
+        // write the frame counters and the settings changed since the last save to the store
+        // call after each send and after changing the configuration
+        // returns MDOT_OK if success, MDOT_ERROR if no store is set or the write failed
+        int32_t saveSettingsChanges();
+
         // Convert pin number 2-8 to pin name DIO2-DI8
         static PinName pinNum2Name(uint8_t num);
 
@@ -0,0 +1,108 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#include "mDot.h"
+#include "ChannelPlan.h"
+
+namespace {
+
+    lora::AdrPolicy* adrPolicy = NULL;
+    bool adrOutstanding = false;                // confirmed send selected and not yet reported
+    uint32_t adrUp = 0;
+    uint32_t adrMissedAcks = 0;
+
+}
+
+void mDot::setAdrPolicy(lora::AdrPolicy* policy) {
+    adrPolicy = policy;
+    adrOutstanding = false;
+}
+
+lora::AdrPolicy* mDot::getAdrPolicy() {
+    return adrPolicy;
+}
+
+int32_t mDot::applyAdrPolicy(uint8_t size) {
+    if (adrPolicy == NULL || getAdr()) {
+        return MDOT_ERROR;
+    }
+
+    lora::ChannelPlan* plan = getChannelPlan();
+
+    if (plan == NULL) {
+        return MDOT_NO_CHANNEL_PLAN;
+    }
+
+    lora::Statistics& stats = getSettings()->Stats;
+
+    if (adrOutstanding && stats.Up != adrUp) {
+        uint32_t sent = stats.Up - adrUp;
+        uint32_t missed = stats.MissedAcks - adrMissedAcks;
+        adrPolicy->Outcome(missed > 0xFF ? 0xFF : missed, sent > missed);
+    }
+    adrOutstanding = false;
+
+    lora::AdrLimits limits;
+    limits.MaxPower = getMaxTxPower();
+    limits.MinPower = getMinTxPower();
+    limits.PowerStep = 2;
+    limits.MaxRedundancy = 15;
+
+    for (uint8_t i = 0; i < plan->GetNumberOfChannels(); i++) {
+        if (!plan->IsChannelEnabled(i)) {
+            continue;
+        }
+
+        lora::Channel channel = plan->GetChannel(i);
+
+        for (uint8_t dr = channel.DrRange.Fields.Min; dr <= channel.DrRange.Fields.Max && dr < lora::ADR_POLICY_DATARATES; dr++) {
+            lora::Datarate datarate = plan->GetDatarate(dr);
+
+            if (datarate.SpreadingFactor >= lora::SF_FSK || datarate.Bandwidth > lora::BW_500) {
+                continue;
+            }
+
+            limits.Allow(dr, datarate.SpreadingFactor, 125000 << datarate.Bandwidth, plan->GetMaxPayloadSize(dr));
+        }
+    }
+
+    lora::AdrUplink uplink;
+    uplink.Size = size;
+    uplink.Attempts = getAck();
+    uplink.Confirmed = uplink.Attempts != 0;
+
+    lora::AdrSettings settings = adrPolicy->Select(uplink, stats, limits);
+    int32_t ret;
+
+    if ((ret = setTxDataRate(settings.Datarate)) != MDOT_OK) {
+        return ret;
+    }
+
+    if ((ret = setTxPower(settings.Power)) != MDOT_OK) {
+        return ret;
+    }
+
+    if (!uplink.Confirmed && (ret = setRepeat(settings.Redundancy)) != MDOT_OK) {
+        return ret;
+    }
+
+    adrOutstanding = uplink.Confirmed;
+    adrUp = stats.Up;
+    adrMissedAcks = stats.MissedAcks;
+
+    return MDOT_OK;
+}
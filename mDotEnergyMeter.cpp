@@ -0,0 +1,54 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#include "mDot.h"
+
+lora::EnergyMeter& mDot::getEnergyMeter() {
+    return lora::EnergyMeter::Global();
+}
+
+void mDot::setEnergyProfile(const lora::EnergyProfile& profile) {
+    lora::EnergyMeter::Global().SetProfile(profile);
+}
+
+#if defined(__ARMCC_VERSION)
+
+// the sleep entry points are called from mDot::sleep inside the prebuilt library, armlink
+// routes those calls through the $Sub$$ copies here and $Super$$ reaches the originals
+extern "C" {
+
+    void $Super$$_ZN8LowPower13enterStopModeEh7PinName(uint8_t wakeMode, PinName wakePin);
+    void $Super$$_ZN8LowPower16enterStandbyModeEh7PinName(uint8_t wakeMode, PinName wakePin);
+
+    void $Sub$$_ZN8LowPower13enterStopModeEh7PinName(uint8_t wakeMode, PinName wakePin) {
+        lora::EnergyMeter& meter = lora::EnergyMeter::Global();
+        meter.SetMcuState(lora::ENERGY_MCU_STOP);
+        $Super$$_ZN8LowPower13enterStopModeEh7PinName(wakeMode, wakePin);
+        meter.SetMcuState(lora::ENERGY_MCU_RUN);
+    }
+
+    // a target that resets out of standby never comes back here, the meter starts over with it
+    void $Sub$$_ZN8LowPower16enterStandbyModeEh7PinName(uint8_t wakeMode, PinName wakePin) {
+        lora::EnergyMeter& meter = lora::EnergyMeter::Global();
+        meter.SetMcuState(lora::ENERGY_MCU_STANDBY);
+        $Super$$_ZN8LowPower16enterStandbyModeEh7PinName(wakeMode, wakePin);
+        meter.SetMcuState(lora::ENERGY_MCU_RUN);
+    }
+
+}
+
+#endif
@@ -0,0 +1,350 @@
+/**********************************************************************
+* COPYRIGHT 2015 MULTI-TECH SYSTEMS, INC.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*   1. Redistributions of source code must retain the above copyright notice,
+*      this list of conditions and the following disclaimer.
+*   2. Redistributions in binary form must reproduce the above copyright notice,
+*      this list of conditions and the following disclaimer in the documentation
+*      and/or other materials provided with the distribution.
+*   3. Neither the name of MULTI-TECH SYSTEMS, INC. nor the names of its contributors
+*      may be used to endorse or promote products derived from this software
+*      without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+******************************************************************************
+*/
+
+#include "mDotEvent.h"
+#include "TraceRing.h"
+#include "PerfStats.h"
+#include <algorithm>
+
+namespace {
+
+    // the MAC only reports its timing through these hooks, so the uplink in flight is kept
+    // here in us_ticker_read() time, the receive windows open a fixed delay after TX done
+    bool sending = false;
+    bool joining = false;
+    uint32_t txStart = 0;
+    uint32_t txDone = 0;
+    uint32_t rx1Delay = 0;                  //!< us from TX done to RX1
+    uint64_t txDoneAt = 0;                  //!< EnergyMeter::Now() at TX done
+
+    uint32_t WindowOpen(uint8_t slot) {
+        return txDone + rx1Delay + (slot == lora::RX_2 ? 1000000U : 0U);
+    }
+
+    /**
+     * Meter RX1 or RX2 as RX from its opening, the radio is put to sleep once a window closes
+     */
+    void MeterWindow(uint8_t slot) {
+        if (slot != lora::RX_1 && slot != lora::RX_2) {
+            return;
+        }
+
+        lora::EnergyMeter& meter = lora::EnergyMeter::Global();
+        uint64_t now = lora::EnergyMeter::Now();
+        uint64_t open = txDoneAt + rx1Delay + (slot == lora::RX_2 ? 1000000U : 0U);
+
+        meter.SetRadioStateAt(std::min(open, now), lora::ENERGY_RADIO_RX);
+        meter.SetRadioStateAt(now, lora::ENERGY_RADIO_SLEEP);
+    }
+
+    void EndSend() {
+        if (sending) {
+            lora::PerfStats::Global().Record(lora::PERF_SEND, us_ticker_read() - txStart);
+            lora::EnergyMeter::Global().End(lora::ENERGY_UPLINK);
+            sending = false;
+        }
+    }
+
+    void EndJoin() {
+        if (joining) {
+            lora::PerfStats::Global().Record(lora::PERF_JOIN, us_ticker_read() - txStart);
+            lora::EnergyMeter::Global().End(lora::ENERGY_JOIN);
+            joining = false;
+        }
+    }
+
+}
+
+mDotEvent::~mDotEvent() {
+}
+
+void mDotEvent::MacEvent(LoRaMacEventFlags *flags, LoRaMacEventInfo *info) {
+    if (mts::MTSLog::getLogLevel() == mts::MTSLog::TRACE_LEVEL) {
+        std::string msg = "OK";
+        switch (info->Status) {
+            case LORAMAC_EVENT_INFO_STATUS_ERROR:
+                msg = "ERROR";
+                break;
+            case LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT:
+                msg = "TX_TIMEOUT";
+                break;
+            case LORAMAC_EVENT_INFO_STATUS_RX_TIMEOUT:
+                msg = "RX_TIMEOUT";
+                break;
+            case LORAMAC_EVENT_INFO_STATUS_RX_ERROR:
+                msg = "RX_ERROR";
+                break;
+            case LORAMAC_EVENT_INFO_STATUS_JOIN_FAIL:
+                msg = "JOIN_FAIL";
+                break;
+            case LORAMAC_EVENT_INFO_STATUS_DOWNLINK_FAIL:
+                msg = "DOWNLINK_FAIL";
+                break;
+            case LORAMAC_EVENT_INFO_STATUS_ADDRESS_FAIL:
+                msg = "ADDRESS_FAIL";
+                break;
+            case LORAMAC_EVENT_INFO_STATUS_MIC_FAIL:
+                msg = "MIC_FAIL";
+                break;
+            default:
+                break;
+        }
+        logTrace("Event: %s", msg.c_str());
+
+        logTrace("Flags Tx: %d Rx: %d RxData: %d RxSlot: %d LinkCheck: %d JoinAccept: %d",
+                 flags->Bits.Tx, flags->Bits.Rx, flags->Bits.RxData, flags->Bits.RxSlot, flags->Bits.LinkCheck, flags->Bits.JoinAccept);
+        logTrace("Info: Status: %d ACK: %d Retries: %d TxDR: %d RxPort: %d RxSize: %d RSSI: %d SNR: %d Energy: %d Margin: %d Gateways: %d",
+                 info->Status, info->TxAckReceived, info->TxNbRetries, info->TxDatarate, info->RxPort, info->RxBufferSize,
+                 info->RxRssi, info->RxSnr, info->Energy, info->DemodMargin, info->NbGateways);
+    }
+}
+
+void mDotEvent::TxStart() {
+    LORA_TRACE(lora::TRACE_TX_START);
+
+    // a TX start before the windows of the last uplink ended drops that uplink unrecorded
+    txStart = us_ticker_read();
+    joining = !mDot::getInstance()->getNetworkJoinStatus();
+    sending = !joining;
+
+    lora::EnergyMeter& meter = lora::EnergyMeter::Global();
+    meter.Begin(joining ? lora::ENERGY_JOIN : lora::ENERGY_UPLINK);
+    meter.SetRadioState(lora::ENERGY_RADIO_TX, (int8_t) mDot::getInstance()->getTxPower());
+    logDebug("mDotEvent - TxStart");
+
+}
+
+void mDotEvent::TxDone(uint8_t dr) {
+    LORA_TRACE(lora::TRACE_TX_DONE, dr);
+
+    txDone = us_ticker_read();
+    txDoneAt = lora::EnergyMeter::Now();
+    rx1Delay = std::max(joining ? mDot::getInstance()->getJoinDelay() : mDot::getInstance()->getRxDelay(), (uint8_t) 1) * 1000000U;
+
+    lora::EnergyMeter::Global().SetRadioState(lora::ENERGY_RADIO_STANDBY);
+    _timeSinceTx.reset();
+    _timeSinceTx.start();
+
+    RxPayloadSize = 0;
+    LinkCheckAnsReceived = false;
+    PacketReceived = false;
+    AckReceived = false;
+    DuplicateRx = false;
+    PongReceived = false;
+    TxNbRetries = 0;
+
+    logInfo("mDotEvent - TxDone");
+    memset(&_flags, 0, sizeof(LoRaMacEventFlags));
+    memset(&_info, 0, sizeof(LoRaMacEventInfo));
+
+    _flags.Bits.Tx = 1;
+    _info.TxDatarate = dr;
+    _info.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    Notify();
+
+}
+
+void mDotEvent::TxTimeout() {
+    LORA_TRACE(lora::TRACE_TX_TIMEOUT);
+    EndSend();
+    EndJoin();
+    lora::EnergyMeter::Global().SetRadioState(lora::ENERGY_RADIO_STANDBY);
+    logDebug("mDotEvent - TxTimeout");
+
+    _flags.Bits.Tx = 1;
+    _info.Status = LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT;
+    Notify();
+}
+
+void mDotEvent::JoinAccept(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr) {
+    EndJoin();
+    logDebug("mDotEvent - JoinAccept");
+
+    _flags.Bits.Tx = 0;
+    _flags.Bits.JoinAccept = 1;
+    _info.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    Notify();
+
+}
+
+void mDotEvent::JoinFailed(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr) {
+    EndJoin();
+    logDebug("mDotEvent - JoinFailed");
+
+    _flags.Bits.Tx = 0;
+    _flags.Bits.JoinAccept = 1;
+    _info.Status = LORAMAC_EVENT_INFO_STATUS_JOIN_FAIL;
+    Notify();
+
+}
+
+void mDotEvent::MissedAck(uint8_t retries) {
+    logDebug("mDotEvent - MissedAck : retries %u", retries);
+    TxNbRetries = retries;
+    _info.TxNbRetries = retries;
+}
+
+void mDotEvent::PacketRx(uint8_t port, uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr, lora::DownlinkControl ctrl, uint8_t slot, uint8_t retries, uint32_t address, uint32_t fcnt, bool dupRx) {
+    EndSend();
+    logDebug("mDotEvent - PacketRx ADDR: %08x", address);
+
+    if (!dupRx) {
+        RxPort = port;
+        PacketReceived = true;
+
+        memcpy(RxPayload, payload, size);
+        RxPayloadSize = size;
+
+        if (ctrl.Bits.Ack) {
+            AckReceived = true;
+        }
+    }
+
+    DuplicateRx = dupRx;
+
+    _flags.Bits.Tx = 0;
+    _flags.Bits.Rx = 1;
+    _flags.Bits.RxData = size > 0;
+    _flags.Bits.RxSlot = slot;
+    _info.RxBuffer = payload;
+    _info.RxBufferSize = size;
+    _info.RxPort = port;
+    _info.RxRssi = rssi;
+    _info.RxSnr = snr;
+    _info.TxAckReceived = AckReceived;
+    _info.DuplicateRx = DuplicateRx;
+    _info.TxNbRetries = retries;
+    _info.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    Notify();
+}
+
+void mDotEvent::RxDone(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr, lora::DownlinkControl ctrl, uint8_t slot) {
+    LORA_TRACE(lora::TRACE_RX_DONE, slot, size, ((uint32_t) (uint16_t) snr << 16) | (uint16_t) rssi);
+
+    // the radio reports the downlink once it is in, so this includes its time on air
+    int32_t rx = (int32_t) (us_ticker_read() - WindowOpen(slot));
+
+    if ((sending || joining) && (slot == lora::RX_1 || slot == lora::RX_2) && rx > 0) {
+        lora::PerfStats::Global().Record(lora::PERF_RX_WINDOW_TO_DONE, rx);
+    }
+
+    MeterWindow(slot);
+
+    logDebug("mDotEvent - RxDone");
+
+}
+
+void mDotEvent::BeaconRx(const lora::BeaconData_t& beacon_data, int16_t rssi, int16_t snr) {
+    logDebug("mDotEvent - BeaconRx");
+    BeaconLocked = true;
+    BeaconData = beacon_data;
+}
+
+void mDotEvent::BeaconLost() {
+    logDebug("mDotEvent - BeaconLost");
+    BeaconLocked = false;
+}
+
+void mDotEvent::Pong(int16_t m_rssi, int16_t m_snr, int16_t s_rssi, int16_t s_snr) {
+    logDebug("mDotEvent - Pong");
+    PongReceived = true;
+    PongRssi = s_rssi;
+    PongSnr = s_snr;
+}
+
+void mDotEvent::ServerTime(uint32_t seconds, uint8_t sub_seconds) {
+    logDebug("mDotEvent - ServerTime");
+    ServerTimeReceived = true;
+
+    std::chrono::milliseconds current_server_time_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds(seconds)) +
+        std::chrono::milliseconds(static_cast<uint16_t>(sub_seconds) * 4) +
+        std::chrono::duration_cast<std::chrono::milliseconds>(_timeSinceTx.elapsed_time());
+        // std::chrono::duration_cast<std::chrono::milliseconds>(_timeSinceTx.elapsed_time());
+
+    ServerTimeSeconds = static_cast<uint32_t>(current_server_time_ms.count() / 1000);
+    ServerTimeMillis = static_cast<uint16_t>(current_server_time_ms.count() % 1000);
+}
+
+void mDotEvent::NetworkLinkCheck(int16_t m_rssi, int16_t m_snr, int16_t s_snr, uint8_t s_gateways) {
+    logDebug("mDotEvent - NetworkLinkCheck");
+    LinkCheckAnsReceived = true;
+    DemodMargin = s_snr;
+    NbGateways = s_gateways;
+
+    _flags.Bits.Tx = 0;
+    _flags.Bits.LinkCheck = 1;
+    _info.RxRssi = m_rssi;
+    _info.RxSnr = m_snr;
+    _info.DemodMargin = s_snr;
+    _info.NbGateways = s_gateways;
+    _info.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    Notify();
+}
+
+void mDotEvent::RxTimeout(uint8_t slot) {
+    LORA_TRACE(lora::TRACE_RX_TIMEOUT, slot);
+
+    MeterWindow(slot);
+
+    if (slot == lora::RX_2) {
+        EndSend();
+    }
+
+    logDebug("mDotEvent - RxTimeout on Slot %d", slot);
+
+    _flags.Bits.Tx = 0;
+    _flags.Bits.RxSlot = slot;
+    _info.Status = LORAMAC_EVENT_INFO_STATUS_RX_TIMEOUT;
+    Notify();
+
+}
+
+void mDotEvent::RxError(uint8_t slot) {
+    LORA_TRACE(lora::TRACE_RX_ERROR, slot);
+
+    MeterWindow(slot);
+
+    if (slot == lora::RX_2) {
+        EndSend();
+    }
+
+    logDebug("mDotEvent - RxError");
+
+    memset(&_flags, 0, sizeof(LoRaMacEventFlags));
+    memset(&_info, 0, sizeof(LoRaMacEventInfo));
+
+    _flags.Bits.RxSlot = slot;
+    _info.Status = LORAMAC_EVENT_INFO_STATUS_RX_ERROR;
+    Notify();
+
+}
+
+uint8_t mDotEvent::MeasureBattery() {
+    return 255;
+}
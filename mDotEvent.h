@@ -106,227 +106,47 @@ class mDotEvent: public lora::MacEvents {
             memset(&_info, 0, sizeof(LoRaMacEventInfo));
         }
 
-        virtual ~mDotEvent() {
-        }
-
-        virtual void MacEvent(LoRaMacEventFlags *flags, LoRaMacEventInfo *info) {
-            if (mts::MTSLog::getLogLevel() == mts::MTSLog::TRACE_LEVEL) {
-                std::string msg = "OK";
-                switch (info->Status) {
-                    case LORAMAC_EVENT_INFO_STATUS_ERROR:
-                        msg = "ERROR";
-                        break;
-                    case LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT:
-                        msg = "TX_TIMEOUT";
-                        break;
-                    case LORAMAC_EVENT_INFO_STATUS_RX_TIMEOUT:
-                        msg = "RX_TIMEOUT";
-                        break;
-                    case LORAMAC_EVENT_INFO_STATUS_RX_ERROR:
-                        msg = "RX_ERROR";
-                        break;
-                    case LORAMAC_EVENT_INFO_STATUS_JOIN_FAIL:
-                        msg = "JOIN_FAIL";
-                        break;
-                    case LORAMAC_EVENT_INFO_STATUS_DOWNLINK_FAIL:
-                        msg = "DOWNLINK_FAIL";
-                        break;
-                    case LORAMAC_EVENT_INFO_STATUS_ADDRESS_FAIL:
-                        msg = "ADDRESS_FAIL";
-                        break;
-                    case LORAMAC_EVENT_INFO_STATUS_MIC_FAIL:
-                        msg = "MIC_FAIL";
-                        break;
-                    default:
-                        break;
-                }
-                logTrace("Event: %s", msg.c_str());
-
-                logTrace("Flags Tx: %d Rx: %d RxData: %d RxSlot: %d LinkCheck: %d JoinAccept: %d",
-                         flags->Bits.Tx, flags->Bits.Rx, flags->Bits.RxData, flags->Bits.RxSlot, flags->Bits.LinkCheck, flags->Bits.JoinAccept);
-                logTrace("Info: Status: %d ACK: %d Retries: %d TxDR: %d RxPort: %d RxSize: %d RSSI: %d SNR: %d Energy: %d Margin: %d Gateways: %d",
-                         info->Status, info->TxAckReceived, info->TxNbRetries, info->TxDatarate, info->RxPort, info->RxBufferSize,
-                         info->RxRssi, info->RxSnr, info->Energy, info->DemodMargin, info->NbGateways);
-            }
-        }
-
-        virtual void TxStart() {
-            logDebug("mDotEvent - TxStart");
-
-        }
-
-        virtual void TxDone(uint8_t dr) {
-            _timeSinceTx.reset();
-            _timeSinceTx.start();
-
-            RxPayloadSize = 0;
-            LinkCheckAnsReceived = false;
-            PacketReceived = false;
-            AckReceived = false;
-            DuplicateRx = false;
-            PongReceived = false;
-            TxNbRetries = 0;
+        // the hooks are defined in mDotEvent.cpp, the strong copies there replace the weak
+        // ones the prebuilt library emits so every build links the traced and metered hooks
+        virtual ~mDotEvent();
 
-            logInfo("mDotEvent - TxDone");
-            memset(&_flags, 0, sizeof(LoRaMacEventFlags));
-            memset(&_info, 0, sizeof(LoRaMacEventInfo));
+        virtual void MacEvent(LoRaMacEventFlags *flags, LoRaMacEventInfo *info);
 
-            _flags.Bits.Tx = 1;
-            _info.TxDatarate = dr;
-            _info.Status = LORAMAC_EVENT_INFO_STATUS_OK;
-            Notify();
+        virtual void TxStart();
 
-        }
+        virtual void TxDone(uint8_t dr);
 
         void Notify() {
             MacEvent(&_flags, &_info);
         }
 
-        virtual void TxTimeout(void) {
-            logDebug("mDotEvent - TxTimeout");
-
-            _flags.Bits.Tx = 1;
-            _info.Status = LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT;
-            Notify();
-        }
-
-        virtual void JoinAccept(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr) {
-            logDebug("mDotEvent - JoinAccept");
-
-            _flags.Bits.Tx = 0;
-            _flags.Bits.JoinAccept = 1;
-            _info.Status = LORAMAC_EVENT_INFO_STATUS_OK;
-            Notify();
-
-        }
-
-        virtual void JoinFailed(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr) {
-            logDebug("mDotEvent - JoinFailed");
-
-            _flags.Bits.Tx = 0;
-            _flags.Bits.JoinAccept = 1;
-            _info.Status = LORAMAC_EVENT_INFO_STATUS_JOIN_FAIL;
-            Notify();
-
-        }
-
-        virtual void MissedAck(uint8_t retries) {
-            logDebug("mDotEvent - MissedAck : retries %u", retries);
-            TxNbRetries = retries;
-            _info.TxNbRetries = retries;
-        }
-
-        virtual void PacketRx(uint8_t port, uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr, lora::DownlinkControl ctrl, uint8_t slot, uint8_t retries, uint32_t address, uint32_t fcnt, bool dupRx) {
-            logDebug("mDotEvent - PacketRx ADDR: %08x", address);
-
-            if (!dupRx) {
-                RxPort = port;
-                PacketReceived = true;
-
-                memcpy(RxPayload, payload, size);
-                RxPayloadSize = size;
-
-                if (ctrl.Bits.Ack) {
-                    AckReceived = true;
-                }
-            }
-
-            DuplicateRx = dupRx;
-
-            _flags.Bits.Tx = 0;
-            _flags.Bits.Rx = 1;
-            _flags.Bits.RxData = size > 0;
-            _flags.Bits.RxSlot = slot;
-            _info.RxBuffer = payload;
-            _info.RxBufferSize = size;
-            _info.RxPort = port;
-            _info.RxRssi = rssi;
-            _info.RxSnr = snr;
-            _info.TxAckReceived = AckReceived;
-            _info.DuplicateRx = DuplicateRx;
-            _info.TxNbRetries = retries;
-            _info.Status = LORAMAC_EVENT_INFO_STATUS_OK;
-            Notify();
-        }
-
-        virtual void RxDone(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr, lora::DownlinkControl ctrl, uint8_t slot) {
-            logDebug("mDotEvent - RxDone");
-
-        }
-
-        virtual void BeaconRx(const lora::BeaconData_t& beacon_data, int16_t rssi, int16_t snr) {
-            logDebug("mDotEvent - BeaconRx");
-            BeaconLocked = true;
-            BeaconData = beacon_data;
-        }
-
-        virtual void BeaconLost() {
-            logDebug("mDotEvent - BeaconLost");
-            BeaconLocked = false;
-        }
+        virtual void TxTimeout(void);
 
-        virtual void Pong(int16_t m_rssi, int16_t m_snr, int16_t s_rssi, int16_t s_snr) {
-            logDebug("mDotEvent - Pong");
-            PongReceived = true;
-            PongRssi = s_rssi;
-            PongSnr = s_snr;
-        }
+        virtual void JoinAccept(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr);
 
-        virtual void ServerTime(uint32_t seconds, uint8_t sub_seconds) {
-            logDebug("mDotEvent - ServerTime");
-            ServerTimeReceived = true;
+        virtual void JoinFailed(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr);
 
-            std::chrono::milliseconds current_server_time_ms =
-                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds(seconds)) +
-                std::chrono::milliseconds(static_cast<uint16_t>(sub_seconds) * 4) +
-                std::chrono::duration_cast<std::chrono::milliseconds>(_timeSinceTx.elapsed_time());
-                // std::chrono::duration_cast<std::chrono::milliseconds>(_timeSinceTx.elapsed_time());
+        virtual void MissedAck(uint8_t retries);
 
-            ServerTimeSeconds = static_cast<uint32_t>(current_server_time_ms.count() / 1000);
-            ServerTimeMillis = static_cast<uint16_t>(current_server_time_ms.count() % 1000);
-        }
+        virtual void PacketRx(uint8_t port, uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr, lora::DownlinkControl ctrl, uint8_t slot, uint8_t retries, uint32_t address, uint32_t fcnt, bool dupRx);
 
-        virtual void NetworkLinkCheck(int16_t m_rssi, int16_t m_snr, int16_t s_snr, uint8_t s_gateways) {
-            logDebug("mDotEvent - NetworkLinkCheck");
-            LinkCheckAnsReceived = true;
-            DemodMargin = s_snr;
-            NbGateways = s_gateways;
-
-            _flags.Bits.Tx = 0;
-            _flags.Bits.LinkCheck = 1;
-            _info.RxRssi = m_rssi;
-            _info.RxSnr = m_snr;
-            _info.DemodMargin = s_snr;
-            _info.NbGateways = s_gateways;
-            _info.Status = LORAMAC_EVENT_INFO_STATUS_OK;
-            Notify();
-        }
+        virtual void RxDone(uint8_t *payload, uint16_t size, int16_t rssi, int16_t snr, lora::DownlinkControl ctrl, uint8_t slot);
 
-        virtual void RxTimeout(uint8_t slot) {
-            logDebug("mDotEvent - RxTimeout on Slot %d", slot);
+        virtual void BeaconRx(const lora::BeaconData_t& beacon_data, int16_t rssi, int16_t snr);
 
-            _flags.Bits.Tx = 0;
-            _flags.Bits.RxSlot = slot;
-            _info.Status = LORAMAC_EVENT_INFO_STATUS_RX_TIMEOUT;
-            Notify();
+        virtual void BeaconLost();
 
-        }
+        virtual void Pong(int16_t m_rssi, int16_t m_snr, int16_t s_rssi, int16_t s_snr);
 
-        virtual void RxError(uint8_t slot) {
-            logDebug("mDotEvent - RxError");
+        virtual void ServerTime(uint32_t seconds, uint8_t sub_seconds);
 
-            memset(&_flags, 0, sizeof(LoRaMacEventFlags));
-            memset(&_info, 0, sizeof(LoRaMacEventInfo));
+        virtual void NetworkLinkCheck(int16_t m_rssi, int16_t m_snr, int16_t s_snr, uint8_t s_gateways);
 
-            _flags.Bits.RxSlot = slot;
-            _info.Status = LORAMAC_EVENT_INFO_STATUS_RX_ERROR;
-            Notify();
+        virtual void RxTimeout(uint8_t slot);
 
-        }
+        virtual void RxError(uint8_t slot);
 
-        virtual uint8_t MeasureBattery(void) {
-            return 255;
-        }
+        virtual uint8_t MeasureBattery(void);
 
         bool LinkCheckAnsReceived;
         uint8_t DemodMargin;
@@ -0,0 +1,144 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#include "mDot.h"
+
+#if defined(TARGET_MTS_MDOT_F411RE)
+
+namespace {
+
+    const uint8_t MAX_OPEN_FILES = 4;
+
+    /**
+     * An open mdot_file, the position and size are kept here as the file system does not report them
+     */
+    class UserFileDevice : public lora::FileDevice {
+        public:
+            UserFileDevice() : _dot(NULL), _position(0), _size(0), _append(false) {
+                _file.fd = -1;
+            }
+
+            bool Open(mDot* dot, const char* name, int mode) {
+                _file = dot->openUserFile(name, mode);
+
+                if (_file.fd < 0) {
+                    return false;
+                }
+
+                _dot = dot;
+                _size = (mode & mDot::FM_TRUNC) ? 0 : _file.size;
+                _position = (mode & mDot::FM_APPEND) ? _size : 0;
+                _append = (mode & mDot::FM_APPEND) != 0;
+
+                return true;
+            }
+
+            bool Close() {
+                bool ok = _dot->closeUserFile(_file);
+
+                _file.fd = -1;
+                return ok;
+            }
+
+            bool IsOpen() const {
+                return _file.fd >= 0;
+            }
+
+            virtual int32_t Read(uint8_t* data, uint32_t size) {
+                int read = _dot->readUserFile(_file, data, size);
+
+                if (read < 0) {
+                    return -1;
+                }
+
+                _position += read;
+                return read;
+            }
+
+            virtual int32_t Write(const uint8_t* data, uint32_t size) {
+                int written = _dot->writeUserFile(_file, (void*) data, size);
+
+                if (written < 0) {
+                    return -1;
+                }
+
+                if (_append) {
+                    _position = _size;
+                }
+
+                _position += written;
+
+                if (_position > _size) {
+                    _size = _position;
+                }
+
+                return written;
+            }
+
+            virtual int32_t Seek(int32_t offset, int whence) {
+                int64_t target = whence == SEEK_SET ? offset : whence == SEEK_CUR ? (int64_t) _position + offset : (int64_t) _size + offset;
+
+                if (target < 0 || !_dot->seekUserFile(_file, offset, whence)) {
+                    return -1;
+                }
+
+                _position = target;
+                return 0;
+            }
+
+            virtual uint32_t Tell() const {
+                return _position;
+            }
+
+            virtual uint32_t Size() const {
+                return _size;
+            }
+
+        private:
+            mDot* _dot;
+            mDot::mdot_file _file;
+            uint32_t _position;
+            uint32_t _size;
+            bool _append;
+    };
+
+    UserFileDevice userFiles[MAX_OPEN_FILES];
+
+}
+
+lora::FileDevice* mDot::openUserFileDevice(const char* file, int mode) {
+    for (uint8_t i = 0; i < MAX_OPEN_FILES; i++) {
+        if (!userFiles[i].IsOpen()) {
+            return userFiles[i].Open(this, file, mode) ? &userFiles[i] : NULL;
+        }
+    }
+
+    logError("no file device free to open %s", file);
+    return NULL;
+}
+
+bool mDot::closeUserFileDevice(lora::FileDevice* file) {
+    for (uint8_t i = 0; i < MAX_OPEN_FILES; i++) {
+        if (file == &userFiles[i] && userFiles[i].IsOpen()) {
+            return userFiles[i].Close();
+        }
+    }
+
+    return false;
+}
+
+#endif /* TARGET_MTS_MDOT_F411RE */
@@ -0,0 +1,115 @@
+/**********************************************************************
+* COPYRIGHT 2026 MULTI-TECH SYSTEMS, INC.
+*
+* ALL RIGHTS RESERVED BY AND FOR THE EXCLUSIVE BENEFIT OF
+* MULTI-TECH SYSTEMS, INC.
+*
+* MULTI-TECH SYSTEMS, INC. - CONFIDENTIAL AND PROPRIETARY
+* INFORMATION AND/OR TRADE SECRET.
+*
+* NOTICE: ALL CODE, PROGRAM, INFORMATION, SCRIPT, INSTRUCTION,
+* DATA, AND COMMENT HEREIN IS AND SHALL REMAIN THE CONFIDENTIAL
+* INFORMATION AND PROPERTY OF MULTI-TECH SYSTEMS, INC.
+* USE AND DISCLOSURE THEREOF, EXCEPT AS STRICTLY AUTHORIZED IN A
+* WRITTEN AGREEMENT SIGNED BY MULTI-TECH SYSTEMS, INC. IS PROHIBITED.
+*
+***********************************************************************/
+
+#include "mDot.h"
+
+#include <string.h>
+
+namespace {
+
+    lora::SettingsStore* settingsStore = NULL;
+
+#if defined(TARGET_XDOT_L151CC) || defined(TARGET_XDOT_MAX32670)
+    const uint32_t EEPROM_SIZE = 0x1800;
+    const uint32_t EEPROM_WORD = 4;
+
+    class EepromNvm : public lora::NvmDevice {
+        public:
+            EepromNvm(mDot* dot) : _dot(dot) {}
+
+            virtual int32_t Read(uint32_t address, uint8_t* data, uint32_t size) {
+                if (address + size > EEPROM_SIZE) {
+                    return -1;
+                }
+
+                return _dot->nvmRead(address, data, size) ? 0 : -1;
+            }
+
+            virtual int32_t Program(uint32_t address, const uint8_t* data, uint32_t size) {
+                if (address + size > EEPROM_SIZE) {
+                    return -1;
+                }
+
+                return _dot->nvmWrite(address, (void*) data, size) ? 0 : -1;
+            }
+
+            virtual int32_t Erase(uint32_t address, uint32_t size) {
+                uint8_t blank[64];
+
+                memset(blank, lora::NVM_ERASED, sizeof(blank));
+
+                for (uint32_t done = 0; done < size; done += sizeof(blank)) {
+                    uint32_t length = size - done < sizeof(blank) ? size - done : sizeof(blank);
+
+                    if (Program(address + done, blank, length) != 0) {
+                        return -1;
+                    }
+                }
+
+                return 0;
+            }
+
+            virtual uint32_t EraseSize() const {
+                return EEPROM_WORD;
+            }
+
+            virtual uint32_t ProgramSize() const {
+                return EEPROM_WORD;
+            }
+
+            // EEPROM words are rewritten in place, counters can clear one bit at a time
+            virtual bool Reprogrammable() const {
+                return true;
+            }
+
+        private:
+            mDot* _dot;
+    };
+#endif
+
+}
+
+#if defined(TARGET_XDOT_L151CC) || defined(TARGET_XDOT_MAX32670)
+lora::NvmDevice& mDot::getNvmDevice() {
+    static EepromNvm nvm(this);
+    return nvm;
+}
+#endif
+
+int32_t mDot::setSettingsStore(lora::SettingsStore* store) {
+    settingsStore = NULL;
+
+    if (store == NULL) {
+        return MDOT_OK;
+    }
+
+    if (store->Mount(*getSettings()) != lora::LORA_OK) {
+        logError("settings store failed to mount");
+        return MDOT_ERROR;
+    }
+
+    settingsStore = store;
+    return MDOT_OK;
+}
+
+int32_t mDot::saveSettingsChanges() {
+    if (settingsStore == NULL) {
+        return MDOT_ERROR;
+    }
+
+    return settingsStore->Save(*getSettings()) == lora::LORA_OK ? MDOT_OK : MDOT_ERROR;
+}
@@ -16,6 +16,8 @@
 ***********************************************************************/
 
 #include "ChannelPlan_AS923.h"
+#include "PerfStats.h"
+#include "MacCommandCodec.h"
 #include "ChannelPlans.h"
 #include "limits.h"
 
@@ -421,14 +423,7 @@ uint8_t ChannelPlan_AS923::HandleRxParamSetup(const uint8_t* payload, uint8_t in
     int8_t drOffset = 0;
     uint32_t freq = 0;
 
-    drOffset = payload[index++];
-    datarate = drOffset & 0x0F;
-    drOffset = (drOffset >> 4) & 0x07;
-
-    freq = payload[index++];
-    freq |= payload[index++] << 8;
-    freq |= payload[index++] << 16;
-    freq *= 100;
+    MacCommandCodec::DecodeRxParamSetupReq(payload + index, datarate, drOffset, freq);
 
     if (!CheckRfFrequency(freq)) {
         logInfo("Freq KO");
@@ -584,16 +579,7 @@ uint8_t ChannelPlan_AS923::HandleAdrCommand(const uint8_t* payload, uint8_t inde
     uint8_t nbRep = 0;
 
     status = 0x07;
-    datarate = payload[index++];
-    power = datarate & 0x0F;
-    datarate = (datarate >> 4) & 0x0F;
-
-    mask = payload[index++];
-    mask |= payload[index++] << 8;
-
-    nbRep = payload[index++];
-    ctrl = (nbRep >> 4) & 0x07;
-    nbRep &= 0x0F;
+    MacCommandCodec::DecodeLinkAdrReq(payload + index, datarate, power, mask, ctrl, nbRep);
 
     if (nbRep == 0) {
         nbRep = 1;
@@ -807,6 +793,7 @@ uint8_t ChannelPlan_AS923::GetNextChannel()
     bool error = false;
 
     if (GetSettings()->Session.AggregatedTimeOffEnd != 0) {
+        PerfStats::Global().CountDutyCycle(LORA_AGGREGATED_DUTY_CYCLE, GetTimeOffAir());
         return LORA_AGGREGATED_DUTY_CYCLE;
     }
 
@@ -817,6 +804,7 @@ uint8_t ChannelPlan_AS923::GetNextChannel()
             int8_t band = GetDutyBand(GetSettings()->Network.TxFrequency);
             logDebug("band: %d freq: %d", band, GetSettings()->Network.TxFrequency);
             if (band != -1 && _dutyBands[band].TimeOffEnd != 0) {
+                PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
                 return LORA_NO_CHANS_ENABLED;
             }
         }
@@ -836,6 +824,7 @@ uint8_t ChannelPlan_AS923::GetNextChannel()
     }
 
 // Search how many channels are enabled
+    bool held = false;                  // a channel left out only because its duty band is off
     DatarateRange range;
     uint8_t dr_index = GetSettings()->Session.TxDatarate;
     uint32_t now = std::chrono::duration_cast<std::chrono::milliseconds>(_dutyCycleTimer.elapsed_time()).count();
@@ -855,6 +844,8 @@ uint8_t ChannelPlan_AS923::GetNextChannel()
             // logDebug("band: %d freq: %d", band, _channels[i].Frequency);
             if (band != -1 && _dutyBands[band].TimeOffEnd == 0) {
                 enabledChannels[nbEnabledChannels++] = i;
+            } else if (band != -1) {
+                held = true;
             }
         }
     }
@@ -866,6 +857,11 @@ uint8_t ChannelPlan_AS923::GetNextChannel()
 
     if (nbEnabledChannels == 0) {
         delete [] enabledChannels;
+        if (held) {
+            PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
+        } else {
+            PerfStats::Global().CountStatus(LORA_NO_CHANS_ENABLED);
+        }
         return LORA_NO_CHANS_ENABLED;
     }
 
@@ -874,6 +870,7 @@ uint8_t ChannelPlan_AS923::GetNextChannel()
         int16_t timeout = 10000;
         Timer tmr;
         tmr.start();
+        bool channelFree = false;
 
         while(std::chrono::duration_cast<std::chrono::milliseconds>(tmr.elapsed_time()).count() < timeout)
         {
@@ -884,13 +881,22 @@ uint8_t ChannelPlan_AS923::GetNextChannel()
 
                 if (GetRadio()->IsChannelFree(SxRadio::MODEM_LORA, freq, thres)) {
                     _txChannel = channel;
+                    channelFree = true;
                     break;
                 }
             }
             else {
             	error = true;
+            	break;
             }
         }
+
+        // every probe in the listen before talk time found its channel busy
+        if (!channelFree && !error) {
+            delete [] enabledChannels;
+            PerfStats::Global().CountStatus(LORA_LBT_CHANNEL_BUSY);
+            return LORA_LBT_CHANNEL_BUSY;
+        }
     } else {
         uint8_t channel = 0;
         if(_randomChannel.NextChannel(enabledChannels, nbEnabledChannels, &channel))  {
@@ -950,10 +956,10 @@ uint8_t ChannelPlan_AS923::HandleMacCommand(uint8_t* payload, uint8_t& index) {
 
     switch (payload[index++]) {
         case SRV_MAC_TX_PARAM_SETUP_REQ: {
-            uint8_t eirp_dwell = payload[index++];
-
-            GetSettings()->Session.DownlinkDwelltime = (eirp_dwell >> 5) & 0x01;
-            GetSettings()->Session.UplinkDwelltime = (eirp_dwell >> 4) & 0x01;
+            uint8_t eirp = 0;
+            MacCommandCodec::DecodeTxParamSetupReq(payload + index, GetSettings()->Session.DownlinkDwelltime,
+                                                   GetSettings()->Session.UplinkDwelltime, eirp);
+            index += MacCommandCodec::ServerCommandSize(SRV_MAC_TX_PARAM_SETUP_REQ) - 1;
             //change data rate with if dwell time changes
             if(GetSettings()->Session.UplinkDwelltime == 1) {
                 if(GetSettings()->Session.TxDatarate < lora::DR_2) {
@@ -962,13 +968,11 @@ uint8_t ChannelPlan_AS923::HandleMacCommand(uint8_t* payload, uint8_t& index) {
                 }
             }
 
-            GetSettings()->Session.Max_EIRP = MAX_ERP_VALUES[(eirp_dwell & 0x0F)];
+            GetSettings()->Session.Max_EIRP = MAX_ERP_VALUES[eirp];
 
             GetSettings()->Session.TxPower = GetSettings()->Session.Max_EIRP;
   
-            if (GetSettings()->Session.CommandBufferIndex < std::min<int>(GetMaxPayloadSize(), COMMANDS_BUFFER_SIZE)) {
-                GetSettings()->Session.CommandBuffer[GetSettings()->Session.CommandBufferIndex++] = MOTE_MAC_TX_PARAM_SETUP_ANS;
-            }
+            MacCommandCodec::ReserveAnswer(GetSettings()->Session, MOTE_MAC_TX_PARAM_SETUP_ANS, GetMaxPayloadSize());
 
             logDebug("TX PARAM DWELL UL: %d DL: %d Max EIRP: %d", GetSettings()->Session.UplinkDwelltime, GetSettings()->Session.DownlinkDwelltime, GetSettings()->Session.Max_EIRP);
             break;
@@ -16,6 +16,8 @@
 ***********************************************************************/
 
 #include "ChannelPlan_AU915.h"
+#include "PerfStats.h"
+#include "MacCommandCodec.h"
 #include "limits.h"
 
 using namespace lora;
@@ -481,14 +483,7 @@ uint8_t ChannelPlan_AU915::HandleRxParamSetup(const uint8_t* payload, uint8_t in
     int8_t drOffset = 0;
     uint32_t freq = 0;
 
-    drOffset = payload[index++];
-    datarate = drOffset & 0x0F;
-    drOffset = (drOffset >> 4) & 0x07;
-
-    freq = payload[index++];
-    freq |= payload[index++] << 8;
-    freq |= payload[index++] << 16;
-    freq *= 100;
+    MacCommandCodec::DecodeRxParamSetupReq(payload + index, datarate, drOffset, freq);
 
     if (!CheckRfFrequency(freq)) {
         logInfo("Freq KO");
@@ -611,16 +606,8 @@ uint8_t ChannelPlan_AU915::HandleAdrCommand(const uint8_t* payload, uint8_t inde
     uint8_t nbRep = 0;
 
     status = 0x07;
-    datarate = payload[index++];
-    power = datarate & 0x0F;
-    datarate = (datarate >> 4) & 0x0F;
-
-    mask = payload[index++];
-    mask |= payload[index++] << 8;
-
-    nbRep = payload[index++];
-    ctrl = (nbRep >> 4) & 0x07;
-    nbRep &= 0x0F;
+    MacCommandCodec::DecodeLinkAdrReq(payload + index, datarate, power, mask, ctrl, nbRep);
+    _adr.Stage(_channelMask, payload, index, size);
 
     if (nbRep == 0) {
         nbRep = 1;
@@ -644,7 +631,7 @@ uint8_t ChannelPlan_AU915::HandleAdrCommand(const uint8_t* payload, uint8_t inde
         case 2:
         case 3:
         case 4:
-            SetChannelMask(ctrl, mask);
+            _adr.SetChannelMask(ctrl, mask);
             break;
 
         case 5:
@@ -654,53 +641,55 @@ uint8_t ChannelPlan_AU915::HandleAdrCommand(const uint8_t* payload, uint8_t inde
                         t_125k |= (0xff << ((i % 2) * 8));
                     }
                     if(i % 2 == 1) {
-                        SetChannelMask(i/2, t_125k);
+                        _adr.SetChannelMask(i/2, t_125k);
                         t_125k = 0;
                     }
                 }
-                SetChannelMask(4, mask);
+                _adr.SetChannelMask(4, mask);
             } else {
                 status &= 0xFE; // ChannelMask KO
                 logWarning("Rejecting mask, will not disable all channels");
+                _adr.AddStatus(status);
                 return LORA_ERROR;
             }
             break;
 
         case 6:
             // enable all 125 kHz channels
-            SetChannelMask(0, 0xFFFF);
-            SetChannelMask(1, 0xFFFF);
-            SetChannelMask(2, 0xFFFF);
-            SetChannelMask(3, 0xFFFF);
-            SetChannelMask(4, mask);
+            _adr.SetChannelMask(0, 0xFFFF);
+            _adr.SetChannelMask(1, 0xFFFF);
+            _adr.SetChannelMask(2, 0xFFFF);
+            _adr.SetChannelMask(3, 0xFFFF);
+            _adr.SetChannelMask(4, mask);
             break;
 
         case 7:
             // disable all 125 kHz channels
-            SetChannelMask(0, 0x0);
-            SetChannelMask(1, 0x0);
-            SetChannelMask(2, 0x0);
-            SetChannelMask(3, 0x0);
-            SetChannelMask(4, mask);
+            _adr.SetChannelMask(0, 0x0);
+            _adr.SetChannelMask(1, 0x0);
+            _adr.SetChannelMask(2, 0x0);
+            _adr.SetChannelMask(3, 0x0);
+            _adr.SetChannelMask(4, mask);
             break;
 
         default:
             logWarning("rejecting RFU or unknown control value %d", ctrl);
             status &= 0xFE; // ChannelMask KO
+            _adr.AddStatus(status);
             return LORA_ERROR;
     }
 
     if (GetSettings()->Network.ADREnabled) {
         if (status == 0x07) {
             if (datarate != 0xF)
-                GetSettings()->Session.TxDatarate = datarate;
+                _adr.SetDatarate(datarate);
             if (power != 0xF) {
                 if (GetSettings()->Session.Max_EIRP > (power * 2))
-                    GetSettings()->Session.TxPower = GetSettings()->Session.Max_EIRP - (power * 2);
+                    _adr.SetTxPower(GetSettings()->Session.Max_EIRP - (power * 2));
                 else
-                    GetSettings()->Session.TxPower = 0;
+                    _adr.SetTxPower(0);
             }
-            GetSettings()->Session.Redundancy = nbRep;
+            _adr.SetRedundancy(nbRep);
         }
     } else {
         logDebug("ADR is disabled, DR and Power not changed.");
@@ -708,14 +697,16 @@ uint8_t ChannelPlan_AU915::HandleAdrCommand(const uint8_t* payload, uint8_t inde
 
     logDebug("ADR DR: %u PWR: %u Ctrl: %02x Mask: %04x NbRep: %u Stat: %02x", datarate, power, ctrl, mask, nbRep, status);
 
+    _adr.AddStatus(status);
     return LORA_OK;
 }
 
 uint8_t ChannelPlan_AU915::ValidateAdrConfiguration() {
     uint8_t status = 0x07;
     uint8_t chans_enabled = 0;
-    uint8_t datarate = GetSettings()->Session.TxDatarate;
-    uint8_t power = GetSettings()->Session.TxPower;
+    uint8_t datarate = _adr.GetDatarate(GetSettings()->Session.TxDatarate);
+    uint8_t power = _adr.GetTxPower(GetSettings()->Session.TxPower);
+    const std::vector<uint16_t>& channelMask = _adr.Pending() ? _adr.GetChannelMask() : _channelMask;
 
     if (GetSettings()->Network.ADREnabled) {
         if (datarate > _maxDatarate) {
@@ -733,10 +724,10 @@ uint8_t ChannelPlan_AU915::ValidateAdrConfiguration() {
     }
 
     // at least 2 125kHz channels must be enabled
-    chans_enabled += CountBits(_channelMask[0]);
-    chans_enabled += CountBits(_channelMask[1]);
-    chans_enabled += CountBits(_channelMask[2]);
-    chans_enabled += CountBits(_channelMask[3]);
+    chans_enabled += CountBits(channelMask[0]);
+    chans_enabled += CountBits(channelMask[1]);
+    chans_enabled += CountBits(channelMask[2]);
+    chans_enabled += CountBits(channelMask[3]);
     // Semtech reference (LoRaMac-node) enforces at least 2 channels
     if (datarate < 6 && chans_enabled < 2) {
         logWarning("ADR Channel Mask KO - at least 2 125kHz channels must be enabled");
@@ -744,11 +735,22 @@ uint8_t ChannelPlan_AU915::ValidateAdrConfiguration() {
     }
 
     // if TXDR == 6 (SF8@500kHz) at least 1 500kHz channel must be enabled
-    if (datarate == DR_6 && (CountBits(_channelMask[4] & 0xFF) == 0)) {
+    if (datarate == DR_6 && (CountBits(channelMask[4] & 0xFF) == 0)) {
         logWarning("ADR Datarate KO - DR4 requires at least 1 500kHz channel enabled");
         status &= 0xFD; // Datarate KO
     }
 
+    // the Mac validates once per LinkADRReq block, the block is applied as a whole or not at all
+    if (_adr.Pending()) {
+        status &= _adr.GetStatus();
+
+        if (status == 0x07) {
+            _adr.Commit(this, _channelMask);
+        } else {
+            _adr.Abort();
+        }
+    }
+
     return status;
 }
 
@@ -831,6 +833,7 @@ uint8_t ChannelPlan_AU915::GetNextChannel()
     bool error = false;
 
     if (GetSettings()->Session.AggregatedTimeOffEnd != 0) {
+        PerfStats::Global().CountDutyCycle(LORA_AGGREGATED_DUTY_CYCLE, GetTimeOffAir());
         return LORA_AGGREGATED_DUTY_CYCLE;
     }
 
@@ -841,6 +844,7 @@ uint8_t ChannelPlan_AU915::GetNextChannel()
             int8_t band = GetDutyBand(GetSettings()->Network.TxFrequency);
             logDebug("band: %d freq: %d", band, GetSettings()->Network.TxFrequency);
             if (band != -1 && _dutyBands[band].TimeOffEnd != 0) {
+                PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
                 return LORA_NO_CHANS_ENABLED;
             }
         }
@@ -856,7 +860,7 @@ uint8_t ChannelPlan_AU915::GetNextChannel()
     uint8_t start = 0;
     uint8_t maxChannels = _numChans125k;
     uint8_t nbEnabledChannels = 0;
-    uint8_t *enabledChannels = new uint8_t[maxChannels];
+    uint16_t enabledChannels[6] = { 0 };     // channel mask words, 96 channels at most
 
     if (GetTxDatarate().Bandwidth == BW_500) {
         maxChannels = _numChans500k;
@@ -864,6 +868,7 @@ uint8_t ChannelPlan_AU915::GetNextChannel()
     }
 
 // Search how many channels are enabled
+    bool held = false;                  // a channel left out only because its duty band is off
     DatarateRange range;
     uint8_t dr_index = GetSettings()->Session.TxDatarate;
     auto now = duration_cast<milliseconds>(_dutyCycleTimer.elapsed_time()).count();
@@ -874,16 +879,25 @@ uint8_t ChannelPlan_AU915::GetNextChannel()
         }
     }
 
-    for (uint8_t i = start; i < start + maxChannels; i++) {
-        range = GetChannel(i).DrRange;
-        // logDebug("chan: %d freq: %d range:%02x", i, GetChannel(i).Frequency, range.Value);
+    // whole words of the channel mask, the channels of a word share their datarate range and
+    // duty band so a word is left out as a whole when either rules it out
+    for (uint8_t word = start / 16; word * 16 < start + maxChannels && word < _channelMask.size(); word++) {
+        uint8_t first = std::max<uint8_t>(start, word * 16);
+        uint8_t end = std::min<uint8_t>(start + maxChannels, word * 16 + 16);
+        uint16_t group = ((1UL << (end - word * 16)) - 1) & ~((1UL << (first - word * 16)) - 1);
+        uint16_t enabled = _channelMask[word] & group;
+
+        range = GetChannel(first).DrRange;
+        if (enabled == 0 || dr_index < range.Fields.Min || dr_index > range.Fields.Max) {
+            continue;
+        }
 
-        if (IsChannelEnabled(i) && (dr_index >= range.Fields.Min && dr_index <= range.Fields.Max)) {
-            int8_t band = GetDutyBand(GetChannel(i).Frequency);
-            // logDebug("band: %d freq: %d", band, _channels[i].Frequency);
-            if (band != -1 && _dutyBands[band].TimeOffEnd == 0) {
-                enabledChannels[nbEnabledChannels++] = i;
-            }
+        int8_t band = GetDutyBand(GetChannel(first).Frequency);
+        if (band != -1 && _dutyBands[band].TimeOffEnd == 0) {
+            enabledChannels[word] = enabled;
+            nbEnabledChannels += CountBits(enabled);
+        } else if (band != -1) {
+            held = true;
         }
     }
 
@@ -902,7 +916,11 @@ uint8_t ChannelPlan_AU915::GetNextChannel()
     int16_t thres = DEFAULT_FREE_CHAN_RSSI_THRESHOLD;
 
     if (nbEnabledChannels == 0) {
-        delete [] enabledChannels;
+        if (held) {
+            PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
+        } else {
+            PerfStats::Global().CountStatus(LORA_NO_CHANS_ENABLED);
+        }
         return LORA_NO_CHANS_ENABLED;
     }
 
@@ -911,26 +929,35 @@ uint8_t ChannelPlan_AU915::GetNextChannel()
         int16_t timeout = 10000;
         Timer tmr;
         tmr.start();
+        bool channelFree = false;
 
         while(std::chrono::duration_cast<std::chrono::milliseconds>(tmr.elapsed_time()).count() < timeout)
         {
             uint8_t channel = 0;
             // grab the next channel if any are enabled
-            if(_randomChannel.NextChannel(enabledChannels, nbEnabledChannels, &channel)) {
+            if(_randomChannel.NextChannel(enabledChannels, 6, &channel)) {
                 freq = GetChannel(channel).Frequency;
 
                 if (GetRadio()->IsChannelFree(SxRadio::MODEM_LORA, freq, thres)) {
                     _txChannel = channel;
+                    channelFree = true;
                     break;
                 }
             }
             else {
             	error = true;
+            	break;
             }
         }
+
+        // every probe in the listen before talk time found its channel busy
+        if (!channelFree && !error) {
+            PerfStats::Global().CountStatus(LORA_LBT_CHANNEL_BUSY);
+            return LORA_LBT_CHANNEL_BUSY;
+        }
     } else {
         uint8_t channel = 0;
-        if(_randomChannel.NextChannel(enabledChannels, nbEnabledChannels, &channel))  {
+        if(_randomChannel.NextChannel(enabledChannels, 6, &channel))  {
             _txChannel = channel;
             freq = GetChannel(_txChannel).Frequency;
         }
@@ -949,7 +976,6 @@ uint8_t ChannelPlan_AU915::GetNextChannel()
         GetRadio()->SetChannel(freq);
     }
 
-    delete [] enabledChannels;
     return LORA_OK;
 }
 
@@ -1001,10 +1027,10 @@ uint8_t ChannelPlan_AU915::HandleMacCommand(uint8_t* payload, uint8_t& index) {
 
     switch (payload[index++]) {
         case SRV_MAC_TX_PARAM_SETUP_REQ: {
-            uint8_t eirp_dwell = payload[index++];
-
-            GetSettings()->Session.DownlinkDwelltime = (eirp_dwell >> 5) & 0x01;
-            GetSettings()->Session.UplinkDwelltime = (eirp_dwell >> 4) & 0x01;
+            uint8_t eirp = 0;
+            MacCommandCodec::DecodeTxParamSetupReq(payload + index, GetSettings()->Session.DownlinkDwelltime,
+                                                   GetSettings()->Session.UplinkDwelltime, eirp);
+            index += MacCommandCodec::ServerCommandSize(SRV_MAC_TX_PARAM_SETUP_REQ) - 1;
             
             //change data rate with if dwell time changes
             if(GetSettings()->Session.UplinkDwelltime == 0) {
@@ -1017,13 +1043,11 @@ uint8_t ChannelPlan_AU915::HandleMacCommand(uint8_t* payload, uint8_t& index) {
                 }
             }
 
-            GetSettings()->Session.Max_EIRP = MAX_ERP_VALUES[(eirp_dwell & 0x0F)];
+            GetSettings()->Session.Max_EIRP = MAX_ERP_VALUES[eirp];
 
             GetSettings()->Session.TxPower = GetSettings()->Session.Max_EIRP;
 
-            if (GetSettings()->Session.CommandBufferIndex < std::min<int>(GetMaxPayloadSize(), COMMANDS_BUFFER_SIZE)) {
-                GetSettings()->Session.CommandBuffer[GetSettings()->Session.CommandBufferIndex++] = MOTE_MAC_TX_PARAM_SETUP_ANS;
-            }
+            MacCommandCodec::ReserveAnswer(GetSettings()->Session, MOTE_MAC_TX_PARAM_SETUP_ANS, GetMaxPayloadSize());
 
             logDebug("TX PARAM DWELL UL: %d DL: %d Max EIRP: %d", GetSettings()->Session.UplinkDwelltime, GetSettings()->Session.DownlinkDwelltime, GetSettings()->Session.Max_EIRP);
             break;
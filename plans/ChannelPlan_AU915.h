@@ -19,6 +19,7 @@
 #include "Lora.h"
 #include "SxRadio.h"
 #include "ChannelPlan.h"
+#include "AdrTransaction.h"
 #include <vector>
 
 namespace lora {
@@ -219,6 +220,8 @@ namespace lora {
 
             /**
              * Validate the configuration after multiple ADR commands have been applied
+             * While a LinkADRReq block is staged the staged mask, datarate and power are checked,
+             * then the block is committed if every command in it was accepted or dropped if not
              * @return status to be returned in MoteCommand answer
              */
             virtual uint8_t ValidateAdrConfiguration();
@@ -313,6 +316,8 @@ namespace lora {
             static const uint8_t AU915_MAX_PAYLOAD_SIZE_REPEATER_400[]; //!< List of repeater compatible max payload sizes for each datarate
             static const uint8_t MAX_ERP_VALUES[];                      //!< Lookup table for Max EIRP (dBm) codes
 
+            AdrTransaction _adr;                                        //!< LinkADRReq block staged until validated
+
             typedef struct __attribute__((packed)) {
                 uint8_t RFU1[5];
                 uint8_t Time[4];
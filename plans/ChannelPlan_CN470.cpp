@@ -16,6 +16,8 @@
 ***********************************************************************/
 
 #include "ChannelPlan_CN470.h"
+#include "PerfStats.h"
+#include "MacCommandCodec.h"
 #include "limits.h"
 
 using namespace lora;
@@ -429,14 +431,7 @@ uint8_t ChannelPlan_CN470::HandleRxParamSetup(const uint8_t* payload, uint8_t in
     int8_t drOffset = 0;
     uint32_t freq = 0;
 
-    drOffset = payload[index++];
-    datarate = drOffset & 0x0F;
-    drOffset = (drOffset >> 4) & 0x07;
-
-    freq = payload[index++];
-    freq |= payload[index++] << 8;
-    freq |= payload[index++] << 16;
-    freq *= 100;
+    MacCommandCodec::DecodeRxParamSetupReq(payload + index, datarate, drOffset, freq);
 
     if (!CheckRfFrequency(freq)) {
         logInfo("Freq KO");
@@ -560,16 +555,8 @@ uint8_t ChannelPlan_CN470::HandleAdrCommand(const uint8_t* payload, uint8_t inde
     uint8_t nbRep = 0;
 
     status = 0x07;
-    datarate = payload[index++];
-    power = datarate & 0x0F;
-    datarate = (datarate >> 4) & 0x0F;
-
-    mask = payload[index++];
-    mask |= payload[index++] << 8;
-
-    nbRep = payload[index++];
-    ctrl = (nbRep >> 4) & 0x07;
-    nbRep &= 0x0F;
+    MacCommandCodec::DecodeLinkAdrReq(payload + index, datarate, power, mask, ctrl, nbRep);
+    _adr.Stage(_channelMask, payload, index, size);
 
     if (nbRep == 0) {
         nbRep = 1;
@@ -592,35 +579,36 @@ uint8_t ChannelPlan_CN470::HandleAdrCommand(const uint8_t* payload, uint8_t inde
         case 3:
         case 4:
         case 5:
-            SetChannelMask(ctrl, mask);
+            _adr.SetChannelMask(ctrl, mask);
             break;
 
         case 6:
             // enable all 125 kHz channels
-            SetChannelMask(0, 0xFFFF);
-            SetChannelMask(1, 0xFFFF);
-            SetChannelMask(2, 0xFFFF);
-            SetChannelMask(3, 0xFFFF);
-            SetChannelMask(4, 0xFFFF);
-            SetChannelMask(5, 0xFFFF);
+            _adr.SetChannelMask(0, 0xFFFF);
+            _adr.SetChannelMask(1, 0xFFFF);
+            _adr.SetChannelMask(2, 0xFFFF);
+            _adr.SetChannelMask(3, 0xFFFF);
+            _adr.SetChannelMask(4, 0xFFFF);
+            _adr.SetChannelMask(5, 0xFFFF);
             break;
 
         case 7:
         default:
             logWarning("rejecting RFU or unknown control value %d", ctrl);
             status &= 0xFE; // ChannelMask KO
+            _adr.AddStatus(status);
             return LORA_ERROR;
     }
 
     if (GetSettings()->Network.ADREnabled) {
         if (status == 0x07) {
             if (datarate != 0xF)
-                GetSettings()->Session.TxDatarate = datarate;
+                _adr.SetDatarate(datarate);
             if (power != 0xF)
-                GetSettings()->Session.TxPower = TX_POWERS[power];
+                _adr.SetTxPower(TX_POWERS[power]);
 
             logDebug("ADR Set Redundancy %d", nbRep);
-            GetSettings()->Session.Redundancy = nbRep;
+            _adr.SetRedundancy(nbRep);
         }
     } else {
         logDebug("ADR is disabled, DR and Power not changed.");
@@ -628,14 +616,16 @@ uint8_t ChannelPlan_CN470::HandleAdrCommand(const uint8_t* payload, uint8_t inde
 
     logDebug("ADR DR: %u PWR: %u Ctrl: %02x Mask: %04x NbRep: %u Stat: %02x", datarate, power, ctrl, mask, nbRep, status);
 
+    _adr.AddStatus(status);
     return LORA_OK;
 }
 
 uint8_t ChannelPlan_CN470::ValidateAdrConfiguration() {
     uint8_t status = 0x07;
     uint8_t chans_enabled = 0;
-    uint8_t datarate = GetSettings()->Session.TxDatarate;
-    uint8_t power = GetSettings()->Session.TxPower;
+    uint8_t datarate = _adr.GetDatarate(GetSettings()->Session.TxDatarate);
+    uint8_t power = _adr.GetTxPower(GetSettings()->Session.TxPower);
+    const std::vector<uint16_t>& channelMask = _adr.Pending() ? _adr.GetChannelMask() : _channelMask;
 
     if (GetSettings()->Network.ADREnabled) {
         if (datarate > _maxDatarate) {
@@ -648,18 +638,29 @@ uint8_t ChannelPlan_CN470::ValidateAdrConfiguration() {
         }
     }
     // at least 1 125kHz channels must be enabled
-    chans_enabled += CountBits(_channelMask[0]);
-    chans_enabled += CountBits(_channelMask[1]);
-    chans_enabled += CountBits(_channelMask[2]);
-    chans_enabled += CountBits(_channelMask[3]);
-    chans_enabled += CountBits(_channelMask[4]);
-    chans_enabled += CountBits(_channelMask[5]);
+    chans_enabled += CountBits(channelMask[0]);
+    chans_enabled += CountBits(channelMask[1]);
+    chans_enabled += CountBits(channelMask[2]);
+    chans_enabled += CountBits(channelMask[3]);
+    chans_enabled += CountBits(channelMask[4]);
+    chans_enabled += CountBits(channelMask[5]);
 
     if (chans_enabled == 0) {
         logWarning("ADR Channel Mask KO - at least 1 125kHz channel must be enabled");
         status &= 0xFE; // ChannelMask KO
     }
 
+    // the Mac validates once per LinkADRReq block, the block is applied as a whole or not at all
+    if (_adr.Pending()) {
+        status &= _adr.GetStatus();
+
+        if (status == 0x07) {
+            _adr.Commit(this, _channelMask);
+        } else {
+            _adr.Abort();
+        }
+    }
+
     return status;
 }
 
@@ -737,7 +738,10 @@ void lora::ChannelPlan_CN470::EnableDefaultChannels() {
 
 uint8_t ChannelPlan_CN470::GetNextChannel()
 {
+    bool error = false;
+
     if (GetSettings()->Session.AggregatedTimeOffEnd != 0) {
+        PerfStats::Global().CountDutyCycle(LORA_AGGREGATED_DUTY_CYCLE, GetTimeOffAir());
         return LORA_AGGREGATED_DUTY_CYCLE;
     }
 
@@ -748,6 +752,7 @@ uint8_t ChannelPlan_CN470::GetNextChannel()
             int8_t band = GetDutyBand(GetSettings()->Network.TxFrequency);
             logDebug("band: %d freq: %d", band, GetSettings()->Network.TxFrequency);
             if (band != -1 && _dutyBands[band].TimeOffEnd != 0) {
+                PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
                 return LORA_NO_CHANS_ENABLED;
             }
         }
@@ -759,10 +764,11 @@ uint8_t ChannelPlan_CN470::GetNextChannel()
     uint8_t start = 0;
     uint8_t maxChannels = _numChans125k;
     uint8_t nbEnabledChannels = 0;
-    uint8_t *enabledChannels = new uint8_t[maxChannels];
+    uint16_t enabledChannels[6] = { 0 };     // channel mask words, 96 channels at most
 
 
     // Search how many channels are enabled
+    bool held = false;                  // a channel left out only because its duty band is off
     DatarateRange range;
     uint8_t dr_index = GetSettings()->Session.TxDatarate;
     auto now = duration_cast<milliseconds>(_dutyCycleTimer.elapsed_time()).count();
@@ -773,16 +779,25 @@ uint8_t ChannelPlan_CN470::GetNextChannel()
         }
     }
 
-    for (uint8_t i = start; i < start + maxChannels; i++) {
-        range = GetChannel(i).DrRange;
-        // logDebug("chan: %d freq: %d range:%02x", i, GetChannel(i).Frequency, range.Value);
+    // whole words of the channel mask, the channels of a word share their datarate range and
+    // duty band so a word is left out as a whole when either rules it out
+    for (uint8_t word = start / 16; word * 16 < start + maxChannels && word < _channelMask.size(); word++) {
+        uint8_t first = std::max<uint8_t>(start, word * 16);
+        uint8_t end = std::min<uint8_t>(start + maxChannels, word * 16 + 16);
+        uint16_t group = ((1UL << (end - word * 16)) - 1) & ~((1UL << (first - word * 16)) - 1);
+        uint16_t enabled = _channelMask[word] & group;
 
-        if (IsChannelEnabled(i) && (dr_index >= range.Fields.Min && dr_index <= range.Fields.Max)) {
-            int8_t band = GetDutyBand(GetChannel(i).Frequency);
-            // logDebug("band: %d freq: %d", band, _channels[i].Frequency);
-            if (band != -1 && _dutyBands[band].TimeOffEnd == 0) {
-                enabledChannels[nbEnabledChannels++] = i;
-            }
+        range = GetChannel(first).DrRange;
+        if (enabled == 0 || dr_index < range.Fields.Min || dr_index > range.Fields.Max) {
+            continue;
+        }
+
+        int8_t band = GetDutyBand(GetChannel(first).Frequency);
+        if (band != -1 && _dutyBands[band].TimeOffEnd == 0) {
+            enabledChannels[word] = enabled;
+            nbEnabledChannels += CountBits(enabled);
+        } else if (band != -1) {
+            held = true;
         }
     }
 
@@ -792,7 +807,11 @@ uint8_t ChannelPlan_CN470::GetNextChannel()
     int16_t thres = DEFAULT_FREE_CHAN_RSSI_THRESHOLD;
 
     if (nbEnabledChannels == 0) {
-        delete [] enabledChannels;
+        if (held) {
+            PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
+        } else {
+            PerfStats::Global().CountStatus(LORA_NO_CHANS_ENABLED);
+        }
         return LORA_NO_CHANS_ENABLED;
     }
 
@@ -801,29 +820,53 @@ uint8_t ChannelPlan_CN470::GetNextChannel()
         int16_t timeout = 10000;
         Timer tmr;
         tmr.start();
-        auto tm_ms = duration_cast<milliseconds>(_dutyCycleTimer.elapsed_time()).count();
-
-        for (uint8_t j = rand_r(0, nbEnabledChannels - 1); tm_ms < timeout; j++) {
-            tm_ms = duration_cast<milliseconds>(_dutyCycleTimer.elapsed_time()).count();
-            freq = GetChannel(enabledChannels[j]).Frequency;
-
-            if (GetRadio()->IsChannelFree(SxRadio::MODEM_LORA, freq, thres)) {
-                _txChannel = enabledChannels[j];
+        bool channelFree = false;
+
+        while(std::chrono::duration_cast<std::chrono::milliseconds>(tmr.elapsed_time()).count() < timeout)
+        {
+            uint8_t channel = 0;
+            // grab the next channel if any are enabled
+            if(_randomChannel.NextChannel(enabledChannels, 6, &channel)) {
+                freq = GetChannel(channel).Frequency;
+
+                if (GetRadio()->IsChannelFree(SxRadio::MODEM_LORA, freq, thres)) {
+                    _txChannel = channel;
+                    channelFree = true;
+                    break;
+                }
+            }
+            else {
+                error = true;
                 break;
             }
         }
+
+        // every probe in the listen before talk time found its channel busy
+        if (!channelFree && !error) {
+            PerfStats::Global().CountStatus(LORA_LBT_CHANNEL_BUSY);
+            return LORA_LBT_CHANNEL_BUSY;
+        }
     } else {
-        uint8_t j = rand_r(0, nbEnabledChannels - 1);
-        _txChannel = enabledChannels[j];
-        freq = GetChannel(_txChannel).Frequency;
+        uint8_t channel = 0;
+        if(_randomChannel.NextChannel(enabledChannels, 6, &channel))  {
+            _txChannel = channel;
+            freq = GetChannel(_txChannel).Frequency;
+        }
+        else  {
+            error = true;
+        }
     }
 
-    assert(freq != 0);
+    if(error) {
+        logError("Unable to select a random channel");
+    }
+    else {
+        assert(freq != 0);
 
-    logDebug("Using channel %d : %d", _txChannel, freq);
-    GetRadio()->SetChannel(freq);
+        logDebug("Using channel %d : %d", _txChannel, freq);
+        GetRadio()->SetChannel(freq);
+    }
 
-    delete [] enabledChannels;
     return LORA_OK;
 }
 
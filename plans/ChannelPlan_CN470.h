@@ -19,6 +19,7 @@
 #include "Lora.h"
 #include "SxRadio.h"
 #include "ChannelPlan.h"
+#include "AdrTransaction.h"
 #include <vector>
 
 namespace lora {
@@ -230,6 +231,8 @@ namespace lora {
 
             /**
              * Validate the configuration after multiple ADR commands have been applied
+             * While a LinkADRReq block is staged the staged mask, datarate and power are checked,
+             * then the block is committed if every command in it was accepted or dropped if not
              * @return status to be returned in MoteCommand answer
              */
             virtual uint8_t ValidateAdrConfiguration();
@@ -301,6 +304,8 @@ namespace lora {
             static const uint8_t CN470_MAX_PAYLOAD_SIZE[];              //!< List of max payload sizes for each datarate
             static const uint8_t CN470_MAX_PAYLOAD_SIZE_REPEATER[];     //!< List of repeater compatible max payload sizes for each datarate
 
+            AdrTransaction _adr;                                        //!< LinkADRReq block staged until validated
+
             typedef struct __attribute__((packed)) {
                 uint8_t RFU1[5];
                 uint8_t Time[4];
@@ -16,6 +16,8 @@
 ***********************************************************************/
 
 #include "ChannelPlan_IN865.h"
+#include "PerfStats.h"
+#include "MacCommandCodec.h"
 #include "limits.h"
 
 using namespace lora;
@@ -390,14 +392,7 @@ uint8_t ChannelPlan_IN865::HandleRxParamSetup(const uint8_t* payload, uint8_t in
     int8_t drOffset = 0;
     uint32_t freq = 0;
 
-    drOffset = payload[index++];
-    datarate = drOffset & 0x0F;
-    drOffset = (drOffset >> 4) & 0x07;
-
-    freq = payload[index++];
-    freq |= payload[index++] << 8;
-    freq |= payload[index++] << 16;
-    freq *= 100;
+    MacCommandCodec::DecodeRxParamSetupReq(payload + index, datarate, drOffset, freq);
 
     if (!CheckRfFrequency(freq)) {
         logInfo("Freq KO");
@@ -545,16 +540,7 @@ uint8_t ChannelPlan_IN865::HandleAdrCommand(const uint8_t* payload, uint8_t inde
     uint8_t nbRep = 0;
 
     status = 0x07;
-    datarate = payload[index++];
-    power = datarate & 0x0F;
-    datarate = (datarate >> 4) & 0x0F;
-
-    mask = payload[index++];
-    mask |= payload[index++] << 8;
-
-    nbRep = payload[index++];
-    ctrl = (nbRep >> 4) & 0x07;
-    nbRep &= 0x0F;
+    MacCommandCodec::DecodeLinkAdrReq(payload + index, datarate, power, mask, ctrl, nbRep);
 
     if (nbRep == 0) {
         nbRep = 1;
@@ -764,6 +750,7 @@ uint8_t ChannelPlan_IN865::GetNextChannel()
     bool error = false;
 
     if (GetSettings()->Session.AggregatedTimeOffEnd != 0) {
+        PerfStats::Global().CountDutyCycle(LORA_AGGREGATED_DUTY_CYCLE, GetTimeOffAir());
         return LORA_AGGREGATED_DUTY_CYCLE;
     }
 
@@ -774,6 +761,7 @@ uint8_t ChannelPlan_IN865::GetNextChannel()
             int8_t band = GetDutyBand(GetSettings()->Network.TxFrequency);
             logDebug("band: %d freq: %d", band, GetSettings()->Network.TxFrequency);
             if (band != -1 && _dutyBands[band].TimeOffEnd != 0) {
+                PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
                 return LORA_NO_CHANS_ENABLED;
             }
         }
@@ -793,6 +781,7 @@ uint8_t ChannelPlan_IN865::GetNextChannel()
     }
 
 // Search how many channels are enabled
+    bool held = false;                  // a channel left out only because its duty band is off
     DatarateRange range;
     uint8_t dr_index = GetSettings()->Session.TxDatarate;
     auto now = duration_cast<milliseconds>(_dutyCycleTimer.elapsed_time()).count();
@@ -812,6 +801,8 @@ uint8_t ChannelPlan_IN865::GetNextChannel()
             // logDebug("band: %d freq: %d", band, _channels[i].Frequency);
             if (band != -1 && _dutyBands[band].TimeOffEnd == 0) {
                 enabledChannels[nbEnabledChannels++] = i;
+            } else if (band != -1) {
+                held = true;
             }
         }
     }
@@ -823,6 +814,11 @@ uint8_t ChannelPlan_IN865::GetNextChannel()
 
     if (nbEnabledChannels == 0) {
         delete [] enabledChannels;
+        if (held) {
+            PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
+        } else {
+            PerfStats::Global().CountStatus(LORA_NO_CHANS_ENABLED);
+        }
         return LORA_NO_CHANS_ENABLED;
     }
 
@@ -831,6 +827,7 @@ uint8_t ChannelPlan_IN865::GetNextChannel()
         int16_t timeout = 10000;
         Timer tmr;
         tmr.start();
+        bool channelFree = false;
 
         while(std::chrono::duration_cast<std::chrono::milliseconds>(tmr.elapsed_time()).count() < timeout)
         {
@@ -841,13 +838,22 @@ uint8_t ChannelPlan_IN865::GetNextChannel()
 
                 if (GetRadio()->IsChannelFree(SxRadio::MODEM_LORA, freq, thres)) {
                     _txChannel = channel;
+                    channelFree = true;
                     break;
                 }
             }
             else {
             	error = true;
+            	break;
             }
         }
+
+        // every probe in the listen before talk time found its channel busy
+        if (!channelFree && !error) {
+            delete [] enabledChannels;
+            PerfStats::Global().CountStatus(LORA_LBT_CHANNEL_BUSY);
+            return LORA_LBT_CHANNEL_BUSY;
+        }
     } else {
         uint8_t channel = 0;
         if(_randomChannel.NextChannel(enabledChannels, nbEnabledChannels, &channel))  {
@@ -16,6 +16,8 @@
 ***********************************************************************/
 
 #include "ChannelPlan_KR920.h"
+#include "PerfStats.h"
+#include "MacCommandCodec.h"
 #include "limits.h"
 
 using namespace lora;
@@ -367,14 +369,7 @@ uint8_t ChannelPlan_KR920::HandleRxParamSetup(const uint8_t* payload, uint8_t in
     int8_t drOffset = 0;
     uint32_t freq = 0;
 
-    drOffset = payload[index++];
-    datarate = drOffset & 0x0F;
-    drOffset = (drOffset >> 4) & 0x07;
-
-    freq = payload[index++];
-    freq |= payload[index++] << 8;
-    freq |= payload[index++] << 16;
-    freq *= 100;
+    MacCommandCodec::DecodeRxParamSetupReq(payload + index, datarate, drOffset, freq);
 
     if (!CheckRfFrequency(freq)) {
         logInfo("Freq KO");
@@ -522,16 +517,7 @@ uint8_t ChannelPlan_KR920::HandleAdrCommand(const uint8_t* payload, uint8_t inde
     uint8_t nbRep = 0;
 
     status = 0x07;
-    datarate = payload[index++];
-    power = datarate & 0x0F;
-    datarate = (datarate >> 4) & 0x0F;
-
-    mask = payload[index++];
-    mask |= payload[index++] << 8;
-
-    nbRep = payload[index++];
-    ctrl = (nbRep >> 4) & 0x07;
-    nbRep &= 0x0F;
+    MacCommandCodec::DecodeLinkAdrReq(payload + index, datarate, power, mask, ctrl, nbRep);
 
     if (nbRep == 0) {
         nbRep = 1;
@@ -742,6 +728,7 @@ uint8_t ChannelPlan_KR920::GetNextChannel()
 	bool error = false;
 
     if (GetSettings()->Session.AggregatedTimeOffEnd != 0) {
+        PerfStats::Global().CountDutyCycle(LORA_AGGREGATED_DUTY_CYCLE, GetTimeOffAir());
         return LORA_AGGREGATED_DUTY_CYCLE;
     }
 
@@ -752,6 +739,7 @@ uint8_t ChannelPlan_KR920::GetNextChannel()
             int8_t band = GetDutyBand(GetSettings()->Network.TxFrequency);
             logDebug("band: %d freq: %d", band, GetSettings()->Network.TxFrequency);
             if (band != -1 && _dutyBands[band].TimeOffEnd != 0) {
+                PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
                 return LORA_NO_CHANS_ENABLED;
             }
         }
@@ -771,6 +759,7 @@ uint8_t ChannelPlan_KR920::GetNextChannel()
     }
 
 // Search how many channels are enabled
+    bool held = false;                  // a channel left out only because its duty band is off
     DatarateRange range;
     uint8_t dr_index = GetSettings()->Session.TxDatarate;
     auto now = duration_cast<milliseconds>(_dutyCycleTimer.elapsed_time()).count();
@@ -790,6 +779,8 @@ uint8_t ChannelPlan_KR920::GetNextChannel()
             // logDebug("band: %d freq: %d", band, _channels[i].Frequency);
             if (band != -1 && _dutyBands[band].TimeOffEnd == 0) {
                 enabledChannels[nbEnabledChannels++] = i;
+            } else if (band != -1) {
+                held = true;
             }
         }
     }
@@ -801,6 +792,11 @@ uint8_t ChannelPlan_KR920::GetNextChannel()
 
     if (nbEnabledChannels == 0) {
         delete [] enabledChannels;
+        if (held) {
+            PerfStats::Global().CountDutyCycle(LORA_NO_FREE_CHAN, GetTimeOffAir());
+        } else {
+            PerfStats::Global().CountStatus(LORA_NO_CHANS_ENABLED);
+        }
         return LORA_NO_CHANS_ENABLED;
     }
 
@@ -809,17 +805,27 @@ uint8_t ChannelPlan_KR920::GetNextChannel()
         int16_t timeout = 10000;
         Timer tmr;
         tmr.start();
-        auto tm_ms = duration_cast<milliseconds>(_dutyCycleTimer.elapsed_time()).count();
+        bool channelFree = false;
+        auto tm_ms = duration_cast<milliseconds>(tmr.elapsed_time()).count();
 
-        for (uint8_t j = rand_r(0, nbEnabledChannels - 1); tm_ms < timeout; j++) {
-            tm_ms = duration_cast<milliseconds>(_dutyCycleTimer.elapsed_time()).count();
+        // probe the enabled channels in turn from a random one
+        for (uint8_t j = rand_r(0, nbEnabledChannels - 1); tm_ms < timeout; j = (j + 1) % nbEnabledChannels) {
+            tm_ms = duration_cast<milliseconds>(tmr.elapsed_time()).count();
             freq = GetChannel(enabledChannels[j]).Frequency;
 
             if (GetRadio()->IsChannelFree(SxRadio::MODEM_LORA, freq, thres)) {
                 _txChannel = enabledChannels[j];
+                channelFree = true;
                 break;
             }
         }
+
+        // every probe in the listen before talk time found its channel busy
+        if (!channelFree && !error) {
+            delete [] enabledChannels;
+            PerfStats::Global().CountStatus(LORA_LBT_CHANNEL_BUSY);
+            return LORA_LBT_CHANNEL_BUSY;
+        }
     } else {
         uint8_t channel = 0;
         if(_randomChannel.NextChannel(enabledChannels, nbEnabledChannels, &channel))  {
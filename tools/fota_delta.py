@@ -0,0 +1,289 @@
+#!/usr/bin/env python3
+"""
+Build delta firmware images for FOTA.
+
+The patch is applied on the device by DeltaPatch (Fota/Fragmentation/DeltaPatch.h)
+against the running application.  Send the patch file in place of the full
+image through the fragmentation session.
+
+    fota_delta.py diff old.bin new.bin patch.bin
+    fota_delta.py apply old.bin patch.bin out.bin
+    fota_delta.py selftest
+    fota_delta.py fixtures dir
+
+Format, all integers little endian:
+    "MTD2", u32 old size, u32 new size, u64 crc64 of old image, u64 crc64 of new image
+    records of
+        varint copy length                bytes copied unchanged from the old cursor
+        varint extra length, extra bytes  copied as is
+        zigzag varint seek                move of the old cursor
+"""
+
+import argparse
+import os
+import random
+import struct
+import sys
+
+MAGIC = b"MTD2"
+BLOCK = 8           # bytes hashed to find matches
+MAX_CANDIDATES = 16 # old offsets tried per hash
+
+
+def _crc64_table():
+    poly = 0x95AC9329AC4BC9B5
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ poly if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+
+_CRC64_TABLE = _crc64_table()
+
+
+def crc64(data, crc=0):
+    """crc64 as in the library (Jones polynomial, reflected, no final xor)"""
+    table = _CRC64_TABLE
+    for b in data:
+        crc = table[(crc ^ b) & 0xFF] ^ (crc >> 8)
+    return crc
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return value << 1 if value >= 0 else ((-value) << 1) - 1
+
+
+def _index(old):
+    index = {}
+    for pos in range(0, len(old) - BLOCK + 1):
+        key = old[pos:pos + BLOCK]
+        slots = index.get(key)
+        if slots is None:
+            index[key] = [pos]
+        elif len(slots) < MAX_CANDIDATES:
+            slots.append(pos)
+    return index
+
+
+def _match_length(old, new, o, n):
+    length = 0
+    limit = min(len(old) - o, len(new) - n)
+    while length < limit and old[o + length] == new[n + length]:
+        length += 1
+    return length
+
+
+def _matches(old, new):
+    index = _index(old)
+    matches = []
+    pos = 0
+    last_old = 0
+    while pos + BLOCK <= len(new):
+        candidates = index.get(new[pos:pos + BLOCK])
+        if not candidates:
+            pos += 1
+            continue
+        best_len = 0
+        best_old = 0
+        # prefer continuing where the previous match left off, code moves in blocks
+        for o in [last_old] + candidates:
+            if o + BLOCK > len(old):
+                continue
+            length = _match_length(old, new, o, pos)
+            if length > best_len:
+                best_len, best_old = length, o
+        if best_len < BLOCK:
+            pos += 1
+            continue
+        matches.append((pos, best_old, best_len))
+        pos += best_len
+        last_old = best_old + best_len
+    return matches
+
+
+def diff(old, new):
+    out = bytearray(MAGIC)
+    out += struct.pack("<IIQQ", len(old), len(new), crc64(old), crc64(new))
+
+    if not new:
+        return bytes(out)
+
+    matches = _matches(old, new)
+    cursor = 0
+    written = 0
+
+    def record(copy, extra, next_old):
+        nonlocal cursor
+        out.extend(varint(copy))
+        out.extend(varint(len(extra)))
+        out.extend(extra)
+        out.extend(varint(zigzag(next_old - cursor - copy)))
+        cursor = next_old
+
+    # literal bytes before the first match
+    first = matches[0] if matches else (len(new), 0, 0)
+    record(0, new[:first[0]], first[1])
+    written = first[0]
+
+    for i, (n, o, length) in enumerate(matches):
+        following = matches[i + 1] if i + 1 < len(matches) else (len(new), o + length, 0)
+        record(length, new[n + length:following[0]], following[1])
+        written = following[0]
+
+    assert written == len(new)
+    return bytes(out)
+
+
+def _read_varint(patch, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = patch[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+
+
+def apply(old, patch):
+    """reference applier, mirrors DeltaPatch::apply()"""
+    if patch[:4] != MAGIC:
+        raise ValueError("bad magic")
+    old_size, new_size, old_crc, new_crc = struct.unpack_from("<IIQQ", patch, 4)
+    if old_size != len(old) or crc64(old) != old_crc:
+        raise ValueError("patch made for a different image")
+
+    out = bytearray()
+    pos = 28
+    cursor = 0
+    while len(out) < new_size:
+        length, pos = _read_varint(patch, pos)
+        if cursor + length > len(old):
+            raise ValueError("record out of range")
+        out.extend(old[cursor:cursor + length])
+        cursor += length
+        length, pos = _read_varint(patch, pos)
+        out.extend(patch[pos:pos + length])
+        pos += length
+        seek, pos = _read_varint(patch, pos)
+        cursor += (seek >> 1) ^ -(seek & 1)
+        if not 0 <= cursor <= len(old) or len(out) > new_size:
+            raise ValueError("record out of range")
+    if crc64(out) != new_crc:
+        raise ValueError("patch rebuilt a different image")
+    return bytes(out)
+
+
+def _mutate(rng, image):
+    """a plausible next build: a few edited functions, inserted code, shifted addresses"""
+    new = bytearray(image)
+    for _ in range(rng.randint(3, 8)):
+        at = rng.randrange(len(new))
+        size = rng.randint(16, 1024)
+        new[at:at] = bytes(rng.getrandbits(8) for _ in range(size))
+    for _ in range(rng.randint(20, 60)):
+        at = rng.randrange(len(new) - 4)
+        new[at:at + 4] = struct.pack("<I", rng.getrandbits(32))
+    return bytes(new)
+
+
+def selftest():
+    rng = random.Random(1)
+    ok = True
+    same = bytes(rng.getrandbits(8) for _ in range(4096))
+    cases = [
+        ("empty", b"", b""),
+        ("grow from empty", b"", bytes(range(256)) * 4),
+        ("identical", same, same),
+    ]
+
+    # code like content: instruction words drawn from a small vocabulary
+    words = [struct.pack("<I", rng.getrandbits(32)) for _ in range(512)]
+    for size in (16 * 1024, 128 * 1024):
+        base = b"".join(rng.choice(words) for _ in range(size // 4))
+        cases.append(("%dk build" % (size // 1024), base, _mutate(rng, base)))
+
+    for name, old, new in cases:
+        patch = diff(old, new)
+        good = apply(old, patch) == new
+        ok &= good
+        ratio = 100.0 * len(patch) / len(new) if new else 0
+        print("%-16s old %7d new %7d patch %7d  %5.1f%%  %s" %
+              (name, len(old), len(new), len(patch), ratio, "ok" if good else "FAIL"))
+    return 0 if ok else 1
+
+
+def fixtures(path):
+    """old.bin, new.bin and the patch between them for the host tests in Sim"""
+    rng = random.Random(2)
+    words = [struct.pack("<I", rng.getrandbits(32)) for _ in range(512)]
+    old = b"".join(rng.choice(words) for _ in range(16 * 1024 // 4))
+    new = _mutate(rng, old)
+    patch = diff(old, new)
+    if apply(old, patch) != new:
+        print("patch does not reproduce the new build", file=sys.stderr)
+        return 1
+    if not os.path.isdir(path):
+        os.makedirs(path)
+    for name, data in (("old.bin", old), ("new.bin", new), ("patch.bin", patch)):
+        open(os.path.join(path, name), "wb").write(data)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    sub = parser.add_subparsers(dest="command")
+    p = sub.add_parser("diff", help="make a patch from old to new")
+    p.add_argument("old")
+    p.add_argument("new")
+    p.add_argument("patch")
+    p = sub.add_parser("apply", help="apply a patch on the host")
+    p.add_argument("old")
+    p.add_argument("patch")
+    p.add_argument("out")
+    sub.add_parser("selftest", help="round trip synthetic builds and print patch ratios")
+    p = sub.add_parser("fixtures", help="write old.bin, new.bin and patch.bin of a synthetic build")
+    p.add_argument("dir")
+    args = parser.parse_args()
+
+    if args.command == "diff":
+        old = open(args.old, "rb").read()
+        new = open(args.new, "rb").read()
+        patch = diff(old, new)
+        if apply(old, patch) != new:
+            print("patch does not reproduce %s" % args.new, file=sys.stderr)
+            return 1
+        open(args.patch, "wb").write(patch)
+        print("%s: %d bytes, %.1f%% of %s" %
+              (args.patch, len(patch), 100.0 * len(patch) / max(len(new), 1), os.path.basename(args.new)))
+        return 0
+    if args.command == "apply":
+        old = open(args.old, "rb").read()
+        open(args.out, "wb").write(apply(old, open(args.patch, "rb").read()))
+        return 0
+    if args.command == "selftest":
+        return selftest()
+    if args.command == "fixtures":
+        return fixtures(args.dir)
+    parser.print_help()
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""
+Compress firmware images for FOTA.
+
+The image is expanded on the device by LzDecoder (Fota/Fragmentation/LzDecoder.h)
+into the upgrade file.  Send the compressed file in place of the full image
+through the fragmentation session, fewer bytes means fewer fragments.
+
+    fota_lz.py compress image.bin image.lz [--window-bits 10]
+    fota_lz.py decompress image.lz image.bin
+    fota_lz.py bench image.bin [more.bin ...]
+    fota_lz.py selftest
+    fota_lz.py fixtures dir
+
+Format, all integers little endian:
+    "MTZ1", u32 uncompressed size, u8 window bits
+    sequences of
+        token       literal count << 4 | (match length - 3)
+        [count]     a nibble of 15 continues with bytes added until one is below 255
+        literals
+        u16 offset  distance back into the output, 1 to window size
+        [length]
+    the last sequence ends after its literals
+"""
+
+import argparse
+import os
+import random
+import struct
+import sys
+import time
+
+MAGIC = b"MTZ1"
+MIN_MATCH = 3
+MAX_CHAIN = 64      # earlier positions tried per hash
+
+
+def _length_bytes(value):
+    out = bytearray()
+    while value >= 255:
+        out.append(255)
+        value -= 255
+    out.append(value)
+    return out
+
+
+def _sequence(out, literals, offset, length):
+    lit = len(literals)
+    token = min(lit, 15) << 4
+    if offset:
+        token |= min(length - MIN_MATCH, 15)
+    out.append(token)
+    if lit >= 15:
+        out += _length_bytes(lit - 15)
+    out += literals
+    if offset:
+        out += struct.pack("<H", offset)
+        if length - MIN_MATCH >= 15:
+            out += _length_bytes(length - MIN_MATCH - 15)
+
+
+def compress(data, window_bits=10):
+    if not 1 <= window_bits <= 16:
+        raise ValueError("window bits must be 1 to 16")
+    window = 1 << window_bits
+    out = bytearray(MAGIC)
+    out += struct.pack("<IB", len(data), window_bits)
+
+    head = {}
+    prev = [0] * len(data)
+
+    def insert(i):
+        if i + MIN_MATCH <= len(data):
+            key = data[i:i + MIN_MATCH]
+            prev[i] = head.get(key, -1)
+            head[key] = i
+
+    def longest(i):
+        best_len = 0
+        best_off = 0
+        if i + MIN_MATCH > len(data):
+            return 0, 0
+        cand = head.get(data[i:i + MIN_MATCH], -1)
+        chain = MAX_CHAIN
+        limit = len(data) - i
+        while cand >= 0 and i - cand <= window and chain:
+            length = 0
+            while length < limit and data[cand + length] == data[i + length]:
+                length += 1
+            if length > best_len:
+                best_len, best_off = length, i - cand
+                if length == limit:
+                    break
+            cand = prev[cand]
+            chain -= 1
+        return best_len, best_off
+
+    pos = 0
+    literal_start = 0
+    while pos < len(data):
+        length, offset = longest(pos)
+        insert(pos)
+        if length < MIN_MATCH:
+            pos += 1
+            continue
+        # lazy match, a longer match one byte later is worth a literal
+        if longest(pos + 1)[0] > length + 1:
+            pos += 1
+            continue
+        _sequence(out, data[literal_start:pos], offset, length)
+        for i in range(pos + 1, pos + length):
+            insert(i)
+        pos += length
+        literal_start = pos
+
+    if literal_start < len(data):
+        _sequence(out, data[literal_start:], 0, 0)
+    return bytes(out)
+
+
+def _read_length(data, pos, value):
+    if value < 15:
+        return value, pos
+    while True:
+        byte = data[pos]
+        pos += 1
+        value += byte
+        if byte != 255:
+            return value, pos
+
+
+def decompress(data):
+    """reference decoder, mirrors LzDecoder::decode()"""
+    if data[:4] != MAGIC:
+        raise ValueError("bad magic")
+    size, window_bits = struct.unpack_from("<IB", data, 4)
+    window = 1 << window_bits
+    out = bytearray()
+    pos = 9
+    while len(out) < size:
+        token = data[pos]
+        pos += 1
+        lit, pos = _read_length(data, pos, token >> 4)
+        out += data[pos:pos + lit]
+        pos += lit
+        if len(out) >= size:
+            break
+        offset = struct.unpack_from("<H", data, pos)[0]
+        pos += 2
+        if not 0 < offset <= min(window, len(out)):
+            raise ValueError("offset outside the window")
+        length, pos = _read_length(data, pos, token & 0x0F)
+        for _ in range(length + MIN_MATCH):
+            out.append(out[-offset])
+    if len(out) != size:
+        raise ValueError("stream longer than the image")
+    return bytes(out)
+
+
+def bench(paths, window_bits):
+    for path in paths:
+        data = open(path, "rb").read()
+        start = time.time()
+        packed = compress(data, window_bits)
+        packed_time = time.time() - start
+        start = time.time()
+        ok = decompress(packed) == data
+        unpacked_time = time.time() - start
+        print("%-24s %8d -> %8d  %5.1f%%  compress %.2fs  decompress %.2fs  %s" %
+              (path[-24:], len(data), len(packed), 100.0 * len(packed) / max(len(data), 1),
+               packed_time, unpacked_time, "ok" if ok else "FAIL"))
+
+
+def selftest():
+    rng = random.Random(1)
+    words = [struct.pack("<I", rng.getrandbits(32)) for _ in range(512)]
+    code = b"".join(rng.choice(words) for _ in range(16 * 1024))
+    cases = [
+        ("empty", b""),
+        ("one byte", b"x"),
+        ("run", b"\xff" * 5000),
+        ("random", bytes(rng.getrandbits(8) for _ in range(4096))),
+        ("code like", code),
+        ("erased tail", code[:8192] + b"\xff" * 8192),
+    ]
+    ok = True
+    for bits in (8, 10):
+        for name, data in cases:
+            packed = compress(data, bits)
+            good = decompress(packed) == data
+            ok &= good
+            print("window %4d %-12s %7d -> %7d  %5.1f%%  %s" %
+                  (1 << bits, name, len(data), len(packed), 100.0 * len(packed) / max(len(data), 1),
+                   "ok" if good else "FAIL"))
+    return 0 if ok else 1
+
+
+def fixtures(path):
+    """image.bin and image.lz of a synthetic build for the host tests in Sim"""
+    rng = random.Random(3)
+    words = [struct.pack("<I", rng.getrandbits(32)) for _ in range(512)]
+    code = b"".join(rng.choice(words) for _ in range(12 * 1024 // 4))
+    # literals long enough for the extended count, and an erased tail for long overlapping matches
+    image = code[:6144] + bytes(rng.getrandbits(8) for _ in range(600)) + code[6144:] + b"\xff" * 4096
+    packed = compress(image)
+    if decompress(packed) != image:
+        print("compressed image does not expand to the image", file=sys.stderr)
+        return 1
+    if not os.path.isdir(path):
+        os.makedirs(path)
+    for name, data in (("image.bin", image), ("image.lz", packed)):
+        open(os.path.join(path, name), "wb").write(data)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    sub = parser.add_subparsers(dest="command")
+    p = sub.add_parser("compress", help="compress an image")
+    p.add_argument("image")
+    p.add_argument("out")
+    p.add_argument("--window-bits", type=int, default=10, help="must not exceed LZ_WINDOW_BITS of the device")
+    p = sub.add_parser("decompress", help="expand an image on the host")
+    p.add_argument("packed")
+    p.add_argument("out")
+    p = sub.add_parser("bench", help="print compression ratio and time for images")
+    p.add_argument("images", nargs="+")
+    p.add_argument("--window-bits", type=int, default=10)
+    sub.add_parser("selftest", help="round trip synthetic images")
+    p = sub.add_parser("fixtures", help="write image.bin and image.lz of a synthetic build")
+    p.add_argument("dir")
+    args = parser.parse_args()
+
+    if args.command == "compress":
+        data = open(args.image, "rb").read()
+        packed = compress(data, args.window_bits)
+        if decompress(packed) != data:
+            print("compressed image does not expand to %s" % args.image, file=sys.stderr)
+            return 1
+        open(args.out, "wb").write(packed)
+        print("%s: %d bytes, %.1f%% of %d" % (args.out, len(packed), 100.0 * len(packed) / max(len(data), 1), len(data)))
+        return 0
+    if args.command == "decompress":
+        open(args.out, "wb").write(decompress(open(args.packed, "rb").read()))
+        return 0
+    if args.command == "bench":
+        bench(args.images, args.window_bits)
+        return 0
+    if args.command == "selftest":
+        return selftest()
+    if args.command == "fixtures":
+        return fixtures(args.dir)
+    parser.print_help()
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
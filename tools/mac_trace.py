@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""
+Render a lora::TraceRing dump as a Chrome trace or as text.
+
+Load the JSON in chrome://tracing or https://ui.perfetto.dev to see MAC and link
+states, radio TX and RX slices and the MAC event callbacks on one timeline.
+
+    mac_trace.py chrome dump.bin trace.json
+    mac_trace.py chrome --hex 4d54540140420f00... trace.json
+    mac_trace.py text dump.bin
+
+Format (TraceRing::Dump in TraceRing.h), integers little endian:
+    "MTT", u8 version, u32 tick rate, u32 first position, u32 record count
+    per record: u32 time, u8 event, u8 arg8, u16 arg16, u32 arg32
+Timestamps are free running and wrap at 2^32 ticks.  Records are in order, so the
+wraps are undone as long as no two records are more than one wrap apart.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"MTT"
+VERSION = 1
+
+MAC_STATES = ["IDLE", "RX1", "RX2", "RXC", "TX", "JOIN", "ERROR"]
+LINK_STATES = ["IDLE", "TX", "ACK_TX", "REP_TX", "RX", "RX1", "RX2", "RXC", "RX_BEACON", "RX_PING", "P2P"]
+
+NONE, MAC_STATE, LINK_STATE, SET_CHANNEL, SET_RX_CONFIG, SET_TX_CONFIG, SEND, RX, SLEEP, STANDBY, \
+    TX_START, TX_DONE, TX_TIMEOUT, RX_DONE, RX_TIMEOUT, RX_ERROR = range(16)
+USER = 0x80
+
+EVENT_NAMES = {
+    MAC_STATE: "MacState",
+    LINK_STATE: "LinkState",
+    SET_CHANNEL: "SetChannel",
+    SET_RX_CONFIG: "SetRxConfig",
+    SET_TX_CONFIG: "SetTxConfig",
+    SEND: "Send",
+    RX: "Rx",
+    SLEEP: "Sleep",
+    STANDBY: "Standby",
+    TX_START: "TxStart",
+    TX_DONE: "TxDone",
+    TX_TIMEOUT: "TxTimeout",
+    RX_DONE: "RxDone",
+    RX_TIMEOUT: "RxTimeout",
+    RX_ERROR: "RxError",
+}
+
+# Chrome trace thread ids, one track each
+TRACK_MAC, TRACK_LINK, TRACK_RADIO, TRACK_EVENTS, TRACK_USER = 1, 2, 3, 4, 5
+TRACK_NAMES = {
+    TRACK_MAC: "MAC state",
+    TRACK_LINK: "Link state",
+    TRACK_RADIO: "Radio",
+    TRACK_EVENTS: "MAC events",
+    TRACK_USER: "Application",
+}
+
+
+def int16(value):
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def int32(value):
+    return value - 0x100000000 if value & 0x80000000 else value
+
+
+def parse(data):
+    if len(data) < 16 or data[:3] != MAGIC:
+        raise ValueError("not a trace dump")
+    if data[3] != VERSION:
+        raise ValueError("unsupported dump version %d" % data[3])
+
+    rate, first, count = struct.unpack_from("<III", data, 4)
+    if len(data) != 16 + count * 12:
+        raise ValueError("dump holds %d bytes, header says %d records" % (len(data), count))
+
+    records = []
+    base = 0
+    last = None
+    for i in range(count):
+        time, event, arg8, arg16, arg32 = struct.unpack_from("<IBBHI", data, 16 + i * 12)
+        if last is not None and time < last:
+            base += 1 << 32
+        last = time
+        records.append({
+            "us": (base + time) * 1e6 / rate,
+            "event": event,
+            "arg8": arg8,
+            "arg16": arg16,
+            "arg32": arg32,
+        })
+
+    return {"rate": rate, "first": first, "records": records}
+
+
+def state_name(names, value):
+    return names[value] if value < len(names) else str(value)
+
+
+def describe(record):
+    event = record["event"]
+    arg8, arg16, arg32 = record["arg8"], record["arg16"], record["arg32"]
+
+    if event == MAC_STATE:
+        return "MacState %s" % state_name(MAC_STATES, arg8), {}
+    if event == LINK_STATE:
+        return "LinkState %s" % state_name(LINK_STATES, arg8), {}
+    if event == SET_CHANNEL:
+        return "SetChannel", {"frequency": arg32}
+    if event == SET_RX_CONFIG:
+        return "SetRxConfig", {"sf": arg8, "bandwidth": arg16, "symbol_timeout": arg32}
+    if event == SET_TX_CONFIG:
+        return "SetTxConfig", {"sf": arg8, "bandwidth": arg16, "power": int32(arg32)}
+    if event == SEND:
+        return "Send", {"size": arg8}
+    if event == RX:
+        return "Rx", {"timeout_us": arg32}
+    if event == TX_DONE:
+        return "TxDone", {"datarate": arg8}
+    if event == RX_DONE:
+        return "RxDone", {"slot": arg8, "size": arg16, "rssi": int16(arg32 & 0xFFFF), "snr": int16(arg32 >> 16)}
+    if event in (RX_TIMEOUT, RX_ERROR):
+        return EVENT_NAMES[event], {"slot": arg8}
+    if event >= USER:
+        return "User %d" % (event - USER), {"arg8": arg8, "arg16": arg16, "arg32": arg32}
+    return EVENT_NAMES.get(event, "Event %d" % event), {}
+
+
+def chrome(trace):
+    events = []
+    for tid, name in TRACK_NAMES.items():
+        events.append({"ph": "M", "name": "thread_name", "pid": 1, "tid": tid, "args": {"name": name}})
+
+    records = trace["records"]
+    end = records[-1]["us"] if records else 0
+    open_state = {TRACK_MAC: None, TRACK_LINK: None}
+    radio = None        # (name, start, args) of the TX or RX slice in progress
+
+    def close_state(tid, now):
+        state = open_state[tid]
+        if state is not None:
+            events.append({"ph": "X", "name": state[0], "pid": 1, "tid": tid, "ts": state[1], "dur": now - state[1]})
+            open_state[tid] = None
+
+    def close_radio(now, outcome):
+        nonlocal radio
+        if radio is not None:
+            args = dict(radio[2])
+            if outcome is not None:
+                args["outcome"] = outcome
+            events.append({"ph": "X", "name": radio[0], "pid": 1, "tid": TRACK_RADIO, "ts": radio[1], "dur": now - radio[1], "args": args})
+            radio = None
+
+    for record in records:
+        now = record["us"]
+        event = record["event"]
+        name, args = describe(record)
+
+        if event in (MAC_STATE, LINK_STATE):
+            tid = TRACK_MAC if event == MAC_STATE else TRACK_LINK
+            close_state(tid, now)
+            if record["arg8"] != 0:
+                open_state[tid] = (name.split(" ", 1)[1], now)
+            continue
+
+        if event in (SEND, RX):
+            close_radio(now, "aborted")
+            radio = ("TX" if event == SEND else "RX", now, args)
+        elif event in (SLEEP, STANDBY):
+            close_radio(now, "aborted")
+        elif event in (TX_DONE, TX_TIMEOUT) and radio is not None and radio[0] == "TX":
+            close_radio(now, name)
+        elif event in (RX_DONE, RX_TIMEOUT, RX_ERROR) and radio is not None and radio[0] == "RX":
+            close_radio(now, name)
+
+        if event in (SET_CHANNEL, SET_RX_CONFIG, SET_TX_CONFIG, SEND, RX, SLEEP, STANDBY):
+            tid = TRACK_RADIO
+        elif event >= USER:
+            tid = TRACK_USER
+        else:
+            tid = TRACK_EVENTS
+
+        events.append({"ph": "i", "s": "t", "name": name, "pid": 1, "tid": tid, "ts": now, "args": args})
+
+    close_state(TRACK_MAC, end)
+    close_state(TRACK_LINK, end)
+    close_radio(end, None)
+
+    return {"traceEvents": events, "displayTimeUnit": "ms",
+            "otherData": {"tick_rate": trace["rate"], "first_position": trace["first"]}}
+
+
+def text(trace):
+    start = trace["records"][0]["us"] if trace["records"] else 0
+    for record in trace["records"]:
+        name, args = describe(record)
+        details = " ".join("%s=%s" % item for item in args.items())
+        print("%14.3f ms  %-22s %s" % ((record["us"] - start) / 1000.0, name, details))
+
+
+def load(args, parser):
+    if args.hex is not None:
+        return bytes.fromhex(args.hex)
+    if args.dump is not None:
+        with open(args.dump, "rb") as f:
+            return f.read()
+    parser.error("give a dump file or --hex")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    chrome_cmd = commands.add_parser("chrome", help="write Chrome trace JSON")
+    chrome_cmd.add_argument("dump", nargs="?", help="binary dump file")
+    chrome_cmd.add_argument("output", nargs="?", help="JSON file, stdout if omitted")
+    chrome_cmd.add_argument("--hex", help="dump as a hex string")
+
+    text_cmd = commands.add_parser("text", help="print one line per record")
+    text_cmd.add_argument("dump", nargs="?", help="binary dump file")
+    text_cmd.add_argument("--hex", help="dump as a hex string")
+
+    args = parser.parse_args()
+
+    if args.command == "chrome" and args.hex is not None and args.output is None:
+        # with --hex the only positional argument is the output
+        args.output, args.dump = args.dump, None
+
+    try:
+        trace = parse(load(args, parser))
+    except ValueError as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+
+    if args.command == "text":
+        text(trace)
+        return 0
+
+    output = json.dumps(chrome(trace), indent=1)
+    if args.output is None:
+        print(output)
+    else:
+        with open(args.output, "w") as f:
+            f.write(output)
+        print("%d records, %.3f s" % (len(trace["records"]),
+              (trace["records"][-1]["us"] - trace["records"][0]["us"]) / 1e6 if trace["records"] else 0))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""
+Decode the latency histograms and counters written by mDot::dumpPerfStats().
+
+The dump is binary; read it from a file or pass it as hex, e.g. as printed by the
+application over the debug port.
+
+    perf_stats.py decode dump.bin
+    perf_stats.py decode --hex 0106180604...
+    perf_stats.py decode dump.bin --json
+
+Format (lora::PerfStats::Dump in PerfStats.h), integers are unsigned LEB128 varints:
+    u8 version, u8 operations, u8 buckets, u8 bucket shift, u8 counters
+    per operation
+        count, min us, max us, total us, mask of non-empty buckets
+        count of each bucket set in the mask, lowest first
+    per counter
+        value
+Bucket 0 holds samples below 2^shift us, bucket n from 2^(shift + n - 1) us up to
+twice that, the last bucket has no upper limit.
+"""
+
+import argparse
+import json
+import sys
+
+VERSION = 1
+
+OPERATIONS = [
+    "send",
+    "duty cycle wait",
+    "rx window to done",
+    "join",
+    "flash save",
+    "fota fragment",
+]
+
+COUNTERS = [
+    "no channels",
+    "no free channel",
+    "aggregated duty cycle",
+    "lbt busy",
+]
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise ValueError("dump truncated at byte %d" % self.pos)
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.byte()
+            value |= (byte & 0x7F) << shift
+            if not byte & 0x80:
+                return value
+            shift += 7
+
+
+def bucket_range(bucket, shift, buckets):
+    low = 0 if bucket == 0 else 1 << (shift + bucket - 1)
+    high = None if bucket == buckets - 1 else (1 << (shift + bucket)) - 1
+    return low, high
+
+
+def percentile(histogram, shift, buckets, percent):
+    if histogram["count"] == 0:
+        return 0
+    rank = max(1, (histogram["count"] * percent + 99) // 100)
+    seen = 0
+    for bucket, count in sorted(histogram["buckets"].items()):
+        seen += count
+        if seen >= rank:
+            high = bucket_range(bucket, shift, buckets)[1]
+            return histogram["max"] if high is None else min(high, histogram["max"])
+    return histogram["max"]
+
+
+def decode(data):
+    reader = Reader(data)
+    version = reader.byte()
+    if version != VERSION:
+        raise ValueError("unsupported dump version %d" % version)
+
+    operations = reader.byte()
+    buckets = reader.byte()
+    shift = reader.byte()
+    counters = reader.byte()
+
+    result = {"buckets": buckets, "shift": shift, "operations": {}, "counters": {}}
+
+    for op in range(operations):
+        histogram = {
+            "count": reader.varint(),
+            "min": reader.varint(),
+            "max": reader.varint(),
+            "total": reader.varint(),
+            "buckets": {},
+        }
+        mask = reader.varint()
+        for bucket in range(buckets):
+            if mask & (1 << bucket):
+                histogram["buckets"][bucket] = reader.varint()
+        name = OPERATIONS[op] if op < len(OPERATIONS) else "operation %d" % op
+        result["operations"][name] = histogram
+
+    for counter in range(counters):
+        name = COUNTERS[counter] if counter < len(COUNTERS) else "counter %d" % counter
+        result["counters"][name] = reader.varint()
+
+    if reader.pos != len(data):
+        raise ValueError("%d bytes after the dump" % (len(data) - reader.pos))
+
+    return result
+
+
+def report(stats):
+    shift = stats["shift"]
+    buckets = stats["buckets"]
+
+    for name, histogram in stats["operations"].items():
+        if histogram["count"] == 0:
+            continue
+        mean = histogram["total"] // histogram["count"]
+        print("%-16s %8d samples  min %9d  mean %9d  p50 %9d  p95 %9d  max %9d us" % (
+            name, histogram["count"], histogram["min"], mean,
+            percentile(histogram, shift, buckets, 50), percentile(histogram, shift, buckets, 95), histogram["max"]))
+        for bucket, count in sorted(histogram["buckets"].items()):
+            low, high = bucket_range(bucket, shift, buckets)
+            upper = "inf" if high is None else str(high)
+            bar = "#" * max(1, count * 40 // histogram["count"])
+            print("    %9d - %9s us %8d %s" % (low, upper, count, bar))
+
+    for name, value in stats["counters"].items():
+        print("%-24s %d" % (name, value))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    decode_cmd = commands.add_parser("decode", help="print a dump")
+    decode_cmd.add_argument("dump", nargs="?", help="binary dump file")
+    decode_cmd.add_argument("--hex", help="dump as a hex string")
+    decode_cmd.add_argument("--json", action="store_true", help="print JSON instead of a table")
+
+    args = parser.parse_args()
+
+    if args.hex is not None:
+        data = bytes.fromhex(args.hex)
+    elif args.dump is not None:
+        with open(args.dump, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("give a dump file or --hex")
+
+    try:
+        stats = decode(data)
+    except ValueError as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+
+    if args.json:
+        print(json.dumps(stats, indent=2))
+    else:
+        report(stats)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())